@@ -6,9 +6,12 @@
 #include "./av/codec.hpp"
 #include "./av/format.hpp"
 #include "./av/frame.hpp"
+#include "./av/frame_converter.hpp"
 #include "./av/fwd.hpp"
 #include "./av/media_chunk.hpp"
 #include "./av/packet.hpp"
+#include "./av/sample_converter.hpp"
 #include "./av/sample_format.hpp"
+#include "./av/sample_kernels.hpp"
 
 #endif // SHADOW_CAST_AV_HPP_INCLUDED
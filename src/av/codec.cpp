@@ -2,12 +2,61 @@
 #include "av/buffer.hpp"
 #include "error.hpp"
 #include "nvidia.hpp"
+#include "utils/scope_guard.hpp"
 #include <X11/Xlib.h>
+#include <algorithm>
+#include <iterator>
 #include <libavutil/rational.h>
+#include <new>
 extern "C" {
 #include <libavutil/hwcontext_cuda.h>
 }
 
+namespace
+{
+std::string_view const kSoftwareVideoEncoders[] = { "libx264",
+                                                    "libx265",
+                                                    "ffv1" };
+
+/* The format a software encoder takes its frames in. The capture's
+ * own is best, since then nothing needs converting, followed by
+ * packed RGB, which keeps FFV1 lossless, and then 4:2:0...
+ */
+auto software_pixel_format(AVCodec const& codec, AVPixelFormat source_format)
+    -> AVPixelFormat
+{
+    auto const supports = [&](AVPixelFormat format) {
+        for (auto const* p = codec.pix_fmts; p && *p != AV_PIX_FMT_NONE; ++p)
+            if (*p == format)
+                return true;
+
+        return false;
+    };
+
+    for (auto const format :
+         { source_format, AV_PIX_FMT_BGR0, AV_PIX_FMT_YUV420P })
+        if (supports(format))
+            return format;
+
+    throw sc::CodecError { "The video encoder doesn't support any of the "
+                           "captured frame formats" };
+}
+
+/* FFV1 only accepts certain numbers of slices. This is the most of
+ * them that `threads` can encode at once...
+ */
+auto ffv1_slices(int threads) noexcept -> int
+{
+    int const accepted[] = { 4, 6, 9, 12, 16, 24 };
+    auto slices = accepted[0];
+    for (auto const n : accepted)
+        if (n <= threads)
+            slices = n;
+
+    return slices;
+}
+} // namespace
+
 namespace sc
 {
 auto CodecContextDeleter::operator()(AVCodecContext* ptr) noexcept -> void
@@ -20,7 +69,8 @@ auto create_video_encoder(std::string const& encoder_name,
                           AVBufferPool* pool,
                           VideoOutputSize size,
                           FrameTime const& ft,
-                          AVPixelFormat pixel_format) -> sc::CodecContextPtr
+                          AVPixelFormat pixel_format,
+                          std::int64_t bit_rate) -> sc::CodecContextPtr
 {
     sc::BorrowedPtr<AVCodec const> video_encoder { avcodec_find_encoder_by_name(
         encoder_name.c_str()) };
@@ -38,7 +88,7 @@ auto create_video_encoder(std::string const& encoder_name,
     video_encoder_context->sample_aspect_ratio = AVRational { 1, 1 };
     video_encoder_context->max_b_frames = 0;
     video_encoder_context->pix_fmt = AV_PIX_FMT_CUDA;
-    video_encoder_context->bit_rate = 100'000;
+    video_encoder_context->bit_rate = bit_rate ? bit_rate : 100'000;
     video_encoder_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     video_encoder_context->width = size.width;
     video_encoder_context->height = size.height;
@@ -81,7 +131,10 @@ auto create_video_encoder(std::string const& encoder_name,
     video_encoder_context->hw_frames_ctx = av_buffer_ref(frame_context.get());
 
     AVDictionary* options = nullptr;
-    av_dict_set_int(&options, "qp", 21, 0);
+    if (bit_rate)
+        av_dict_set(&options, "rc", "vbr", 0);
+    else
+        av_dict_set_int(&options, "qp", 21, 0);
     av_dict_set(&options, "preset", "p5", 0);
 
     if (auto const ret = avcodec_open2(
@@ -94,4 +147,91 @@ auto create_video_encoder(std::string const& encoder_name,
     return video_encoder_context;
 }
 
+auto is_software_video_encoder(std::string_view encoder_name) -> bool
+{
+    return std::find(std::begin(kSoftwareVideoEncoders),
+                     std::end(kSoftwareVideoEncoders),
+                     encoder_name) != std::end(kSoftwareVideoEncoders);
+}
+
+auto create_software_video_encoder(std::string const& encoder_name,
+                                   VideoOutputSize size,
+                                   FrameTime const& ft,
+                                   AVPixelFormat source_format,
+                                   int threads,
+                                   std::int64_t bit_rate)
+    -> sc::CodecContextPtr
+{
+    sc::BorrowedPtr<AVCodec const> video_encoder { avcodec_find_encoder_by_name(
+        encoder_name.c_str()) };
+    if (!video_encoder) {
+        throw CodecError { "Failed to find video codec: " + encoder_name };
+    }
+
+    sc::CodecContextPtr video_encoder_context { avcodec_alloc_context3(
+        video_encoder.get()) };
+    if (!video_encoder_context)
+        throw std::bad_alloc {};
+
+    video_encoder_context->codec_id = video_encoder->id;
+    auto const timebase = ft.fps_ratio();
+    video_encoder_context->time_base = timebase;
+    video_encoder_context->framerate.num = timebase.den;
+    video_encoder_context->framerate.den = timebase.num;
+    video_encoder_context->sample_aspect_ratio = AVRational { 1, 1 };
+    video_encoder_context->max_b_frames = 0;
+    video_encoder_context->pix_fmt =
+        software_pixel_format(*video_encoder, source_format);
+    video_encoder_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    video_encoder_context->width = size.width;
+    video_encoder_context->height = size.height;
+    video_encoder_context->thread_count = std::max(threads, 1);
+
+    /* `FrameConverter` converts to YUV with the BT.601 coefficients,
+     * in limited range...
+     */
+    if (video_encoder_context->pix_fmt == AV_PIX_FMT_YUV420P) {
+        video_encoder_context->color_range = AVCOL_RANGE_MPEG;
+        video_encoder_context->colorspace = AVCOL_SPC_SMPTE170M;
+    }
+
+    AVDictionary* options = nullptr;
+    SC_SCOPE_GUARD([&] { av_dict_free(&options); });
+
+    if (encoder_name == "ffv1") {
+        /* FFV1 is intra-only, so it's split into slices that are
+         * encoded in parallel...
+         */
+        video_encoder_context->thread_type = FF_THREAD_SLICE;
+        video_encoder_context->level = 3;
+        video_encoder_context->slices = ffv1_slices(threads);
+    }
+    else {
+        /* x264 and x265 encode several frames at once, each on its own
+         * thread...
+         */
+        video_encoder_context->thread_type = FF_THREAD_FRAME;
+        video_encoder_context->bit_rate = bit_rate;
+        if (!bit_rate)
+            av_dict_set_int(&options, "crf", 23, 0);
+        av_dict_set(&options, "preset", "veryfast", 0);
+
+        if (encoder_name == "libx265")
+            av_dict_set(&options,
+                        "x265-params",
+                        ("pools=" + std::to_string(std::max(threads, 1)))
+                            .c_str(),
+                        0);
+    }
+
+    if (auto const ret = avcodec_open2(
+            video_encoder_context.get(), video_encoder.get(), &options);
+        ret < 0) {
+        throw CodecError { "Failed to open video codec: " +
+                           av_error_to_string(ret) };
+    }
+
+    return video_encoder_context;
+}
+
 } // namespace sc
@@ -4,8 +4,10 @@
 #include "av/fwd.hpp"
 #include "display/display.hpp"
 #include "nvidia.hpp"
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace sc
 {
@@ -21,12 +23,39 @@ struct VideoOutputSize
 };
 
 using CodecContextPtr = std::unique_ptr<AVCodecContext, CodecContextDeleter>;
+
+/* Creates an encoder for CUDA frames of `size`. If `bit_rate` is
+ * zero then the encoder targets a constant quality, otherwise it
+ * targets `bit_rate` bits per second...
+ */
 auto create_video_encoder(std::string const& encoder_name,
                           CUcontext cuda_ctx,
                           AVBufferPool* pool,
                           VideoOutputSize size,
                           FrameTime const& ft,
-                          AVPixelFormat pixel_format) -> sc::CodecContextPtr;
+                          AVPixelFormat pixel_format,
+                          std::int64_t bit_rate = 0) -> sc::CodecContextPtr;
+
+/* True if `encoder_name` is one of the encoders that run on the CPU,
+ * rather than NVENC: "libx264", "libx265" or "ffv1"...
+ */
+[[nodiscard]] auto is_software_video_encoder(std::string_view encoder_name)
+    -> bool;
+
+/* Creates a software encoder for system memory frames of `size`,
+ * captured as `source_format`. The encoder takes `source_format` as
+ * it is if it can, otherwise frames must be converted to its
+ * `pix_fmt`, e.g. with a `FrameConverter`. It uses up to `threads`
+ * threads of its own. `bit_rate` is as for `create_video_encoder()`,
+ * except that FFV1 is always lossless...
+ */
+auto create_software_video_encoder(std::string const& encoder_name,
+                                   VideoOutputSize size,
+                                   FrameTime const& ft,
+                                   AVPixelFormat source_format,
+                                   int threads,
+                                   std::int64_t bit_rate = 0)
+    -> sc::CodecContextPtr;
 } // namespace sc
 
 #endif // SHADOW_CAST_AV_CODEC_HPP_INCLUDED
@@ -1,4 +1,71 @@
 #include "av/format.hpp"
+#include "error.hpp"
+#include "utils/scope_guard.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+
+std::size_t constexpr kIOBufferSize = 256 * 1'024;
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+using WriteBuffer = std::uint8_t const*;
+#else
+using WriteBuffer = std::uint8_t*;
+#endif
+
+auto to_averror(std::exception_ptr ex) noexcept -> int
+{
+    try {
+        std::rethrow_exception(ex);
+    }
+    catch (std::system_error const& e) {
+        return AVERROR(e.code().value());
+    }
+    catch (std::bad_alloc const&) {
+        return AVERROR(ENOMEM);
+    }
+    catch (...) {
+        return AVERROR(EIO);
+    }
+}
+
+auto write_packet(void* opaque, WriteBuffer buf, int size) noexcept -> int
+{
+    auto& file = *static_cast<sc::WriteBehindFile*>(opaque);
+    try {
+        file.write(std::span<std::uint8_t const> {
+            buf, static_cast<std::size_t>(size) });
+    }
+    catch (...) {
+        return to_averror(std::current_exception());
+    }
+
+    return size;
+}
+
+auto seek(void* opaque, std::int64_t offset, int whence) noexcept
+    -> std::int64_t
+{
+    auto& file = *static_cast<sc::WriteBehindFile*>(opaque);
+    if (whence & AVSEEK_SIZE)
+        return file.size();
+
+    try {
+        return file.seek(offset, whence & ~AVSEEK_FORCE);
+    }
+    catch (...) {
+        return to_averror(std::current_exception());
+    }
+}
+
+} // namespace
 
 namespace sc
 {
@@ -8,4 +75,103 @@ auto FormatContextDeleter::operator()(AVFormatContext* ptr) noexcept -> void
     avformat_free_context(ptr);
 }
 
+auto DictionaryDeleter::operator()(AVDictionary* ptr) noexcept -> void
+{
+    av_dict_free(&ptr);
+}
+
+auto IOContextDeleter::operator()(AVIOContext* ptr) noexcept -> void
+{
+    av_freep(&ptr->buffer);
+    avio_context_free(&ptr);
+}
+
+auto make_io_context(WriteBehindFile& file) -> IOContextPtr
+{
+    auto* buffer = static_cast<unsigned char*>(av_malloc(kIOBufferSize));
+    if (!buffer)
+        throw std::bad_alloc {};
+
+    IOContextPtr ctx { avio_alloc_context(buffer,
+                                          kIOBufferSize,
+                                          1,
+                                          &file,
+                                          nullptr,
+                                          &write_packet,
+                                          &seek) };
+    if (!ctx) {
+        av_free(buffer);
+        throw std::bad_alloc {};
+    }
+
+    ctx->seekable = AVIO_SEEKABLE_NORMAL;
+    return ctx;
+}
+
+auto write_header(AVFormatContext& format_context,
+                  AVDictionary const* options) -> void
+{
+    AVDictionary* header_options = nullptr;
+    SC_SCOPE_GUARD([&] { av_dict_free(&header_options); });
+    if (auto const ret = av_dict_copy(&header_options, options, 0); ret < 0)
+        throw FormatError { "Failed to copy header options: " +
+                            av_error_to_string(ret) };
+
+    if (auto const ret =
+            avformat_write_header(&format_context, &header_options);
+        ret < 0)
+        throw IOError { "Failed to write header: " +
+                        av_error_to_string(ret) };
+}
+
+auto fragment_options(AVOutputFormat const& format) -> DictionaryPtr
+{
+    std::string_view const name { format.name };
+    AVDictionary* options = nullptr;
+
+    /* The mov muxer normally holds the index of every sample until
+     * the trailer. With these flags it writes an empty index up
+     * front, and a self-contained fragment each time it's
+     * flushed...
+     */
+    if (name == "mp4" || name == "mov" || name == "ipod" || name == "ismv") {
+        if (auto const ret =
+                av_dict_set(&options,
+                            "movflags",
+                            "+frag_custom+empty_moov+default_base_moof",
+                            0);
+            ret < 0)
+            throw FormatError { "Failed to set fragment options: " +
+                                av_error_to_string(ret) };
+
+        return DictionaryPtr { options };
+    }
+
+    /* Matroska is already written as a series of clusters, and
+     * flushing ends the current one...
+     */
+    if (name == "matroska" || name == "webm")
+        return DictionaryPtr { options };
+
+    throw FormatError { "Fragmented output isn't supported by the " +
+                        std::string { name } + " format" };
+}
+
+auto flush_fragment(AVFormatContext& format_context) -> void
+{
+    /* Packets waiting to be interleaved belong in this fragment
+     * too...
+     */
+    if (auto const ret = av_interleaved_write_frame(&format_context, nullptr);
+        ret < 0)
+        throw IOError { "Failed to flush interleaved packets: " +
+                        av_error_to_string(ret) };
+
+    if (auto const ret = av_write_frame(&format_context, nullptr); ret < 0)
+        throw IOError { "Failed to flush fragment: " +
+                        av_error_to_string(ret) };
+
+    avio_flush(format_context.pb);
+}
+
 } // namespace sc
@@ -1,10 +1,12 @@
 #ifndef SHADOW_CAST_AV_FORMAT_HPP_INCLUDED
 #define SHADOW_CAST_AV_FORMAT_HPP_INCLUDED
 
+#include "io/write_behind_file.hpp"
 #include <memory>
 
 extern "C" {
 #include <libavformat/avformat.h>
+#include <libavutil/dict.h>
 }
 
 namespace sc
@@ -17,6 +19,44 @@ struct FormatContextDeleter
 
 using FormatContextPtr = std::unique_ptr<AVFormatContext, FormatContextDeleter>;
 
+struct IOContextDeleter
+{
+    auto operator()(AVIOContext* ptr) noexcept -> void;
+};
+
+using IOContextPtr = std::unique_ptr<AVIOContext, IOContextDeleter>;
+
+struct DictionaryDeleter
+{
+    auto operator()(AVDictionary* ptr) noexcept -> void;
+};
+
+using DictionaryPtr = std::unique_ptr<AVDictionary, DictionaryDeleter>;
+
+/* Creates a seekable, write-only `AVIOContext` that writes to
+ * `file`, which must outlive it. Errors from `file` are returned to
+ * libavformat as `AVERROR` codes...
+ */
+auto make_io_context(WriteBehindFile& file) -> IOContextPtr;
+
+/* Writes the header with a copy of `options`, which may be null, so
+ * the same options can be used for more than one file...
+ */
+auto write_header(AVFormatContext& format_context,
+                  AVDictionary const* options) -> void;
+
+/* Returns the header options that make `format` write its output as
+ * a series of fragments, each one ended by `flush_fragment()`, rather
+ * than keeping an index of the whole file to write at the end.
+ * Throws if `format` can't be fragmented...
+ */
+auto fragment_options(AVOutputFormat const& format) -> DictionaryPtr;
+
+/* Ends the current fragment and passes everything that's been
+ * written so far on to the output's `AVIOContext`...
+ */
+auto flush_fragment(AVFormatContext& format_context) -> void;
+
 } // namespace sc
 
 #endif // SHADOW_CAST_AV_FORMAT_HPP_INCLUDED
@@ -0,0 +1,148 @@
+#include "av/frame_converter.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <iterator>
+#include <new>
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+namespace
+{
+/* Each plane's rows are aligned as `av_malloc()` aligns the buffer,
+ * which is what the encoders' SIMD routines expect...
+ */
+int constexpr kAlignment = 32;
+
+auto make_pool(AVPixelFormat format, int width, int height)
+    -> sc::BufferPoolPtr
+{
+    auto const frame_size =
+        av_image_get_buffer_size(format, width, height, kAlignment);
+    if (frame_size < 0)
+        throw sc::CodecError { "Unsupported software frame format: " +
+                               sc::av_error_to_string(frame_size) };
+
+    sc::BufferPoolPtr pool { av_buffer_pool_init(
+        static_cast<std::size_t>(frame_size), nullptr) };
+    if (!pool)
+        throw std::bad_alloc {};
+
+    return pool;
+}
+
+/* Takes a buffer from `pool`, and lays out `format`'s planes in it...
+ */
+auto get_buffer(AVBufferPool& pool,
+                AVPixelFormat format,
+                int width,
+                int height,
+                std::uint8_t* (&data)[AV_NUM_DATA_POINTERS],
+                int (&linesize)[AV_NUM_DATA_POINTERS]) -> AVBufferRef*
+{
+    auto* buffer = av_buffer_pool_get(&pool);
+    if (!buffer)
+        throw std::bad_alloc {};
+
+    if (auto const ret = av_image_fill_arrays(
+            data, linesize, buffer->data, format, width, height, kAlignment);
+        ret < 0) {
+        av_buffer_unref(&buffer);
+        throw sc::CodecError { "Failed to lay out a software frame: " +
+                               sc::av_error_to_string(ret) };
+    }
+
+    return buffer;
+}
+
+} // namespace
+
+namespace sc
+{
+auto ScalerDeleter::operator()(SwsContext* ptr) const noexcept -> void
+{
+    sws_freeContext(ptr);
+}
+
+FrameConverter::FrameConverter(VideoOutputSize size,
+                               AVPixelFormat source_format,
+                               AVPixelFormat target_format)
+    : size_ { size }
+    , source_format_ { source_format }
+    , target_format_ { target_format }
+{
+    auto const width = static_cast<int>(size.width);
+    auto const height = static_cast<int>(size.height);
+    pool_ = make_pool(target_format, width, height);
+    if (source_format == target_format)
+        return;
+
+    staging_pool_ = make_pool(source_format, width, height);
+    scaler_ = ScalerPtr { sws_getContext(width,
+                                         height,
+                                         source_format,
+                                         width,
+                                         height,
+                                         target_format,
+                                         SWS_BILINEAR,
+                                         nullptr,
+                                         nullptr,
+                                         nullptr) };
+    if (!scaler_)
+        throw CodecError { "Failed to create a software frame converter" };
+}
+
+auto FrameConverter::prepare(AVFrame& frame) -> Destination
+{
+    auto const format = scaler_ ? source_format_ : target_format_;
+    frame.format = format;
+    frame.width = static_cast<int>(size_.width);
+    frame.height = static_cast<int>(size_.height);
+    frame.buf[0] = get_buffer(scaler_ ? *staging_pool_ : *pool_,
+                              format,
+                              frame.width,
+                              frame.height,
+                              frame.data,
+                              frame.linesize);
+    frame.extended_data = frame.data;
+
+    return { .data = frame.data[0],
+             .pitch = static_cast<std::size_t>(frame.linesize[0]) };
+}
+
+auto FrameConverter::convert(AVFrame& frame) -> void
+{
+    if (!scaler_ || frame.format == target_format_)
+        return;
+
+    std::uint8_t* data[AV_NUM_DATA_POINTERS] {};
+    int linesize[AV_NUM_DATA_POINTERS] {};
+    auto* buffer = get_buffer(
+        *pool_, target_format_, frame.width, frame.height, data, linesize);
+
+    if (auto const ret = sws_scale(scaler_.get(),
+                                   frame.data,
+                                   frame.linesize,
+                                   0,
+                                   frame.height,
+                                   data,
+                                   linesize);
+        ret < 0) {
+        av_buffer_unref(&buffer);
+        throw CodecError { "Failed to convert a software frame: " +
+                           av_error_to_string(ret) };
+    }
+
+    /* The downloaded pixels go back to the staging pool, unless
+     * another reference to the frame still holds them...
+     */
+    av_buffer_unref(&frame.buf[0]);
+    frame.buf[0] = buffer;
+    std::copy(std::begin(data), std::end(data), std::begin(frame.data));
+    std::copy(
+        std::begin(linesize), std::end(linesize), std::begin(frame.linesize));
+    frame.extended_data = frame.data;
+    frame.format = target_format_;
+}
+
+} // namespace sc
@@ -0,0 +1,77 @@
+#ifndef SHADOW_CAST_AV_FRAME_CONVERTER_HPP_INCLUDED
+#define SHADOW_CAST_AV_FRAME_CONVERTER_HPP_INCLUDED
+
+#include "av/buffer_pool.hpp"
+#include "av/codec.hpp"
+#include "av/frame.hpp"
+#include "av/fwd.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+namespace sc
+{
+struct ScalerDeleter
+{
+    auto operator()(SwsContext* ptr) const noexcept -> void;
+};
+
+using ScalerPtr = std::unique_ptr<SwsContext, ScalerDeleter>;
+
+/* Turns captured frames, downloaded from the GPU as packed
+ * `source_format` pixels, into system memory frames of a software
+ * encoder's `target_format`. Either way, the pixels are downloaded
+ * straight into the frame. If the formats differ, the frame stays in
+ * the source format until it's converted, which can be done later,
+ * on another thread, e.g. the encoder's, rather than the capture's.
+ *
+ * Each frame's buffer comes from a pool, so a steady capture doesn't
+ * allocate, and a frame that's still held, e.g. by the encoder for
+ * its lookahead, or waiting to be converted, is never overwritten.
+ * `prepare()` and `convert()` may be called from different threads,
+ * but each only from one...
+ */
+struct FrameConverter
+{
+    /* Where, and with what pitch, to download a captured frame...
+     */
+    struct Destination
+    {
+        std::uint8_t* data;
+        std::size_t pitch;
+    };
+
+    FrameConverter(VideoOutputSize size,
+                   AVPixelFormat source_format,
+                   AVPixelFormat target_format);
+
+    /* Gives `frame` a buffer, and returns where its captured pixels
+     * should be downloaded to...
+     */
+    auto prepare(AVFrame& frame) -> Destination;
+
+    /* Converts the pixels downloaded for `frame` into the target
+     * format, in a new buffer, releasing the one they were downloaded
+     * to. Does nothing if `frame` is already in the target format...
+     */
+    auto convert(AVFrame& frame) -> void;
+
+private:
+    VideoOutputSize size_;
+    AVPixelFormat source_format_;
+    AVPixelFormat target_format_;
+    BufferPoolPtr pool_;
+
+    /* Only used if the formats differ. The buffers the captured
+     * pixels are downloaded to, and their converter...
+     */
+    BufferPoolPtr staging_pool_;
+    ScalerPtr scaler_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_AV_FRAME_CONVERTER_HPP_INCLUDED
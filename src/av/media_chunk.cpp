@@ -1,69 +1,163 @@
 #include "av/media_chunk.hpp"
-#include <cassert>
+#include "error.hpp"
+#include <cstring>
+#include <new>
+#include <string>
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/samplefmt.h>
+}
 
 namespace sc
 {
-auto DynamicBuffer::reset() noexcept -> void { bytes_committed_ = 0; }
 
-auto DynamicBuffer::prepare(std::size_t n) -> std::span<std::uint8_t>
+auto MediaChunk::DataDeleter::operator()(std::uint8_t* ptr) const noexcept
+    -> void
 {
-    if (n > capacity())
-        data_.resize(data_.size() + (n - capacity()));
+    av_free(ptr);
+}
 
-    return std::span { next(begin(data_), bytes_committed_), end(data_) };
+auto MediaChunk::planes() const noexcept -> std::span<std::uint8_t* const>
+{
+    return std::span { planes_.data(), num_planes_ };
 }
 
-auto DynamicBuffer::commit(std::size_t n) -> void
+auto MediaChunk::reset() noexcept -> void
 {
-    assert(n <= (data_.size() - bytes_committed_));
-    bytes_committed_ += n;
+    position = 0;
+    sample_count = 0;
 }
 
-auto DynamicBuffer::consume(std::size_t n) -> void
+auto MediaChunkPool::ItemDeleter::operator()(MediaChunk* chunk) const noexcept
+    -> void
 {
-    assert(n <= bytes_committed_);
-    data_.erase(begin(data_), next(begin(data_), n));
+    chunk->pool_->put(chunk);
+}
 
-    bytes_committed_ -= n;
+auto MediaChunkPool::create(SampleFormat sample_format,
+                            std::size_t num_channels,
+                            std::size_t frame_size,
+                            std::size_t num_chunks)
+    -> std::shared_ptr<MediaChunkPool>
+{
+    return std::shared_ptr<MediaChunkPool> { new MediaChunkPool {
+        sample_format, num_channels, frame_size, num_chunks } };
 }
 
-auto DynamicBuffer::data() noexcept -> std::span<std::uint8_t>
+MediaChunkPool::MediaChunkPool(SampleFormat sample_format,
+                               std::size_t num_channels,
+                               std::size_t frame_size,
+                               std::size_t num_chunks)
+    : frame_size_ { frame_size }
+    , chunks_ { std::make_unique<MediaChunk[]>(num_chunks) }
 {
-    return std::span { data_.data(), bytes_committed_ };
+    auto const format = convert_to_libav_format(sample_format);
+    auto const num_planes = is_interleaved_format(sample_format)
+                                ? std::size_t { 1 }
+                                : num_channels;
+    if (num_planes > AV_NUM_DATA_POINTERS)
+        throw CodecError { "Too many audio channels: " +
+                           std::to_string(num_channels) };
+
+    auto const channels = static_cast<int>(num_channels);
+    auto const samples = static_cast<int>(frame_size);
+    buffer_size_ =
+        av_samples_get_buffer_size(&linesize_, channels, samples, format, 0);
+    if (buffer_size_ < 0)
+        throw CodecError { "Unsupported audio chunk format: " +
+                           av_error_to_string(buffer_size_) };
+
+    auto const chunk_size = static_cast<std::size_t>(buffer_size_);
+
+    for (std::size_t i = 0; i < num_chunks; ++i) {
+        auto& chunk = chunks_[i];
+        chunk.pool_ = this;
+        chunk.num_planes_ = num_planes;
+        chunk.data_.reset(static_cast<std::uint8_t*>(av_malloc(chunk_size)));
+        if (!chunk.data_)
+            throw std::bad_alloc {};
+
+        /* Fault the chunk in now, rather than on PipeWire's thread...
+         */
+        std::memset(chunk.data_.get(), 0, chunk_size);
+        static_cast<void>(av_samples_fill_arrays(chunk.planes_.data(),
+                                                 nullptr,
+                                                 chunk.data_.get(),
+                                                 channels,
+                                                 samples,
+                                                 format,
+                                                 0));
+        free_.push_back(&chunk);
+    }
 }
 
-auto DynamicBuffer::data() const noexcept -> std::span<std::uint8_t const>
+MediaChunkPool::~MediaChunkPool()
 {
-    return std::span { data_.data(), bytes_committed_ };
+    returned_.pop_all(free_);
+    while (!free_.empty())
+        free_.pop_front();
 }
 
-auto DynamicBuffer::size() const noexcept -> std::size_t
+auto MediaChunkPool::get() noexcept -> MediaChunk*
 {
-    return bytes_committed_;
+    /* Returned chunks are only collected once the free ones have run
+     * out, so this is usually a single unlink...
+     */
+    if (free_.empty())
+        returned_.pop_all(free_);
+
+    if (free_.empty())
+        return nullptr;
+
+    auto* chunk = &free_.front();
+    free_.pop_front();
+    chunk->reset();
+    return chunk;
 }
 
-auto DynamicBuffer::capacity() const noexcept -> std::size_t
+auto MediaChunkPool::put(MediaChunk* chunk) noexcept -> void
 {
-    return data_.size() - size();
+    static_cast<void>(returned_.push(chunk));
 }
 
-auto MediaChunk::reset() noexcept -> void
+auto MediaChunkPool::frame_size() const noexcept -> std::size_t
 {
-    timestamp_ms = 0;
-    sample_count = 0;
-    for (auto& b : channel_buffers())
-        b.reset();
+    return frame_size_;
 }
 
-auto MediaChunk::channel_buffers() noexcept -> std::vector<DynamicBuffer>&
+auto MediaChunkPool::attach(ItemPtr chunk, AVFrame& frame) -> void
 {
-    return buffers_;
+    auto& pool = *chunk->pool_;
+    chunk->owner_ = pool.shared_from_this();
+
+    auto* buffer = av_buffer_create(chunk->data_.get(),
+                                    static_cast<std::size_t>(pool.buffer_size_),
+                                    &MediaChunkPool::release,
+                                    chunk.get(),
+                                    0);
+    if (!buffer) {
+        chunk->owner_.reset();
+        throw std::bad_alloc {};
+    }
+
+    frame.buf[0] = buffer;
+    auto const planes = chunk->planes();
+    for (std::size_t i = 0; i < planes.size(); ++i)
+        frame.data[i] = planes[i];
+
+    frame.extended_data = frame.data;
+    frame.linesize[0] = pool.linesize_;
+    static_cast<void>(chunk.release());
 }
 
-auto MediaChunk::channel_buffers() const noexcept
-    -> std::vector<DynamicBuffer> const&
+auto MediaChunkPool::release(void* opaque, std::uint8_t*) noexcept -> void
 {
-    return buffers_;
+    /* This may drop the last reference to the pool, so the chunk
+     * mustn't be touched once it's been returned...
+     */
+    auto* chunk = static_cast<MediaChunk*>(opaque);
+    auto owner = std::move(chunk->owner_);
+    owner->put(chunk);
 }
 
 } // namespace sc
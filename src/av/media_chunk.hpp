@@ -1,41 +1,122 @@
 #ifndef SHADOW_CAST_AV_MEDIA_CHUNK_HPP_INCLUDED
 #define SHADOW_CAST_AV_MEDIA_CHUNK_HPP_INCLUDED
 
+#include <array>
 #include <cinttypes>
 #include <cstddef>
+#include <memory>
 #include <span>
-#include <vector>
 
+#include "av/sample_format.hpp"
 #include "utils/intrusive_list.hpp"
+#include "utils/mpsc_queue.hpp"
+extern "C" {
+#include <libavutil/frame.h>
+}
 
 namespace sc
 {
-struct DynamicBuffer
+struct MediaChunkPool;
+
+/* One encoder frame's worth of captured samples, held in memory that
+ * the encoder's `AVFrame` can reference directly...
+ */
+struct MediaChunk : ListItemBase
 {
-    auto prepare(std::size_t) -> std::span<std::uint8_t>;
-    auto commit(std::size_t) -> void;
-    auto consume(std::size_t) -> void;
-    auto data() noexcept -> std::span<std::uint8_t>;
-    auto data() const noexcept -> std::span<std::uint8_t const>;
-    auto size() const noexcept -> std::size_t;
-    auto capacity() const noexcept -> std::size_t;
+    /* Where the chunk's first sample falls, in samples since the
+     * capture started...
+     */
+    std::uint64_t position { 0 };
+
+    /* How many of the pool's `frame_size()` samples have been
+     * written...
+     */
+    std::size_t sample_count { 0 };
+
+    /* One plane for each channel of a planar format, or a single
+     * plane holding every channel of an interleaved one...
+     */
+    [[nodiscard]] auto planes() const noexcept
+        -> std::span<std::uint8_t* const>;
     auto reset() noexcept -> void;
 
 private:
-    std::vector<std::uint8_t> data_;
-    std::size_t bytes_committed_ { 0 };
+    friend struct MediaChunkPool;
+
+    struct DataDeleter
+    {
+        auto operator()(std::uint8_t* ptr) const noexcept -> void;
+    };
+
+    MediaChunkPool* pool_ { nullptr };
+    std::unique_ptr<std::uint8_t, DataDeleter> data_;
+    std::array<std::uint8_t*, AV_NUM_DATA_POINTERS> planes_ {};
+    std::size_t num_planes_ { 0 };
+
+    /* Keeps the pool alive while a frame references the chunk...
+     */
+    std::shared_ptr<MediaChunkPool> owner_;
 };
 
-struct MediaChunk : ListItemBase
+/* A fixed set of `MediaChunk`s, all allocated up front. A single
+ * producer, e.g. PipeWire's realtime thread, takes chunks with
+ * `get()`, which never waits or allocates. Chunks can be returned
+ * from any thread, and usually are by libavcodec, once it releases
+ * the frame a chunk was `attach()`ed to...
+ */
+struct MediaChunkPool : std::enable_shared_from_this<MediaChunkPool>
 {
-    std::size_t timestamp_ms { 0 };
-    std::size_t sample_count { 0 };
-    auto channel_buffers() noexcept -> std::vector<DynamicBuffer>&;
-    auto channel_buffers() const noexcept -> std::vector<DynamicBuffer> const&;
-    auto reset() noexcept -> void;
+    struct ItemDeleter
+    {
+        auto operator()(MediaChunk* chunk) const noexcept -> void;
+    };
+
+    using ItemPtr = std::unique_ptr<MediaChunk, ItemDeleter>;
+
+    [[nodiscard]] static auto create(SampleFormat sample_format,
+                                     std::size_t num_channels,
+                                     std::size_t frame_size,
+                                     std::size_t num_chunks)
+        -> std::shared_ptr<MediaChunkPool>;
+
+    ~MediaChunkPool();
+
+    MediaChunkPool(MediaChunkPool const&) = delete;
+    auto operator=(MediaChunkPool const&) -> MediaChunkPool& = delete;
+
+    /* Returns an empty chunk, or null if they're all in use. Only the
+     * producer may call this...
+     */
+    [[nodiscard]] auto get() noexcept -> MediaChunk*;
+
+    /* Returns `chunk` to the pool. This may be called from any
+     * thread...
+     */
+    auto put(MediaChunk* chunk) noexcept -> void;
+
+    [[nodiscard]] auto frame_size() const noexcept -> std::size_t;
+
+    /* Points `frame`'s planes at `chunk`'s samples, without copying
+     * them. The chunk is returned to its pool when the frame's last
+     * reference to it is released, and keeps the pool alive until
+     * then...
+     */
+    static auto attach(ItemPtr chunk, AVFrame& frame) -> void;
 
 private:
-    std::vector<DynamicBuffer> buffers_;
+    MediaChunkPool(SampleFormat sample_format,
+                   std::size_t num_channels,
+                   std::size_t frame_size,
+                   std::size_t num_chunks);
+
+    static auto release(void* opaque, std::uint8_t* data) noexcept -> void;
+
+    std::size_t frame_size_;
+    int buffer_size_ { 0 };
+    int linesize_ { 0 };
+    std::unique_ptr<MediaChunk[]> chunks_;
+    IntrusiveList<MediaChunk> free_;
+    MpscQueue<MediaChunk> returned_;
 };
 } // namespace sc
 
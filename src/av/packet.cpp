@@ -1,4 +1,7 @@
 #include "av/packet.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 
 namespace sc
 {
@@ -9,4 +12,75 @@ auto PacketPtrDeleter::operator()(AVPacket* ptr) const noexcept -> void
 
 PacketUnrefGuard::~PacketUnrefGuard() { av_packet_unref(packet); }
 
+auto decode_time(AVPacket const& packet, AVRational time_base) noexcept
+    -> std::int64_t
+{
+    auto const ts = packet.dts != AV_NOPTS_VALUE ? packet.dts : packet.pts;
+    return av_rescale_q(ts, time_base, AVRational { 1, 1'000'000'000 });
+}
+
+auto is_video_keyframe(AVPacket const& packet, AVStream const& stream) noexcept
+    -> bool
+{
+    return stream.codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+           (packet.flags & AV_PKT_FLAG_KEY);
+}
+
+auto PacketBufferPool::get(std::size_t size) -> AVBufferRef*
+{
+    auto const shift = std::max<std::size_t>(
+        std::bit_width(std::max<std::size_t>(size, 1) - 1), kMinSizeShift);
+    if (shift > kMaxSizeShift)
+        return av_buffer_alloc(size);
+
+    auto& pool = pools_[shift - kMinSizeShift];
+    if (!pool) {
+        pool = BufferPoolPtr { av_buffer_pool_init(std::size_t { 1 } << shift,
+                                                   nullptr) };
+        if (!pool)
+            return nullptr;
+    }
+
+    return av_buffer_pool_get(pool.get());
+}
+
+auto PacketBufferPool::attach(AVCodecContext& codec_context) noexcept -> void
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 134, 100)
+    if (codec_context.opaque == this || !codec_context.codec ||
+        !(codec_context.codec->capabilities & AV_CODEC_CAP_DR1))
+        return;
+
+    codec_context.opaque = this;
+    codec_context.get_encode_buffer = &get_encode_buffer;
+#else
+    static_cast<void>(codec_context);
+#endif
+}
+
+auto PacketBufferPool::get_encode_buffer(AVCodecContext* codec_context,
+                                         AVPacket* packet,
+                                         int flags) -> int
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 134, 100)
+    auto& self = *static_cast<PacketBufferPool*>(codec_context->opaque);
+    auto const size = static_cast<std::size_t>(packet->size);
+    auto* buffer = self.get(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!buffer)
+        return avcodec_default_get_encode_buffer(codec_context, packet, flags);
+
+    /* Pooled buffers aren't cleared, so the padding has to be...
+     */
+    std::memset(buffer->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    packet->buf = buffer;
+    packet->data = buffer->data;
+    return 0;
+#else
+    static_cast<void>(codec_context);
+    static_cast<void>(packet);
+    static_cast<void>(flags);
+    return AVERROR(ENOSYS);
+#endif
+}
+
 } // namespace sc
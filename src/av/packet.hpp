@@ -1,7 +1,11 @@
 #ifndef SHADOW_CAST_AV_PACKET_HPP_INCLUDED
 #define SHADOW_CAST_AV_PACKET_HPP_INCLUDED
 
+#include "./buffer_pool.hpp"
 #include "./fwd.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace sc
@@ -21,5 +25,54 @@ struct PacketUnrefGuard
 
 using PacketPtr = std::unique_ptr<AVPacket, PacketPtrDeleter>;
 
+/* The packet's decode timestamp, or its presentation timestamp if it
+ * doesn't have one, converted from `time_base` to nanoseconds...
+ */
+[[nodiscard]] auto decode_time(AVPacket const& packet,
+                               AVRational time_base) noexcept
+    -> std::int64_t;
+
+/* True if `packet` is a keyframe of a video `stream`...
+ */
+[[nodiscard]] auto is_video_keyframe(AVPacket const& packet,
+                                     AVStream const& stream) noexcept -> bool;
+
+/* Reference counted buffers for encoded packets, kept in
+ * power-of-two size classes. An encoder that takes its packets'
+ * buffers from here stops allocating once each size it needs has
+ * been used, and because references to a packet share its buffer,
+ * rather than copying it, the data is written exactly once by the
+ * encoder. A buffer goes back to its pool when its last reference
+ * is released, on whichever thread that happens.
+ *
+ * `get()`, and the encoders attached to the pool, must only be used
+ * from one thread at a time...
+ */
+struct PacketBufferPool
+{
+    /* Returns a buffer of at least `size` bytes, or null if it can't
+     * be allocated. Buffers too big for the largest size class are
+     * allocated on their own...
+     */
+    [[nodiscard]] auto get(std::size_t size) -> AVBufferRef*;
+
+    /* Has `codec_context` take its packets' buffers from this pool,
+     * if its encoder supports it. The pool must outlive any further
+     * use of the encoder. Attaching the same encoder again does
+     * nothing...
+     */
+    auto attach(AVCodecContext& codec_context) noexcept -> void;
+
+private:
+    static constexpr std::size_t kMinSizeShift = 12;
+    static constexpr std::size_t kMaxSizeShift = 26;
+
+    static auto get_encode_buffer(AVCodecContext* codec_context,
+                                  AVPacket* packet,
+                                  int flags) -> int;
+
+    std::array<BufferPoolPtr, kMaxSizeShift - kMinSizeShift + 1> pools_ {};
+};
+
 } // namespace sc
 #endif // SHADOW_CAST_AV_PACKET_HPP_INCLUDED
@@ -0,0 +1,262 @@
+#include "av/sample_converter.hpp"
+#include "error.hpp"
+#include "utils/contracts.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+/* Samples are converted this many, per channel, at a time. Small
+ * enough that the scratch buffers stay in L1 for stereo...
+ */
+std::size_t constexpr kBlockSize = 256;
+
+enum struct SampleType
+{
+    s16,
+    s32,
+    f32,
+    f64
+};
+
+auto sample_type(sc::SampleFormat format) noexcept -> SampleType
+{
+    using sc::SampleFormat;
+
+    switch (format) {
+    case SampleFormat::s16_interleaved:
+    case SampleFormat::s16_planar:
+        return SampleType::s16;
+    case SampleFormat::s32_interleaved:
+    case SampleFormat::s32_planar:
+        return SampleType::s32;
+    case SampleFormat::double_interleaved:
+    case SampleFormat::double_planar:
+        return SampleType::f64;
+    default:
+        return SampleType::f32;
+    }
+}
+
+auto to_float(sc::SampleKernels const& kernels,
+              SampleType type,
+              std::uint8_t const* source,
+              float* target,
+              std::size_t n) noexcept -> void
+{
+    switch (type) {
+    case SampleType::s16:
+        kernels.s16_to_float(
+            reinterpret_cast<std::int16_t const*>(source), target, n);
+        break;
+    case SampleType::s32:
+        kernels.s32_to_float(
+            reinterpret_cast<std::int32_t const*>(source), target, n);
+        break;
+    case SampleType::f64:
+        kernels.double_to_float(
+            reinterpret_cast<double const*>(source), target, n);
+        break;
+    case SampleType::f32:
+        std::memcpy(target, source, n * sizeof(float));
+        break;
+    }
+}
+
+auto from_float(sc::SampleKernels const& kernels,
+                SampleType type,
+                float const* source,
+                std::uint8_t* target,
+                std::size_t n) noexcept -> void
+{
+    switch (type) {
+    case SampleType::s16:
+        kernels.float_to_s16(
+            source, reinterpret_cast<std::int16_t*>(target), n);
+        break;
+    case SampleType::s32:
+        kernels.float_to_s32(
+            source, reinterpret_cast<std::int32_t*>(target), n);
+        break;
+    case SampleType::f64:
+        kernels.float_to_double(source, reinterpret_cast<double*>(target), n);
+        break;
+    case SampleType::f32:
+        std::memcpy(target, source, n * sizeof(float));
+        break;
+    }
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto is_convertible_sample_format(SampleFormat format) noexcept -> bool
+{
+    switch (format) {
+    case SampleFormat::s16_interleaved:
+    case SampleFormat::s32_interleaved:
+    case SampleFormat::float_interleaved:
+    case SampleFormat::double_interleaved:
+    case SampleFormat::s16_planar:
+    case SampleFormat::s32_planar:
+    case SampleFormat::float_planar:
+    case SampleFormat::double_planar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+SampleConverter::SampleConverter(SampleFormat source_format,
+                                 SampleFormat target_format,
+                                 std::size_t num_channels,
+                                 SampleKernels const& kernels)
+    : source_format_ { source_format }
+    , target_format_ { target_format }
+    , num_channels_ { num_channels }
+    , kernels_ { &kernels }
+    , source_floats_(kBlockSize * num_channels)
+    , target_floats_(kBlockSize * num_channels)
+    , float_planes_(num_channels)
+    , layout_planes_(num_channels)
+{
+    for (auto format : { source_format, target_format }) {
+        if (!is_convertible_sample_format(format))
+            throw CodecError { std::string { "Can't convert audio samples "
+                                             "to, or from, " } +
+                               sample_format_name(format) };
+    }
+
+    if (num_channels == 0)
+        throw CodecError { "Can't convert audio without any channels" };
+}
+
+auto SampleConverter::convert(std::span<std::uint8_t const* const> source,
+                              std::size_t source_offset,
+                              std::span<std::uint8_t* const> target,
+                              std::size_t target_offset,
+                              std::size_t n) noexcept -> void
+{
+    auto const source_planes =
+        is_interleaved_format(source_format_) ? 1 : num_channels_;
+    auto const target_planes =
+        is_interleaved_format(target_format_) ? 1 : num_channels_;
+    SC_EXPECT(source.size() >= source_planes);
+    SC_EXPECT(target.size() >= target_planes);
+
+    if (source_format_ == target_format_) {
+        auto const stride = sample_format_size(source_format_) *
+                            (num_channels_ / source_planes);
+        for (std::size_t p = 0; p < source_planes; ++p)
+            std::memcpy(target[p] + target_offset * stride,
+                        source[p] + source_offset * stride,
+                        n * stride);
+        return;
+    }
+
+    for (std::size_t done = 0; done < n;) {
+        auto const count = std::min(kBlockSize, n - done);
+        convert_block(
+            source, source_offset + done, target, target_offset + done, count);
+        done += count;
+    }
+}
+
+auto SampleConverter::convert_block(std::span<std::uint8_t const* const> source,
+                                    std::size_t source_offset,
+                                    std::span<std::uint8_t* const> target,
+                                    std::size_t target_offset,
+                                    std::size_t n) noexcept -> void
+{
+    auto const& kernels = *kernels_;
+    auto const source_type = sample_type(source_format_);
+    auto const target_type = sample_type(target_format_);
+    auto const source_interleaved = is_interleaved_format(source_format_);
+    auto const target_interleaved = is_interleaved_format(target_format_);
+    auto const source_planes = source_interleaved ? 1 : num_channels_;
+    auto const target_planes = target_interleaved ? 1 : num_channels_;
+    auto const source_width = num_channels_ / source_planes;
+    auto const target_width = num_channels_ / target_planes;
+    auto const source_stride = sample_format_size(source_format_) *
+                               source_width;
+    auto const target_stride = sample_format_size(target_format_) *
+                               target_width;
+
+    /* First, the source as floats, still in its own layout. Float
+     * samples are used where they are...
+     */
+    for (std::size_t p = 0; p < source_planes; ++p) {
+        auto const* samples = source[p] + source_offset * source_stride;
+        if (source_type == SampleType::f32) {
+            float_planes_[p] = reinterpret_cast<float const*>(samples);
+            continue;
+        }
+
+        auto* floats = source_floats_.data() + p * kBlockSize * source_width;
+        to_float(kernels, source_type, samples, floats, n * source_width);
+        float_planes_[p] = floats;
+    }
+
+    /* Then, into the target's layout. Float targets are written
+     * directly...
+     */
+    if (source_interleaved != target_interleaved) {
+        auto const to_target = target_type == SampleType::f32;
+        auto const target_plane = [&](std::size_t p) {
+            if (to_target)
+                return reinterpret_cast<float*>(target[p] +
+                                                target_offset * target_stride);
+            return target_floats_.data() + p * kBlockSize * target_width;
+        };
+
+        for (std::size_t p = 0; p < target_planes; ++p)
+            layout_planes_[p] = target_plane(p);
+
+        if (source_interleaved)
+            kernels.deinterleave(
+                float_planes_[0],
+                std::span { layout_planes_.data(), target_planes },
+                n);
+        else
+            kernels.interleave(
+                std::span { float_planes_.data(), source_planes },
+                layout_planes_[0],
+                n);
+
+        if (to_target)
+            return;
+
+        for (std::size_t p = 0; p < target_planes; ++p)
+            float_planes_[p] = layout_planes_[p];
+    }
+
+    /* Finally, floats to the target's sample type...
+     */
+    for (std::size_t p = 0; p < target_planes; ++p)
+        from_float(kernels,
+                   target_type,
+                   float_planes_[p],
+                   target[p] + target_offset * target_stride,
+                   n * target_width);
+}
+
+auto SampleConverter::source_format() const noexcept -> SampleFormat
+{
+    return source_format_;
+}
+
+auto SampleConverter::target_format() const noexcept -> SampleFormat
+{
+    return target_format_;
+}
+
+auto SampleConverter::kernels() const noexcept -> SampleKernels const&
+{
+    return *kernels_;
+}
+
+} // namespace sc
@@ -0,0 +1,71 @@
+#ifndef SHADOW_CAST_AV_SAMPLE_CONVERTER_HPP_INCLUDED
+#define SHADOW_CAST_AV_SAMPLE_CONVERTER_HPP_INCLUDED
+
+#include "av/sample_format.hpp"
+#include "av/sample_kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sc
+{
+
+/* True if `SampleConverter` can convert to, and from, `format`. That
+ * is, any s16, s32, float, or double format...
+ */
+[[nodiscard]] auto is_convertible_sample_format(SampleFormat format) noexcept
+    -> bool;
+
+/* Converts audio from one `SampleFormat` to another, with any number
+ * of channels. Samples are converted a block at a time, through
+ * scratch buffers that are allocated up front, so `convert()` never
+ * allocates and is safe to call from a realtime thread.
+ *
+ * Anything but a plain copy goes by way of `float`, so s32 and double
+ * samples keep 24 bits of precision. Formats that match are just
+ * copied...
+ */
+struct SampleConverter
+{
+    SampleConverter(SampleFormat source_format,
+                    SampleFormat target_format,
+                    std::size_t num_channels,
+                    SampleKernels const& kernels = best_sample_kernels());
+
+    /* Converts `n` samples of each channel, starting `source_offset`
+     * samples into `source`'s planes, and `target_offset` samples into
+     * `target`'s. An interleaved format has a single plane, and a
+     * planar one has one plane for each channel...
+     */
+    auto convert(std::span<std::uint8_t const* const> source,
+                 std::size_t source_offset,
+                 std::span<std::uint8_t* const> target,
+                 std::size_t target_offset,
+                 std::size_t n) noexcept -> void;
+
+    [[nodiscard]] auto source_format() const noexcept -> SampleFormat;
+    [[nodiscard]] auto target_format() const noexcept -> SampleFormat;
+    [[nodiscard]] auto kernels() const noexcept -> SampleKernels const&;
+
+private:
+    auto convert_block(std::span<std::uint8_t const* const> source,
+                       std::size_t source_offset,
+                       std::span<std::uint8_t* const> target,
+                       std::size_t target_offset,
+                       std::size_t n) noexcept -> void;
+
+    SampleFormat source_format_;
+    SampleFormat target_format_;
+    std::size_t num_channels_;
+    SampleKernels const* kernels_;
+
+    std::vector<float> source_floats_;
+    std::vector<float> target_floats_;
+    std::vector<float const*> float_planes_;
+    std::vector<float*> layout_planes_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_AV_SAMPLE_CONVERTER_HPP_INCLUDED
@@ -0,0 +1,547 @@
+#include "av/sample_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+float constexpr kS16Scale = 32'768.0f;
+float constexpr kS16Max = 32'767.0f;
+float constexpr kS32Scale = 2'147'483'648.0f;
+
+/* The largest float below 2^31. Anything bigger would overflow an
+ * `int32_t`...
+ */
+float constexpr kS32Max = 2'147'483'520.0f;
+
+namespace scalar
+{
+
+auto s16_to_float(std::int16_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(in[i]) * (1.0f / kS16Scale);
+}
+
+auto s32_to_float(std::int32_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(in[i]) * (1.0f / kS32Scale);
+}
+
+auto double_to_float(double const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(in[i]);
+}
+
+/* Clamped before rounding, as the SIMD kernels are, so that every
+ * set of kernels gives the same result...
+ */
+auto float_to_s16(float const* in, std::int16_t* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        auto const v = std::clamp(in[i] * kS16Scale, -kS16Scale, kS16Max);
+        out[i] = static_cast<std::int16_t>(std::lrintf(v));
+    }
+}
+
+auto float_to_s32(float const* in, std::int32_t* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        auto const v = std::clamp(in[i] * kS32Scale, -kS32Scale, kS32Max);
+        out[i] = static_cast<std::int32_t>(std::lrintf(v));
+    }
+}
+
+auto float_to_double(float const* in, double* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = static_cast<double>(in[i]);
+}
+
+auto interleave(std::span<float const* const> planes,
+                float* interleaved,
+                std::size_t n) noexcept -> void
+{
+    auto const channels = planes.size();
+    for (std::size_t c = 0; c < channels; ++c) {
+        auto const* plane = planes[c];
+        for (std::size_t i = 0; i < n; ++i)
+            interleaved[i * channels + c] = plane[i];
+    }
+}
+
+auto deinterleave(float const* interleaved,
+                  std::span<float* const> planes,
+                  std::size_t n) noexcept -> void
+{
+    auto const channels = planes.size();
+    for (std::size_t c = 0; c < channels; ++c) {
+        auto* plane = planes[c];
+        for (std::size_t i = 0; i < n; ++i)
+            plane[i] = interleaved[i * channels + c];
+    }
+}
+
+auto mix(float const* in, float gain, float* out, std::size_t n) noexcept
+    -> void
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] += in[i] * gain;
+}
+
+} // namespace scalar
+
+sc::SampleKernels constexpr kScalarKernels {
+    .name = "scalar",
+    .s16_to_float = &scalar::s16_to_float,
+    .s32_to_float = &scalar::s32_to_float,
+    .double_to_float = &scalar::double_to_float,
+    .float_to_s16 = &scalar::float_to_s16,
+    .float_to_s32 = &scalar::float_to_s32,
+    .float_to_double = &scalar::float_to_double,
+    .interleave = &scalar::interleave,
+    .deinterleave = &scalar::deinterleave,
+    .mix = &scalar::mix,
+};
+
+#if defined(__x86_64__)
+
+/* SSE2 is part of x86-64, so these need no special compiler flags,
+ * or check at runtime. Each kernel finishes any samples that don't
+ * fill a whole vector with the scalar kernel. Only stereo is
+ * (de)interleaved with vectors; any other channel count is left to
+ * the scalar kernels...
+ */
+namespace sse2
+{
+
+auto s16_to_float(std::int16_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm_set1_ps(1.0f / kS16Scale);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const x =
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+
+        /* Each sample is sign extended by unpacking it into the top
+         * half of a 32 bit lane and shifting it back down...
+         */
+        auto const lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        auto const hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+
+    scalar::s16_to_float(in + i, out + i, n - i);
+}
+
+auto s32_to_float(std::int32_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm_set1_ps(1.0f / kS32Scale);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const x =
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+
+    scalar::s32_to_float(in + i, out + i, n - i);
+}
+
+auto double_to_float(double const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+        auto const hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+
+    scalar::double_to_float(in + i, out + i, n - i);
+}
+
+auto float_to_s16(float const* in, std::int16_t* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm_set1_ps(kS16Scale);
+    auto const min = _mm_set1_ps(-kS16Scale);
+    auto const max = _mm_set1_ps(kS16Max);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const a = _mm_min_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), min), max);
+        auto const b = _mm_min_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), min), max);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+
+    scalar::float_to_s16(in + i, out + i, n - i);
+}
+
+auto float_to_s32(float const* in, std::int32_t* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm_set1_ps(kS32Scale);
+    auto const min = _mm_set1_ps(-kS32Scale);
+    auto const max = _mm_set1_ps(kS32Max);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const x = _mm_min_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), min), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_cvtps_epi32(x));
+    }
+
+    scalar::float_to_s32(in + i, out + i, n - i);
+}
+
+auto float_to_double(float const* in, double* out, std::size_t n) noexcept
+    -> void
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const x = _mm_loadu_ps(in + i);
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(x));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+
+    scalar::float_to_double(in + i, out + i, n - i);
+}
+
+auto interleave(std::span<float const* const> planes,
+                float* interleaved,
+                std::size_t n) noexcept -> void
+{
+    if (planes.size() != 2)
+        return scalar::interleave(planes, interleaved, n);
+
+    auto const* left = planes[0];
+    auto const* right = planes[1];
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const l = _mm_loadu_ps(left + i);
+        auto const r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(interleaved + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(interleaved + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+
+    std::array const rest { left + i, right + i };
+    scalar::interleave(rest, interleaved + 2 * i, n - i);
+}
+
+auto deinterleave(float const* interleaved,
+                  std::span<float* const> planes,
+                  std::size_t n) noexcept -> void
+{
+    if (planes.size() != 2)
+        return scalar::deinterleave(interleaved, planes, n);
+
+    auto* left = planes[0];
+    auto* right = planes[1];
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const a = _mm_loadu_ps(interleaved + 2 * i);
+        auto const b = _mm_loadu_ps(interleaved + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i,
+                      _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    std::array const rest { left + i, right + i };
+    scalar::deinterleave(interleaved + 2 * i, rest, n - i);
+}
+
+auto mix(float const* in, float gain, float* out, std::size_t n) noexcept
+    -> void
+{
+    auto const g = _mm_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const x = _mm_mul_ps(_mm_loadu_ps(in + i), g);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), x));
+    }
+
+    scalar::mix(in + i, gain, out + i, n - i);
+}
+
+} // namespace sse2
+
+sc::SampleKernels constexpr kSse2Kernels {
+    .name = "sse2",
+    .s16_to_float = &sse2::s16_to_float,
+    .s32_to_float = &sse2::s32_to_float,
+    .double_to_float = &sse2::double_to_float,
+    .float_to_s16 = &sse2::float_to_s16,
+    .float_to_s32 = &sse2::float_to_s32,
+    .float_to_double = &sse2::float_to_double,
+    .interleave = &sse2::interleave,
+    .deinterleave = &sse2::deinterleave,
+    .mix = &sse2::mix,
+};
+
+/* These are compiled for AVX2 function by function, so the rest of
+ * the build still runs on any x86-64 CPU. They're only used once
+ * `__builtin_cpu_supports()` has confirmed the CPU has AVX2...
+ */
+namespace avx2
+{
+
+#define SC_AVX2 __attribute__((target("avx2")))
+
+SC_AVX2 auto
+s16_to_float(std::int16_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm256_set1_ps(1.0f / kS16Scale);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const x = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+
+    scalar::s16_to_float(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto
+s32_to_float(std::int32_t const* in, float* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm256_set1_ps(1.0f / kS32Scale);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const x =
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+
+    scalar::s32_to_float(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto
+double_to_float(double const* in, float* out, std::size_t n) noexcept -> void
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(in + i)));
+        _mm_storeu_ps(out + i + 4,
+                      _mm256_cvtpd_ps(_mm256_loadu_pd(in + i + 4)));
+    }
+
+    scalar::double_to_float(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto
+float_to_s16(float const* in, std::int16_t* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm256_set1_ps(kS16Scale);
+    auto const min = _mm256_set1_ps(-kS16Scale);
+    auto const max = _mm256_set1_ps(kS16Max);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto const a = _mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), min),
+            max);
+        auto const b = _mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale),
+                          min),
+            max);
+
+        /* Packing works within each 128 bit lane, so the middle two
+         * quarters come out swapped...
+         */
+        auto const packed =
+            _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+
+    scalar::float_to_s16(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto
+float_to_s32(float const* in, std::int32_t* out, std::size_t n) noexcept
+    -> void
+{
+    auto const scale = _mm256_set1_ps(kS32Scale);
+    auto const min = _mm256_set1_ps(-kS32Scale);
+    auto const max = _mm256_set1_ps(kS32Max);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const x = _mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), min),
+            max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_cvtps_epi32(x));
+    }
+
+    scalar::float_to_s32(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto
+float_to_double(float const* in, double* out, std::size_t n) noexcept -> void
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+        _mm256_storeu_pd(out + i + 4,
+                         _mm256_cvtps_pd(_mm_loadu_ps(in + i + 4)));
+    }
+
+    scalar::float_to_double(in + i, out + i, n - i);
+}
+
+SC_AVX2 auto interleave(std::span<float const* const> planes,
+                        float* interleaved,
+                        std::size_t n) noexcept -> void
+{
+    if (planes.size() != 2)
+        return scalar::interleave(planes, interleaved, n);
+
+    auto const* left = planes[0];
+    auto const* right = planes[1];
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const l = _mm256_loadu_ps(left + i);
+        auto const r = _mm256_loadu_ps(right + i);
+
+        /* Unpacking works within each 128 bit lane, so the halves are
+         * put back in order afterwards...
+         */
+        auto const lo = _mm256_unpacklo_ps(l, r);
+        auto const hi = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(interleaved + 2 * i,
+                         _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(interleaved + 2 * i + 8,
+                         _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+
+    std::array const rest { left + i, right + i };
+    scalar::interleave(rest, interleaved + 2 * i, n - i);
+}
+
+SC_AVX2 auto deinterleave(float const* interleaved,
+                          std::span<float* const> planes,
+                          std::size_t n) noexcept -> void
+{
+    if (planes.size() != 2)
+        return scalar::deinterleave(interleaved, planes, n);
+
+    auto* left = planes[0];
+    auto* right = planes[1];
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const a = _mm256_loadu_ps(interleaved + 2 * i);
+        auto const b = _mm256_loadu_ps(interleaved + 2 * i + 8);
+
+        /* Each shuffle leaves pairs of samples out of order across the
+         * lanes, which the permute puts right...
+         */
+        auto const l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        auto const r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_pd(
+            reinterpret_cast<double*>(left + i),
+            _mm256_permute4x64_pd(_mm256_castps_pd(l), 0xd8));
+        _mm256_storeu_pd(
+            reinterpret_cast<double*>(right + i),
+            _mm256_permute4x64_pd(_mm256_castps_pd(r), 0xd8));
+    }
+
+    std::array const rest { left + i, right + i };
+    scalar::deinterleave(interleaved + 2 * i, rest, n - i);
+}
+
+/* Deliberately not fused, so the sums match the other kernels'...
+ */
+SC_AVX2 auto
+mix(float const* in, float gain, float* out, std::size_t n) noexcept -> void
+{
+    auto const g = _mm256_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const x = _mm256_mul_ps(_mm256_loadu_ps(in + i), g);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), x));
+    }
+
+    scalar::mix(in + i, gain, out + i, n - i);
+}
+
+#undef SC_AVX2
+
+} // namespace avx2
+
+sc::SampleKernels constexpr kAvx2Kernels {
+    .name = "avx2",
+    .s16_to_float = &avx2::s16_to_float,
+    .s32_to_float = &avx2::s32_to_float,
+    .double_to_float = &avx2::double_to_float,
+    .float_to_s16 = &avx2::float_to_s16,
+    .float_to_s32 = &avx2::float_to_s32,
+    .float_to_double = &avx2::float_to_double,
+    .interleave = &avx2::interleave,
+    .deinterleave = &avx2::deinterleave,
+    .mix = &avx2::mix,
+};
+
+#endif
+
+struct KernelList
+{
+    std::array<sc::SampleKernels const*, 3> kernels {};
+    std::size_t size { 0 };
+};
+
+auto detect_kernels() noexcept -> KernelList
+{
+    KernelList list;
+    list.kernels[list.size++] = &kScalarKernels;
+#if defined(__x86_64__)
+    list.kernels[list.size++] = &kSse2Kernels;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        list.kernels[list.size++] = &kAvx2Kernels;
+#endif
+    return list;
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto scalar_sample_kernels() noexcept -> SampleKernels const&
+{
+    return kScalarKernels;
+}
+
+auto available_sample_kernels() noexcept
+    -> std::span<SampleKernels const* const>
+{
+    static auto const list = detect_kernels();
+    return std::span { list.kernels.data(), list.size };
+}
+
+auto best_sample_kernels() noexcept -> SampleKernels const&
+{
+    return *available_sample_kernels().back();
+}
+
+} // namespace sc
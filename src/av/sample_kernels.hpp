@@ -0,0 +1,65 @@
+#ifndef SHADOW_CAST_AV_SAMPLE_KERNELS_HPP_INCLUDED
+#define SHADOW_CAST_AV_SAMPLE_KERNELS_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace sc
+{
+
+/* The routines that `SampleConverter` is built from. Every sample
+ * type is converted to, and from, `float`, with integer samples
+ * scaled to, and clamped from, [-1, 1), and rounded to the nearest
+ * value. Each routine converts `n` contiguous samples.
+ *
+ * The (de)interleaving routines move `n` samples of each of the
+ * given planes to, or from, a single interleaved buffer. `mix` adds
+ * `n` samples, scaled by `gain`, to those already in `out`...
+ */
+struct SampleKernels
+{
+    char const* name;
+
+    auto (*s16_to_float)(std::int16_t const*, float*, std::size_t) noexcept
+        -> void;
+    auto (*s32_to_float)(std::int32_t const*, float*, std::size_t) noexcept
+        -> void;
+    auto (*double_to_float)(double const*, float*, std::size_t) noexcept
+        -> void;
+    auto (*float_to_s16)(float const*, std::int16_t*, std::size_t) noexcept
+        -> void;
+    auto (*float_to_s32)(float const*, std::int32_t*, std::size_t) noexcept
+        -> void;
+    auto (*float_to_double)(float const*, double*, std::size_t) noexcept
+        -> void;
+
+    auto (*interleave)(std::span<float const* const> planes,
+                       float* interleaved,
+                       std::size_t n) noexcept -> void;
+    auto (*deinterleave)(float const* interleaved,
+                         std::span<float* const> planes,
+                         std::size_t n) noexcept -> void;
+
+    auto (*mix)(float const* in,
+                float gain,
+                float* out,
+                std::size_t n) noexcept -> void;
+};
+
+[[nodiscard]] auto scalar_sample_kernels() noexcept -> SampleKernels const&;
+
+/* Returns every set of kernels this CPU can run, slowest first. The
+ * SSE2 and AVX2 kernels are only included on x86-64...
+ */
+[[nodiscard]] auto available_sample_kernels() noexcept
+    -> std::span<SampleKernels const* const>;
+
+/* The fastest kernels this CPU can run. The CPU's features are only
+ * checked the first time this is called...
+ */
+[[nodiscard]] auto best_sample_kernels() noexcept -> SampleKernels const&;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_AV_SAMPLE_KERNELS_HPP_INCLUDED
@@ -83,6 +83,34 @@ requires((sizeof...(rest) == 0) || (std::is_same_v<Ts, GLenum> && ...))
     }
 }
 
+/* Copies the read framebuffer's color buffer, of `src_width` x
+ * `src_height`, into the draw framebuffer's, of `dst_width` x
+ * `dst_height`, scaling it with `filter`...
+ */
+template <BoundFramebufferConcept R, BoundFramebufferConcept D>
+auto blit_framebuffer(R const& read_target,
+                      D const& draw_target,
+                      GLint src_width,
+                      GLint src_height,
+                      GLint dst_width,
+                      GLint dst_height,
+                      GLenum filter) -> void
+{
+    SC_CHECK_GL_BINDING(read_target);
+    SC_CHECK_GL_BINDING(draw_target);
+    gl().glBlitFramebuffer(0,
+                           0,
+                           src_width,
+                           src_height,
+                           0,
+                           0,
+                           dst_width,
+                           dst_height,
+                           GL_COLOR_BUFFER_BIT,
+                           filter);
+    SC_CHECK_GL_ERROR("glBlitFramebuffer");
+}
+
 constexpr FramebufferTarget<GL_DRAW_FRAMEBUFFER> draw_framebuffer_target {};
 constexpr FramebufferTarget<GL_READ_FRAMEBUFFER> read_framebuffer_target {};
 } // namespace sc::opengl
@@ -2,6 +2,7 @@
 #define SHADOW_CAST_HANDLERS_HPP_INCLUDED
 
 #include "./handlers/audio_chunk_writer.hpp"
+#include "./handlers/audio_mixer.hpp"
 #include "./handlers/drm_video_frame_writer.hpp"
 #include "./handlers/stream_finalizer.hpp"
 #include "./handlers/video_frame_writer.hpp"
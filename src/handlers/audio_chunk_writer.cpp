@@ -1,13 +1,12 @@
 #include "handlers/audio_chunk_writer.hpp"
 #include "av/frame.hpp"
-#include "av/sample_format.hpp"
 #include "config.hpp"
 #include "error.hpp"
 #include "services/encoder.hpp"
-#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <memory>
-#include <numeric>
+#include <utility>
 
 namespace sc
 {
@@ -21,18 +20,12 @@ ChunkWriter::ChunkWriter(AVCodecContext* codec_context,
     , encoder_ { encoder }
     , frame_size_ { frame_size }
     , frame_ { av_frame_alloc() }
-    , total_samples_written_ { 0 }
 {
 }
 
-auto ChunkWriter::operator()(MediaChunk const& chunk) -> void
+auto ChunkWriter::operator()(MediaChunkPool::ItemPtr chunk) -> void
 {
-    SC_EXPECT(chunk.sample_count >= frame_size_);
-    sc::SampleFormat const sample_format =
-        sc::convert_from_libav_format(codec_context_->sample_fmt);
-
-    auto const sample_size = sc::sample_format_size(sample_format);
-    auto const interleaved = sc::is_interleaved_format(sample_format);
+    SC_EXPECT(chunk->sample_count == frame_size_);
 
     auto encoder_frame =
         encoder_.prepare_frame(codec_context_.get(), stream_.get());
@@ -42,28 +35,24 @@ auto ChunkWriter::operator()(MediaChunk const& chunk) -> void
     frame->format = codec_context_->sample_fmt;
     frame->sample_rate = codec_context_->sample_rate;
 #if LIBAVCODEC_VERSION_MAJOR < 60
-    frame->channels = interleaved ? 2 : chunk.channel_buffers().size();
+    frame->channels = static_cast<int>(chunk->planes().size() == 1
+                                           ? 2
+                                           : chunk->planes().size());
     frame->channel_layout = AV_CH_LAYOUT_STEREO;
 #else
     av_channel_layout_copy(&frame->ch_layout, &codec_context_->ch_layout);
 #endif
-    frame->pts = total_samples_written_;
-    total_samples_written_ += frame->nb_samples;
-
-    sc::initialize_writable_buffer(frame);
-
-    auto n = 0;
-    for (auto const& channel_buffer : chunk.channel_buffers()) {
-        std::size_t const num_bytes = interleaved
-                                          ? frame->nb_samples * sample_size * 2
-                                          : frame->nb_samples * sample_size;
-
-        std::span source = channel_buffer.data().subspan(0, num_bytes);
-        std::span target { reinterpret_cast<std::uint8_t*>(frame->data[n++]),
-                           num_bytes };
-
-        std::copy(begin(source), end(source), begin(target));
-    }
+    /* Chunks are stamped from the capture clock, so a source that
+     * dropped out leaves a gap, rather than pulling the rest of the
+     * track early...
+     */
+    frame->pts = static_cast<std::int64_t>(chunk->position);
+
+    /* The frame references the chunk's samples as they are. The chunk
+     * goes back to the audio service's pool once the encoder releases
+     * the frame...
+     */
+    MediaChunkPool::attach(std::move(chunk), *frame);
 
     encoder_.write_frame(std::move(encoder_frame));
 }
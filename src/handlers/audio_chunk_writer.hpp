@@ -15,7 +15,7 @@ struct ChunkWriter
                          Encoder encoder,
                          std::size_t frame_size) noexcept;
 
-    auto operator()(MediaChunk const& chunk) -> void;
+    auto operator()(MediaChunkPool::ItemPtr chunk) -> void;
 
 private:
     BorrowedPtr<AVCodecContext> codec_context_;
@@ -23,7 +23,6 @@ private:
     Encoder encoder_;
     std::size_t frame_size_;
     FramePtr frame_;
-    std::size_t total_samples_written_ { 0 };
 };
 
 } // namespace sc
@@ -0,0 +1,143 @@
+#include "handlers/audio_mixer.hpp"
+#include "logging.hpp"
+#include "utils/contracts.hpp"
+#include <algorithm>
+#include <string>
+#include <utility>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+/* How many frames' worth of mixed audio may be waiting to be
+ * encoded...
+ */
+std::size_t constexpr kBufferedSeconds = 2;
+
+/* How far ahead of the slowest source the others may get before the
+ * mix goes on without it...
+ */
+std::size_t constexpr kMaxSkewMs = 200;
+
+auto end_of(sc::MediaChunk const& chunk) noexcept -> std::uint64_t
+{
+    return chunk.position + chunk.sample_count;
+}
+
+} // namespace
+
+namespace sc
+{
+
+AudioMixer::AudioMixer(std::vector<float> gains,
+                       SampleFormat sample_format,
+                       std::size_t num_channels,
+                       std::size_t frame_size,
+                       std::size_t sample_rate,
+                       OutputType output)
+    : num_channels_ { num_channels }
+    , frame_size_ { frame_size }
+    , max_skew_ { sample_rate * kMaxSkewMs / 1'000 }
+    , chunks_ { MediaChunkPool::create(
+          sample_format,
+          num_channels,
+          frame_size,
+          (kBufferedSeconds * sample_rate + frame_size - 1) / frame_size) }
+    , converter_ { SampleFormat::float_planar, sample_format, num_channels }
+    , mix_(frame_size * num_channels)
+    , output_ { std::move(output) }
+{
+    /* Sized up front, rather than grown, because the chunk queues
+     * can't be moved without the chance of throwing...
+     */
+    inputs_ = std::vector<Input>(gains.size());
+    for (std::size_t i = 0; i < gains.size(); ++i)
+        inputs_[i].gain = gains[i];
+
+    for (std::size_t c = 0; c < num_channels; ++c)
+        mix_planes_.push_back(reinterpret_cast<std::uint8_t const*>(
+            mix_.data() + c * frame_size));
+}
+
+auto AudioMixer::operator()(std::size_t source, MediaChunkPool::ItemPtr chunk)
+    -> void
+{
+    SC_EXPECT(source < inputs_.size());
+    SC_EXPECT(chunk->planes().size() == num_channels_);
+
+    /* The mix starts with the first chunk from any source...
+     */
+    if (!position_)
+        position_ = chunk->position;
+
+    /* Too late to be mixed...
+     */
+    if (end_of(*chunk) <= *position_)
+        return;
+
+    inputs_[source].chunks.push_back(std::move(chunk));
+    while (is_frame_ready())
+        mix_frame();
+}
+
+auto AudioMixer::is_frame_ready() const noexcept -> bool
+{
+    auto const end = *position_ + frame_size_;
+    auto every_source = true;
+    for (auto const& input : inputs_) {
+        auto const reached =
+            input.chunks.empty() ? 0 : end_of(*input.chunks.back());
+        if (reached >= end + max_skew_)
+            return true;
+
+        every_source = every_source && reached >= end;
+    }
+
+    return every_source;
+}
+
+auto AudioMixer::mix_frame() -> void
+{
+    auto const start = *position_;
+    auto const end = start + frame_size_;
+    auto const& kernels = converter_.kernels();
+    std::fill(mix_.begin(), mix_.end(), 0.0f);
+
+    for (auto& input : inputs_) {
+        for (auto const& chunk : input.chunks) {
+            auto const from = std::max(start, chunk->position);
+            auto const to = std::min(end, end_of(*chunk));
+            if (from >= to)
+                continue;
+
+            auto const planes = chunk->planes();
+            auto const n = static_cast<std::size_t>(to - from);
+            for (std::size_t c = 0; c < num_channels_; ++c) {
+                auto const* samples = reinterpret_cast<float const*>(planes[c]);
+                kernels.mix(samples + (from - chunk->position),
+                            input.gain,
+                            mix_.data() + c * frame_size_ + (from - start),
+                            n);
+            }
+        }
+
+        while (!input.chunks.empty() && end_of(*input.chunks.front()) <= end)
+            input.chunks.pop_front();
+    }
+
+    position_ = end;
+
+    MediaChunkPool::ItemPtr mixed { chunks_->get() };
+    if (!mixed) {
+        log::warn("Audio mix buffer full. Dropped a frame"s);
+        return;
+    }
+
+    mixed->position = start;
+    mixed->sample_count = frame_size_;
+    converter_.convert(mix_planes_, 0, mixed->planes(), 0, frame_size_);
+    output_(std::move(mixed));
+}
+
+} // namespace sc
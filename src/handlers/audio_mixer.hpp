@@ -0,0 +1,76 @@
+#ifndef SHADOW_CAST_HANDLERS_AUDIO_MIXER_HPP_INCLUDED
+#define SHADOW_CAST_HANDLERS_AUDIO_MIXER_HPP_INCLUDED
+
+#include "av/media_chunk.hpp"
+#include "av/sample_converter.hpp"
+#include "av/sample_format.hpp"
+#include "utils/receiver.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sc
+{
+
+/* Mixes the chunks captured from several audio sources into a single
+ * stream, each scaled by its own gain, and passes the mixed chunks,
+ * in `sample_format`, to `output`. The sources' chunks must hold
+ * planar floats.
+ *
+ * Chunks are lined up by their `position`s, so sources that started
+ * at different times, or have gaps, stay in step. A frame is mixed
+ * once every source has reached its end or, so that a source that
+ * has stopped delivering doesn't hold up the rest, once any source is
+ * `max_skew` samples beyond it. Anything a source delivers for a
+ * frame that's already been mixed is discarded...
+ */
+struct AudioMixer
+{
+    using OutputType = Receiver<void(MediaChunkPool::ItemPtr)>;
+
+    AudioMixer(std::vector<float> gains,
+               SampleFormat sample_format,
+               std::size_t num_channels,
+               std::size_t frame_size,
+               std::size_t sample_rate,
+               OutputType output);
+
+    /* Mixes whatever `chunk`, from the `source`th source, completes...
+     */
+    auto operator()(std::size_t source, MediaChunkPool::ItemPtr chunk)
+        -> void;
+
+private:
+    struct Input
+    {
+        float gain { 1.0f };
+        std::deque<MediaChunkPool::ItemPtr> chunks;
+    };
+
+    [[nodiscard]] auto is_frame_ready() const noexcept -> bool;
+    auto mix_frame() -> void;
+
+    std::vector<Input> inputs_;
+    std::size_t num_channels_;
+    std::size_t frame_size_;
+    std::uint64_t max_skew_;
+    std::shared_ptr<MediaChunkPool> chunks_;
+    SampleConverter converter_;
+
+    /* A frame of planar floats, that each source is added to...
+     */
+    std::vector<float> mix_;
+    std::vector<std::uint8_t const*> mix_planes_;
+
+    /* Where the next frame to be mixed starts...
+     */
+    std::optional<std::uint64_t> position_;
+    OutputType output_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_HANDLERS_AUDIO_MIXER_HPP_INCLUDED
@@ -1,25 +1,84 @@
 #include "handlers/drm_video_frame_writer.hpp"
+#include "error.hpp"
 #include "services/encoder.hpp"
+#include "utils/contracts.hpp"
 #include "utils/elapsed.hpp"
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+/* The color converter's output...
+ */
+auto constexpr kCapturedPixelFormat = AV_PIX_FMT_RGB0;
+} // namespace
 
 namespace sc
 {
 
 DRMVideoFrameWriter::DRMVideoFrameWriter(AVCodecContext* codec_context,
                                          AVStream* stream,
-                                         Encoder encoder)
+                                         Encoder encoder,
+                                         FrameTimeline& timeline)
     : codec_context_ { codec_context }
     , stream_ { stream }
     , encoder_ { encoder }
+    , timeline_ { &timeline }
+{
+    if (!codec_context->hw_frames_ctx)
+        converter_ = std::make_shared<FrameConverter>(
+            VideoOutputSize { .width = static_cast<std::uint32_t>(
+                                  codec_context->width),
+                              .height = static_cast<std::uint32_t>(
+                                  codec_context->height) },
+            kCapturedPixelFormat,
+            codec_context->pix_fmt);
+}
+
+auto DRMVideoFrameWriter::write_duplicate(std::uint64_t pts) -> void
+{
+    SC_EXPECT(previous_);
+
+    auto encoder_frame =
+        encoder_.prepare_frame(codec_context_.get(), stream_.get());
+    auto* frame = encoder_frame->frame.get();
+    if (auto const r = av_frame_ref(frame, previous_.get()); r < 0)
+        throw std::runtime_error { "Failed to duplicate frame: " +
+                                   av_error_to_string(r) };
+
+    frame->pts = static_cast<std::int64_t>(pts);
+    encoder_frame->converter = converter_;
+    encoder_.write_frame(std::move(encoder_frame));
+}
+
+auto DRMVideoFrameWriter::keep_previous(AVFrame const* frame) -> void
 {
+    if (timeline_->policy() != OverrunPolicy::duplicate)
+        return;
+
+    if (!previous_)
+        previous_ = FramePtr { av_frame_alloc() };
+    else
+        av_frame_unref(previous_.get());
+
+    if (auto const r = av_frame_ref(previous_.get(), frame); r < 0)
+        throw std::runtime_error { "Failed to keep frame: " +
+                                   av_error_to_string(r) };
 }
 
 auto DRMVideoFrameWriter::operator()(CUarray data,
                                      NvCuda const& cuda,
-                                     std::uint64_t /*frame_time*/) -> void
+                                     FrameTick const& tick) -> void
 {
     SC_EXPECT(data);
 
+    /* Duplicates of the previous frame fill any missed ticks
+     * before the new frame is written...
+     */
+    auto const step = timeline_->step(tick.index, tick.missed);
+    for (std::uint64_t i = 0; i < step.duplicates; ++i)
+        write_duplicate(step.first_duplicate + i);
+
     auto encoder_frame =
         encoder_.prepare_frame(codec_context_.get(), stream_.get());
     auto* frame = encoder_frame->frame.get();
@@ -32,39 +91,57 @@ auto DRMVideoFrameWriter::operator()(CUarray data,
     frame->color_trc = codec_context_->color_trc;
     frame->colorspace = codec_context_->colorspace;
     frame->chroma_location = codec_context_->chroma_sample_location;
-    if (auto const r =
-            av_hwframe_get_buffer(codec_context_->hw_frames_ctx, frame, 0);
-        r < 0)
-        throw std::runtime_error { "Failed to get H/W frame buffer" };
-
-    SC_EXPECT(frame->linesize[0]);
-    SC_EXPECT(frame->height);
-    SC_EXPECT(frame->data[0]);
 
     CUDA_MEMCPY2D memcpy_struct {};
 
     memcpy_struct.srcXInBytes = 0;
     memcpy_struct.srcY = 0;
     memcpy_struct.srcMemoryType = CU_MEMORYTYPE_ARRAY;
+    memcpy_struct.srcArray = data;
     memcpy_struct.dstXInBytes = 0;
     memcpy_struct.dstY = 0;
-    memcpy_struct.dstMemoryType = CU_MEMORYTYPE_DEVICE;
-    memcpy_struct.srcArray = data;
-    memcpy_struct.dstDevice = reinterpret_cast<CUdeviceptr>(frame->data[0]);
-    memcpy_struct.dstPitch = frame->linesize[0];
-    memcpy_struct.WidthInBytes = frame->linesize[0];
+
+    if (converter_) {
+        auto const destination = converter_->prepare(*frame);
+        memcpy_struct.dstMemoryType = CU_MEMORYTYPE_HOST;
+        memcpy_struct.dstHost = destination.data;
+        memcpy_struct.dstPitch = destination.pitch;
+    }
+    else {
+        if (auto const r = av_hwframe_get_buffer(
+                codec_context_->hw_frames_ctx, frame, 0);
+            r < 0)
+            throw std::runtime_error { "Failed to get H/W frame buffer" };
+
+        SC_EXPECT(frame->linesize[0]);
+        SC_EXPECT(frame->height);
+        SC_EXPECT(frame->data[0]);
+
+        memcpy_struct.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+        memcpy_struct.dstDevice =
+            reinterpret_cast<CUdeviceptr>(frame->data[0]);
+        memcpy_struct.dstPitch = frame->linesize[0];
+    }
+
+    /* The frame's rows may be padded beyond the width of the source
+     * array, e.g. for a scaled rendition, so only the pixels are
+     * copied...
+     */
+    memcpy_struct.WidthInBytes = frame->width * sizeof(std::uint32_t);
     memcpy_struct.Height = frame->height;
 
     if (auto const r = cuda.cuMemcpy2D_v2(&memcpy_struct); r != CUDA_SUCCESS) {
         char const* err = "unknown";
         cuda.cuGetErrorString(r, &err);
         throw std::runtime_error {
-            std::to_string(frame_number_) +
+            std::to_string(step.pts) +
             std::string { " Failed to copy CUDA buffer: " } + err
         };
     }
 
-    frame->pts = frame_number_++;
+    frame->pts = static_cast<std::int64_t>(step.pts);
+    keep_previous(frame);
+    encoder_frame->converter = converter_;
 
     encoder_.write_frame(std::move(encoder_frame));
 }
@@ -2,25 +2,46 @@
 #define SHADOW_CAST_HANDLERS_DRM_VIDEO_FRAME_WRITER_HPP_INCLUDED
 
 #include "av.hpp"
+#include "av/frame.hpp"
+#include "av/frame_converter.hpp"
 #include "nvidia.hpp"
 #include "services/encoder.hpp"
+#include "services/frame_scheduler.hpp"
+#include "utils/borrowed_ptr.hpp"
+#include "utils/frame_timeline.hpp"
 #include <cstdint>
+#include <memory>
 
 namespace sc
 {
+/* Writes each captured frame to an encoder. Frames are copied on the
+ * GPU for a hardware encoder, or downloaded into system memory for a
+ * software one. Any conversion to the software encoder's format is
+ * left to the encoder's context, so the capture thread only downloads
+ * and queues the frame...
+ */
 struct DRMVideoFrameWriter
 {
     DRMVideoFrameWriter(AVCodecContext* codec_context,
                         AVStream* stream,
-                        Encoder encoder);
+                        Encoder encoder,
+                        FrameTimeline& timeline);
 
-    auto operator()(CUarray, NvCuda const&, std::uint64_t) -> void;
+    auto operator()(CUarray, NvCuda const&, FrameTick const&) -> void;
 
 private:
+    auto write_duplicate(std::uint64_t pts) -> void;
+    auto keep_previous(AVFrame const*) -> void;
+
     BorrowedPtr<AVCodecContext> codec_context_;
     BorrowedPtr<AVStream> stream_;
     Encoder encoder_;
-    std::size_t frame_number_ { 0 };
+    BorrowedPtr<FrameTimeline> timeline_;
+    std::shared_ptr<FrameConverter> converter_;
+
+    /* The last frame written, kept for duplicating...
+     */
+    FramePtr previous_;
 };
 
 } // namespace sc
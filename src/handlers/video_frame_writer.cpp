@@ -1,24 +1,68 @@
 #include "handlers/video_frame_writer.hpp"
 #include "handlers/audio_chunk_writer.hpp"
+#include "error.hpp"
 #include "services/encoder.hpp"
+#include "utils/contracts.hpp"
 #include "utils/elapsed.hpp"
+#include <stdexcept>
 
 namespace sc
 {
 
 VideoFrameWriter::VideoFrameWriter(AVCodecContext* codec_context,
                                    AVStream* stream,
-                                   Encoder encoder)
+                                   Encoder encoder,
+                                   FrameTimeline& timeline)
     : codec_context_ { codec_context }
     , stream_ { stream }
     , encoder_ { encoder }
+    , timeline_ { &timeline }
 {
 }
 
+auto VideoFrameWriter::write_duplicate(std::uint64_t pts) -> void
+{
+    SC_EXPECT(previous_);
+
+    auto encoder_frame =
+        encoder_.prepare_frame(codec_context_.get(), stream_.get());
+    auto* frame = encoder_frame->frame.get();
+    if (auto const r = av_frame_ref(frame, previous_.get()); r < 0)
+        throw std::runtime_error { "Failed to duplicate frame: " +
+                                   av_error_to_string(r) };
+
+    frame->pts = static_cast<std::int64_t>(pts);
+    encoder_.write_frame(std::move(encoder_frame));
+}
+
+auto VideoFrameWriter::keep_previous(AVFrame const* frame) -> void
+{
+    if (timeline_->policy() != OverrunPolicy::duplicate)
+        return;
+
+    if (!previous_)
+        previous_ = FramePtr { av_frame_alloc() };
+    else
+        av_frame_unref(previous_.get());
+
+    if (auto const r = av_frame_ref(previous_.get(), frame); r < 0)
+        throw std::runtime_error { "Failed to keep frame: " +
+                                   av_error_to_string(r) };
+}
+
 auto VideoFrameWriter::operator()(CUdeviceptr cu_device_ptr,
                                   NVFBC_FRAME_GRAB_INFO,
-                                  std::uint64_t /*frame_time*/) -> void
+                                  FrameTick const& tick) -> void
 {
+    /* NvFBC grabs every frame into the same device buffer, which
+     * already holds the new frame by the time we're called, so a
+     * duplicate repeats the new frame's contents at the missed
+     * ticks. The timestamps are what keep the stream in sync...
+     */
+    auto const step = timeline_->step(tick.index, tick.missed);
+    for (std::uint64_t i = 0; i < step.duplicates; ++i)
+        write_duplicate(step.first_duplicate + i);
+
     auto encoder_frame =
         encoder_.prepare_frame(codec_context_.get(), stream_.get());
     auto* frame = encoder_frame->frame.get();
@@ -42,7 +86,8 @@ auto VideoFrameWriter::operator()(CUdeviceptr cu_device_ptr,
     frame->colorspace = codec_context_->colorspace;
     frame->chroma_location = codec_context_->chroma_sample_location;
 
-    frame->pts = frame_number_++;
+    frame->pts = static_cast<std::int64_t>(step.pts);
+    keep_previous(frame);
 
     encoder_.write_frame(std::move(encoder_frame));
 }
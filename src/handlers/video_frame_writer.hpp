@@ -2,8 +2,12 @@
 #define SHADOW_CAST_HANDLERS_VIDEO_FRAME_WRITER_HPP_INCLUDED
 
 #include "av.hpp"
+#include "av/frame.hpp"
 #include "nvidia.hpp"
 #include "services/encoder.hpp"
+#include "services/frame_scheduler.hpp"
+#include "utils/borrowed_ptr.hpp"
+#include "utils/frame_timeline.hpp"
 #include <cstdint>
 
 namespace sc
@@ -12,17 +16,25 @@ struct VideoFrameWriter
 {
     VideoFrameWriter(AVCodecContext* codec_context,
                      AVStream* stream,
-                     Encoder encoder);
+                     Encoder encoder,
+                     FrameTimeline& timeline);
 
     auto operator()(CUdeviceptr cu_device_ptr,
                     NVFBC_FRAME_GRAB_INFO,
-                    std::uint64_t) -> void;
+                    FrameTick const&) -> void;
 
 private:
+    auto write_duplicate(std::uint64_t pts) -> void;
+    auto keep_previous(AVFrame const*) -> void;
+
     BorrowedPtr<AVCodecContext> codec_context_;
     BorrowedPtr<AVStream> stream_;
     Encoder encoder_;
-    std::size_t frame_number_ { 0 };
+    BorrowedPtr<FrameTimeline> timeline_;
+
+    /* The last frame written, kept for duplicating...
+     */
+    FramePtr previous_;
 };
 
 } // namespace sc
@@ -7,5 +7,6 @@
 #include "./io/process.hpp"
 #include "./io/signals.hpp"
 #include "./io/unix_socket.hpp"
+#include "./io/write_behind_file.hpp"
 
 #endif // SHADOW_CAST_IO_HPP_INCLUDED
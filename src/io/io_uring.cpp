@@ -0,0 +1,176 @@
+#include "io/io_uring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+
+auto io_uring_setup(unsigned entries, io_uring_params& params) noexcept -> int
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+auto io_uring_enter(int fd,
+                    unsigned to_submit,
+                    unsigned min_complete,
+                    unsigned flags) noexcept -> int
+{
+    return static_cast<int>(::syscall(
+        __NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+auto map_ring(int fd, std::size_t size, off_t offset) -> void*
+{
+    auto* ptr = ::mmap(nullptr,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE,
+                       fd,
+                       offset);
+    if (ptr == MAP_FAILED)
+        throw std::system_error { errno, std::system_category() };
+
+    return ptr;
+}
+
+template <typename T>
+auto ring_ptr(void* ring, std::uint32_t offset) noexcept -> T*
+{
+    return reinterpret_cast<T*>(static_cast<std::byte*>(ring) + offset);
+}
+
+} // namespace
+
+namespace sc
+{
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params {};
+
+    /* The completion queue is made larger than the submission
+     * queue so that long-lived operations, such as polls, don't
+     * starve it...
+     */
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    if (fd_ = io_uring_setup(entries, params); fd_ < 0)
+        throw std::system_error { errno, std::system_category() };
+
+    features_ = params.features;
+
+    try {
+        sq_ring_size_ =
+            params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = sq_ring_;
+        }
+        else {
+            sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = map_ring(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+        }
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(
+            map_ring(fd_, sqes_size_, IORING_OFF_SQES));
+    }
+    catch (...) {
+        release();
+        throw;
+    }
+
+    sq_head_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_array_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.array);
+    sq_mask_ = *ring_ptr<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    cq_head_ = ring_ptr<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ring_ptr<unsigned>(cq_ring_, params.cq_off.tail);
+    cqes_ = ring_ptr<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    cq_mask_ = *ring_ptr<unsigned>(cq_ring_, params.cq_off.ring_mask);
+}
+
+IoUring::~IoUring() { release(); }
+
+auto IoUring::release() noexcept -> void
+{
+    if (sqes_)
+        static_cast<void>(::munmap(sqes_, sqes_size_));
+
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+        static_cast<void>(::munmap(cq_ring_, cq_ring_size_));
+
+    if (sq_ring_)
+        static_cast<void>(::munmap(sq_ring_, sq_ring_size_));
+
+    if (fd_ >= 0)
+        static_cast<void>(::close(fd_));
+
+    sqes_ = nullptr;
+    cq_ring_ = nullptr;
+    sq_ring_ = nullptr;
+    fd_ = -1;
+}
+
+auto IoUring::get_sqe() -> io_uring_sqe&
+{
+    while (pending() == sq_entries_)
+        static_cast<void>(submit_and_wait(0));
+
+    auto const index = sq_local_tail_ & sq_mask_;
+    sq_array_[index] = index;
+    sq_local_tail_ += 1;
+
+    auto& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    return sqe;
+}
+
+auto IoUring::submit_and_wait(unsigned wait_nr) -> bool
+{
+    std::atomic_ref { *sq_tail_ }.store(sq_local_tail_,
+                                        std::memory_order_release);
+
+    auto const flags = wait_nr ? IORING_ENTER_GETEVENTS : 0u;
+    if (io_uring_enter(fd_, pending(), wait_nr, flags) < 0) {
+        switch (errno) {
+        case EINTR:
+            return false;
+        /* The completion queue has overflowed, or the kernel is
+         * short of resources. Either way, the caller should reap
+         * some completions before trying again...
+         */
+        case EBUSY:
+        case EAGAIN:
+            return true;
+        default:
+            throw std::system_error { errno, std::system_category() };
+        }
+    }
+
+    return true;
+}
+
+auto IoUring::fd() const noexcept -> int { return fd_; }
+
+auto IoUring::pending() const noexcept -> unsigned
+{
+    return sq_local_tail_ -
+           std::atomic_ref { *sq_head_ }.load(std::memory_order_acquire);
+}
+
+} // namespace sc
@@ -0,0 +1,87 @@
+#ifndef SHADOW_CAST_IO_IO_URING_HPP_INCLUDED
+#define SHADOW_CAST_IO_IO_URING_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+namespace sc
+{
+
+/* A minimal io_uring instance, using the raw system calls rather
+ * than liburing. Submission entries are queued with `get_sqe()`
+ * and handed to the kernel by `submit_and_wait()`, which does
+ * both in a single `io_uring_enter()` call. Not thread safe...
+ */
+struct IoUring
+{
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(IoUring const&) = delete;
+    auto operator=(IoUring const&) -> IoUring& = delete;
+
+    /* Returns a zeroed submission entry. If the submission queue
+     * is full then the queued entries are submitted first...
+     */
+    auto get_sqe() -> io_uring_sqe&;
+
+    /* Submits all queued entries and waits for at least `wait_nr`
+     * completions. Returns false if the wait was interrupted by a
+     * signal...
+     */
+    auto submit_and_wait(unsigned wait_nr) -> bool;
+
+    /* Calls `f` with each available completion entry, then
+     * returns them to the kernel. Returns the number of entries
+     * processed...
+     */
+    template <typename F>
+    auto for_each_completion(F&& f) -> std::size_t
+    {
+        auto head =
+            std::atomic_ref { *cq_head_ }.load(std::memory_order_relaxed);
+        auto const tail =
+            std::atomic_ref { *cq_tail_ }.load(std::memory_order_acquire);
+
+        std::size_t n = 0;
+        for (; head != tail; ++head, ++n)
+            f(static_cast<io_uring_cqe const&>(cqes_[head & cq_mask_]));
+
+        std::atomic_ref { *cq_head_ }.store(head, std::memory_order_release);
+        return n;
+    }
+
+    [[nodiscard]] auto fd() const noexcept -> int;
+
+private:
+    auto pending() const noexcept -> unsigned;
+    auto release() noexcept -> void;
+
+    int fd_ { -1 };
+    unsigned features_ { 0 };
+
+    void* sq_ring_ { nullptr };
+    std::size_t sq_ring_size_ { 0 };
+    void* cq_ring_ { nullptr };
+    std::size_t cq_ring_size_ { 0 };
+    io_uring_sqe* sqes_ { nullptr };
+    std::size_t sqes_size_ { 0 };
+
+    unsigned* sq_head_ { nullptr };
+    unsigned* sq_tail_ { nullptr };
+    unsigned* sq_array_ { nullptr };
+    unsigned sq_mask_ { 0 };
+    unsigned sq_entries_ { 0 };
+    unsigned sq_local_tail_ { 0 };
+
+    unsigned* cq_head_ { nullptr };
+    unsigned* cq_tail_ { nullptr };
+    io_uring_cqe* cqes_ { nullptr };
+    unsigned cq_mask_ { 0 };
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_IO_IO_URING_HPP_INCLUDED
@@ -0,0 +1,358 @@
+#include "io/write_behind_file.hpp"
+#include "logging.hpp"
+#include "utils/elapsed.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/types.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+/* The background thread waits for at least `kWriteSize` bytes
+ * before writing, and writes at most `kMaxWriteSize` at once.
+ * `O_DIRECT` writes must be aligned to `kDirectAlignment`, in
+ * memory and in the file...
+ */
+std::size_t constexpr kWriteSize = 1'024 * 1'024;
+std::size_t constexpr kMaxWriteSize = 8 * kWriteSize;
+std::size_t constexpr kDirectAlignment = 4'096;
+
+auto ring_capacity(std::size_t requested) noexcept -> std::size_t
+{
+    auto const size = std::max(requested, 2 * kWriteSize);
+    return (size + kWriteSize - 1) / kWriteSize * kWriteSize;
+}
+
+auto write_all(int fd, std::span<std::uint8_t const> data, off_t offset)
+    -> void
+{
+    while (data.size()) {
+        auto const result = ::pwrite(fd, data.data(), data.size(), offset);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+
+            throw std::system_error { errno, std::system_category() };
+        }
+
+        data = data.subspan(result);
+        offset += result;
+    }
+}
+
+} // namespace
+
+namespace sc
+{
+
+WriteBehindFile::WriteBehindFile(std::string const& path,
+                                 WriteBehindOptions const& options)
+    : capacity_ { ring_capacity(options.buffer_size) }
+    , buffer_ { static_cast<std::uint8_t*>(
+          std::aligned_alloc(kDirectAlignment, capacity_)) }
+    , preallocate_ { options.preallocate }
+{
+    if (!buffer_)
+        throw std::bad_alloc {};
+
+    /* Fault the whole ring in now, rather than while capturing...
+     */
+    std::memset(buffer_.get(), 0, capacity_);
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw std::system_error { errno,
+                                  std::system_category(),
+                                  "Failed to open output file" };
+
+    if (options.direct_io) {
+        direct_fd_ = ::open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (direct_fd_ < 0)
+            log::warn("Couldn't open output file with O_DIRECT: "s +
+                      std::strerror(errno) + ". Using buffered writes");
+    }
+
+    try {
+        writer_ = std::thread { [&] { run_writer(); } };
+    }
+    catch (...) {
+        static_cast<void>(::close(fd_));
+        if (direct_fd_ >= 0)
+            static_cast<void>(::close(direct_fd_));
+
+        throw;
+    }
+}
+
+WriteBehindFile::~WriteBehindFile()
+{
+    try {
+        close();
+    }
+    catch (std::exception const& e) {
+        log::error("Failed to write output file: "s + e.what());
+    }
+}
+
+auto WriteBehindFile::write(std::span<std::uint8_t const> data) -> void
+{
+    if (position_ != end_) {
+        /* Not an append, so anything that's still buffered has to
+         * reach the file first...
+         */
+        drain();
+
+        if (position_ < end_) {
+            auto const n = std::min<std::uint64_t>(data.size(),
+                                                   end_ - position_);
+            write_all(fd_, data.first(n), static_cast<off_t>(position_));
+            position_ += n;
+            data = data.subspan(n);
+        }
+
+        if (data.size() && position_ > end_) {
+            std::lock_guard lock { mutex_ };
+            written_ = end_ = position_;
+        }
+    }
+
+    append(data);
+    position_ += data.size();
+    size_ = std::max(size_, position_);
+}
+
+auto WriteBehindFile::seek(std::int64_t offset, int whence) -> std::int64_t
+{
+    std::int64_t base;
+    switch (whence) {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = static_cast<std::int64_t>(position_);
+        break;
+    case SEEK_END:
+        base = static_cast<std::int64_t>(size_);
+        break;
+    default:
+        throw std::system_error { EINVAL, std::system_category() };
+    }
+
+    if (base + offset < 0)
+        throw std::system_error { EINVAL, std::system_category() };
+
+    position_ = static_cast<std::uint64_t>(base + offset);
+    return base + offset;
+}
+
+auto WriteBehindFile::size() const noexcept -> std::int64_t
+{
+    return static_cast<std::int64_t>(size_);
+}
+
+auto WriteBehindFile::is_direct() const noexcept -> bool
+{
+    return direct_fd_ >= 0;
+}
+
+auto WriteBehindFile::close() -> void
+{
+    if (!writer_.joinable())
+        return;
+
+    std::exception_ptr ex;
+    try {
+        drain();
+    }
+    catch (...) {
+        ex = std::current_exception();
+    }
+
+    {
+        std::lock_guard lock { mutex_ };
+        stopping_ = true;
+    }
+    data_ready_.notify_one();
+    writer_.join();
+
+    /* Give back any space that was preallocated past the end...
+     */
+    if (!ex && ::ftruncate(fd_, static_cast<off_t>(size_)) < 0)
+        ex = std::make_exception_ptr(
+            std::system_error { errno, std::system_category() });
+
+    static_cast<void>(::close(fd_));
+    if (direct_fd_ >= 0)
+        static_cast<void>(::close(direct_fd_));
+
+    if (ex)
+        std::rethrow_exception(ex);
+}
+
+auto WriteBehindFile::metrics() const -> WriteBehindMetrics
+{
+    std::lock_guard lock { mutex_ };
+    return metrics_;
+}
+
+auto WriteBehindFile::append(std::span<std::uint8_t const> data) -> void
+{
+    while (data.size()) {
+        std::size_t space;
+        {
+            std::unique_lock lock { mutex_ };
+            if (end_ - written_ == capacity_) {
+                Elapsed stalled;
+                metrics_.stalls += 1;
+                space_ready_.wait(lock, [&] {
+                    return error_ || end_ - written_ < capacity_;
+                });
+                metrics_.stall_time += stalled.nanosecond_value();
+            }
+
+            if (error_)
+                std::rethrow_exception(error_);
+
+            space = capacity_ - (end_ - written_);
+        }
+
+        /* The background thread never reads past `end_`, so the free
+         * part of the ring can be filled without holding the lock...
+         */
+        auto const index = end_ % capacity_;
+        auto const n = std::min({ data.size(), space, capacity_ - index });
+        std::memcpy(buffer_.get() + index, data.data(), n);
+        data = data.subspan(n);
+
+        std::size_t pending;
+        {
+            std::lock_guard lock { mutex_ };
+            end_ += n;
+            pending = end_ - written_;
+            metrics_.high_water = std::max(metrics_.high_water, pending);
+        }
+
+        if (pending >= kWriteSize)
+            data_ready_.notify_one();
+    }
+}
+
+auto WriteBehindFile::drain() -> void
+{
+    std::unique_lock lock { mutex_ };
+    if (written_ != end_) {
+        draining_ = true;
+        data_ready_.notify_one();
+        space_ready_.wait(lock, [&] { return error_ || written_ == end_; });
+        draining_ = false;
+    }
+
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+auto WriteBehindFile::run_writer() noexcept -> void
+{
+    std::unique_lock lock { mutex_ };
+    try {
+        while (true) {
+            data_ready_.wait(lock, [&] {
+                auto const pending = end_ - written_;
+                return stopping_ || pending >= kWriteSize ||
+                       (draining_ && pending);
+            });
+
+            auto const pending = end_ - written_;
+            if (!pending)
+                break;
+
+            auto const offset = written_;
+            lock.unlock();
+            Elapsed elapsed;
+            auto const n = write_out(offset, pending);
+            auto const write_time = elapsed.nanosecond_value();
+            lock.lock();
+
+            written_ += n;
+            metrics_.bytes_written += n;
+            metrics_.writes += 1;
+            metrics_.write_time += write_time;
+            space_ready_.notify_one();
+        }
+    }
+    catch (...) {
+        if (!lock.owns_lock())
+            lock.lock();
+
+        error_ = std::current_exception();
+        space_ready_.notify_one();
+    }
+}
+
+auto WriteBehindFile::write_out(std::uint64_t offset, std::uint64_t pending)
+    -> std::size_t
+{
+    auto const index = offset % capacity_;
+    auto size = std::min<std::uint64_t>(
+        { pending, capacity_ - index, kMaxWriteSize });
+
+    /* Only whole, aligned blocks can go through `O_DIRECT`. Anything
+     * either side of them, which only happens after a seek or at
+     * the end of the file, is written through the page cache...
+     */
+    auto fd = fd_;
+    if (direct_fd_ >= 0) {
+        if (auto const head = offset % kDirectAlignment; head) {
+            size = std::min<std::uint64_t>(size, kDirectAlignment - head);
+        }
+        else if (size >= kDirectAlignment) {
+            size -= size % kDirectAlignment;
+            fd = direct_fd_;
+        }
+    }
+
+    preallocate(offset, offset + size);
+
+    auto const result = ::pwrite(
+        fd, buffer_.get() + index, size, static_cast<off_t>(offset));
+    if (result < 0) {
+        if (errno == EINTR)
+            return 0;
+
+        throw std::system_error { errno, std::system_category() };
+    }
+
+    return static_cast<std::size_t>(result);
+}
+
+auto WriteBehindFile::preallocate(std::uint64_t offset,
+                                  std::uint64_t end) noexcept -> void
+{
+    if (!preallocate_ || end <= allocated_)
+        return;
+
+    /* Reserve the next chunk of the file, without changing its
+     * size. If the file system can't do this then the writes are
+     * no worse off than they would be without it...
+     */
+    auto const start = std::max(offset, allocated_);
+    auto const target = end + preallocate_;
+    if (::fallocate(fd_,
+                    FALLOC_FL_KEEP_SIZE,
+                    static_cast<off_t>(start),
+                    static_cast<off_t>(target - start)) < 0) {
+        preallocate_ = 0;
+        return;
+    }
+
+    allocated_ = target;
+}
+
+} // namespace sc
@@ -0,0 +1,150 @@
+#ifndef SHADOW_CAST_IO_WRITE_BEHIND_FILE_HPP_INCLUDED
+#define SHADOW_CAST_IO_WRITE_BEHIND_FILE_HPP_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+
+namespace sc
+{
+
+struct WriteBehindOptions
+{
+    /* The size of the ring buffer, in bytes. Rounded up to a whole
+     * number of writes...
+     */
+    std::size_t buffer_size { 64 * 1'024 * 1'024 };
+
+    /* Disk space is reserved this many bytes ahead of the data with
+     * `fallocate()`. Zero disables preallocation...
+     */
+    std::uint64_t preallocate { 256 * 1'024 * 1'024 };
+
+    /* Write with `O_DIRECT`, bypassing the page cache, if the file
+     * system supports it...
+     */
+    bool direct_io { false };
+};
+
+struct WriteBehindMetrics
+{
+    std::uint64_t bytes_written { 0 };
+    std::uint64_t writes { 0 };
+
+    /* Nanoseconds spent in write system calls...
+     */
+    std::uint64_t write_time { 0 };
+
+    /* The most bytes that were waiting to be written at once...
+     */
+    std::size_t high_water { 0 };
+
+    /* How many times, and for how many nanoseconds, a writer was
+     * made to wait because the buffer was full...
+     */
+    std::uint64_t stalls { 0 };
+    std::uint64_t stall_time { 0 };
+};
+
+/* A file that's written by a background thread. `write()` copies
+ * into a preallocated ring buffer, and the thread writes the ring
+ * out in large, aligned blocks. If the disk falls behind and the
+ * ring fills up then `write()` blocks until there's space again.
+ *
+ * Writes that land anywhere other than the end of the file, such
+ * as a muxer patching its header, first wait for the ring to be
+ * written out and are then written immediately.
+ *
+ * All members, other than `metrics()`, must be called from the
+ * same thread...
+ */
+struct WriteBehindFile
+{
+    explicit WriteBehindFile(std::string const& path,
+                             WriteBehindOptions const& options = {});
+    ~WriteBehindFile();
+
+    WriteBehindFile(WriteBehindFile const&) = delete;
+    auto operator=(WriteBehindFile const&) -> WriteBehindFile& = delete;
+
+    /* Writes `data` at the current position. Throws if the
+     * background thread has failed...
+     */
+    auto write(std::span<std::uint8_t const> data) -> void;
+
+    /* Moves the current position, with the same `whence` values as
+     * `lseek()`, and returns the new position...
+     */
+    auto seek(std::int64_t offset, int whence) -> std::int64_t;
+
+    [[nodiscard]] auto size() const noexcept -> std::int64_t;
+
+    /* True if the file was opened with `O_DIRECT`...
+     */
+    [[nodiscard]] auto is_direct() const noexcept -> bool;
+
+    /* Writes out everything that's buffered, stops the background
+     * thread and closes the file. Rethrows any error from the
+     * background thread. Calling this again does nothing...
+     */
+    auto close() -> void;
+
+    [[nodiscard]] auto metrics() const -> WriteBehindMetrics;
+
+private:
+    struct FreeDeleter
+    {
+        auto operator()(std::uint8_t* ptr) const noexcept -> void
+        {
+            std::free(ptr);
+        }
+    };
+
+    auto append(std::span<std::uint8_t const> data) -> void;
+    auto drain() -> void;
+    auto run_writer() noexcept -> void;
+    auto write_out(std::uint64_t offset, std::uint64_t pending)
+        -> std::size_t;
+    auto preallocate(std::uint64_t offset, std::uint64_t end) noexcept
+        -> void;
+
+    int fd_ { -1 };
+    int direct_fd_ { -1 };
+    std::size_t capacity_;
+    std::unique_ptr<std::uint8_t, FreeDeleter> buffer_;
+
+    /* Only used by the calling thread...
+     */
+    std::uint64_t position_ { 0 };
+    std::uint64_t size_ { 0 };
+
+    /* Only used by the background thread...
+     */
+    std::uint64_t preallocate_;
+    std::uint64_t allocated_ { 0 };
+
+    /* The ring holds the bytes of the file in `[written_, end_)`...
+     */
+    mutable std::mutex mutex_;
+    std::condition_variable data_ready_;
+    std::condition_variable space_ready_;
+    std::uint64_t written_ { 0 };
+    std::uint64_t end_ { 0 };
+    bool draining_ { false };
+    bool stopping_ { false };
+    std::exception_ptr error_;
+    WriteBehindMetrics metrics_;
+
+    std::thread writer_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_IO_WRITE_BEHIND_FILE_HPP_INCLUDED
@@ -5,24 +5,26 @@
 #include <X11/Xlib.h>
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
+#include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <future>
 #include <initializer_list>
 #include <iostream>
 #include <libavutil/dict.h>
 #include <libavutil/pixfmt.h>
 #include <memory>
+#include <optional>
 #include <signal.h>
 #include <string_view>
 #include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-#include "metrics/formatting.hpp"
-#include "metrics/metrics.hpp"
-#endif
 
 #if FF_API_BUFFER_SIZE_T
 using BufferSize = int;
@@ -65,6 +67,15 @@ auto set_drm_video_frame_handler(sc::Context& ctx, F&& handler)
         std::forward<F>(handler));
 }
 
+template <typename F>
+auto add_drm_scaled_frame_handler(sc::Context& ctx,
+                                  sc::Rendition const& rendition,
+                                  F&& handler)
+{
+    ctx.services().use_if<sc::DRMVideoService>()->add_scaled_frame_handler(
+        rendition.width, rendition.height, std::forward<F>(handler));
+}
+
 struct PipewireInit
 {
     PipewireInit(int& argc, char** argv) noexcept { pw_init(&argc, &argv); }
@@ -91,49 +102,710 @@ auto apply_audio_codec_modifiers(AVCodec const& codec, AVDictionary*& output)
     }
 }
 
+auto frame_pacing(sc::Parameters const& params) noexcept -> sc::FramePacing
+{
+    return sc::FramePacing { .spin_threshold = params.spin_threshold,
+                             .timer_slack = params.timer_slack };
+}
+
+auto reactor_backend(sc::Parameters const& params) noexcept
+    -> sc::ReactorBackendType
+{
+    return params.use_io_uring ? sc::ReactorBackendType::io_uring
+                               : sc::ReactorBackendType::epoll;
+}
+
+auto write_behind_options(sc::Parameters const& params) noexcept
+    -> sc::WriteBehindOptions
+{
+    return sc::WriteBehindOptions { .buffer_size = params.write_buffer_size,
+                                    .direct_io = params.direct_io };
+}
+
+auto is_segmented(sc::Parameters const& params) noexcept -> bool
+{
+    return params.segment_duration || params.segment_max_bytes;
+}
+
+/* Options for every output file's header...
+ */
+auto header_options(sc::Parameters const& params,
+                    AVFormatContext const& format_context) -> sc::DictionaryPtr
+{
+    if (!params.fragment_duration)
+        return nullptr;
+
+    return sc::fragment_options(*format_context.oformat);
+}
+
+/* The file that the muxer writes to. In replay mode nothing is
+ * written until a replay is saved, and segmented output writes to
+ * files of its own, so in either case there isn't one...
+ */
+struct SessionOutput
+{
+    std::optional<sc::WriteBehindFile> file;
+    sc::IOContextPtr io_context;
+};
+
+auto open_output(sc::Parameters const& params,
+                 AVFormatContext& format_context,
+                 SessionOutput& output) -> void
+{
+    if (params.replay_duration || is_segmented(params))
+        return;
+
+    output.file.emplace(params.output_file, write_behind_options(params));
+    output.io_context = sc::make_io_context(*output.file);
+    format_context.pb = output.io_context.get();
+    format_context.flags |= AVFMT_FLAG_CUSTOM_IO;
+    sc::write_header(format_context,
+                     header_options(params, format_context).get());
+}
+
+/* Times each phase of shutting down, and holds the deadline that
+ * the capture and encoders, and then the muxer, each have to finish
+ * by...
+ */
+struct Shutdown
+{
+    explicit Shutdown(std::uint64_t timeout) noexcept
+        : timeout_ { timeout }
+    {
+    }
+
+    /* Called once the capture has been asked to stop...
+     */
+    auto start() noexcept -> void
+    {
+        started_ = true;
+        total_.reset();
+        phase_.reset();
+        restart_deadline();
+    }
+
+    auto restart_deadline() noexcept -> void
+    {
+        deadline_ = std::chrono::steady_clock::now() +
+                    std::chrono::nanoseconds { timeout_ };
+    }
+
+    [[nodiscard]] auto deadline() const noexcept
+        -> std::chrono::steady_clock::time_point
+    {
+        return deadline_;
+    }
+
+    auto end_phase(std::string_view description) -> void
+    {
+        if (!started_)
+            return;
+
+        std::cerr << description << " in " << phase_.value() << " ms\n";
+        phase_.reset();
+    }
+
+    auto finish() -> void
+    {
+        if (started_)
+            std::cerr << "Shut down in " << total_.value() << " ms\n";
+    }
+
+private:
+    std::uint64_t timeout_;
+    bool started_ { false };
+    sc::Elapsed total_;
+    sc::Elapsed phase_;
+    std::chrono::steady_clock::time_point deadline_ {};
+};
+
+/* Writes the trailer, waits for the output file to reach the disk,
+ * and reports how well the disk kept up...
+ */
+auto close_output(AVFormatContext& format_context,
+                  SessionOutput& output,
+                  Shutdown& shutdown) noexcept -> void
+{
+    SC_SCOPE_GUARD([&] { shutdown.finish(); });
+    if (!output.file)
+        return;
+
+    if (auto const ret = av_write_trailer(&format_context); ret < 0)
+        std::cerr << "Failed to write trailer: "
+                  << sc::av_error_to_string(ret) << '\n';
+
+    try {
+        output.file->close();
+        shutdown.end_phase("Finished the output file");
+    }
+    catch (std::exception const& e) {
+        std::cerr << "Failed to write output file: " << e.what() << '\n';
+        return;
+    }
+
+    auto const metrics = output.file->metrics();
+    if (metrics.stalls)
+        std::cerr << "WARNING: Encoding was held up " << metrics.stalls
+                  << " times waiting for the disk\n";
+
+#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
+    auto constexpr kBytesPerMiB = 1'024.0 * 1'024.0;
+    auto const mib = metrics.bytes_written / kBytesPerMiB;
+    auto const seconds = metrics.write_time / 1'000'000'000.0;
+    std::cout << "\nOutput File\n"
+              << "Written: " << mib << " MiB in " << metrics.writes
+              << " writes (" << (seconds > 0 ? mib / seconds : 0)
+              << " MiB/s)\n"
+              << "High water: " << metrics.high_water / kBytesPerMiB
+              << " MiB\n"
+              << "Stalls: " << metrics.stalls << " ("
+              << metrics.stall_time / 1'000'000 << " ms)\n";
+#endif
+}
+
+/* The contexts that encode each stream, and the one that muxes
+ * their packets into the output. Each rendition, and each audio
+ * track, has an encoder context of its own...
+ */
+struct MediaContexts
+{
+    MediaContexts(sc::FrameTime const& frame_time,
+                  std::size_t renditions,
+                  std::size_t audio_tracks)
+        : video_encoder { frame_time }
+        , muxer { frame_time }
+    {
+        for (std::size_t i = 0; i < renditions; ++i)
+            rendition_encoders.push_back(
+                std::make_unique<sc::Context>(frame_time));
+
+        for (std::size_t i = 0; i < audio_tracks; ++i)
+            audio_encoders.push_back(
+                std::make_unique<sc::Context>(frame_time));
+    }
+
+    auto encoders() -> std::vector<sc::Context*>
+    {
+        std::vector<sc::Context*> result { &video_encoder };
+        for (auto& c : rendition_encoders)
+            result.push_back(c.get());
+
+        for (auto& c : audio_encoders)
+            result.push_back(c.get());
+
+        return result;
+    }
+
+    /* The name of each of `encoders()`, in the same order...
+     */
+    auto encoder_names() const -> std::vector<std::string>
+    {
+        std::vector<std::string> result { "Video" };
+        for (std::size_t i = 0; i < rendition_encoders.size(); ++i)
+            result.push_back("Rendition " + std::to_string(i + 1));
+
+        for (std::size_t i = 0; i < audio_encoders.size(); ++i)
+            result.push_back(audio_encoders.size() == 1
+                                 ? std::string { "Audio" }
+                                 : "Audio " + std::to_string(i + 1));
+
+        return result;
+    }
+
+    sc::Context video_encoder;
+    sc::Context muxer;
+    std::vector<std::unique_ptr<sc::Context>> rendition_encoders;
+    std::vector<std::unique_ptr<sc::Context>> audio_encoders;
+};
+
+/* A stream's encoder, and what it needs to be flushed...
+ */
+struct EncoderStage
+{
+    sc::Context& context;
+    sc::BorrowedPtr<AVCodecContext> codec;
+    sc::BorrowedPtr<AVStream> stream;
+};
+
+/* Adds a stream, to `format_context`, for the packets of a video
+ * encoder...
+ */
+auto add_video_stream(AVFormatContext& format_context,
+                      AVCodecContext const& encoder_context)
+    -> sc::BorrowedPtr<AVStream>
+{
+    sc::BorrowedPtr<AVStream> stream { avformat_new_stream(
+        &format_context, encoder_context.codec) };
+    if (!stream)
+        throw sc::CodecError { "Failed to allocate video stream" };
+
+    if (auto const ret = avcodec_parameters_from_context(stream->codecpar,
+                                                         &encoder_context);
+        ret < 0) {
+        throw sc::CodecError {
+            "Failed to copy video codec parameters from context: " +
+            sc::av_error_to_string(ret)
+        };
+    }
+
+    return stream;
+}
+
+/* Creates an encoder for `size` frames of the captured video. NVENC
+ * encodes them straight from the GPU, while a software encoder is
+ * given them in system memory, and shares the encoder CPUs with the
+ * renditions' encoders...
+ */
+auto create_capture_encoder(sc::Parameters const& params,
+                            CUcontext cuda_ctx,
+                            sc::VideoOutputSize size,
+                            std::int64_t bit_rate = 0) -> sc::CodecContextPtr
+{
+    if (!sc::is_software_video_encoder(params.video_encoder))
+        return sc::create_video_encoder(params.video_encoder,
+                                        cuda_ctx,
+                                        nullptr,
+                                        size,
+                                        params.frame_time,
+                                        AV_PIX_FMT_RGB0,
+                                        bit_rate);
+
+    /* The encoder starts its threads when it's opened, and they keep
+     * the affinity of the thread that opened it...
+     */
+    sc::ThreadPolicyGuard policy { sc::ThreadPolicy {
+        .cpus = params.topology.encoder.cpus } };
+
+    return sc::create_software_video_encoder(
+        params.video_encoder,
+        size,
+        params.frame_time,
+        AV_PIX_FMT_RGB0,
+        sc::encoder_thread_budget(params.topology,
+                                  params.renditions.size() + 1),
+        bit_rate);
+}
+
+/* A scaled encode of the captured video, written as an extra
+ * stream. See `Rendition`...
+ */
+struct RenditionStage
+{
+    sc::Rendition rendition;
+    sc::CodecContextPtr codec;
+    sc::BorrowedPtr<AVStream> stream;
+    sc::FrameTimeline timeline;
+};
+
+auto create_renditions(sc::Parameters const& params,
+                       CUcontext cuda_ctx,
+                       AVFormatContext& format_context)
+    -> std::vector<RenditionStage>
+{
+    std::vector<RenditionStage> renditions;
+    renditions.reserve(params.renditions.size());
+    for (auto const& rendition : params.renditions) {
+        auto codec = create_capture_encoder(
+            params,
+            cuda_ctx,
+            { .width = rendition.width, .height = rendition.height },
+            rendition.bit_rate);
+        auto stream = add_video_stream(format_context, *codec);
+        renditions.push_back(RenditionStage {
+            .rendition = rendition,
+            .codec = std::move(codec),
+            .stream = stream,
+            .timeline = sc::FrameTimeline { params.overrun_policy,
+                                            params.max_duplicates } });
+    }
+
+    return renditions;
+}
+
+/* The video encoder, followed by each rendition's...
+ */
+auto video_encoder_stages(MediaContexts& media,
+                          EncoderStage video,
+                          std::vector<RenditionStage> const& renditions)
+    -> std::vector<EncoderStage>
+{
+    std::vector<EncoderStage> stages { video };
+    for (std::size_t i = 0; i < renditions.size(); ++i)
+        stages.push_back(EncoderStage { *media.rendition_encoders[i],
+                                        renditions[i].codec.get(),
+                                        renditions[i].stream.get() });
+
+    return stages;
+}
+
+/* An encode of the captured audio, written as a stream of its own.
+ * Each audio source has a track, unless they're mixed into one...
+ */
+struct AudioTrack
+{
+    sc::CodecContextPtr codec;
+    sc::BorrowedPtr<AVStream> stream;
+};
+
+auto create_audio_encoder(sc::Parameters const& params,
+                          sc::BorrowedPtr<AVCodec const> encoder,
+                          sc::SampleFormat sample_format)
+    -> sc::CodecContextPtr
+{
+    sc::CodecContextPtr audio_encoder_context { avcodec_alloc_context3(
+        encoder.get()) };
+    if (!audio_encoder_context)
+        throw sc::CodecError { "Failed to allocate audio codec context" };
+
+#if LIBAVCODEC_VERSION_MAJOR < 60
+    audio_encoder_context->channels = 2;
+    audio_encoder_context->channel_layout = av_get_default_channel_layout(2);
+#else
+    av_channel_layout_default(&audio_encoder_context->ch_layout, 2);
+#endif
+    audio_encoder_context->sample_rate = params.sample_rate;
+    audio_encoder_context->sample_fmt =
+        sc::convert_to_libav_format(sample_format);
+    audio_encoder_context->bit_rate = 128'000;
+    audio_encoder_context->time_base = AVRational { 1, params.sample_rate };
+    audio_encoder_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary* options = nullptr;
+    apply_audio_codec_modifiers(*encoder, options);
+
+    if (auto const ret =
+            avcodec_open2(audio_encoder_context.get(), encoder.get(), &options);
+        ret < 0) {
+        throw sc::CodecError { "Failed to open audio codec: " +
+                               sc::av_error_to_string(ret) };
+    }
+
+    return audio_encoder_context;
+}
+
+/* Audio streams are added before any video stream, so the tracks
+ * keep the indexes they've always had...
+ */
+auto create_audio_tracks(sc::Parameters const& params,
+                         AVFormatContext& format_context)
+    -> std::vector<AudioTrack>
+{
+    sc::BorrowedPtr<AVCodec const> encoder { avcodec_find_encoder_by_name(
+        params.audio_encoder.c_str()) };
+    if (!encoder) {
+        throw sc::CodecError { "Failed to find required audio codec" };
+    }
+
+    if (!sc::is_sample_rate_supported(params.sample_rate, encoder))
+        throw std::runtime_error { "Sample rate not supported by codec: " +
+                                   std::to_string(params.sample_rate) };
+
+    auto const supported_formats = find_supported_formats(encoder);
+    if (!supported_formats.size())
+        throw std::runtime_error { "No supported sample formats found" };
+
+    auto const num_tracks =
+        params.mix_audio ? std::size_t { 1 } : params.audio_sources.size();
+    std::vector<AudioTrack> tracks;
+    tracks.reserve(num_tracks);
+    for (std::size_t i = 0; i < num_tracks; ++i) {
+        auto codec =
+            create_audio_encoder(params, encoder, supported_formats.front());
+        sc::BorrowedPtr<AVStream> stream { avformat_new_stream(
+            &format_context, codec->codec) };
+
+        if (!stream)
+            throw sc::CodecError { "Failed to allocate audio stream" };
+
+        if (auto const ret = avcodec_parameters_from_context(stream->codecpar,
+                                                             codec.get());
+            ret < 0) {
+            throw sc::CodecError {
+                "Failed to copy codec parameters from context: " +
+                sc::av_error_to_string(ret)
+            };
+        }
+
+        /* Names each track after what it holds, so players can tell
+         * them apart...
+         */
+        if (params.audio_sources.size() > 1) {
+            auto const title =
+                params.mix_audio
+                    ? std::string { "Mix" }
+                    : sc::audio_source_name(params.audio_sources[i]);
+            av_dict_set(&stream->metadata, "title", title.c_str(), 0);
+        }
+
+        tracks.push_back(AudioTrack { .codec = std::move(codec),
+                                      .stream = stream });
+    }
+
+    return tracks;
+}
+
+auto audio_encoder_stages(MediaContexts& media,
+                          std::vector<AudioTrack> const& tracks)
+    -> std::vector<EncoderStage>
+{
+    std::vector<EncoderStage> stages;
+    for (std::size_t i = 0; i < tracks.size(); ++i)
+        stages.push_back(EncoderStage { *media.audio_encoders[i],
+                                        tracks[i].codec.get(),
+                                        tracks[i].stream.get() });
+
+    return stages;
+}
+
+/* Writes each source's chunks to its own track or, when they're
+ * mixed, mixes them and writes the one track...
+ */
+auto audio_chunk_handler(sc::Parameters const& params,
+                         MediaContexts& media,
+                         std::vector<AudioTrack> const& tracks,
+                         std::size_t frame_size)
+    -> sc::AudioService::ChunkReceiverType
+{
+    auto const writer = [&](std::size_t i) {
+        return sc::ChunkWriter { tracks[i].codec.get(),
+                                 tracks[i].stream.get(),
+                                 sc::Encoder { *media.audio_encoders[i] },
+                                 frame_size };
+    };
+
+    if (params.mix_audio) {
+        std::vector<float> gains;
+        for (auto const& source : params.audio_sources)
+            gains.push_back(source.gain);
+
+        return sc::AudioService::ChunkReceiverType { sc::AudioMixer {
+            std::move(gains),
+            sc::convert_from_libav_format(tracks.front().codec->sample_fmt),
+            2,
+            frame_size,
+            static_cast<std::size_t>(params.sample_rate),
+            sc::AudioMixer::OutputType { writer(0) } } };
+    }
+
+    std::vector<sc::ChunkWriter> writers;
+    for (std::size_t i = 0; i < tracks.size(); ++i)
+        writers.push_back(writer(i));
+
+    return sc::AudioService::ChunkReceiverType {
+        [writers = std::move(writers)](
+            std::size_t source, sc::MediaChunkPool::ItemPtr chunk) mutable {
+            writers[source](std::move(chunk));
+        }
+    };
+}
+
+/* Sources are captured in the encoder's format, unless they're to be
+ * mixed first...
+ */
+auto add_audio_service(sc::Parameters const& params,
+                       sc::Context& audio,
+                       std::vector<AudioTrack> const& tracks,
+                       std::size_t frame_size) -> void
+{
+    auto const sample_format =
+        params.mix_audio
+            ? sc::SampleFormat::float_planar
+            : sc::convert_from_libav_format(tracks.front().codec->sample_fmt);
+
+    audio.services().add_from_factory<sc::AudioService>([&] {
+        return std::make_unique<sc::AudioService>(params.audio_sources,
+                                                  sample_format,
+                                                  params.sample_rate,
+                                                  frame_size);
+    });
+}
+
+auto add_media_services(sc::Parameters const& params,
+                        MediaContexts& media,
+                        sc::BorrowedPtr<AVFormatContext> format_context)
+    -> void
+{
+    media.muxer.services().add_from_factory<sc::MuxerService>([&] {
+        if (params.replay_duration)
+            return std::make_unique<sc::MuxerService>(
+                format_context,
+                sc::ReplayLimits { .duration = params.replay_duration,
+                                   .max_bytes = params.replay_max_bytes });
+
+        if (is_segmented(params))
+            return std::make_unique<sc::MuxerService>(
+                format_context,
+                sc::SegmentLimits { .duration = params.segment_duration,
+                                    .max_bytes = params.segment_max_bytes },
+                write_behind_options(params),
+                header_options(params, *format_context));
+
+        return std::make_unique<sc::MuxerService>(format_context);
+    });
+
+    auto muxer = sc::BorrowedPtr<sc::MuxerService> {
+        media.muxer.services().use_if<sc::MuxerService>()
+    };
+    if (params.fragment_duration)
+        muxer->set_fragment_duration(params.fragment_duration);
+
+    /* A sink that can't finish within the shutdown timeout is given
+     * up on, rather than holding up the main output...
+     */
+    for (auto const& url : params.tee_outputs)
+        muxer->add_sink(
+            url,
+            sc::TeeSinkOptions { .close_timeout = std::chrono::nanoseconds {
+                                     params.shutdown_timeout } });
+
+    for (auto* c : media.encoders()) {
+        c->services().add_from_factory<sc::EncoderService>(
+            [&] {
+                return std::make_unique<sc::EncoderService>(
+                    muxer, params.encoder_queue);
+            });
+    }
+}
+
+auto configure_contexts(sc::Parameters const& params,
+                        sc::Context& video,
+                        sc::Context& audio,
+                        MediaContexts& media) -> void
+{
+    video.set_pacing(frame_pacing(params));
+    auto media_contexts = media.encoders();
+    media_contexts.push_back(&media.muxer);
+    for (auto* c : { &video, &audio })
+        c->set_backend(reactor_backend(params));
+
+    video.set_thread_policy(params.topology.video);
+    audio.set_thread_policy(params.topology.audio);
+    for (auto* c : media_contexts) {
+        c->set_backend(reactor_backend(params));
+        c->set_thread_policy(params.topology.encoder);
+    }
+
+    /* By now the encoders, and their frame pools, have been
+     * allocated, so locking memory here faults them all in before
+     * the first frame is captured...
+     */
+    if (params.topology.lock_memory && !sc::lock_memory())
+        std::cerr << "WARNING: Couldn't lock memory: "
+                  << std::strerror(errno) << '\n';
+}
+
+/* Warns about any frames that were dropped because an encoder fell
+ * too far behind...
+ */
+auto report_encoder_queues(MediaContexts& media) -> void
+{
+    auto const encoders = media.encoders();
+    auto const names = media.encoder_names();
+    for (std::size_t i = 0; i < encoders.size(); ++i) {
+        auto const metrics = encoders[i]
+                                 ->services()
+                                 .use_if<sc::EncoderService>()
+                                 ->queue_metrics();
+        if (metrics.dropped)
+            std::cerr << "WARNING: The " << names[i] << " encoder fell "
+                      << "behind, and dropped " << metrics.dropped
+                      << " frames\n";
+
+#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
+        std::cout << names[i] << " Encoder Queue\n"
+                  << "High water: " << metrics.high_water << " frames\n"
+                  << "Dropped: " << metrics.dropped << " frames\n\n";
+#endif
+    }
+}
+
 auto run_loop(sc::Context& main,
-              sc::Context& media,
               sc::Context& audio,
-              sc::BorrowedPtr<AVCodecContext> video_codec,
-              sc::BorrowedPtr<AVStream> video_stream,
-              sc::BorrowedPtr<AVCodecContext> audio_codec,
-              sc::BorrowedPtr<AVStream> audio_stream) -> void
+              MediaContexts& media,
+              std::vector<EncoderStage> const& video_encoders,
+              std::vector<EncoderStage> const& audio_encoders,
+              sc::FrameTimeline const& video_timeline,
+              Shutdown& shutdown) -> void
 {
     std::mutex exception_mutex;
     std::exception_ptr ex;
-    sc::Encoder encoder { media };
+
+    auto const capture_exception = [&] {
+        std::lock_guard lock { exception_mutex };
+        if (!ex)
+            ex = std::current_exception();
+    };
 
     auto const stop = [&] {
         main.request_stop();
         audio.request_stop();
     };
 
-    main.services().add<sc::SignalService>(sc::SignalService {});
-    add_signal_handler(main, SIGINT, [&](std::uint32_t) { stop(); });
+    auto const start = [&](sc::Context& ctx) {
+        return std::async(std::launch::async, [&, c = &ctx] {
+            SC_SCOPE_GUARD([&] { stop(); });
+            try {
+                c->run();
+            }
+            catch (...) {
+                capture_exception();
+            }
+        });
+    };
 
-    auto media_thread = std::thread([&] {
-        SC_SCOPE_GUARD([&] { stop(); });
+    auto const flush = [&](EncoderStage const& stage) {
         try {
-            media.run();
+            sc::Encoder { stage.context }.flush(stage.codec, stage.stream);
         }
         catch (...) {
-            std::lock_guard lock { exception_mutex };
-            if (!ex)
-                ex = std::current_exception();
+            capture_exception();
         }
-    });
 
-    auto audio_thread = std::thread([&] {
-        SC_SCOPE_GUARD([&] { stop(); });
-        try {
-            audio.run();
-        }
-        catch (...) {
-            std::lock_guard lock { exception_mutex };
-            if (!ex)
-                ex = std::current_exception();
-        }
-    });
+        stage.context.request_stop();
+    };
+
+    auto const finished_in_time = [&](std::future<void> const& f) {
+        return f.wait_until(shutdown.deadline()) == std::future_status::ready;
+    };
+
+    /* A thread that's still running once it's been abandoned, and
+     * given another timeout, is stuck somewhere it can't be
+     * interrupted, e.g. inside a codec, or PipeWire. It can't be
+     * joined, and still references the session, so the process exits
+     * without finishing the output...
+     */
+    auto const finish_or_exit = [&](std::future<void> const& f,
+                                    std::string_view name) {
+        if (finished_in_time(f))
+            return;
+
+        std::cerr << "ERROR: The " << name << " didn't stop. Exiting "
+                  << "without finishing the output\n";
+        std::_Exit(EXIT_FAILURE);
+    };
+
+    main.services().add<sc::SignalService>(sc::SignalService {});
+    add_signal_handler(main, SIGINT, [&](std::uint32_t) { stop(); });
+
+    if (auto* muxer = media.muxer.services().use_if<sc::MuxerService>();
+        muxer->is_replay())
+        add_signal_handler(
+            main, SIGUSR1, [=](std::uint32_t) { muxer->save_replay(); });
+
+    /* The video and audio are captured on one timeline, so that their
+     * timestamps line up...
+     */
+    auto const origin = main.clock().now();
+    main.set_origin(origin);
+    audio.set_origin(origin);
+
+    auto muxer_thread = start(media.muxer);
+    std::vector<std::future<void>> encoder_threads;
+    for (auto const& stage : video_encoders)
+        encoder_threads.push_back(start(stage.context));
+    for (auto const& stage : audio_encoders)
+        encoder_threads.push_back(start(stage.context));
+    auto audio_thread = start(audio);
 
     {
         SC_SCOPE_GUARD([&] { stop(); });
@@ -141,31 +813,101 @@ auto run_loop(sc::Context& main,
             main.run();
         }
         catch (...) {
-            std::lock_guard lock { exception_mutex };
-            if (!ex)
-                ex = std::current_exception();
+            capture_exception();
         }
     }
 
+    shutdown.start();
     std::cerr << "Finalizing output. Please wait...\n";
 
-    audio_thread.join();
+    /* The video capture has stopped, so the video encoders can be
+     * flushed while the audio is still stopping. Each encoder drains
+     * its queue, and the flushed packets, into the muxer, which
+     * writes them as they arrive...
+     */
+    for (auto const& stage : video_encoders)
+        flush(stage);
 
-    try {
-        encoder.flush(video_codec.get(), video_stream.get());
-        encoder.flush(audio_codec.get(), audio_stream.get());
+    /* Stopping the audio capture has to finish by the deadline too.
+     * There's nothing queued to discard, so it's just given one more
+     * timeout...
+     */
+    if (!finished_in_time(audio_thread)) {
+        std::cerr << "WARNING: The audio capture didn't stop in time\n";
+        shutdown.restart_deadline();
+        finish_or_exit(audio_thread, "audio capture");
     }
-    catch (...) {
-        std::lock_guard lock { exception_mutex };
-        if (!ex)
-            ex = std::current_exception();
+
+    shutdown.end_phase("Stopped capturing");
+    for (auto const& stage : audio_encoders)
+        flush(stage);
+
+    if (!std::all_of(
+            encoder_threads.begin(), encoder_threads.end(), finished_in_time)) {
+        std::cerr << "WARNING: The encoders didn't finish in time. "
+                     "Discarding the frames still queued\n";
+        for (auto* c : media.encoders())
+            c->services().use_if<sc::EncoderService>()->abandon();
+
+        shutdown.restart_deadline();
+        for (auto const& t : encoder_threads)
+            finish_or_exit(t, "encoders");
     }
 
-    media.request_stop();
-    media_thread.join();
+    shutdown.end_phase("Flushed the encoders");
+
+    /* Only once every encoder has stopped can the muxer be stopped.
+     * It has a deadline of its own...
+     */
+    shutdown.restart_deadline();
+    media.muxer.request_stop();
+    if (!finished_in_time(muxer_thread)) {
+        std::cerr << "WARNING: The muxer didn't finish in time. "
+                     "Discarding the packets still queued\n";
+        media.muxer.services().use_if<sc::MuxerService>()->abandon();
+
+        shutdown.restart_deadline();
+        finish_or_exit(muxer_thread, "muxer");
+    }
+
+    shutdown.end_phase("Drained the muxer");
 
     if (ex)
         std::rethrow_exception(ex);
+
+    if (auto const& counts = video_timeline.counts();
+        counts.dropped || counts.duplicated)
+        std::cerr << "Video frames dropped: " << counts.dropped
+                  << ", duplicated: " << counts.duplicated << '\n';
+
+    report_encoder_queues(media);
+
+#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
+    sc::format_context_metrics(std::cout, main.metrics(), "Video Context");
+    std::cout << '\n';
+    sc::format_context_metrics(std::cout, audio.metrics(), "Audio Context");
+    std::cout << '\n';
+    sc::format_context_metrics(
+        std::cout, media.video_encoder.metrics(), "Video Encoder Context");
+    std::cout << '\n';
+    for (std::size_t i = 0; i < media.rendition_encoders.size(); ++i) {
+        sc::format_context_metrics(std::cout,
+                                   media.rendition_encoders[i]->metrics(),
+                                   "Rendition " + std::to_string(i + 1) +
+                                       " Encoder Context");
+        std::cout << '\n';
+    }
+    auto const names = media.encoder_names();
+    auto const first_audio = names.size() - media.audio_encoders.size();
+    for (std::size_t i = 0; i < media.audio_encoders.size(); ++i) {
+        sc::format_context_metrics(std::cout,
+                                   media.audio_encoders[i]->metrics(),
+                                   names[first_audio + i] + " Encoder Context");
+        std::cout << '\n';
+    }
+    sc::format_context_metrics(
+        std::cout, media.muxer.metrics(), "Muxer Context");
+#endif
 }
 
 auto run_wayland(sc::Parameters const& params, sc::wayland::DisplayPtr display)
@@ -193,64 +935,7 @@ auto run_wayland(sc::Parameters const& params, sc::wayland::DisplayPtr display)
     }
 
     sc::FormatContextPtr format_context { fc_tmp };
-    sc::BorrowedPtr<AVCodec const> encoder { avcodec_find_encoder_by_name(
-        params.audio_encoder.c_str()) };
-    if (!encoder) {
-        throw sc::CodecError { "Failed to find required audio codec" };
-    }
-
-    if (!sc::is_sample_rate_supported(params.sample_rate, encoder))
-        throw std::runtime_error { "Sample rate not supported by codec: " +
-                                   std::to_string(params.sample_rate) };
-
-    auto const supported_formats = find_supported_formats(encoder);
-    if (!supported_formats.size())
-        throw std::runtime_error { "No supported sample formats found" };
-
-    sc::CodecContextPtr audio_encoder_context { avcodec_alloc_context3(
-        encoder.get()) };
-    if (!audio_encoder_context)
-        throw sc::CodecError { "Failed to allocate audio codec context" };
-
-#if LIBAVCODEC_VERSION_MAJOR < 60
-    audio_encoder_context->channels = 2;
-    audio_encoder_context->channel_layout = av_get_default_channel_layout(2);
-#else
-    av_channel_layout_default(&audio_encoder_context->ch_layout, 2);
-#endif
-    audio_encoder_context->sample_rate = params.sample_rate;
-    audio_encoder_context->sample_fmt =
-        sc::convert_to_libav_format(supported_formats.front());
-    audio_encoder_context->bit_rate = 128'000;
-    audio_encoder_context->time_base = AVRational { 1, params.sample_rate };
-    audio_encoder_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-
-    AVDictionary* options = nullptr;
-    apply_audio_codec_modifiers(*encoder, options);
-
-    if (auto const ret =
-            avcodec_open2(audio_encoder_context.get(), encoder.get(), &options);
-        ret < 0) {
-        throw sc::CodecError { "Failed to open audio codec: " +
-                               sc::av_error_to_string(ret) };
-    }
-
-    sc::BorrowedPtr<AVStream> stream { avformat_new_stream(
-        format_context.get(), audio_encoder_context->codec) };
-
-    if (!stream)
-        throw sc::CodecError { "Failed to allocate audio stream" };
-
-    stream->index = 0;
-
-    if (auto const ret = avcodec_parameters_from_context(
-            stream->codecpar, audio_encoder_context.get());
-        ret < 0) {
-        throw sc::CodecError {
-            "Failed to copy codec parameters from context: " +
-            sc::av_error_to_string(ret)
-        };
-    }
+    auto audio_tracks = create_audio_tracks(params, *format_context);
 
     /* cuMemcpy2D seems to fail if
      * we use the buffer pool. Hmm...
@@ -260,56 +945,30 @@ auto run_wayland(sc::Parameters const& params, sc::wayland::DisplayPtr display)
     // if (!buffer_pool)
     //     throw sc::CodecError { "Failed to allocate video buffer pool" };
 
-    auto video_encoder_context = sc::create_video_encoder(
-        params.video_encoder.c_str(),
+    auto video_encoder_context = create_capture_encoder(
+        params,
         cuda_ctx.get(),
-        nullptr, /*buffer_pool.get(),*/
-        { .width = wayland->output_width, .height = wayland->output_height },
-        params.frame_time,
-        AV_PIX_FMT_RGB0);
+        { .width = wayland->output_width, .height = wayland->output_height });
 
-    sc::BorrowedPtr<AVStream> video_stream { avformat_new_stream(
-        format_context.get(), video_encoder_context->codec) };
-    if (!video_stream)
-        throw sc::CodecError { "Failed to allocate video stream" };
+    auto video_stream =
+        add_video_stream(*format_context, *video_encoder_context);
 
-    video_stream->index = 1;
-
-    if (auto const ret = avcodec_parameters_from_context(
-            video_stream->codecpar, video_encoder_context.get());
-        ret < 0) {
-        throw sc::CodecError {
-            "Failed to copy video codec parameters from context: " +
-            sc::av_error_to_string(ret)
-        };
-    }
+    auto renditions =
+        create_renditions(params, cuda_ctx.get(), *format_context);
 
-    if (auto const ret = avio_open(
-            &format_context->pb, params.output_file.c_str(), AVIO_FLAG_WRITE);
-        ret < 0) {
-        throw sc::IOError { "Failed to open output file: " +
-                            sc::av_error_to_string(ret) };
-    }
-
-    struct AVIOContextCloseGuard
-    {
-        ~AVIOContextCloseGuard() { avio_close(ctx); }
-        AVIOContext* ctx;
-    } avio_context_close_guard { format_context->pb };
-
-    if (auto const ret = avformat_write_header(format_context.get(), nullptr);
-        ret < 0) {
-        throw sc::IOError { "Failed to write header: " +
-                            sc::av_error_to_string(ret) };
-    }
+    SessionOutput output;
+    open_output(params, *format_context, output);
 
     sc::Context ctx { params.frame_time };
     sc::Context audio_ctx { params.frame_time };
-    sc::Context media_ctx { params.frame_time };
+    MediaContexts media { params.frame_time,
+                          renditions.size(),
+                          audio_tracks.size() };
+    configure_contexts(params, ctx, audio_ctx, media);
 
-    std::size_t const frame_size = audio_encoder_context->frame_size
-                                       ? audio_encoder_context->frame_size
-                                       : 2048;
+    auto const& audio_codec = *audio_tracks.front().codec;
+    std::size_t const frame_size =
+        audio_codec.frame_size ? audio_codec.frame_size : 2048;
 
     ctx.services().add<sc::SignalService>(sc::SignalService {});
     add_signal_handler(ctx, SIGINT, [&](std::uint32_t) {
@@ -317,49 +976,76 @@ auto run_wayland(sc::Parameters const& params, sc::wayland::DisplayPtr display)
         audio_ctx.request_stop();
     });
 
-    audio_ctx.services().add_from_factory<sc::AudioService>([&] {
-        return std::make_unique<sc::AudioService>(
-            supported_formats.front(), params.sample_rate, frame_size);
-    });
+    add_audio_service(params, audio_ctx, audio_tracks, frame_size);
 
     ctx.services().add_from_factory<sc::DRMVideoService>([&] {
         return std::make_unique<sc::DRMVideoService>(
             nvcudalib, cuda_ctx.get(), egl, *wayland, wayland_egl);
     });
 
-    media_ctx.services().add_from_factory<sc::EncoderService>([&] {
-        return std::make_unique<sc::EncoderService>(format_context.get());
-    });
+    add_media_services(params, media, format_context.get());
 
-    sc::Encoder media_writer { media_ctx };
-
-    set_audio_chunk_handler(audio_ctx,
-                            sc::ChunkWriter { audio_encoder_context.get(),
-                                              stream.get(),
-                                              media_writer,
-                                              frame_size });
-    set_drm_video_frame_handler(
-        ctx,
-        sc::DRMVideoFrameWriter {
-            video_encoder_context.get(), video_stream.get(), media_writer });
-
-    SC_SCOPE_GUARD([&] {
-        if (auto const ret = av_write_trailer(format_context.get()); ret < 0)
-            std::cerr << "Failed to write trailer: "
-                      << sc::av_error_to_string(ret) << '\n';
-    });
+    sc::Encoder video_writer { media.video_encoder };
+
+    set_audio_chunk_handler(
+        audio_ctx,
+        audio_chunk_handler(params, media, audio_tracks, frame_size));
+    sc::FrameTimeline video_timeline { params.overrun_policy,
+                                       params.max_duplicates };
+    set_drm_video_frame_handler(ctx,
+                                sc::DRMVideoFrameWriter {
+                                    video_encoder_context.get(),
+                                    video_stream.get(),
+                                    video_writer,
+                                    video_timeline });
+
+    /* The renditions are scaled from the same capture, and each is
+     * encoded on its own context...
+     */
+    for (std::size_t i = 0; i < renditions.size(); ++i) {
+        auto& rendition = renditions[i];
+        add_drm_scaled_frame_handler(
+            ctx,
+            rendition.rendition,
+            sc::DRMVideoFrameWriter { rendition.codec.get(),
+                                      rendition.stream.get(),
+                                      sc::Encoder {
+                                          *media.rendition_encoders[i] },
+                                      rendition.timeline });
+    }
+
+    Shutdown shutdown { params.shutdown_timeout };
+    SC_SCOPE_GUARD([&] { close_output(*format_context, output, shutdown); });
 
     run_loop(ctx,
-             media_ctx,
              audio_ctx,
-             video_encoder_context.get(),
-             video_stream.get(),
-             audio_encoder_context.get(),
-             stream.get());
+             media,
+             video_encoder_stages(media,
+                                  EncoderStage { media.video_encoder,
+                                                 video_encoder_context.get(),
+                                                 video_stream.get() },
+                                  renditions),
+             audio_encoder_stages(media, audio_tracks),
+             video_timeline,
+             shutdown);
 }
 
 auto run(sc::Parameters const& params) -> void
 {
+    /* NvFBC's frames don't pass through a GPU stage that could scale
+     * them...
+     */
+    if (params.renditions.size())
+        throw std::runtime_error {
+            "Renditions are only supported when capturing a Wayland session"
+        };
+
+    /* ...nor do they pass through system memory...
+     */
+    if (sc::is_software_video_encoder(params.video_encoder))
+        throw std::runtime_error { "Software encoders are only supported "
+                                   "when capturing a Wayland session" };
+
     auto const display = sc::get_display();
     /* CUDA and NvFBC...
      */
@@ -391,64 +1077,7 @@ auto run(sc::Parameters const& params) -> void
     }
 
     sc::FormatContextPtr format_context { fc_tmp };
-    sc::BorrowedPtr<AVCodec const> encoder { avcodec_find_encoder_by_name(
-        params.audio_encoder.c_str()) };
-    if (!encoder) {
-        throw sc::CodecError { "Failed to find required audio codec" };
-    }
-
-    if (!sc::is_sample_rate_supported(params.sample_rate, encoder))
-        throw std::runtime_error { "Sample rate not supported by codec: " +
-                                   std::to_string(params.sample_rate) };
-
-    auto const supported_formats = find_supported_formats(encoder);
-    if (!supported_formats.size())
-        throw std::runtime_error { "No supported sample formats found" };
-
-    sc::CodecContextPtr audio_encoder_context { avcodec_alloc_context3(
-        encoder.get()) };
-    if (!audio_encoder_context)
-        throw sc::CodecError { "Failed to allocate audio codec context" };
-
-#if LIBAVCODEC_VERSION_MAJOR < 60
-    audio_encoder_context->channels = 2;
-    audio_encoder_context->channel_layout = av_get_default_channel_layout(2);
-#else
-    av_channel_layout_default(&audio_encoder_context->ch_layout, 2);
-#endif
-    audio_encoder_context->sample_rate = params.sample_rate;
-    audio_encoder_context->sample_fmt =
-        sc::convert_to_libav_format(supported_formats.front());
-    audio_encoder_context->bit_rate = 128'000;
-    audio_encoder_context->time_base = AVRational { 1, params.sample_rate };
-    audio_encoder_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-
-    AVDictionary* options = nullptr;
-    apply_audio_codec_modifiers(*encoder, options);
-
-    if (auto const ret =
-            avcodec_open2(audio_encoder_context.get(), encoder.get(), &options);
-        ret < 0) {
-        throw sc::CodecError { "Failed to open audio codec: " +
-                               sc::av_error_to_string(ret) };
-    }
-
-    sc::BorrowedPtr<AVStream> stream { avformat_new_stream(
-        format_context.get(), audio_encoder_context->codec) };
-
-    if (!stream)
-        throw sc::CodecError { "Failed to allocate audio stream" };
-
-    stream->index = 0;
-
-    if (auto const ret = avcodec_parameters_from_context(
-            stream->codecpar, audio_encoder_context.get());
-        ret < 0) {
-        throw sc::CodecError {
-            "Failed to copy codec parameters from context: " +
-            sc::av_error_to_string(ret)
-        };
-    }
+    auto audio_tracks = create_audio_tracks(params, *format_context);
 
     sc::BufferPoolPtr buffer_pool { av_buffer_pool_init(
         1, [](BufferSize size) { return av_buffer_alloc(size); }) };
@@ -476,48 +1105,20 @@ auto run(sc::Parameters const& params) -> void
                                  params.frame_time,
                                  AV_PIX_FMT_BGR0);
 
-    sc::BorrowedPtr<AVStream> video_stream { avformat_new_stream(
-        format_context.get(), video_encoder_context->codec) };
-    if (!video_stream)
-        throw sc::CodecError { "Failed to allocate video stream" };
-
-    video_stream->index = 1;
-
-    if (auto const ret = avcodec_parameters_from_context(
-            video_stream->codecpar, video_encoder_context.get());
-        ret < 0) {
-        throw sc::CodecError {
-            "Failed to copy video codec parameters from context: " +
-            sc::av_error_to_string(ret)
-        };
-    }
-
-    if (auto const ret = avio_open(
-            &format_context->pb, params.output_file.c_str(), AVIO_FLAG_WRITE);
-        ret < 0) {
-        throw sc::IOError { "Failed to open output file: " +
-                            sc::av_error_to_string(ret) };
-    }
+    auto video_stream =
+        add_video_stream(*format_context, *video_encoder_context);
 
-    struct AVIOContextCloseGuard
-    {
-        ~AVIOContextCloseGuard() { avio_close(ctx); }
-        AVIOContext* ctx;
-    } avio_context_close_guard { format_context->pb };
-
-    if (auto const ret = avformat_write_header(format_context.get(), nullptr);
-        ret < 0) {
-        throw sc::IOError { "Failed to write header: " +
-                            sc::av_error_to_string(ret) };
-    }
+    SessionOutput output;
+    open_output(params, *format_context, output);
 
     sc::Context ctx { params.frame_time };
     sc::Context audio_ctx { params.frame_time };
-    sc::Context media_ctx { params.frame_time };
+    MediaContexts media { params.frame_time, 0, audio_tracks.size() };
+    configure_contexts(params, ctx, audio_ctx, media);
 
-    std::size_t const frame_size = audio_encoder_context->frame_size
-                                       ? audio_encoder_context->frame_size
-                                       : 2048;
+    auto const& audio_codec = *audio_tracks.front().codec;
+    std::size_t const frame_size =
+        audio_codec.frame_size ? audio_codec.frame_size : 2048;
 
     ctx.services().add<sc::SignalService>(sc::SignalService {});
     add_signal_handler(ctx, SIGINT, [&](std::uint32_t) {
@@ -525,51 +1126,49 @@ auto run(sc::Parameters const& params) -> void
         audio_ctx.request_stop();
     });
 
-    audio_ctx.services().add_from_factory<sc::AudioService>([&] {
-        return std::make_unique<sc::AudioService>(
-            supported_formats.front(), params.sample_rate, frame_size);
-    });
+    add_audio_service(params, audio_ctx, audio_tracks, frame_size);
 
     ctx.services().add_from_factory<sc::VideoService>([&] {
         return std::make_unique<sc::VideoService>(
             nvfbc, cuda_ctx.get(), nvfbc_instance.get());
     });
 
-    media_ctx.services().add_from_factory<sc::EncoderService>([&] {
-        return std::make_unique<sc::EncoderService>(format_context.get());
-    });
+    add_media_services(params, media, format_context.get());
 
-    sc::Encoder media_writer { media_ctx };
+    sc::Encoder video_writer { media.video_encoder };
 
-    set_audio_chunk_handler(audio_ctx,
-                            sc::ChunkWriter { audio_encoder_context.get(),
-                                              stream.get(),
-                                              media_writer,
-                                              frame_size });
+    set_audio_chunk_handler(
+        audio_ctx,
+        audio_chunk_handler(params, media, audio_tracks, frame_size));
+    sc::FrameTimeline video_timeline { params.overrun_policy,
+                                       params.max_duplicates };
     set_video_frame_handler(ctx,
                             sc::VideoFrameWriter { video_encoder_context.get(),
                                                    video_stream.get(),
-                                                   media_writer });
+                                                   video_writer,
+                                                   video_timeline });
 
-    SC_SCOPE_GUARD([&] {
-        if (auto const ret = av_write_trailer(format_context.get()); ret < 0)
-            std::cerr << "Failed to write trailer: "
-                      << sc::av_error_to_string(ret) << '\n';
-    });
+    Shutdown shutdown { params.shutdown_timeout };
+    SC_SCOPE_GUARD([&] { close_output(*format_context, output, shutdown); });
 
     run_loop(ctx,
-             media_ctx,
              audio_ctx,
-             video_encoder_context.get(),
-             video_stream.get(),
-             audio_encoder_context.get(),
-             stream.get());
+             media,
+             { EncoderStage { media.video_encoder,
+                              video_encoder_context.get(),
+                              video_stream.get() } },
+             audio_encoder_stages(media, audio_tracks),
+             video_timeline,
+             shutdown);
 }
 
 auto main(int argc, char const** argv) -> int
 {
     try {
-        sc::block_signals({ SIGINT, SIGCHLD });
+        /* SIGPIPE is blocked so that a tee output whose reader has
+         * gone away fails with EPIPE rather than ending the capture...
+         */
+        sc::block_signals({ SIGINT, SIGCHLD, SIGUSR1, SIGPIPE });
         auto params =
             sc::get_parameters(sc::parse_cmd_line(argc - 1, argv + 1));
 
@@ -607,19 +1206,5 @@ auto main(int argc, char const** argv) -> int
         return 1;
     }
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    sc::metrics::format_histogram(
-        std::cout,
-        sc::metrics::get_histogram(sc::metrics::audio_metrics),
-        "Frame time (ns)",
-        "Audio Frame Times");
-    std::cout << '\n';
-    sc::metrics::format_histogram(
-        std::cout,
-        sc::metrics::get_histogram(sc::metrics::video_metrics),
-        "Frame time (ns)",
-        "Video Frame Times");
-#endif
-
     return 0;
 }
@@ -1,42 +1,35 @@
 #include "metrics/metrics.hpp"
-
-namespace
-{
-
-auto audio_histogram() noexcept -> sc::metrics::AudioFrameTimeHistogram&
-{
-    static sc::metrics::AudioFrameTimeHistogram histogram {};
-    return histogram;
-}
-
-auto video_histogram() noexcept -> sc::metrics::VideoFrameTimeHistogram&
-{
-    static sc::metrics::VideoFrameTimeHistogram histogram {};
-    return histogram;
-}
-
-} // namespace
+#include <algorithm>
 
 namespace sc::metrics
 {
-auto add_frame_time(AudioMetricsTag, std::uint64_t value) noexcept -> void
+
+auto DispatchMetrics::add_dispatch(std::uint64_t value) noexcept -> void
 {
-    audio_histogram().add_value(value);
+    dispatches += 1;
+    total_duration += value;
+    max_duration = std::max(max_duration, value);
+    duration.add_value(value);
 }
 
-auto add_frame_time(VideoMetricsTag, std::uint64_t value) noexcept -> void
+auto DispatchMetrics::add_tick(std::uint64_t value,
+                               std::uint64_t missed) noexcept -> void
 {
-    video_histogram().add_value(value);
+    ticks += 1;
+    missed_ticks += missed;
+    total_lateness += value;
+    max_lateness = std::max(max_lateness, value);
+    lateness.add_value(value);
 }
 
-auto get_histogram(AudioMetricsTag) noexcept -> AudioFrameTimeHistogram const&
+auto DispatchMetrics::mean_duration() const noexcept -> std::uint64_t
 {
-    return audio_histogram();
+    return dispatches ? total_duration / dispatches : 0;
 }
 
-auto get_histogram(VideoMetricsTag) noexcept -> VideoFrameTimeHistogram const&
+auto DispatchMetrics::mean_lateness() const noexcept -> std::uint64_t
 {
-    return video_histogram();
+    return ticks ? total_lateness / ticks : 0;
 }
 
 } // namespace sc::metrics
@@ -8,14 +8,6 @@
 namespace sc::metrics
 {
 
-// clang-format off
-struct AudioMetricsTag { };
-struct VideoMetricsTag { };
-// clang-format on
-
-constexpr AudioMetricsTag audio_metrics {};
-constexpr VideoMetricsTag video_metrics {};
-
 constexpr std::uint64_t kBucketSize =
     std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::chrono::milliseconds(1))
@@ -24,17 +16,46 @@ constexpr std::uint64_t kBucketSize =
 
 constexpr std::size_t kBucketCount = 20;
 
-using AudioFrameTimeHistogram =
-    Histogram<std::uint64_t, kBucketCount, kBucketSize>;
-using VideoFrameTimeHistogram =
+/* Timer lateness is expected to be far smaller than the time
+ * taken to dispatch a frame, so it uses finer buckets...
+ */
+constexpr std::uint64_t kLatenessBucketSize =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::microseconds(50))
+        .count();
+
+using DispatchTimeHistogram =
     Histogram<std::uint64_t, kBucketCount, kBucketSize>;
+using LatenessHistogram =
+    Histogram<std::uint64_t, kBucketCount, kLatenessBucketSize>;
 
-auto add_frame_time(AudioMetricsTag, std::uint64_t value) noexcept -> void;
-auto add_frame_time(VideoMetricsTag, std::uint64_t value) noexcept -> void;
-[[nodiscard]] auto get_histogram(AudioMetricsTag) noexcept
-    -> AudioFrameTimeHistogram const&;
-[[nodiscard]] auto get_histogram(VideoMetricsTag) noexcept
-    -> VideoFrameTimeHistogram const&;
+/* Timing of every dispatch made to a single service. These are
+ * only updated from the thread running the service's context...
+ */
+struct DispatchMetrics
+{
+    auto add_dispatch(std::uint64_t duration) noexcept -> void;
+
+    /* Records a frame tick that was dispatched `lateness`
+     * nanoseconds after its deadline, having missed `missed`
+     * earlier deadlines...
+     */
+    auto add_tick(std::uint64_t lateness, std::uint64_t missed) noexcept
+        -> void;
+
+    [[nodiscard]] auto mean_duration() const noexcept -> std::uint64_t;
+    [[nodiscard]] auto mean_lateness() const noexcept -> std::uint64_t;
+
+    std::uint64_t dispatches { 0 };
+    std::uint64_t total_duration { 0 };
+    std::uint64_t max_duration { 0 };
+    std::uint64_t ticks { 0 };
+    std::uint64_t missed_ticks { 0 };
+    std::uint64_t total_lateness { 0 };
+    std::uint64_t max_lateness { 0 };
+    DispatchTimeHistogram duration;
+    LatenessHistogram lateness;
+};
 
 } // namespace sc::metrics
 
@@ -67,6 +67,7 @@ auto load_opengl() -> OpenGL
     TRY_ATTACH_SYMBOL(
         &opengl.glDeleteFramebuffers, "glDeleteFramebuffers", lib);
     TRY_ATTACH_SYMBOL(&opengl.glBindFramebuffer, "glBindFramebuffer", lib);
+    TRY_ATTACH_SYMBOL(&opengl.glBlitFramebuffer, "glBlitFramebuffer", lib);
     TRY_ATTACH_SYMBOL(&opengl.glDrawBuffers, "glDrawBuffers", lib);
     TRY_ATTACH_SYMBOL(&opengl.glViewport, "glViewport", lib);
     TRY_ATTACH_SYMBOL(&opengl.glGetTexImage, "glGetTexImage", lib);
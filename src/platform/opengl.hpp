@@ -98,6 +98,16 @@ struct OpenGL
     void (*glGenFramebuffers)(GLsizei n, GLuint* ids);
     void (*glDeleteFramebuffers)(GLsizei n, GLuint* framebuffers);
     void (*glBindFramebuffer)(GLenum target, GLuint framebuffer);
+    void (*glBlitFramebuffer)(GLint srcX0,
+                              GLint srcY0,
+                              GLint srcX1,
+                              GLint srcY1,
+                              GLint dstX0,
+                              GLint dstY0,
+                              GLint dstX1,
+                              GLint dstY1,
+                              GLbitfield mask,
+                              GLenum filter);
     void (*glDrawBuffers)(GLsizei n, const GLenum* bufs);
     void (*glViewport)(GLint x, GLint y, GLsizei width, GLsizei height);
     void (*glGetTexImage)(
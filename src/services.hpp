@@ -4,13 +4,19 @@
 #include "config.hpp"
 
 #include "./services/audio_service.hpp"
+#include "./services/clock.hpp"
 #include "./services/context.hpp"
 #include "./services/drm_video_service.hpp"
 #include "./services/encoder.hpp"
 #include "./services/encoder_service.hpp"
+#include "./services/muxer_service.hpp"
+#include "./services/replay_buffer.hpp"
+#include "./services/segmented_output.hpp"
 #include "./services/service.hpp"
 #include "./services/service_registry.hpp"
 #include "./services/signal_service.hpp"
+#include "./services/task.hpp"
+#include "./services/tee_sink.hpp"
 #include "./services/video_service.hpp"
 
 #endif // SHADOW_CAST_SERVICES_HPP_INCLUDED
@@ -1,49 +1,53 @@
 #include "services/audio_service.hpp"
 #include "av/media_chunk.hpp"
 #include "av/sample_format.hpp"
+#include "logging.hpp"
+#include "services/clock.hpp"
 #include "utils/contracts.hpp"
 #include "utils/elapsed.hpp"
+#include "utils/scope_guard.hpp"
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cinttypes>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <errno.h>
 #include <fcntl.h>
-#include <mutex>
 #include <span>
+#include <string>
 #include <sys/eventfd.h>
 #include <system_error>
+#include <utility>
 #include <unistd.h>
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-#include "metrics/metrics.hpp"
-#endif
-
 using namespace std::literals::string_literals;
 
 namespace
 {
 
-auto prepare_buffer_channels(sc::MediaChunk& buffer,
-                             sc::SampleFormat sample_format,
-                             std::size_t num_channels = 2) -> void
-{
-    buffer.channel_buffers().clear();
-    buffer.channel_buffers().push_back(sc::DynamicBuffer {});
+/* How much captured audio each source's chunk pool holds, waiting
+ * to be encoded. Audio that arrives once every chunk is in use is
+ * dropped...
+ */
+std::size_t constexpr kBufferedSeconds = 2;
 
-    if (!sc::is_interleaved_format(sample_format)) {
-        while (num_channels != buffer.channel_buffers().size()) {
-            buffer.channel_buffers().push_back(sc::DynamicBuffer {});
-        }
-    }
+/* The channels PipeWire is asked for...
+ */
+std::size_t constexpr kNumChannels = 2;
 
-    SC_EXPECT(buffer.channel_buffers().size() ==
-                      sc::is_interleaved_format(sample_format)
-                  ? 1
-                  : num_channels);
-}
+/* PipeWire is asked for the format its graph already works in, and
+ * the samples are copied into chunks as they are. They're converted to
+ * the encoder's format later, on the audio context...
+ */
+sc::SampleFormat constexpr kCaptureSampleFormat =
+    sc::SampleFormat::float_planar;
+
+/* How far a source's sample count may drift from the context's clock
+ * before it's pulled back into step. See `SampleClock`...
+ */
+std::size_t constexpr kMaxDriftMs = 50;
 
 } // namespace
 
@@ -73,7 +77,7 @@ struct RequeueBufferGuard
 static void
 on_stream_param_changed(void* _data, uint32_t id, const struct spa_pod* param)
 {
-    sc::AudioLoopData* data = reinterpret_cast<sc::AudioLoopData*>(_data);
+    sc::AudioCapture* data = reinterpret_cast<sc::AudioCapture*>(_data);
 
     /* NULL means to clear the format */
     if (param == NULL || id != SPA_PARAM_Format)
@@ -92,9 +96,10 @@ on_stream_param_changed(void* _data, uint32_t id, const struct spa_pod* param)
     spa_format_audio_raw_parse(param, &data->format.info.raw);
 
     fprintf(stdout,
-            "Audio capturing rate: %d, channels: %d\n",
+            "Audio capturing rate: %d, channels: %d (%s)\n",
             data->format.info.raw.rate,
-            data->format.info.raw.channels);
+            data->format.info.raw.channels,
+            sc::audio_source_name(data->source).c_str());
 }
 constexpr pw_stream_events stream_events = { .version =
                                                  PW_VERSION_STREAM_EVENTS,
@@ -110,19 +115,19 @@ constexpr pw_stream_events stream_events = { .version =
                                              .drained = nullptr,
                                              .command = nullptr,
                                              .trigger_done = nullptr };
-auto start_pipewire(sc::AudioLoopData& data)
+
+/* Creates, and connects, `capture`'s stream. The loop must be
+ * locked...
+ */
+auto connect_stream(pw_thread_loop* loop,
+                    sc::AudioCapture& capture,
+                    std::size_t sample_rate) -> void
 {
-    std::array<spa_pod const*, 2> params {};
+    std::array<spa_pod const*, 1> params {};
     uint8_t buffer[1024];
     struct pw_properties* props;
     struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 
-    /* make a main loop. If you already have another main loop, you can add
-     * the fd of this pipewire mainloop to it. */
-    data.loop = pw_thread_loop_new("shadow-capture-audio", nullptr);
-
-    pw_thread_loop_lock(data.loop);
-
     /* Create a simple stream, the simple stream manages the core and remote
      * objects for you if you don't need to deal with them.
      *
@@ -141,50 +146,136 @@ auto start_pipewire(sc::AudioLoopData& data)
                               PW_KEY_MEDIA_ROLE,
                               "Music",
                               NULL);
-    /* uncomment if you want to capture from the sink monitor ports */
-    pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
 
-    data.stream = pw_stream_new_simple(pw_thread_loop_get_loop(data.loop),
-                                       "audio-capture",
-                                       props,
-                                       &stream_events,
-                                       &data);
+    /* The desktop is captured from a sink's monitor ports. Without a
+     * target, the session manager picks the default sink, or source...
+     */
+    if (capture.source.type == sc::AudioSourceType::desktop)
+        pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+
+    if (capture.source.node.size())
+        pw_properties_set(
+            props, PW_KEY_TARGET_OBJECT, capture.source.node.c_str());
+
+    auto const name = "audio-capture (" +
+                      sc::audio_source_name(capture.source) + ")";
+    capture.stream = pw_stream_new_simple(pw_thread_loop_get_loop(loop),
+                                          name.c_str(),
+                                          props,
+                                          &stream_events,
+                                          &capture);
 
     /* Make one parameter with the supported formats. The
      * SPA_PARAM_EnumFormat id means that this is a format enumeration (of 1
-     * value). We leave the channels and rate empty to accept the native
-     * graph rate and channels. */
+     * value). PipeWire mixes the graph's channels down, or up, to
+     * the stereo pair asked for here. */
     spa_audio_info_raw raw_init = {};
-    fprintf(stderr,
-            "Audio sample format: %s\n",
-            sample_format_name(data.required_sample_format));
-    raw_init.format = convert_to_pipewire_format(data.required_sample_format);
-    raw_init.rate = data.required_sample_rate;
+    raw_init.format = convert_to_pipewire_format(kCaptureSampleFormat);
+    raw_init.rate = static_cast<std::uint32_t>(sample_rate);
+    raw_init.channels = kNumChannels;
+    raw_init.position[0] = SPA_AUDIO_CHANNEL_FL;
+    raw_init.position[1] = SPA_AUDIO_CHANNEL_FR;
     params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &raw_init);
 
     /* Now connect this stream.
      */
     if (pw_stream_connect(
-            data.stream,
+            capture.stream,
             PW_DIRECTION_INPUT,
             PW_ID_ANY,
             static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT |
-                                         PW_STREAM_FLAG_MAP_BUFFERS),
+                                         PW_STREAM_FLAG_MAP_BUFFERS |
+                                         PW_STREAM_FLAG_RT_PROCESS),
             params.data(),
-            params.size()) < 0) {
-        fprintf(stderr, "Couldn't connect stream\n");
-        return;
+            params.size()) < 0)
+        fprintf(stderr, "Couldn't connect stream: %s\n", name.c_str());
+}
+
+auto start_pipewire(std::span<std::unique_ptr<sc::AudioCapture> const> captures,
+                    std::size_t sample_rate) -> pw_thread_loop*
+{
+    /* make a main loop. If you already have another main loop, you can add
+     * the fd of this pipewire mainloop to it. */
+    auto* loop = pw_thread_loop_new("shadow-capture-audio", nullptr);
+
+    pw_thread_loop_lock(loop);
+    for (auto const& capture : captures)
+        connect_stream(loop, *capture, sample_rate);
+
+    pw_thread_loop_unlock(loop);
+    pw_thread_loop_start(loop);
+    return loop;
+}
+
+auto stop_pipewire(pw_thread_loop* loop,
+                   std::span<std::unique_ptr<sc::AudioCapture> const>
+                       captures) noexcept -> void
+{
+    pw_thread_loop_stop(loop);
+    for (auto const& capture : captures)
+        pw_stream_destroy(std::exchange(capture->stream, nullptr));
+
+    pw_thread_loop_destroy(loop);
+}
+
+/* Writes `n` samples of silence to the end of `chunk`. Every format
+ * the chunks can hold is silent at zero...
+ */
+auto pad_with_silence(sc::MediaChunk& chunk,
+                      sc::SampleFormat format,
+                      std::size_t n) noexcept -> void
+{
+    auto const stride = sc::sample_format_size(format) *
+                        (sc::is_interleaved_format(format) ? kNumChannels : 1);
+    for (auto* plane : chunk.planes())
+        std::memset(plane + chunk.sample_count * stride, 0, n * stride);
+
+    chunk.sample_count += n;
+}
+
+/* Converts a captured chunk to the encoder's format, in a chunk from
+ * `capture`'s other pool, and returns the captured one to its own.
+ * Returns null if every converted chunk is still in use, in which case
+ * the samples are dropped...
+ */
+auto convert_chunk(sc::AudioCapture& capture, sc::MediaChunkPool::ItemPtr chunk)
+    -> sc::MediaChunkPool::ItemPtr
+{
+    sc::MediaChunkPool::ItemPtr converted { capture.converted->get() };
+    if (!converted) {
+        capture.dropped_samples.fetch_add(chunk->sample_count,
+                                          std::memory_order_relaxed);
+        return nullptr;
     }
 
-    pw_thread_loop_unlock(data.loop);
-    pw_thread_loop_start(data.loop);
+    std::array<std::uint8_t const*, kNumChannels> source {};
+    std::ranges::copy(chunk->planes(), source.begin());
+    auto const num_planes = chunk->planes().size();
+    capture.converter->convert(std::span { source }.first(num_planes),
+                               0,
+                               converted->planes(),
+                               0,
+                               chunk->sample_count);
+
+    converted->position = chunk->position;
+    converted->sample_count = chunk->sample_count;
+    return converted;
 }
 
-auto stop_pipewire(sc::AudioLoopData& data) noexcept -> void
+/* Returns any chunks that `capture` still holds to its pool...
+ */
+auto return_chunks(sc::AudioCapture& capture) noexcept -> void
 {
-    pw_thread_loop_stop(data.loop);
-    pw_stream_destroy(data.stream);
-    pw_thread_loop_destroy(data.loop);
+    if (capture.filling)
+        capture.chunks->put(std::exchange(capture.filling, nullptr));
+
+    sc::IntrusiveList<sc::MediaChunk> ready;
+    capture.ready.pop_all(ready);
+    while (!ready.empty()) {
+        auto* chunk = &ready.front();
+        ready.pop_front();
+        capture.chunks->put(chunk);
+    }
 }
 
 } // namespace
@@ -192,17 +283,28 @@ auto stop_pipewire(sc::AudioLoopData& data) noexcept -> void
 namespace sc
 {
 
+AudioCapture::AudioCapture(AudioService& owner,
+                           std::size_t source_index,
+                           AudioSource audio_source,
+                           SampleClock sample_clock) noexcept
+    : service { &owner }
+    , index { source_index }
+    , source { std::move(audio_source) }
+    , clock { sample_clock }
+{
+}
+
 auto on_process(void* userdata) -> void
 {
-    sc::AudioLoopData* data = reinterpret_cast<sc::AudioLoopData*>(userdata);
+    auto* capture = reinterpret_cast<sc::AudioCapture*>(userdata);
     struct pw_buffer* b;
 
-    if ((b = pw_stream_dequeue_buffer(data->stream)) == NULL) {
+    if ((b = pw_stream_dequeue_buffer(capture->stream)) == NULL) {
         pw_log_warn("out of buffers: %m");
         return;
     }
 
-    RequeueBufferGuard scope_guard { b, data->stream };
+    RequeueBufferGuard scope_guard { b, capture->stream };
 
     spa_buffer* buf = b->buffer;
 
@@ -211,47 +313,95 @@ auto on_process(void* userdata) -> void
         return;
     }
 
-    auto const sample_size = sample_format_size(data->required_sample_format);
-    auto const num_bytes = buf->datas[0].chunk->size;
-    auto const num_samples = is_interleaved_format(data->required_sample_format)
-                                 ? (num_bytes / 2) / sample_size
-                                 : num_bytes / sample_size;
-
-    std::span channel_data { buf->datas, buf->n_datas };
-
-    auto lock = std::lock_guard { data->service->data_mutex_ };
-
-    auto& input_buffer = data->service->input_buffer_;
-    SC_EXPECT(channel_data.size() == input_buffer.channel_buffers().size());
-
-    auto out_buffer_it = input_buffer.channel_buffers().begin();
-
-    for (auto const& d : channel_data) {
-        sc::DynamicBuffer& chunk_buffer = *out_buffer_it++;
-        auto target_bytes = chunk_buffer.prepare(num_bytes);
-
-        std::span source_bytes { reinterpret_cast<std::uint8_t const*>(d.data),
-                                 num_bytes };
-
-        std::copy(begin(source_bytes), end(source_bytes), begin(target_bytes));
-        chunk_buffer.commit(num_bytes);
+    auto const interleaved = is_interleaved_format(kCaptureSampleFormat);
+    auto const stride = sample_format_size(kCaptureSampleFormat) *
+                        (interleaved ? kNumChannels : 1);
+    auto const num_samples = buf->datas[0].chunk->size / stride;
+
+    std::array<std::uint8_t const*, kNumChannels> channel_data {};
+    auto const num_planes = interleaved ? std::size_t { 1 } : kNumChannels;
+    SC_EXPECT(buf->n_datas >= num_planes);
+    for (std::size_t i = 0; i < num_planes; ++i)
+        channel_data[i] = static_cast<std::uint8_t const*>(buf->datas[i].data);
+
+    /* This runs on PipeWire's realtime thread, so it mustn't wait for
+     * anything, and does no more than copy the samples, in PipeWire's
+     * own format, into pooled chunks. Each full chunk is queued for the
+     * audio context, which converts it, if need be. The audio context
+     * is only woken for the first chunk it hasn't yet collected...
+     */
+    auto& service = *capture->service;
+    auto const frame_size = capture->chunks->frame_size();
+    auto const queue_if_full = [&] {
+        if (capture->filling->sample_count == frame_size &&
+            capture->ready.push(std::exchange(capture->filling, nullptr)))
+            service.notify(1);
+    };
+
+    auto const step = capture->clock.step(service.clock_->now(), num_samples);
+    if (step.resynced)
+        capture->resyncs.fetch_add(1, std::memory_order_relaxed);
+
+    /* A gap, left by falling behind the clock, is filled with silence
+     * as far as the end of the current chunk. The next chunk then
+     * simply starts later...
+     */
+    if (auto* chunk = capture->filling) {
+        auto const end = chunk->position + chunk->sample_count;
+        SC_EXPECT(step.position >= end);
+        auto const gap = std::min<std::uint64_t>(
+            step.position - end, frame_size - chunk->sample_count);
+        if (gap) {
+            pad_with_silence(
+                *chunk, kCaptureSampleFormat, static_cast<std::size_t>(gap));
+            queue_if_full();
+        }
     }
 
-    input_buffer.sample_count += num_samples;
+    auto position = step.position;
+    std::size_t offset = step.skip;
+    while (offset < num_samples) {
+        if (!capture->filling) {
+            capture->filling = capture->chunks->get();
+
+            /* The drop is logged later, off this thread. The dropped
+             * samples still take up their place on the clock...
+             */
+            if (!capture->filling) {
+                capture->dropped_samples.fetch_add(
+                    num_samples - offset, std::memory_order_relaxed);
+                return;
+            }
 
-    if (input_buffer.sample_count >= data->service->frame_size_) {
-        data->service->notify(input_buffer.sample_count /
-                              data->service->frame_size_);
+            capture->filling->position = position;
+        }
+
+        auto& chunk = *capture->filling;
+        auto const n =
+            std::min(num_samples - offset, frame_size - chunk.sample_count);
+        auto const planes = chunk.planes();
+        for (std::size_t i = 0; i < num_planes; ++i)
+            std::memcpy(planes[i] + chunk.sample_count * stride,
+                        channel_data[i] + offset * stride,
+                        n * stride);
+
+        chunk.sample_count += n;
+        offset += n;
+        position += n;
+        queue_if_full();
     }
 }
 
-AudioService::AudioService(SampleFormat sample_format,
+AudioService::AudioService(std::vector<AudioSource> sources,
+                           SampleFormat sample_format,
                            std::size_t sample_rate,
                            std::size_t frame_size)
-    : sample_format_ { sample_format }
+    : sources_ { std::move(sources) }
+    , sample_format_ { sample_format }
     , sample_rate_ { sample_rate }
     , frame_size_ { frame_size }
 {
+    SC_EXPECT(sources_.size());
 }
 
 AudioService::~AudioService() {}
@@ -268,20 +418,57 @@ auto AudioService::on_init(ReadinessRegister reg) -> void
     SC_EXPECT(event_fd_ >= 0);
     reg(event_fd_, &dispatch_chunks);
 
-    prepare_buffer_channels(input_buffer_, sample_format_);
+    /* Every source is placed on the context's timeline, which starts
+     * at the origin it shares with the video, if it was given one, or
+     * otherwise now...
+     */
+    clock_ = &reg.clock();
+    auto const origin = reg.origin().value_or(clock_->now());
+    auto const rate = static_cast<std::uint32_t>(sample_rate_);
+    auto const max_drift = sample_rate_ * kMaxDriftMs / 1'000;
+    auto const num_chunks =
+        (kBufferedSeconds * sample_rate_ + frame_size_ - 1) / frame_size_;
+
+    captures_.clear();
+    for (std::size_t i = 0; i < sources_.size(); ++i) {
+        auto capture = std::make_unique<AudioCapture>(
+            *this, i, sources_[i], SampleClock { origin, rate, max_drift });
+        capture->chunks = MediaChunkPool::create(
+            kCaptureSampleFormat, kNumChannels, frame_size_, num_chunks);
+        if (sample_format_ != kCaptureSampleFormat) {
+            capture->converted = MediaChunkPool::create(
+                sample_format_, kNumChannels, frame_size_, num_chunks);
+            capture->converter.emplace(
+                kCaptureSampleFormat, sample_format_, kNumChannels);
+        }
+        captures_.push_back(std::move(capture));
+    }
 
-    loop_data_ = {};
-    loop_data_.service = this;
-    loop_data_.required_sample_format = sample_format_;
-    loop_data_.required_sample_rate = sample_rate_;
-    start_pipewire(loop_data_);
+    if (auto const& converter = captures_.front()->converter; converter)
+        fprintf(stderr,
+                "Audio sample format: %s (converted from %s, using %s)\n",
+                sample_format_name(sample_format_),
+                sample_format_name(kCaptureSampleFormat),
+                converter->kernels().name);
+    else
+        fprintf(stderr,
+                "Audio sample format: %s\n",
+                sample_format_name(sample_format_));
+
+    loop_ = start_pipewire(captures_, sample_rate_);
 }
 
 auto AudioService::on_uninit() noexcept -> void
 {
+    /* PipeWire's thread is stopped first, since it writes to the
+     * event fd, and produces the chunks...
+     */
+    stop_pipewire(std::exchange(loop_, nullptr), captures_);
     ::close(event_fd_);
     event_fd_ = -1;
-    stop_pipewire(loop_data_);
+
+    for (auto const& capture : captures_)
+        return_chunks(*capture);
 
     if (stream_end_listener_)
         (*stream_end_listener_)();
@@ -293,44 +480,43 @@ auto dispatch_chunks(sc::Service& svc) -> void
     std::uint64_t val;
     ::read(self.event_fd_, &val, sizeof(val));
 
-    std::size_t num_frames = val;
-    SC_EXPECT(num_frames);
-
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    auto const frame_start = global_elapsed.nanosecond_value();
-#endif
-
-    if (auto& listener = self.chunk_listener_; listener) {
-        while (num_frames--) {
-            auto lock = std::lock_guard { self.data_mutex_ };
-            SC_EXPECT(self.input_buffer_.sample_count >= self.frame_size_);
-
-            (*listener)(self.input_buffer_);
-            auto const sample_size =
-                sc::sample_format_size(self.sample_format_);
-            auto const interleaved =
-                sc::is_interleaved_format(self.sample_format_);
-
-            for (auto it = self.input_buffer_.channel_buffers().begin();
-                 it != self.input_buffer_.channel_buffers().end();
-                 ++it) {
-
-                if (interleaved) {
-                    it->consume(sample_size * self.frame_size_ * 2);
-                    break;
-                }
-
-                it->consume(sample_size * self.frame_size_);
+    for (auto const& capture : self.captures_) {
+        if (auto const dropped = capture->dropped_samples.exchange(
+                0, std::memory_order_relaxed);
+            dropped)
+            log::warn("Audio buffer full. Dropped "s +
+                      std::to_string(dropped) + " samples (" +
+                      audio_source_name(capture->source) + ")");
+
+        if (auto const resyncs =
+                capture->resyncs.exchange(0, std::memory_order_relaxed);
+            resyncs)
+            log::warn("Audio drifted from the clock, and was realigned (" +
+                      audio_source_name(capture->source) + ")");
+
+        /* Any chunks the listener doesn't get to, e.g. because it
+         * threw, go back to the pool...
+         */
+        IntrusiveList<MediaChunk> ready;
+        capture->ready.pop_all(ready);
+        SC_SCOPE_GUARD([&] {
+            while (!ready.empty()) {
+                auto* chunk = &ready.front();
+                ready.pop_front();
+                capture->chunks->put(chunk);
             }
+        });
 
-            self.input_buffer_.sample_count -= self.frame_size_;
+        while (!ready.empty()) {
+            MediaChunkPool::ItemPtr chunk { &ready.front() };
+            ready.pop_front();
+            if (capture->converter)
+                chunk = convert_chunk(*capture, std::move(chunk));
+
+            if (auto& listener = self.chunk_listener_; chunk && listener)
+                (*listener)(capture->index, std::move(chunk));
         }
     }
-
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    metrics::add_frame_time(metrics::audio_metrics,
-                            global_elapsed.nanosecond_value() - frame_start);
-#endif
 }
 
 } // namespace sc
@@ -4,32 +4,64 @@
 #include "config.hpp"
 
 #include "av/media_chunk.hpp"
+#include "av/sample_converter.hpp"
 #include "av/sample_format.hpp"
+#include "services/clock.hpp"
 #include "services/readiness.hpp"
 #include "services/service.hpp"
+#include "utils/audio_source.hpp"
 #include "utils/intrusive_list.hpp"
+#include "utils/mpsc_queue.hpp"
 #include "utils/pool.hpp"
 #include "utils/receiver.hpp"
+#include "utils/sample_clock.hpp"
 #include <array>
+#include <atomic>
+#include <cstdint>
 #include <list>
-#include <mutex>
+#include <memory>
 #include <optional>
 #include <pipewire/pipewire.h>
 #include <spa/param/audio/format-utils.h>
+#include <vector>
 
 namespace sc
 {
 
 struct AudioService;
 
-struct AudioLoopData
+/* One PipeWire stream, capturing one `AudioSource`, and what its
+ * callbacks are given. Only PipeWire's thread touches `filling` and
+ * `clock`, and only the audio context touches `converter`...
+ */
+struct AudioCapture
 {
+    AudioCapture(AudioService& owner,
+                 std::size_t source_index,
+                 AudioSource audio_source,
+                 SampleClock sample_clock) noexcept;
+
     AudioService* service;
-    pw_thread_loop* loop;
-    pw_stream* stream;
-    spa_audio_info format;
-    SampleFormat required_sample_format;
-    std::size_t required_sample_rate;
+    std::size_t index;
+    AudioSource source;
+    pw_stream* stream { nullptr };
+    spa_audio_info format {};
+
+    /* PipeWire's thread fills chunks from the pool, and queues them
+     * for the audio context, without sharing a lock...
+     */
+    std::shared_ptr<MediaChunkPool> chunks;
+
+    /* If the encoder's format isn't PipeWire's, the audio context
+     * converts each chunk into one from this pool...
+     */
+    std::shared_ptr<MediaChunkPool> converted;
+    std::optional<SampleConverter> converter;
+    SampleClock clock;
+    MediaChunk* filling { nullptr };
+    MpscQueue<MediaChunk> ready;
+    std::atomic<std::uint64_t> dropped_samples { 0 };
+    std::atomic<std::uint64_t> resyncs { 0 };
 };
 
 auto on_process(void* userdata) -> void;
@@ -40,10 +72,15 @@ struct AudioService final : Service
     friend auto add_chunk(AudioService&, SynchronizedPool<MediaChunk>::ItemPtr)
         -> void;
 
-    using ChunkReceiverType = Receiver<void(MediaChunk const&)>;
+    /* Given the index, in the service's sources, of the source the
+     * chunk was captured from...
+     */
+    using ChunkReceiverType =
+        Receiver<void(std::size_t, MediaChunkPool::ItemPtr)>;
     using StreamEndReceiverType = Receiver<void()>;
 
-    AudioService(SampleFormat,
+    AudioService(std::vector<AudioSource> sources,
+                 SampleFormat,
                  std::size_t /*sample_rate*/,
                  std::size_t /*frame_size*/);
 
@@ -79,12 +116,20 @@ private:
 
     std::optional<ChunkReceiverType> chunk_listener_;
     std::optional<StreamEndReceiverType> stream_end_listener_;
-    std::mutex data_mutex_;
-    AudioLoopData loop_data_ {};
+    std::vector<AudioSource> sources_;
     SampleFormat sample_format_;
     std::size_t sample_rate_;
     std::size_t frame_size_;
-    MediaChunk input_buffer_;
+
+    /* Every source's stream runs on the same PipeWire thread...
+     */
+    pw_thread_loop* loop_ { nullptr };
+    std::vector<std::unique_ptr<AudioCapture>> captures_;
+
+    /* The audio context's clock, which PipeWire's thread reads to
+     * place each quantum on the context's timeline...
+     */
+    Clock const* clock_ { nullptr };
     int event_fd_ { -1 };
 };
 
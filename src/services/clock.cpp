@@ -0,0 +1,51 @@
+#include "services/clock.hpp"
+#include <ctime>
+
+namespace
+{
+std::uint64_t constexpr kNsPerSec = 1'000'000'000;
+}
+
+namespace sc
+{
+
+auto MonotonicClock::now() const noexcept -> std::uint64_t
+{
+    return monotonic_now();
+}
+
+VirtualClock::VirtualClock(std::uint64_t start) noexcept
+    : now_ { start }
+{
+}
+
+auto VirtualClock::now() const noexcept -> std::uint64_t
+{
+    return now_.load(std::memory_order_acquire);
+}
+
+auto VirtualClock::is_virtual() const noexcept -> bool { return true; }
+
+auto VirtualClock::advance_to(std::uint64_t time) noexcept -> void
+{
+    /* Time never goes backwards...
+     */
+    if (time > now_.load(std::memory_order_relaxed))
+        now_.store(time, std::memory_order_release);
+}
+
+auto monotonic_now() noexcept -> std::uint64_t
+{
+    timespec ts {};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * kNsPerSec +
+           static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+auto monotonic_clock() noexcept -> Clock&
+{
+    static MonotonicClock clock;
+    return clock;
+}
+
+} // namespace sc
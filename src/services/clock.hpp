@@ -0,0 +1,67 @@
+#ifndef SHADOW_CAST_SERVICES_CLOCK_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_CLOCK_HPP_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+
+namespace sc
+{
+
+/* The source of time for a `Context`, in nanoseconds. Frame
+ * deadlines, and any timestamps taken by services, are read from
+ * the context's clock...
+ */
+struct Clock
+{
+    virtual ~Clock() = default;
+
+    [[nodiscard]] virtual auto now() const noexcept -> std::uint64_t = 0;
+
+    /* A virtual clock only moves when it's advanced. A context
+     * running on a virtual clock never waits for a frame deadline.
+     * Once it has nothing else to dispatch, it advances the clock
+     * straight to the next deadline...
+     */
+    [[nodiscard]] virtual auto is_virtual() const noexcept -> bool
+    {
+        return false;
+    }
+
+    virtual auto advance_to(std::uint64_t /*time*/) noexcept -> void {}
+};
+
+/* `CLOCK_MONOTONIC`...
+ */
+struct MonotonicClock final : Clock
+{
+    [[nodiscard]] auto now() const noexcept -> std::uint64_t override;
+};
+
+/* A clock that starts at `start`, and only moves forward when
+ * it's advanced. It can be read from any thread, but should
+ * only be advanced by a single context...
+ */
+struct VirtualClock final : Clock
+{
+    explicit VirtualClock(std::uint64_t start = 0) noexcept;
+
+    [[nodiscard]] auto now() const noexcept -> std::uint64_t override;
+    [[nodiscard]] auto is_virtual() const noexcept -> bool override;
+    auto advance_to(std::uint64_t time) noexcept -> void override;
+
+private:
+    std::atomic<std::uint64_t> now_;
+};
+
+/* The time, in nanoseconds, given by `CLOCK_MONOTONIC`...
+ */
+auto monotonic_now() noexcept -> std::uint64_t;
+
+/* A `MonotonicClock` shared by every context that hasn't been
+ * given a clock of its own...
+ */
+auto monotonic_clock() noexcept -> Clock&;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_CLOCK_HPP_INCLUDED
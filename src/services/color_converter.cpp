@@ -41,6 +41,45 @@ auto get_shader_source(char const* first, char const* last) noexcept
     return std::string_view { first, static_cast<std::size_t>(last - first) };
 }
 
+auto create_output_texture(std::uint32_t width, std::uint32_t height)
+    -> sc::opengl::Texture
+{
+    namespace opengl = sc::opengl;
+
+    auto texture = opengl::create<opengl::Texture>();
+    opengl::bind(opengl::texture_2d_target, texture, [&](auto binding) {
+        opengl::texture_image_2d(binding,
+                                 0,
+                                 GL_RGBA,
+                                 width,
+                                 height,
+                                 0,
+                                 GL_BGRA,
+                                 GL_UNSIGNED_BYTE,
+                                 0);
+
+        opengl::texture_parameter(binding, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        opengl::texture_parameter(binding, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    });
+
+    return texture;
+}
+
+auto create_output_framebuffer(sc::opengl::Texture const& texture)
+    -> sc::opengl::Framebuffer
+{
+    namespace opengl = sc::opengl;
+
+    auto fbo = opengl::create<opengl::Framebuffer>();
+    opengl::bind(opengl::draw_framebuffer_target, fbo, [&](auto binding) {
+        opengl::framebuffer_texture(binding, GL_COLOR_ATTACHMENT0, texture, 0);
+        opengl::draw_buffers(binding, GL_COLOR_ATTACHMENT0);
+        opengl::check_framebuffer_status(binding);
+    });
+
+    return fbo;
+}
+
 } // namespace
 
 namespace sc
@@ -52,6 +91,16 @@ ColorConverter::ColorConverter(std::uint32_t output_width,
 {
 }
 
+auto ColorConverter::add_scaled_output(std::uint32_t width,
+                                       std::uint32_t height) -> std::size_t
+{
+    SC_EXPECT(!initialized_);
+
+    scaled_outputs_.push_back(
+        ScaledOutput { .width = width, .height = height });
+    return scaled_outputs_.size() - 1;
+}
+
 auto ColorConverter::initialize() -> void
 {
     if (initialized_)
@@ -121,22 +170,7 @@ auto ColorConverter::initialize() -> void
                      });
     });
 
-    auto output_texture = opengl::create<opengl::Texture>();
-
-    opengl::bind(opengl::texture_2d_target, output_texture, [&](auto binding) {
-        opengl::texture_image_2d(binding,
-                                 0,
-                                 GL_RGBA,
-                                 output_width_,
-                                 output_height_,
-                                 0,
-                                 GL_BGRA,
-                                 GL_UNSIGNED_BYTE,
-                                 0);
-
-        opengl::texture_parameter(binding, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        opengl::texture_parameter(binding, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    });
+    auto output_texture = create_output_texture(output_width_, output_height_);
 
     auto vertex_shader = opengl::create_shader(opengl::ShaderType::vertex);
     std::string_view const vertex_shader_source = SHADER_SOURCE(default_vertex);
@@ -203,6 +237,11 @@ auto ColorConverter::initialize() -> void
         opengl::check_framebuffer_status(binding);
     });
 
+    for (auto& output : scaled_outputs_) {
+        output.texture = create_output_texture(output.width, output.height);
+        output.fbo = create_output_framebuffer(output.texture);
+    }
+
     fbo_ = std::move(fbo);
     input_texture_ = opengl::create<opengl::Texture>();
     mouse_texture_ = opengl::create<opengl::Texture>();
@@ -232,6 +271,13 @@ auto ColorConverter::output_texture() noexcept -> opengl::Texture&
     return output_texture_;
 }
 
+auto ColorConverter::scaled_output_texture(std::size_t index) noexcept
+    -> opengl::Texture&
+{
+    SC_EXPECT(index < scaled_outputs_.size());
+    return scaled_outputs_[index].texture;
+}
+
 auto ColorConverter::convert(std::optional<MouseParameters> mouse_params)
     -> void
 {
@@ -286,6 +332,22 @@ auto ColorConverter::convert(std::optional<MouseParameters> mouse_params)
                          });
         }
     });
+
+    /* Each scaled copy is made from the finished output, cursor and
+     * all, so the capture is only drawn once...
+     */
+    for (auto& output : scaled_outputs_) {
+        auto read_binding = opengl::bind(opengl::read_framebuffer_target, fbo_);
+        auto draw_binding =
+            opengl::bind(opengl::draw_framebuffer_target, output.fbo);
+        opengl::blit_framebuffer(read_binding,
+                                 draw_binding,
+                                 output_width_,
+                                 output_height_,
+                                 output.width,
+                                 output.height,
+                                 GL_LINEAR);
+    }
 }
 
 } // namespace sc
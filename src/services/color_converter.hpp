@@ -7,7 +7,9 @@
 #include "gl/texture.hpp"
 #include "gl/vertex_array_object.hpp"
 #include <cstdint>
+#include <cstddef>
 #include <optional>
+#include <vector>
 
 namespace sc
 {
@@ -23,13 +25,30 @@ struct ColorConverter
     ColorConverter(std::uint32_t output_width,
                    std::uint32_t output_height) noexcept;
 
+    /* Adds a copy of the output, scaled to `width` x `height`, that
+     * each `convert()` updates on the GPU. Must be called before
+     * `initialize()`. Returns the index of the copy...
+     */
+    auto add_scaled_output(std::uint32_t width, std::uint32_t height)
+        -> std::size_t;
+
     auto initialize() -> void;
     [[nodiscard]] auto input_texture() noexcept -> opengl::Texture&;
     [[nodiscard]] auto mouse_texture() noexcept -> opengl::Texture&;
     [[nodiscard]] auto output_texture() noexcept -> opengl::Texture&;
+    [[nodiscard]] auto scaled_output_texture(std::size_t index) noexcept
+        -> opengl::Texture&;
     auto convert(std::optional<MouseParameters> mouse_params) -> void;
 
 private:
+    struct ScaledOutput
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        opengl::Texture texture {};
+        opengl::Framebuffer fbo {};
+    };
+
     opengl::Framebuffer fbo_;
     opengl::Texture input_texture_;
     opengl::Texture mouse_texture_;
@@ -44,6 +63,7 @@ private:
     std::uint32_t output_height_;
     GLuint mouse_dimensions_uniform_;
     GLuint mouse_position_uniform_;
+    std::vector<ScaledOutput> scaled_outputs_;
     bool initialized_ { false };
 };
 
@@ -1,21 +1,20 @@
 #include "services/context.hpp"
 #include "services/readiness.hpp"
-#include "utils/elapsed.hpp"
 #include "utils/scope_guard.hpp"
 #include <algorithm>
 #include <cassert>
 #include <cerrno>
-#include <cstddef>
+#include <cstdlib>
+#include <cxxabi.h>
 #include <errno.h>
-#include <limits>
-#include <poll.h>
-#include <signal.h>
+#include <string>
 #include <sys/eventfd.h>
+#include <sys/prctl.h>
 #include <system_error>
 #include <tuple>
-#include <vector>
-
-std::size_t constexpr kNsPerSec = 1'000'000'000;
+#include <typeinfo>
+#include <unistd.h>
+#include <utility>
 
 namespace
 {
@@ -30,53 +29,59 @@ struct UninitGuard
     sc::ServiceRegistry& reg;
 };
 
-struct RestoreSigmaskGuard
-{
-    ~RestoreSigmaskGuard() { pthread_sigmask(SIG_SETMASK, restore, nullptr); }
-
-    sigset_t* restore;
-};
-
-auto from_nanoseconds(std::uint64_t val) noexcept -> timespec
+auto service_name(sc::Service const& svc) -> std::string
 {
-    return timespec { .tv_sec = static_cast<time_t>(val / kNsPerSec),
-                      .tv_nsec = static_cast<time_t>(val % kNsPerSec) };
+    auto const* mangled = typeid(svc).name();
+    int status = 0;
+    auto* demangled =
+        abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    if (!demangled)
+        return mangled;
+
+    SC_SCOPE_GUARD([&] { std::free(demangled); });
+    return demangled;
 }
 
-auto tick_timers(sc::ReadinessRegister::FrameTickRegisterType& timers,
-                 std::size_t frame_time,
-                 std::size_t max_frame_time) -> std::size_t
+/* Applies a thread's timer slack for the lifetime of this
+ * object, restoring the previous value afterwards. The default
+ * slack of 50us is added to every timer expiry, which is a
+ * significant proportion of a frame at high frame rates...
+ */
+struct TimerSlackGuard
 {
-    auto next_frame_timeout = max_frame_time;
-
-    for (auto& timer : timers) {
-        if (frame_time >= timer.remaining) {
-            timer.remaining =
-                timer.frame_time -
-                std::min(frame_time - timer.remaining, timer.frame_time);
-            timer.dispatch(*timer.svc);
-        }
-        else {
-            timer.remaining -= frame_time;
-        }
+    explicit TimerSlackGuard(std::uint64_t slack) noexcept
+    {
+        if (!slack)
+            return;
 
-        next_frame_timeout = std::min(next_frame_timeout, timer.remaining);
+        previous = ::prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+        if (previous >= 0)
+            static_cast<void>(::prctl(PR_SET_TIMERSLACK, slack, 0, 0, 0));
     }
 
-    return next_frame_timeout;
-}
+    ~TimerSlackGuard()
+    {
+        if (previous >= 0)
+            static_cast<void>(::prctl(PR_SET_TIMERSLACK, previous, 0, 0, 0));
+    }
+
+    TimerSlackGuard(TimerSlackGuard const&) = delete;
+    auto operator=(TimerSlackGuard const&) -> TimerSlackGuard& = delete;
+
+    int previous { -1 };
+};
 
 } // namespace
 
 namespace sc
 {
 Context::Context(FrameTime const& ft) noexcept
-    : frame_time_ { ft.value() }
+    : frame_time_ { ft }
 {
 }
 
 Context::Context(std::uint32_t fps) noexcept
-    : frame_time_ { from_fps(fps).value() }
+    : frame_time_ { from_fps(fps) }
 {
 }
 
@@ -89,31 +94,78 @@ auto Context::request_stop() noexcept -> void
     ::write(event_fd_, &event, sizeof(event));
 }
 
+auto Context::spawn(Task task) -> void { post(task.release()); }
+
+auto Context::post(std::coroutine_handle<> coroutine) -> void
+{
+    reactor_.post(coroutine);
+}
+
+auto Context::set_pacing(FramePacing pacing) noexcept -> void
+{
+    pacing_ = pacing;
+}
+
+auto Context::set_backend(ReactorBackendType backend) noexcept -> void
+{
+    backend_ = backend;
+}
+
+auto Context::set_thread_policy(ThreadPolicy policy) -> void
+{
+    thread_policy_ = std::move(policy);
+}
+
+auto Context::set_clock(Clock& clock) noexcept -> void { clock_ = &clock; }
+
+auto Context::clock() const noexcept -> Clock& { return *clock_; }
+
+auto Context::set_origin(std::uint64_t origin) noexcept -> void
+{
+    origin_ = origin;
+}
+
+auto Context::metrics() const noexcept -> ContextMetrics const&
+{
+    return metrics_;
+}
+
 auto Context::run() -> void
 {
-    using Notifications = ReadinessRegister::NotifyRegisterType;
-    using Timers = ReadinessRegister::FrameTickRegisterType;
+    /* Applied before the services are initialized, so that their
+     * allocations are made on the CPUs that will use them...
+     */
+    ThreadPolicyGuard thread_policy_guard { thread_policy_ };
 
     if (event_fd_ = ::eventfd(0, EFD_NONBLOCK); event_fd_ < 0)
         throw std::system_error { errno, std::system_category() };
 
     SC_SCOPE_GUARD([&] { ::close(event_fd_); });
 
-    Notifications notifications;
-    Timers timers;
+    reactor_.open(event_fd_, backend_);
+    SC_SCOPE_GUARD([&] { reactor_.close(); });
+    reactor_.set_pacing(pacing_);
+    reactor_.set_clock(*clock_);
+    reactor_.set_origin(origin_);
+    detail::CurrentReactorGuard current_reactor_guard { reactor_,
+                                                        frame_time_ };
 
     ServiceRegistryLock registry_lock { reg_ };
     if (!registry_lock) [[unlikely]] {
         assert(false && "Couldn't obtain service registry lock");
     }
 
+    metrics_ = ContextMetrics {};
+    for (auto const& [id, svc] : reg_)
+        metrics_.services[id].name = service_name(*svc);
+
     auto initialized_pos = reg_.begin();
 
     try {
         for (; initialized_pos != reg_.end(); ++initialized_pos) {
-            auto& svc = std::get<1>(*initialized_pos);
-            svc->init(
-                ReadinessRegister { *svc, notifications, timers, frame_time_ });
+            auto& [id, svc] = *initialized_pos;
+            svc->init(ReadinessRegister {
+                *svc, reactor_, frame_time_, &metrics_.services[id].dispatch });
         }
     }
     catch (...) {
@@ -127,69 +179,29 @@ auto Context::run() -> void
 
     UninitGuard uninit_guard { reg_ };
 
-    if (notifications.size() + timers.size() == 0) {
+    /* Closing the reactor destroys any suspended tasks, which may
+     * reference data owned by the services, so it must happen
+     * before they're uninitialized...
+     */
+    SC_SCOPE_GUARD([&] { reactor_.close(); });
+
+    if (reactor_.empty()) {
         /* TODO: We should probably raise an error here...
          */
         return;
     }
 
-    std::vector<pollfd> poll_events;
-    poll_events.reserve(notifications.size() + 1);
-    poll_events.push_back({ event_fd_, POLLIN, 0 });
-
-    std::transform(begin(notifications),
-                   end(notifications),
-                   std::back_inserter(poll_events),
-                   [](auto const& notification) {
-                       return pollfd { std::get<0>(notification), POLLIN, 0 };
-                   });
-
-    Elapsed const& elapsed = global_elapsed;
-    auto frame_start = elapsed.nanosecond_value();
+    TimerSlackGuard timer_slack_guard { pacing_.timer_slack };
+    reactor_.start();
 
+    auto const start_time = monotonic_now();
     while (!stop_requested_) {
-        auto const frame_stop = elapsed.nanosecond_value();
-        auto const frame_time = frame_stop - frame_start;
-        frame_start = frame_stop;
-
-        auto const next_timeout = tick_timers(timers, frame_time, frame_time_);
-
-        auto sleep_for = from_nanoseconds(next_timeout);
-        auto const poll_result =
-            ppoll(poll_events.data(), poll_events.size(), &sleep_for, nullptr);
-
-        if (poll_result < 0) {
-            if (errno != EINTR) {
-                throw std::system_error { errno, std::system_category() };
-            }
-        }
-
-        if (poll_result > 0) {
-            for (auto const& ev : poll_events) {
-
-                if (!(ev.revents & POLLIN))
-                    continue;
-
-                if (ev.fd == event_fd_) {
-                    std::uint64_t discard;
-                    if (auto const result =
-                            ::read(event_fd_, &discard, sizeof(discard));
-                        result < 0)
-                        if (errno != EAGAIN)
-                            throw std::system_error { errno,
-                                                      std::system_category() };
-
-                    continue;
-                }
-
-                auto notify = notifications.find(ev.fd);
-                if (notify != notifications.end()) {
-                    std::get<1>(*notify).dispatch(*std::get<1>(*notify).svc);
-                }
-            }
-        }
+        reactor_.wait();
+        metrics_.iterations += 1;
     }
 
+    metrics_.run_time = monotonic_now() - start_time;
+
     stop_requested_ = false;
 }
 } // namespace sc
@@ -1,9 +1,15 @@
 #ifndef SHADOW_CAST_SERVICES_CONTEXT_HPP_INCLUDED
 #define SHADOW_CAST_SERVICES_CONTEXT_HPP_INCLUDED
 
+#include "services/context_metrics.hpp"
+#include "services/reactor.hpp"
 #include "services/service_registry.hpp"
+#include "services/task.hpp"
 #include "utils/frame_time.hpp"
+#include "utils/thread_policy.hpp"
 #include <atomic>
+#include <coroutine>
+#include <optional>
 
 namespace sc
 {
@@ -19,10 +25,82 @@ struct Context
     auto services() noexcept -> ServiceRegistry&;
     auto request_stop() noexcept -> void;
 
+    /* Starts `task` on this context's thread. If the context is
+     * running then the task starts on its next iteration,
+     * otherwise it starts once the context is run. This may be
+     * called from any thread...
+     */
+    auto spawn(Task task) -> void;
+
+    /* Resumes `coroutine` on this context's thread. This may be
+     * called from any thread. See `resume_on()`...
+     */
+    auto post(std::coroutine_handle<> coroutine) -> void;
+
+    /* Sets how precisely frame ticks are dispatched. Takes effect
+     * the next time `run()` is called...
+     */
+    auto set_pacing(FramePacing) noexcept -> void;
+
+    /* Selects the facility used to wait for events. Takes effect
+     * the next time `run()` is called. If io_uring isn't available
+     * then epoll is used instead...
+     */
+    auto set_backend(ReactorBackendType) noexcept -> void;
+
+    /* Sets the affinity and scheduling of the thread that calls
+     * `run()`, for the duration of the call. Takes effect the
+     * next time `run()` is called...
+     */
+    auto set_thread_policy(ThreadPolicy) -> void;
+
+    /* Sets the clock that frame ticks are scheduled against, and
+     * that services read through `ReadinessRegister::clock()`.
+     * `clock` must outlive any call to `run()`. By default this
+     * is `CLOCK_MONOTONIC`. With a `VirtualClock`, ticks are
+     * dispatched as fast as the services can handle them. Takes
+     * effect the next time `run()` is called...
+     */
+    auto set_clock(Clock& clock) noexcept -> void;
+    [[nodiscard]] auto clock() const noexcept -> Clock&;
+
+    /* Places tick zero of the frame timers at `origin`, a value of
+     * the context's clock, rather than at the time `run()` starts
+     * them. Contexts given the same origin share one timeline, so
+     * their timestamps line up. `origin` mustn't be later than the
+     * time the context starts. Takes effect the next time `run()`
+     * is called...
+     */
+    auto set_origin(std::uint64_t origin) noexcept -> void;
+
+    /* The timing of every dispatch made during the most recent
+     * call to `run()`. This must not be used while the context
+     * is running on another thread...
+     */
+    [[nodiscard]] auto metrics() const noexcept -> ContextMetrics const&;
+
+    template <ServiceLike T>
+    [[nodiscard]] auto metrics_for() const noexcept
+        -> metrics::DispatchMetrics const*
+    {
+        if (auto pos = metrics_.services.find(service_id<T>());
+            pos != metrics_.services.end())
+            return &pos->second.dispatch;
+
+        return nullptr;
+    }
+
 private:
-    std::uint64_t frame_time_;
+    FrameTime frame_time_;
+    FramePacing pacing_ {};
+    ReactorBackendType backend_ { ReactorBackendType::epoll };
+    ThreadPolicy thread_policy_ {};
+    Clock* clock_ { &monotonic_clock() };
+    std::optional<std::uint64_t> origin_;
+    ContextMetrics metrics_;
     std::atomic<bool> stop_requested_ { false };
     ServiceRegistry reg_;
+    Reactor reactor_;
     int event_fd_ { -1 };
 };
 
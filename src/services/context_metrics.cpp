@@ -0,0 +1,90 @@
+#include "services/context_metrics.hpp"
+#include "metrics/formatting.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+std::uint64_t constexpr kNsPerSec = 1'000'000'000;
+std::uint64_t constexpr kNsPerUs = 1'000;
+
+auto write_row(std::ostream& os, auto const&... columns) -> void
+{
+    std::size_t constexpr kColumnWidth = 12;
+    os << "| ";
+    ((os.width(kColumnWidth), os << columns << " | "), ...);
+    os << '\n';
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto ContextMetrics::iterations_per_second() const noexcept -> double
+{
+    if (!run_time)
+        return 0;
+
+    return static_cast<double>(iterations) * kNsPerSec /
+           static_cast<double>(run_time);
+}
+
+auto format_context_metrics(std::ostream& os,
+                            ContextMetrics const& data,
+                            std::string_view title) -> void
+{
+    os << title << '\n';
+    os << "Loop iterations: " << data.iterations << " ("
+       << data.iterations_per_second() << "/s)\n\n";
+
+    /* Sort by name so the output is stable between runs...
+     */
+    std::vector<ServiceMetrics const*> services;
+    for (auto const& [id, svc] : data.services)
+        services.push_back(&svc);
+
+    std::sort(services.begin(), services.end(), [](auto a, auto b) {
+        return a->name < b->name;
+    });
+
+    write_row(os,
+              "Dispatches",
+              "Mean (us)",
+              "Max (us)",
+              "Ticks",
+              "Missed",
+              "Late (us)",
+              "Service");
+    for (auto const* svc : services) {
+        auto const& m = svc->dispatch;
+        write_row(os,
+                  m.dispatches,
+                  m.mean_duration() / kNsPerUs,
+                  m.max_duration / kNsPerUs,
+                  m.ticks,
+                  m.missed_ticks,
+                  m.max_lateness / kNsPerUs,
+                  svc->name);
+    }
+
+    for (auto const* svc : services) {
+        if (!svc->dispatch.dispatches)
+            continue;
+
+        os << '\n';
+        metrics::format_histogram(os,
+                                  svc->dispatch.duration,
+                                  "Dispatch time (ns)",
+                                  svc->name);
+
+        if (!svc->dispatch.ticks)
+            continue;
+
+        os << '\n';
+        metrics::format_histogram(
+            os, svc->dispatch.lateness, "Lateness (ns)", svc->name);
+    }
+}
+
+} // namespace sc
@@ -0,0 +1,44 @@
+#ifndef SHADOW_CAST_SERVICES_CONTEXT_METRICS_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_CONTEXT_METRICS_HPP_INCLUDED
+
+#include "metrics/metrics.hpp"
+#include "services/service_registry.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sc
+{
+
+struct ServiceMetrics
+{
+    std::string name;
+    metrics::DispatchMetrics dispatch;
+};
+
+/* Collected by a context for its most recent call to `run()`...
+ */
+struct ContextMetrics
+{
+    [[nodiscard]] auto iterations_per_second() const noexcept -> double;
+
+    /* The number of times the event loop woke, and the time, in
+     * nanoseconds, it spent running...
+     */
+    std::uint64_t iterations { 0 };
+    std::uint64_t run_time { 0 };
+    std::unordered_map<ServiceId, ServiceMetrics> services;
+};
+
+/* Writes a summary table of `data`, followed by the dispatch time
+ * and lateness histograms of each service that was dispatched...
+ */
+auto format_context_metrics(std::ostream& os,
+                            ContextMetrics const& data,
+                            std::string_view title) -> void;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_CONTEXT_METRICS_HPP_INCLUDED
@@ -19,10 +19,6 @@
 #include <system_error>
 #include <vector>
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-#include "metrics/metrics.hpp"
-#endif
-
 namespace
 {
 char constexpr kSocketPath[] = "/tmp/shadow-cast.sock";
@@ -114,6 +110,22 @@ auto register_gl_texture_in_cuda(sc::NvCuda const& nvcuda,
     }
 }
 
+auto unregister_gl_texture_in_cuda(sc::NvCuda const& nvcuda,
+                                   CUcontext ctx,
+                                   CUgraphicsResource& cuda_gfx_resource)
+    -> void
+{
+    CUcontext old_ctx;
+    nvcuda.cuCtxPushCurrent_v2(ctx);
+    SC_SCOPE_GUARD([&] { nvcuda.cuCtxPopCurrent_v2(&old_ctx); });
+
+    if (cuda_gfx_resource) {
+        nvcuda.cuGraphicsUnmapResources(1, &cuda_gfx_resource, 0);
+        nvcuda.cuGraphicsUnregisterResource(cuda_gfx_resource);
+        cuda_gfx_resource = nullptr;
+    }
+}
+
 auto find_drm_helper_binary()
 {
     using namespace std::string_literals;
@@ -192,7 +204,7 @@ auto DRMVideoService::on_init(ReadinessRegister reg) -> void
     egl_->eglSwapInterval(platform_egl_->egl_display.get(), 0);
 
     reg(FrameTimeRatio(1), &dispatch_frame);
-    frame_time_ = reg.frame_time();
+    register_.emplace(reg);
 }
 
 auto DRMVideoService::on_uninit() noexcept -> void
@@ -207,10 +219,6 @@ auto DRMVideoService::dispatch_frame(Service& svc) -> void
     if (!self.frame_handler_)
         return;
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    auto const frame_start = global_elapsed.nanosecond_value();
-#endif
-
     auto const r =
         get_drm_data(self.drm_socket_, kDRMDataTimeoutMs, &self.drm_proc_mask_);
 
@@ -348,24 +356,28 @@ auto DRMVideoService::dispatch_frame(Service& svc) -> void
         self.cuda_array_);                             /* out */
 
     SC_SCOPE_GUARD([&] {
-        CUcontext old_ctx;
-        self.nvcuda_.cuCtxPushCurrent_v2(self.cuda_ctx_);
-        SC_SCOPE_GUARD([&] { self.nvcuda_.cuCtxPopCurrent_v2(&old_ctx); });
-
-        if (self.cuda_gfx_resource_) {
-            self.nvcuda_.cuGraphicsUnmapResources(
-                1, &self.cuda_gfx_resource_, 0);
-            self.nvcuda_.cuGraphicsUnregisterResource(self.cuda_gfx_resource_);
-            self.cuda_gfx_resource_ = nullptr;
-        }
+        unregister_gl_texture_in_cuda(
+            self.nvcuda_, self.cuda_ctx_, self.cuda_gfx_resource_);
     });
 
-    (*self.frame_handler_)(self.cuda_array_, self.nvcuda_, self.frame_time_);
+    auto const& tick = self.register_->current_tick();
+    (*self.frame_handler_)(self.cuda_array_, self.nvcuda_, tick);
+
+    for (auto& scaled : self.scaled_frame_handlers_) {
+        register_gl_texture_in_cuda(
+            self.nvcuda_,
+            self.cuda_ctx_,
+            self.color_converter_.scaled_output_texture(scaled.output).name(),
+            scaled.cuda_gfx_resource,
+            scaled.cuda_array);
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    metrics::add_frame_time(metrics::video_metrics,
-                            global_elapsed.nanosecond_value() - frame_start);
-#endif
+        SC_SCOPE_GUARD([&] {
+            unregister_gl_texture_in_cuda(
+                self.nvcuda_, self.cuda_ctx_, scaled.cuda_gfx_resource);
+        });
+
+        scaled.handler(scaled.cuda_array, self.nvcuda_, tick);
+    }
 }
 
 } // namespace sc
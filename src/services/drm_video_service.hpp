@@ -10,13 +10,16 @@
 #include "nvidia.hpp"
 #include "platform/egl.hpp"
 #include "platform/wayland.hpp"
+#include "services/frame_scheduler.hpp"
 #include "services/readiness.hpp"
 #include "services/service.hpp"
 #include "utils/borrowed_ptr.hpp"
 #include "utils/receiver.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <signal.h>
+#include <vector>
 
 namespace sc
 {
@@ -24,7 +27,7 @@ namespace sc
 struct DRMVideoService final : Service
 {
     using CaptureFrameReceiverType =
-        Receiver<void(CUarray, NvCuda const&, std::uint64_t)>;
+        Receiver<void(CUarray, NvCuda const&, FrameTick const&)>;
 
     explicit DRMVideoService(NvCuda nvcuda,
                              CUcontext cuda_ctx,
@@ -38,11 +41,34 @@ struct DRMVideoService final : Service
         frame_handler_ = CaptureFrameReceiverType { std::forward<F>(handler) };
     }
 
+    /* Adds a handler that's called with each frame after it's been
+     * scaled to `width` x `height` on the GPU, straight after the
+     * full size frame's handler. Must be called before the service
+     * is initialized...
+     */
+    template <typename F>
+    auto add_scaled_frame_handler(std::uint32_t width,
+                                  std::uint32_t height,
+                                  F&& handler) -> void
+    {
+        scaled_frame_handlers_.push_back(ScaledFrameHandler {
+            .output = color_converter_.add_scaled_output(width, height),
+            .handler = CaptureFrameReceiverType { std::forward<F>(handler) } });
+    }
+
 protected:
     auto on_init(ReadinessRegister) -> void override;
     auto on_uninit() noexcept -> void override;
 
 private:
+    struct ScaledFrameHandler
+    {
+        std::size_t output;
+        CaptureFrameReceiverType handler;
+        CUgraphicsResource cuda_gfx_resource { nullptr };
+        CUarray cuda_array { nullptr };
+    };
+
     static auto dispatch_frame(Service&) -> void;
 
 private:
@@ -56,9 +82,10 @@ private:
     Process drm_process_;
     sigset_t drm_proc_mask_;
     std::optional<CaptureFrameReceiverType> frame_handler_;
+    std::vector<ScaledFrameHandler> scaled_frame_handlers_;
     CUgraphicsResource cuda_gfx_resource_ { nullptr };
     CUarray cuda_array_ { nullptr };
-    std::uint64_t frame_time_ { 0 };
+    std::optional<ReadinessRegister> register_;
 };
 
 } // namespace sc
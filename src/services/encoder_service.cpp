@@ -2,6 +2,7 @@
 #include "config.hpp"
 #include "error.hpp"
 #include "utils/pool.hpp"
+#include <algorithm>
 #include <cstring>
 #include <errno.h>
 #include <libavcodec/avcodec.h>
@@ -18,22 +19,43 @@ std::size_t constexpr kInitialPoolSize = 16;
 
 namespace sc
 {
-EncoderService::EncoderService(
-    BorrowedPtr<AVFormatContext> fmt_context) noexcept
-    : format_context_ { fmt_context }
-    , packet_ { av_packet_alloc() }
+EncoderService::EncoderService(BorrowedPtr<MuxerService> muxer,
+                               QueueOptions const& queue_options) noexcept
+    : muxer_ { muxer }
+    , queue_options_ { queue_options }
+    , pending_ { queue_options }
 {
 }
 
 auto EncoderService::write_frame(PoolType::ItemPtr item) -> void
 {
-    {
-        std::lock_guard lock { data_mutex_ };
-        static_cast<void>(
-            avcodec_send_frame(item->codec_ctx, item->frame.get()));
-        pending_.push_back(item.release());
+    auto notify = false;
+
+    /* A flush is never dropped, and never waits, or shutting down
+     * could be held up by a full queue...
+     */
+    if (!item->frame) {
+        notify = pending_.push_unbounded(item.release());
+    }
+    else {
+        auto const result = pending_.push(item.release());
+        notify = result.notify;
+
+        /* A dropped frame releases its buffer straight away, rather
+         * than when it's next used...
+         */
+        if (result.dropped) {
+            result.dropped->reset();
+            pool_.put(result.dropped);
+        }
     }
 
+    /* Only the first frame of a batch needs to wake the context.
+     * The rest are picked up along with it...
+     */
+    if (!notify)
+        return;
+
     std::uint64_t const event_num { 1 };
     static_cast<void>(::write(notify_fd_, &event_num, sizeof(event_num)));
 }
@@ -45,19 +67,22 @@ auto EncoderService::on_init(ReadinessRegister reg) -> void
             "EncoderService initialization failed: "s + std::strerror(errno)
         };
 
-    pool_.fill(kInitialPoolSize);
+    /* Enough frames to fill the queue are allocated up front...
+     */
+    pool_.fill(std::max(kInitialPoolSize, queue_options_.capacity));
     reg(notify_fd_, &dispatch);
 }
 
 auto EncoderService::on_uninit() noexcept -> void
 {
-    static_cast<void>(::close(notify_fd_));
+    pending_.close();
     try {
         dispatch(*this);
         pool_.clear();
     }
     catch (...) {
     }
+    static_cast<void>(::close(notify_fd_));
 }
 
 auto EncoderService::dispatch(Service& svc) -> void
@@ -66,26 +91,33 @@ auto EncoderService::dispatch(Service& svc) -> void
     std::uint64_t event_num;
     static_cast<void>(::read(self.notify_fd_, &event_num, sizeof(event_num)));
 
+    /* Each encoder is only ever used from this thread, so none of
+     * this needs to be synchronized with the producers...
+     */
     IntrusiveList<StreamPoll> tmp;
-    {
-        std::lock_guard lock { self.data_mutex_ };
-        tmp.splice(tmp.begin(),
-                   self.pending_,
-                   self.pending_.begin(),
-                   self.pending_.end());
-    }
+    self.pending_.pop_all(tmp);
 
     ReturnToPoolGuard return_to_pool_guard { tmp, self.pool_ };
 
-    for (auto const& stream_poll : tmp) {
+    for (auto& stream_poll : tmp) {
+        if (self.abandoned_.load(std::memory_order_relaxed))
+            continue;
+
         auto* stream = stream_poll.stream;
         auto* ctx = stream_poll.codec_ctx;
-        int response = 0;
-        while (response >= 0) {
-            {
-                std::lock_guard lock { self.data_mutex_ };
-                response = avcodec_receive_packet(ctx, self.packet_.get());
-            }
+        if (stream_poll.converter)
+            stream_poll.converter->convert(*stream_poll.frame);
+
+        self.packet_buffers_.attach(*ctx);
+        static_cast<void>(avcodec_send_frame(ctx, stream_poll.frame.get()));
+
+        /* Packets are received straight into the muxer's pool, so
+         * they're handed over without being copied or moved...
+         */
+        while (true) {
+            auto muxer_packet = self.muxer_->pool().get();
+            auto const response =
+                avcodec_receive_packet(ctx, muxer_packet->packet.get());
             if (response == AVERROR(EAGAIN) || response == AVERROR_EOF) {
                 break;
             }
@@ -94,22 +126,33 @@ auto EncoderService::dispatch(Service& svc) -> void
                 throw std::runtime_error { "receive packet error" };
             }
 
-            av_packet_rescale_ts(
-                self.packet_.get(), ctx->time_base, stream->time_base);
-            self.packet_->stream_index = stream->index;
-
-            response = av_interleaved_write_frame(self.format_context_.get(),
-                                                  self.packet_.get());
-            if (response < 0) {
-                throw std::runtime_error { "write packet error: " +
-                                           av_error_to_string(response) };
-            }
+            muxer_packet->stream = stream;
+            muxer_packet->time_base = ctx->time_base;
+            self.muxer_->write_packet(std::move(muxer_packet));
         }
     }
 }
 
 auto EncoderService::pool() noexcept -> PoolType& { return pool_; }
 
+auto EncoderService::queue_metrics() const noexcept -> QueueMetrics
+{
+    return pending_.metrics();
+}
+
+auto EncoderService::abandon() noexcept -> void
+{
+    abandoned_.store(true, std::memory_order_relaxed);
+    pending_.close();
+}
+
+auto EncoderService::IsDroppable::operator()(
+    StreamPoll const& item) const noexcept -> bool
+{
+    return item.frame && item.codec_ctx &&
+           item.codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO;
+}
+
 StreamPoll::StreamPoll()
     : codec_ctx { nullptr }
     , stream { nullptr }
@@ -121,6 +164,7 @@ auto StreamPoll::reset() noexcept -> void
 {
     codec_ctx = nullptr;
     stream = nullptr;
+    converter.reset();
     if (!frame) {
         frame = FramePtr { av_frame_alloc() };
     }
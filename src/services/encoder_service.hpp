@@ -4,17 +4,21 @@
 #include "config.hpp"
 
 #include "av/frame.hpp"
+#include "av/frame_converter.hpp"
 #include "av/packet.hpp"
+#include "services/muxer_service.hpp"
 #include "services/readiness.hpp"
 #include "services/service.hpp"
 #include "utils/borrowed_ptr.hpp"
+#include "utils/bounded_queue.hpp"
 #include "utils/intrusive_list.hpp"
 #include "utils/pool.hpp"
+#include <atomic>
+#include <memory>
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 }
-#include <mutex>
 
 namespace sc
 {
@@ -27,9 +31,22 @@ struct StreamPoll : ListItemBase
     AVStream* stream;
     FramePtr frame;
 
+    /* If set, converts the frame to the encoder's format on the
+     * encoder's context, rather than on the capture thread...
+     */
+    std::shared_ptr<FrameConverter> converter;
+
     auto reset() noexcept -> void;
 };
 
+/* Encodes the frames of a single stream on its own context, and
+ * hands the packets to a `MuxerService`. Capture threads only ever
+ * queue frames, so they're never held up by the encoder, unless
+ * its queue is full. Then, depending on the queue's
+ * `OverflowPolicy`, video frames are dropped, or the capture waits
+ * for space. Audio frames, which can't be dropped without a gap in
+ * the sound, always wait...
+ */
 struct EncoderService final : Service
 {
 private:
@@ -44,17 +61,39 @@ private:
         auto destruct(StreamPoll* item) -> void { item->~StreamPoll(); }
     };
 
+    struct IsDroppable
+    {
+        auto operator()(StreamPoll const& item) const noexcept -> bool;
+    };
+
 public:
     using PoolType = SynchronizedPool<StreamPoll, EncoderPoolLifetime>;
-    EncoderService(BorrowedPtr<AVFormatContext>) noexcept;
+    explicit EncoderService(BorrowedPtr<MuxerService>,
+                            QueueOptions const& = {}) noexcept;
 
     EncoderService(EncoderService const&) = delete;
     auto operator=(EncoderService const&) -> EncoderService& = delete;
 
+    /* Queues a frame to be sent to its encoder on the context's
+     * thread. This may be called from any thread...
+     */
     auto write_frame(PoolType::ItemPtr) -> void;
 
     auto pool() noexcept -> PoolType&;
 
+    /* The depth of the frame queue, the deepest it has been, and
+     * how many frames have been dropped because it was full. This
+     * may be called from any thread...
+     */
+    [[nodiscard]] auto queue_metrics() const noexcept -> QueueMetrics;
+
+    /* Discards, rather than encodes, any frames that are still
+     * queued, including a flush, so that the context stops promptly
+     * once it's asked to, and stops any capture waiting for space in
+     * the queue. This may be called from any thread...
+     */
+    auto abandon() noexcept -> void;
+
 protected:
     auto on_init(ReadinessRegister) -> void override;
     auto on_uninit() noexcept -> void override;
@@ -62,12 +101,13 @@ protected:
 private:
     static auto dispatch(Service&) -> void;
 
-    BorrowedPtr<AVFormatContext> format_context_;
+    BorrowedPtr<MuxerService> muxer_;
     int notify_fd_ { -1 };
-    std::mutex data_mutex_;
-    PacketPtr packet_;
+    PacketBufferPool packet_buffers_;
+    QueueOptions queue_options_;
     PoolType pool_;
-    IntrusiveList<StreamPoll> pending_;
+    BoundedQueue<StreamPoll, IsDroppable> pending_;
+    std::atomic<bool> abandoned_ { false };
 };
 } // namespace sc
 
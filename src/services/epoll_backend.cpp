@@ -0,0 +1,152 @@
+#include "services/reactor_backend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+std::uint64_t constexpr kNsPerSec = 1'000'000'000;
+
+/* Any events beyond this are reported by the next wait, since
+ * handles are level-triggered...
+ */
+std::size_t constexpr kMaxEvents = 64;
+
+auto from_nanoseconds(std::uint64_t val) noexcept -> timespec
+{
+    return timespec { .tv_sec = static_cast<time_t>(val / kNsPerSec),
+                      .tv_nsec = static_cast<long>(val % kNsPerSec) };
+}
+
+/* Waits on file handles with epoll, and on the timer with a
+ * `timerfd`...
+ */
+struct EpollBackend final : sc::ReactorBackend
+{
+    EpollBackend()
+    {
+        if (epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC); epoll_fd_ < 0)
+            throw std::system_error { errno, std::system_category() };
+
+        timer_fd_ =
+            ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ < 0) {
+            auto const err = errno;
+            static_cast<void>(::close(epoll_fd_));
+            throw std::system_error { err, std::system_category() };
+        }
+
+        try {
+            add(timer_fd_, this);
+        }
+        catch (...) {
+            static_cast<void>(::close(timer_fd_));
+            static_cast<void>(::close(epoll_fd_));
+            throw;
+        }
+    }
+
+    ~EpollBackend()
+    {
+        static_cast<void>(::close(timer_fd_));
+        static_cast<void>(::close(epoll_fd_));
+    }
+
+    auto add(int fd, void* data) -> void override
+    {
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = data;
+
+        auto result = ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        if (result < 0 && errno == EEXIST)
+            result = ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+
+        if (result < 0)
+            throw std::system_error { errno, std::system_category() };
+    }
+
+    auto remove(int fd) -> void override
+    {
+        /* The handle may have already been closed by its owner,
+         * in which case the kernel will have removed it from the
+         * interest list already...
+         */
+        if (auto const result =
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            result < 0 && errno != EBADF && errno != ENOENT)
+            throw std::system_error { errno, std::system_category() };
+    }
+
+    auto arm_timer(std::optional<std::uint64_t> wake_time) -> void override
+    {
+        /* A zero `it_value` would disarm the timer, so a wake
+         * time of zero is clamped to 1ns, which has already
+         * passed...
+         */
+        itimerspec spec {};
+        if (wake_time)
+            spec.it_value =
+                from_nanoseconds(std::max(*wake_time, std::uint64_t { 1 }));
+
+        if (auto const result = ::timerfd_settime(
+                timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+            result < 0)
+            throw std::system_error { errno, std::system_category() };
+    }
+
+    auto wait(std::vector<sc::ReactorEvent>& events) -> void override
+    {
+        events.clear();
+
+        ready_.resize(kMaxEvents);
+        auto const num_events = ::epoll_wait(
+            epoll_fd_, ready_.data(), static_cast<int>(ready_.size()), -1);
+
+        if (num_events < 0) {
+            if (errno == EINTR)
+                return;
+
+            throw std::system_error { errno, std::system_category() };
+        }
+
+        for (auto i = 0; i < num_events; ++i) {
+            if (ready_[i].data.ptr == this) {
+                std::uint64_t val;
+                static_cast<void>(::read(timer_fd_, &val, sizeof(val)));
+                events.push_back(
+                    sc::ReactorEvent { .type = sc::ReactorEvent::Type::timer,
+                                       .data = nullptr,
+                                       .result = 0 });
+                continue;
+            }
+
+            events.push_back(
+                sc::ReactorEvent { .type = sc::ReactorEvent::Type::readable,
+                                   .data = ready_[i].data.ptr,
+                                   .result = 0 });
+        }
+    }
+
+private:
+    int epoll_fd_ { -1 };
+    int timer_fd_ { -1 };
+    std::vector<epoll_event> ready_;
+};
+
+} // namespace
+
+namespace sc
+{
+
+auto make_epoll_backend() -> std::unique_ptr<ReactorBackend>
+{
+    return std::make_unique<EpollBackend>();
+}
+
+} // namespace sc
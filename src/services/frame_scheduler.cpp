@@ -0,0 +1,221 @@
+#include "services/frame_scheduler.hpp"
+#include "metrics/metrics.hpp"
+#include "services/service.hpp"
+#include "utils/contracts.hpp"
+#include <algorithm>
+
+namespace
+{
+/* The index of the latest tick whose deadline is at, or
+ * before, `now`. Deadlines are rounded down to whole
+ * nanoseconds by `deadline_of()`, so this is the largest `n`
+ * where `floor(n * num / denom) <= now - origin`...
+ */
+auto latest_tick(sc::FrameTimer const& timer, std::uint64_t now) noexcept
+    -> std::uint64_t
+{
+    using Wide = unsigned __int128;
+    if (now < timer.origin)
+        return 0;
+
+    auto const elapsed = static_cast<Wide>(now - timer.origin);
+    return static_cast<std::uint64_t>(
+        ((elapsed + 1) * timer.period.denom - 1) / timer.period.num);
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto deadline_of(FrameTimer const& timer, std::uint64_t n) noexcept
+    -> std::uint64_t
+{
+    using Wide = unsigned __int128;
+    return timer.origin +
+           static_cast<std::uint64_t>(
+               (static_cast<Wide>(n) * timer.period.num) / timer.period.denom);
+}
+
+auto FrameScheduler::add(FramePeriod period, Readiness readiness)
+    -> FrameTimer&
+{
+    SC_EXPECT(period.num > 0 && period.denom > 0);
+
+    auto& timer =
+        emplace(FrameTimer { .readiness = readiness, .period = period });
+
+    /* A timer added once the scheduler has started joins the shared
+     * timeline at its next tick, rather than starting its own...
+     */
+    timer.origin = origin_;
+    if (started_) {
+        timer.tick = now_ < origin_ ? 0 : latest_tick(timer, now_) + 1;
+        timer.deadline = deadline_of(timer, timer.tick);
+    }
+
+    return timer;
+}
+
+auto FrameScheduler::add_oneshot(FramePeriod period,
+                                 Readiness readiness,
+                                 std::uint64_t now) -> FrameTimer&
+{
+    SC_EXPECT(period.num > 0 && period.denom > 0);
+
+    auto& timer = emplace(FrameTimer {
+        .readiness = readiness, .period = period, .oneshot = true });
+
+    timer.origin = origin_;
+    if (started_) {
+        timer.tick = now < origin_ ? 0 : latest_tick(timer, now) + 1;
+        timer.deadline = deadline_of(timer, timer.tick);
+    }
+
+    return timer;
+}
+
+auto FrameScheduler::emplace(FrameTimer timer) -> FrameTimer&
+{
+    if (spare_.empty())
+        return timers_.emplace_back(timer);
+
+    timers_.splice(timers_.end(), spare_, spare_.begin());
+    return timers_.back() = timer;
+}
+
+auto FrameScheduler::set_pacing(FramePacing pacing) noexcept -> void
+{
+    pacing_ = pacing;
+}
+
+auto FrameScheduler::pacing() const noexcept -> FramePacing const&
+{
+    return pacing_;
+}
+
+auto FrameScheduler::start(std::uint64_t now) noexcept -> void
+{
+    start(now, now);
+}
+
+auto FrameScheduler::start(std::uint64_t now, std::uint64_t origin) noexcept
+    -> void
+{
+    SC_EXPECT(origin <= now);
+
+    now_ = now;
+    origin_ = origin;
+    started_ = true;
+    for (auto& timer : timers_) {
+        timer.origin = origin;
+        timer.tick = 0;
+        timer.deadline = origin;
+        timer.missed = 0;
+        timer.lateness = 0;
+    }
+}
+
+auto FrameScheduler::stop() noexcept -> void { started_ = false; }
+
+auto FrameScheduler::clear() noexcept -> void
+{
+    for (auto const& timer : timers_) {
+        if (timer.readiness.coroutine)
+            timer.readiness.coroutine.destroy();
+    }
+
+    timers_.clear();
+    spare_.clear();
+    started_ = false;
+    origin_ = 0;
+    now_ = 0;
+    current_ = FrameTick {};
+}
+
+auto FrameScheduler::empty() const noexcept -> bool { return timers_.empty(); }
+
+auto FrameScheduler::next_deadline() const noexcept
+    -> std::optional<std::uint64_t>
+{
+    if (!started_ || timers_.empty())
+        return std::nullopt;
+
+    return std::min_element(timers_.begin(),
+                            timers_.end(),
+                            [](auto const& a, auto const& b) {
+                                return a.deadline < b.deadline;
+                            })
+        ->deadline;
+}
+
+auto FrameScheduler::current_tick() const noexcept -> FrameTick const&
+{
+    return current_;
+}
+
+auto FrameScheduler::wake_time() const noexcept -> std::optional<std::uint64_t>
+{
+    auto const deadline = next_deadline();
+    if (!deadline)
+        return deadline;
+
+    return *deadline - std::min(*deadline, pacing_.spin_threshold);
+}
+
+auto FrameScheduler::relax() noexcept -> void
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+auto FrameScheduler::dispatch_due(std::uint64_t now) -> void
+{
+    now_ = now;
+
+    /* Dispatch in deadline order. Each timer's deadline is moved
+     * past `now` before it is dispatched, so each timer is
+     * dispatched at most once here, even if its handler takes
+     * longer than its period...
+     */
+    while (true) {
+        auto due = timers_.end();
+        for (auto it = timers_.begin(); it != timers_.end(); ++it) {
+            if (it->deadline <= now &&
+                (due == timers_.end() || it->deadline < due->deadline))
+                due = it;
+        }
+
+        if (due == timers_.end())
+            break;
+
+        auto& timer = *due;
+        auto const latest = latest_tick(timer, now);
+        timer.missed = latest - timer.tick;
+        timer.lateness = now - deadline_of(timer, latest);
+        timer.tick = latest + 1;
+        timer.deadline = deadline_of(timer, timer.tick);
+
+        if (timer.readiness.metrics)
+            timer.readiness.metrics->add_tick(timer.lateness, timer.missed);
+
+        current_ = FrameTick { .index = latest,
+                               .missed = timer.missed,
+                               .deadline = deadline_of(timer, latest) };
+
+        if (!timer.oneshot) {
+            sc::dispatch(timer.readiness);
+            continue;
+        }
+
+        /* The dispatch may add another one-shot timer, which can
+         * reuse this one's node...
+         */
+        auto const readiness = timer.readiness;
+        spare_.splice(spare_.end(), timers_, due);
+        sc::dispatch(readiness);
+    }
+}
+
+} // namespace sc
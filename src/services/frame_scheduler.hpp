@@ -0,0 +1,174 @@
+#ifndef SHADOW_CAST_SERVICES_FRAME_SCHEDULER_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_FRAME_SCHEDULER_HPP_INCLUDED
+
+#include "services/clock.hpp"
+#include "services/readiness.hpp"
+#include <cstdint>
+#include <list>
+#include <optional>
+
+namespace sc
+{
+
+/* The exact period of a frame timer, in nanoseconds, given
+ * as the ratio `num / denom`...
+ */
+struct FramePeriod
+{
+    std::uint64_t num;
+    std::uint64_t denom;
+};
+
+struct FramePacing
+{
+    /* If non-zero, the scheduler wakes this many nanoseconds
+     * before a deadline and busy-waits for the remainder,
+     * trading CPU time for a more precise dispatch...
+     */
+    std::uint64_t spin_threshold { 0 };
+
+    /* If non-zero, the timer slack applied to the thread
+     * running the context, in nanoseconds. See `prctl(2)`,
+     * `PR_SET_TIMERSLACK`...
+     */
+    std::uint64_t timer_slack { 0 };
+};
+
+struct FrameTimer
+{
+    Readiness readiness;
+    FramePeriod period;
+
+    /* The clock value of tick zero. Every deadline is computed
+     * from this, rather than from the previous deadline, so
+     * error can't accumulate...
+     */
+    std::uint64_t origin { 0 };
+    std::uint64_t tick { 0 };
+    std::uint64_t deadline { 0 };
+
+    /* The number of deadlines that passed without a dispatch,
+     * and how late the dispatch was, for the most recent
+     * tick...
+     */
+    std::uint64_t missed { 0 };
+    std::uint64_t lateness { 0 };
+
+    /* A one-shot timer is removed once it has been dispatched...
+     */
+    bool oneshot { false };
+};
+
+/* Describes the tick that a frame timer is being dispatched for...
+ */
+struct FrameTick
+{
+    /* The index of the tick in the timer's timeline, and the number
+     * of ticks before it that passed without a dispatch...
+     */
+    std::uint64_t index { 0 };
+    std::uint64_t missed { 0 };
+    std::uint64_t deadline { 0 };
+};
+
+/* Dispatches frame timers against a fixed, absolute timeline.
+ * The scheduler doesn't wait by itself; Its owner waits until
+ * `wake_time()`, then calls `dispatch()`...
+ */
+struct FrameScheduler
+{
+    auto add(FramePeriod, Readiness) -> FrameTimer&;
+
+    /* Adds a timer that's dispatched once, at the first deadline
+     * after `now` on a timeline with the given period that starts
+     * at the same time as every other timer. If the scheduler
+     * hasn't started then it's dispatched on tick zero...
+     */
+    auto add_oneshot(FramePeriod, Readiness, std::uint64_t now)
+        -> FrameTimer&;
+    auto set_pacing(FramePacing) noexcept -> void;
+    auto pacing() const noexcept -> FramePacing const&;
+
+    /* Starts the timeline for all timers at `now`. Timers
+     * added after this call join the same timeline, at the
+     * first tick after the most recent time given to `start()`
+     * or `dispatch()`...
+     */
+    auto start(std::uint64_t now) noexcept -> void;
+
+    /* Starts the timeline for all timers at `origin`, which may be
+     * earlier than `now`, e.g. so that it's shared with another
+     * scheduler...
+     */
+    auto start(std::uint64_t now, std::uint64_t origin) noexcept -> void;
+    auto stop() noexcept -> void;
+
+    /* Removes every timer, destroying any coroutine that is
+     * still waiting on one...
+     */
+    auto clear() noexcept -> void;
+
+    [[nodiscard]] auto empty() const noexcept -> bool;
+
+    /* The earliest deadline of all timers, if any...
+     */
+    [[nodiscard]] auto next_deadline() const noexcept
+        -> std::optional<std::uint64_t>;
+
+    /* The tick being dispatched. This is only meaningful from
+     * within a frame timer's dispatch function...
+     */
+    [[nodiscard]] auto current_tick() const noexcept -> FrameTick const&;
+
+    /* The time at which the owner should wake in order to
+     * dispatch the next deadline. This is earlier than
+     * `next_deadline()` when spinning is enabled...
+     */
+    [[nodiscard]] auto wake_time() const noexcept
+        -> std::optional<std::uint64_t>;
+
+    /* Dispatches every timer whose deadline is at, or before,
+     * `now`. If the next deadline is within the spin threshold
+     * then this will busy-wait until it is reached...
+     */
+    template <typename Now>
+    auto dispatch(Now&& clock) -> void
+    {
+        auto now = clock();
+        if (auto const deadline = next_deadline();
+            deadline && *deadline > now &&
+            *deadline - now <= pacing_.spin_threshold) {
+            while (now < *deadline) {
+                relax();
+                now = clock();
+            }
+        }
+
+        dispatch_due(now);
+    }
+
+private:
+    static auto relax() noexcept -> void;
+    auto dispatch_due(std::uint64_t now) -> void;
+    auto emplace(FrameTimer timer) -> FrameTimer&;
+
+    std::list<FrameTimer> timers_;
+
+    /* The nodes of removed one-shot timers, kept for reuse so
+     * that adding a one-shot timer doesn't allocate...
+     */
+    std::list<FrameTimer> spare_;
+    FramePacing pacing_ {};
+    FrameTick current_ {};
+    bool started_ { false };
+    std::uint64_t origin_ { 0 };
+    std::uint64_t now_ { 0 };
+};
+
+/* The deadline of tick `n` in a timer's timeline...
+ */
+auto deadline_of(FrameTimer const&, std::uint64_t n) noexcept -> std::uint64_t;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_FRAME_SCHEDULER_HPP_INCLUDED
@@ -0,0 +1,228 @@
+#include "io/io_uring.hpp"
+#include "services/reactor_backend.hpp"
+#include <cerrno>
+#include <list>
+#include <poll.h>
+#include <system_error>
+#include <unordered_map>
+
+namespace
+{
+std::uint64_t constexpr kNsPerSec = 1'000'000'000;
+unsigned constexpr kRingEntries = 256;
+
+/* The low two bits of each submission's `user_data` identify the
+ * kind of operation. Poll records are pointers, so their low
+ * bits are always clear...
+ */
+std::uint64_t constexpr kTagMask = 3;
+std::uint64_t constexpr kPollTag = 0;
+std::uint64_t constexpr kTimerTag = 1;
+std::uint64_t constexpr kIgnoreTag = 3;
+
+/* Submits every operation through a single io_uring. Each loop
+ * iteration costs one `io_uring_enter()`, which both submits the
+ * operations queued by the previous iteration and waits for the
+ * next completion.
+ *
+ * Polls are one-shot, and are only re-armed after the current
+ * batch has been dispatched, which gives the same level-triggered
+ * behaviour as the epoll backend. The timer is an absolute
+ * `IORING_OP_TIMEOUT`, so it needs neither a `timerfd` nor a read
+ * to drain it...
+ */
+struct IoUringBackend final : sc::ReactorBackend
+{
+    struct Poll
+    {
+        int fd;
+        void* data;
+        bool in_flight;
+        bool cancelled;
+        std::list<Poll>::iterator self;
+    };
+
+    IoUringBackend()
+        : ring_ { kRingEntries }
+    {
+    }
+
+    auto add(int fd, void* data) -> void override
+    {
+        if (auto pos = active_.find(fd); pos != active_.end()) {
+            pos->second->data = data;
+            return;
+        }
+
+        auto& poll = polls_.emplace_back(Poll { .fd = fd,
+                                                .data = data,
+                                                .in_flight = false,
+                                                .cancelled = false,
+                                                .self = {} });
+        poll.self = std::prev(polls_.end());
+        active_.emplace(fd, &poll);
+        submit_poll(poll);
+    }
+
+    auto remove(int fd) -> void override
+    {
+        auto pos = active_.find(fd);
+        if (pos == active_.end())
+            return;
+
+        auto& poll = *pos->second;
+        active_.erase(pos);
+        poll.cancelled = true;
+
+        /* A poll that isn't in flight is waiting to be re-armed,
+         * and will be released then instead...
+         */
+        if (!poll.in_flight)
+            return;
+
+        auto& sqe = ring_.get_sqe();
+        sqe.opcode = IORING_OP_POLL_REMOVE;
+        sqe.fd = -1;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&poll);
+        sqe.user_data = kIgnoreTag;
+    }
+
+    auto arm_timer(std::optional<std::uint64_t> wake_time) -> void override
+    {
+        if (timer_in_flight_) {
+            auto& sqe = ring_.get_sqe();
+            sqe.opcode = IORING_OP_TIMEOUT_REMOVE;
+            sqe.fd = -1;
+            sqe.addr = timer_user_data();
+            sqe.user_data = kIgnoreTag;
+            timer_in_flight_ = false;
+        }
+
+        timer_generation_ += 1;
+        if (!wake_time)
+            return;
+
+        /* The kernel copies the expiry when the submission is
+         * consumed, so it only needs to outlive the next
+         * `io_uring_enter()`...
+         */
+        timer_expiry_ = __kernel_timespec {
+            .tv_sec = static_cast<std::int64_t>(*wake_time / kNsPerSec),
+            .tv_nsec = static_cast<long long>(*wake_time % kNsPerSec)
+        };
+
+        auto& sqe = ring_.get_sqe();
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.fd = -1;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&timer_expiry_);
+        sqe.len = 1;
+        sqe.off = 0;
+        sqe.timeout_flags = IORING_TIMEOUT_ABS;
+        sqe.user_data = timer_user_data();
+        timer_in_flight_ = true;
+    }
+
+    auto wait(std::vector<sc::ReactorEvent>& events) -> void override
+    {
+        events.clear();
+        rearm_polls();
+
+        if (!ring_.submit_and_wait(1))
+            return;
+
+        ring_.for_each_completion(
+            [&](auto const& cqe) { complete(cqe, events); });
+    }
+
+private:
+    auto submit_poll(Poll& poll) -> void
+    {
+        auto& sqe = ring_.get_sqe();
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.fd = poll.fd;
+        sqe.poll32_events = POLLIN;
+        sqe.user_data = reinterpret_cast<std::uint64_t>(&poll);
+        poll.in_flight = true;
+    }
+
+    auto rearm_polls() -> void
+    {
+        for (auto* poll : rearm_) {
+            if (poll->cancelled)
+                polls_.erase(poll->self);
+            else
+                submit_poll(*poll);
+        }
+
+        rearm_.clear();
+    }
+
+    auto complete(io_uring_cqe const& cqe,
+                  std::vector<sc::ReactorEvent>& events) -> void
+    {
+        switch (cqe.user_data & kTagMask) {
+        case kPollTag: {
+            auto& poll = *reinterpret_cast<Poll*>(cqe.user_data);
+            poll.in_flight = false;
+
+            /* A failed poll, e.g. because the handle was closed
+             * without being removed, is dropped, just as epoll
+             * drops a closed handle...
+             */
+            if (!poll.cancelled && cqe.res < 0) {
+                active_.erase(poll.fd);
+                poll.cancelled = true;
+            }
+
+            if (poll.cancelled) {
+                polls_.erase(poll.self);
+                break;
+            }
+
+            events.push_back(
+                sc::ReactorEvent { .type = sc::ReactorEvent::Type::readable,
+                                   .data = poll.data,
+                                   .result = cqe.res });
+            rearm_.push_back(&poll);
+            break;
+        }
+        case kTimerTag:
+            if (cqe.user_data != timer_user_data() || cqe.res != -ETIME)
+                break;
+
+            timer_in_flight_ = false;
+            events.push_back(
+                sc::ReactorEvent { .type = sc::ReactorEvent::Type::timer,
+                                   .data = nullptr,
+                                   .result = 0 });
+            break;
+        default:
+            break;
+        }
+    }
+
+    auto timer_user_data() const noexcept -> std::uint64_t
+    {
+        return (timer_generation_ << 2) | kTimerTag;
+    }
+
+    sc::IoUring ring_;
+    std::list<Poll> polls_;
+    std::unordered_map<int, Poll*> active_;
+    std::vector<Poll*> rearm_;
+    std::uint64_t timer_generation_ { 0 };
+    bool timer_in_flight_ { false };
+    __kernel_timespec timer_expiry_ {};
+};
+
+} // namespace
+
+namespace sc
+{
+
+auto make_io_uring_backend() -> std::unique_ptr<ReactorBackend>
+{
+    return std::make_unique<IoUringBackend>();
+}
+
+} // namespace sc
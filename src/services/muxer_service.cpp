@@ -0,0 +1,223 @@
+#include "services/muxer_service.hpp"
+#include "error.hpp"
+#include "logging.hpp"
+#include "utils/contracts.hpp"
+#include "utils/pool.hpp"
+#include <cstring>
+#include <errno.h>
+#include <new>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+std::size_t constexpr kInitialPoolSize = 64;
+}
+
+namespace sc
+{
+
+MuxerPacket::MuxerPacket()
+    : packet { av_packet_alloc() }
+    , stream { nullptr }
+    , time_base { 0, 1 }
+{
+    if (!packet)
+        throw std::bad_alloc {};
+}
+
+auto MuxerPacket::reset() noexcept -> void
+{
+    av_packet_unref(packet.get());
+    stream = nullptr;
+    time_base = AVRational { 0, 1 };
+}
+
+MuxerService::MuxerService(BorrowedPtr<AVFormatContext> fmt_context) noexcept
+    : format_context_ { fmt_context }
+{
+}
+
+MuxerService::MuxerService(BorrowedPtr<AVFormatContext> fmt_context,
+                           ReplayLimits limits)
+    : format_context_ { fmt_context }
+{
+    replay_.emplace(limits);
+    replay_writer_.emplace(fmt_context->url);
+}
+
+MuxerService::MuxerService(BorrowedPtr<AVFormatContext> fmt_context,
+                           SegmentLimits limits,
+                           WriteBehindOptions const& options,
+                           DictionaryPtr header_options)
+    : format_context_ { fmt_context }
+{
+    segments_.emplace(
+        *fmt_context, limits, options, std::move(header_options));
+}
+
+MuxerService::~MuxerService()
+{
+    /* If this context stopped early because of an error, encoders
+     * may have queued packets after it was uninitialized...
+     */
+    IntrusiveList<MuxerPacket> tmp;
+    pending_.pop_all(tmp);
+    ReturnToPoolGuard return_to_pool_guard { tmp, pool_ };
+}
+
+auto MuxerService::write_packet(PoolType::ItemPtr item) -> void
+{
+    SC_EXPECT(item->stream);
+
+    if (pending_.push(item.release()))
+        notify();
+}
+
+auto MuxerService::pool() noexcept -> PoolType& { return pool_; }
+
+auto MuxerService::is_replay() const noexcept -> bool
+{
+    return replay_.has_value();
+}
+
+auto MuxerService::save_replay() noexcept -> void
+{
+    SC_EXPECT(is_replay());
+    replay_requested_.store(true, std::memory_order_release);
+    notify();
+}
+
+auto MuxerService::set_fragment_duration(std::uint64_t duration) noexcept
+    -> void
+{
+    fragments_.emplace(SegmentLimits { .duration = duration, .max_bytes = 0 });
+}
+
+auto MuxerService::add_sink(std::string url, TeeSinkOptions const& options)
+    -> void
+{
+    sinks_.push_back(
+        std::make_unique<TeeSink>(std::move(url), *format_context_, options));
+}
+
+auto MuxerService::abandon() noexcept -> void
+{
+    abandoned_.store(true, std::memory_order_relaxed);
+}
+
+auto MuxerService::notify() noexcept -> void
+{
+    std::uint64_t const event_num { 1 };
+    static_cast<void>(::write(notify_fd_, &event_num, sizeof(event_num)));
+}
+
+auto MuxerService::end_fragment_before(MuxerPacket const& item) -> void
+{
+    if (!fragments_ ||
+        !fragments_->next(decode_time(*item.packet, item.time_base),
+                          static_cast<std::size_t>(item.packet->size),
+                          is_video_keyframe(*item.packet, *item.stream)))
+        return;
+
+    if (segments_)
+        segments_->flush_fragment();
+    else
+        flush_fragment(*format_context_);
+}
+
+auto MuxerService::on_init(ReadinessRegister reg) -> void
+{
+    if (notify_fd_ = ::eventfd(0, EFD_NONBLOCK); notify_fd_ < 0)
+        throw std::runtime_error { "MuxerService initialization failed: "s +
+                                   std::strerror(errno) };
+
+    pool_.fill(kInitialPoolSize);
+    reg(notify_fd_, &dispatch);
+}
+
+auto MuxerService::on_uninit() noexcept -> void
+{
+    /* The eventfd is closed only once drained, since dispatch reads
+     * from it, and its number could otherwise be reused by an fd
+     * another thread opens in the meantime...
+     */
+    try {
+        dispatch(*this);
+        pool_.clear();
+    }
+    catch (...) {
+    }
+    static_cast<void>(::close(notify_fd_));
+
+    /* Packets still queued were written above, so the last segment,
+     * and each sink, can now be finished. Every sink is stopped
+     * before any is waited for, so they share one timeout...
+     */
+    if (segments_)
+        segments_->close();
+
+    for (auto& sink : sinks_)
+        sink->stop();
+
+    for (auto& sink : sinks_)
+        sink->close();
+}
+
+auto MuxerService::dispatch(Service& svc) -> void
+{
+    auto& self = static_cast<MuxerService&>(svc);
+    std::uint64_t event_num;
+    static_cast<void>(::read(self.notify_fd_, &event_num, sizeof(event_num)));
+
+    IntrusiveList<MuxerPacket> tmp;
+    self.pending_.pop_all(tmp);
+
+    ReturnToPoolGuard return_to_pool_guard { tmp, self.pool_ };
+
+    for (auto& item : tmp) {
+        if (self.abandoned_.load(std::memory_order_relaxed))
+            break;
+
+        for (auto& sink : self.sinks_)
+            sink->push(*item.packet, *item.stream, item.time_base);
+
+        if (self.replay_) {
+            self.replay_->push(*item.packet, *item.stream, item.time_base);
+            continue;
+        }
+
+        self.end_fragment_before(item);
+
+        if (self.segments_) {
+            self.segments_->write(*item.packet, *item.stream, item.time_base);
+            continue;
+        }
+
+        auto* packet = item.packet.get();
+        av_packet_rescale_ts(packet, item.time_base, item.stream->time_base);
+        packet->stream_index = item.stream->index;
+
+        if (auto const response =
+                av_interleaved_write_frame(self.format_context_.get(), packet);
+            response < 0) {
+            throw std::runtime_error { "write packet error: " +
+                                       av_error_to_string(response) };
+        }
+    }
+
+    if (self.replay_requested_.exchange(false, std::memory_order_acquire)) {
+        if (!self.replay_->size()) {
+            log::warn("Nothing to save in the replay buffer yet"s);
+            return;
+        }
+
+        self.replay_writer_->write(self.replay_->snapshot());
+    }
+}
+
+} // namespace sc
@@ -0,0 +1,137 @@
+#ifndef SHADOW_CAST_SERVICES_MUXER_SERVICE_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_MUXER_SERVICE_HPP_INCLUDED
+
+#include "config.hpp"
+
+#include "av/packet.hpp"
+#include "services/readiness.hpp"
+#include "services/replay_buffer.hpp"
+#include "services/segmented_output.hpp"
+#include "services/tee_sink.hpp"
+#include "services/service.hpp"
+#include "utils/borrowed_ptr.hpp"
+#include "utils/intrusive_list.hpp"
+#include "utils/mpsc_queue.hpp"
+#include "utils/pool.hpp"
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace sc
+{
+
+/* An encoded packet on its way to the muxer. Its timestamps are
+ * in `time_base`, the time base of the encoder that produced it...
+ */
+struct MuxerPacket : ListItemBase
+{
+    MuxerPacket();
+
+    PacketPtr packet;
+    AVStream* stream;
+    AVRational time_base;
+
+    auto reset() noexcept -> void;
+};
+
+/* Writes the packets from every encoder to the output. Encoders
+ * run on their own contexts and hand their packets over with
+ * `write_packet()`, so this is the only place that touches the
+ * format context while capturing.
+ *
+ * In replay mode nothing is written to the output. Instead, the
+ * packets are kept in a `ReplayBuffer` until `save_replay()` is
+ * called. In segmented mode the packets are written to a
+ * `SegmentedOutput`, rather than to the format context, which is
+ * only used as a template for each segment.
+ *
+ * If a fragment duration is set then the output is flushed, as a
+ * self-contained fragment, at the first video keyframe after each
+ * duration. See `flush_fragment()`.
+ *
+ * Every packet is also handed to each `TeeSink`, before anything
+ * else is done with it. Sinks write on their own threads, so a slow
+ * sink never holds up the muxer...
+ */
+struct MuxerService final : Service
+{
+    using PoolType = SynchronizedPool<MuxerPacket>;
+
+    explicit MuxerService(BorrowedPtr<AVFormatContext>) noexcept;
+    MuxerService(BorrowedPtr<AVFormatContext>, ReplayLimits);
+    MuxerService(BorrowedPtr<AVFormatContext>,
+                 SegmentLimits,
+                 WriteBehindOptions const&,
+                 DictionaryPtr header_options);
+    ~MuxerService();
+
+    MuxerService(MuxerService const&) = delete;
+    auto operator=(MuxerService const&) -> MuxerService& = delete;
+
+    /* Queues a packet to be written on the context's thread. This
+     * may be called from any thread...
+     */
+    auto write_packet(PoolType::ItemPtr) -> void;
+
+    auto pool() noexcept -> PoolType&;
+
+    [[nodiscard]] auto is_replay() const noexcept -> bool;
+
+    /* Saves the contents of the replay buffer to a new file, next
+     * to the output file, on a background thread. This may be
+     * called from any thread...
+     */
+    auto save_replay() noexcept -> void;
+
+    /* Ends a fragment every `duration` nanoseconds. The output must
+     * have been opened with `fragment_options()`. Must be called
+     * before the context is run...
+     */
+    auto set_fragment_duration(std::uint64_t duration) noexcept -> void;
+
+    /* Adds an extra output, with the same streams as the format
+     * context. See `TeeSink`. Must be called before the context is
+     * run...
+     */
+    auto add_sink(std::string url, TeeSinkOptions const& options = {})
+        -> void;
+
+    /* Discards, rather than writes, any packets that are still
+     * queued, so that the context stops promptly once it's asked to.
+     * The output, and each sink, is still finished. This may be
+     * called from any thread...
+     */
+    auto abandon() noexcept -> void;
+
+protected:
+    auto on_init(ReadinessRegister) -> void override;
+    auto on_uninit() noexcept -> void override;
+
+private:
+    static auto dispatch(Service&) -> void;
+
+    auto notify() noexcept -> void;
+    auto end_fragment_before(MuxerPacket const&) -> void;
+
+    BorrowedPtr<AVFormatContext> format_context_;
+    int notify_fd_ { -1 };
+    PoolType pool_;
+    MpscQueue<MuxerPacket> pending_;
+    std::optional<ReplayBuffer> replay_;
+    std::optional<ReplayWriter> replay_writer_;
+    std::atomic<bool> replay_requested_ { false };
+    std::optional<SegmentedOutput> segments_;
+    std::optional<SegmentTracker> fragments_;
+    std::vector<std::unique_ptr<TeeSink>> sinks_;
+    std::atomic<bool> abandoned_ { false };
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_MUXER_SERVICE_HPP_INCLUDED
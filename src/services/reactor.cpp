@@ -0,0 +1,401 @@
+#include "services/reactor.hpp"
+#include "services/service.hpp"
+#include "services/task.hpp"
+#include "utils/contracts.hpp"
+#include "utils/scope_guard.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <errno.h>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+
+namespace
+{
+
+auto drain(int fd) -> std::uint64_t
+{
+    std::uint64_t val { 0 };
+    if (auto const result = ::read(fd, &val, sizeof(val)); result < 0) {
+        if (errno != EAGAIN)
+            throw std::system_error { errno, std::system_category() };
+
+        return 0;
+    }
+
+    return val;
+}
+
+} // namespace
+
+namespace sc
+{
+
+Reactor::~Reactor()
+{
+    close();
+    for (auto coroutine : posted_)
+        coroutine.destroy();
+}
+
+auto Reactor::open(int wakeup_fd, ReactorBackendType type) -> void
+{
+    SC_EXPECT(!backend_);
+
+    backend_type_ = ReactorBackendType::epoll;
+    if (type == ReactorBackendType::io_uring) {
+        try {
+            backend_ = make_io_uring_backend();
+            backend_type_ = ReactorBackendType::io_uring;
+        }
+        catch (std::system_error const&) {
+        }
+    }
+
+    if (!backend_)
+        backend_ = make_epoll_backend();
+
+    try {
+        add_entry(Entry { .type = EntryType::wakeup,
+                          .fd = wakeup_fd,
+                          .readiness = { nullptr, nullptr },
+                          .removed = false });
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+
+    std::lock_guard lock { post_mutex_ };
+    wakeup_fd_ = wakeup_fd;
+}
+
+auto Reactor::close() noexcept -> void
+{
+    {
+        std::lock_guard lock { post_mutex_ };
+        wakeup_fd_ = -1;
+    }
+
+    backend_.reset();
+
+    /* Any coroutine still waiting is destroyed, including those
+     * left behind by a resumption that threw...
+     */
+    for (auto const& [fd, entry] : entries_) {
+        if (entry.type == EntryType::oneshot && !entry.removed)
+            entry.readiness.coroutine.destroy();
+    }
+
+    for (auto i = num_resumed_; i < resuming_.size(); ++i)
+        resuming_[i].destroy();
+
+    resuming_.clear();
+    num_resumed_ = 0;
+    entries_.clear();
+    removed_.clear();
+    scheduler_.clear();
+    started_ = false;
+    armed_wake_time_ = std::nullopt;
+}
+
+auto Reactor::backend() const noexcept -> ReactorBackendType
+{
+    return backend_type_;
+}
+
+auto Reactor::start() -> void
+{
+    started_ = true;
+    auto const now = clock_->now();
+    scheduler_.start(now, origin_.value_or(now));
+    arm_timer();
+
+    /* Coroutines may have been posted before the reactor was
+     * opened...
+     */
+    std::lock_guard lock { post_mutex_ };
+    if (posted_.size())
+        signal_wakeup();
+}
+
+auto Reactor::set_pacing(FramePacing pacing) noexcept -> void
+{
+    scheduler_.set_pacing(pacing);
+}
+
+auto Reactor::set_clock(Clock& clock) noexcept -> void
+{
+    SC_EXPECT(!started_);
+    clock_ = &clock;
+}
+
+auto Reactor::clock() const noexcept -> Clock& { return *clock_; }
+
+auto Reactor::set_origin(std::optional<std::uint64_t> origin) noexcept -> void
+{
+    SC_EXPECT(!started_);
+    origin_ = origin;
+}
+
+auto Reactor::origin() const noexcept -> std::optional<std::uint64_t>
+{
+    return origin_;
+}
+
+auto Reactor::current_tick() const noexcept -> FrameTick const&
+{
+    return scheduler_.current_tick();
+}
+
+auto Reactor::add_notification(int fd, Readiness readiness) -> void
+{
+    add_entry(Entry { .type = EntryType::notification,
+                      .fd = fd,
+                      .readiness = readiness,
+                      .removed = false });
+}
+
+auto Reactor::add_frame_tick(FramePeriod period, Readiness readiness) -> void
+{
+    SC_EXPECT(period.num > 0 && period.denom > 0);
+    scheduler_.add(period, readiness);
+    if (started_)
+        arm_timer();
+}
+
+auto Reactor::remove_notification(int fd) -> void
+{
+    auto pos = entries_.find(fd);
+    if (pos == entries_.end())
+        return;
+
+    auto& entry = pos->second;
+    if (entry.removed || entry.type == EntryType::wakeup)
+        return;
+
+    backend_->remove(fd);
+    entry.removed = true;
+    removed_.push_back(fd);
+}
+
+auto Reactor::resume_at_next_tick(FramePeriod period,
+                                  std::coroutine_handle<> coroutine) -> void
+{
+    SC_EXPECT(period.num > 0 && period.denom > 0);
+    scheduler_.add_oneshot(
+        period, Readiness { .svc = nullptr,
+                            .dispatch = nullptr,
+                            .coroutine = coroutine },
+        clock_->now());
+    if (started_)
+        arm_timer();
+}
+
+auto Reactor::resume_when_readable(int fd, std::coroutine_handle<> coroutine)
+    -> void
+{
+    add_entry(Entry { .type = EntryType::oneshot,
+                      .fd = fd,
+                      .readiness = { .svc = nullptr,
+                                     .dispatch = nullptr,
+                                     .coroutine = coroutine },
+                      .removed = false });
+}
+
+auto Reactor::post(std::coroutine_handle<> coroutine) -> void
+{
+    std::lock_guard lock { post_mutex_ };
+    posted_.push_back(coroutine);
+    signal_wakeup();
+}
+
+auto Reactor::empty() noexcept -> bool
+{
+    {
+        std::lock_guard lock { post_mutex_ };
+        if (posted_.size())
+            return false;
+    }
+
+    return scheduler_.empty() &&
+           std::none_of(entries_.begin(), entries_.end(), [](auto const& e) {
+               auto const& entry = std::get<1>(e);
+               return entry.type != EntryType::wakeup && !entry.removed;
+           });
+}
+
+auto Reactor::wait() -> void
+{
+    release_removed();
+    backend_->wait(events_);
+
+    SC_SCOPE_GUARD([&] { release_removed(); });
+
+    for (auto const& event : events_) {
+        switch (event.type) {
+        case ReactorEvent::Type::timer:
+            /* The timer is one-shot, so it must be re-armed even
+             * if the next wake time happens to be unchanged...
+             */
+            armed_wake_time_ = std::nullopt;
+            dispatch_timers();
+            break;
+        case ReactorEvent::Type::readable: {
+            auto& entry = *static_cast<Entry*>(event.data);
+
+            /* A previous dispatch in this batch may have removed
+             * this registration...
+             */
+            if (entry.removed)
+                break;
+
+            switch (entry.type) {
+            case EntryType::wakeup:
+                static_cast<void>(drain(entry.fd));
+                resume_posted();
+                break;
+            case EntryType::oneshot:
+                remove_notification(entry.fd);
+                sc::dispatch(entry.readiness);
+                break;
+            default:
+                sc::dispatch(entry.readiness);
+                break;
+            }
+            break;
+        }
+        }
+    }
+
+    arm_timer();
+}
+
+auto Reactor::add_entry(Entry entry) -> Entry&
+{
+    SC_EXPECT(backend_);
+
+    auto const fd = entry.fd;
+    auto pos = entries_.find(fd);
+
+    /* Re-registering a handle that was removed earlier in
+     * the current dispatch batch, or one that was closed
+     * and re-opened by its owner, replaces the existing
+     * registration...
+     */
+    if (pos != entries_.end()) {
+        pos->second = entry;
+    }
+    else if (spare_entries_.size()) {
+        auto node = std::move(spare_entries_.back());
+        spare_entries_.pop_back();
+        node.key() = fd;
+        node.mapped() = entry;
+        pos = entries_.insert(std::move(node)).position;
+    }
+    else {
+        pos = entries_.emplace(fd, entry).first;
+    }
+
+    try {
+        backend_->add(fd, &pos->second);
+    }
+    catch (...) {
+        entries_.erase(pos);
+        throw;
+    }
+
+    return pos->second;
+}
+
+auto Reactor::arm_timer() -> void
+{
+    if (!started_)
+        return;
+
+    auto wake_time = scheduler_.wake_time();
+
+    /* A virtual clock's deadlines aren't waited for. The timer is
+     * armed at a time that has already passed, so the next wait
+     * only collects the events that are already pending...
+     */
+    if (wake_time && clock_->is_virtual())
+        wake_time = 0;
+
+    if (wake_time == armed_wake_time_)
+        return;
+
+    /* The timer is armed at an absolute time, so the time
+     * spent dispatching doesn't delay the next frame...
+     */
+    backend_->arm_timer(wake_time);
+    armed_wake_time_ = wake_time;
+}
+
+auto Reactor::dispatch_timers() -> void
+{
+    auto const now = [&] { return clock_->now(); };
+    if (!clock_->is_virtual()) {
+        scheduler_.dispatch(now);
+        return;
+    }
+
+    /* Virtual time only moves once everything that's ready in the
+     * current batch has been dispatched, so a deadline is never
+     * reached ahead of the work that precedes it...
+     */
+    if (std::any_of(events_.begin(), events_.end(), [](auto const& event) {
+            return event.type == ReactorEvent::Type::readable;
+        }))
+        return;
+
+    if (auto const deadline = scheduler_.next_deadline(); deadline) {
+        clock_->advance_to(*deadline);
+        scheduler_.dispatch(now);
+    }
+}
+
+auto Reactor::release_removed() noexcept -> void
+{
+    for (auto const fd : removed_) {
+        auto pos = entries_.find(fd);
+        if (pos == entries_.end() || !pos->second.removed)
+            continue;
+
+        try {
+            spare_entries_.push_back(entries_.extract(pos));
+        }
+        catch (...) {
+        }
+    }
+
+    removed_.clear();
+}
+
+auto Reactor::resume_posted() -> void
+{
+    {
+        std::lock_guard lock { post_mutex_ };
+        std::swap(posted_, resuming_);
+    }
+
+    /* If a coroutine throws, those that follow it are destroyed
+     * when the reactor is closed...
+     */
+    for (num_resumed_ = 0; num_resumed_ < resuming_.size();)
+        sc::resume(resuming_[num_resumed_++]);
+
+    resuming_.clear();
+    num_resumed_ = 0;
+}
+
+auto Reactor::signal_wakeup() noexcept -> void
+{
+    if (wakeup_fd_ < 0)
+        return;
+
+    std::uint64_t const val { 1 };
+    static_cast<void>(::write(wakeup_fd_, &val, sizeof(val)));
+}
+
+} // namespace sc
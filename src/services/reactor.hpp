@@ -0,0 +1,167 @@
+#ifndef SHADOW_CAST_SERVICES_REACTOR_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_REACTOR_HPP_INCLUDED
+
+#include "services/clock.hpp"
+#include "services/frame_scheduler.hpp"
+#include "services/reactor_backend.hpp"
+#include "services/readiness.hpp"
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace sc
+{
+
+/* An event demultiplexer. Each registration is stored in a
+ * node-based container so its address remains stable for as
+ * long as it's registered. That address is handed to the
+ * backend, and from there to the kernel, so a wakeup dispatches
+ * straight to the registration without any lookup. Frame timers
+ * are managed by a `FrameScheduler`, whose next wake time is
+ * given to the backend's timer as an absolute deadline, so frame
+ * ticks never drift.
+ *
+ * Registrations can be added and removed while `wait()` is
+ * dispatching, but only from the thread calling `wait()`.
+ * Removed entries are kept alive until the current batch of
+ * events has been dispatched.
+ */
+struct Reactor
+{
+    enum struct EntryType
+    {
+        notification,
+        oneshot,
+        wakeup
+    };
+
+    struct Entry
+    {
+        EntryType type;
+        int fd;
+        Readiness readiness;
+        bool removed;
+    };
+
+    Reactor() noexcept = default;
+    ~Reactor();
+
+    Reactor(Reactor const&) = delete;
+    auto operator=(Reactor const&) -> Reactor& = delete;
+
+    /* Creates the backend. If the io_uring backend is requested
+     * but isn't available then this falls back to epoll. See
+     * `backend()`. `wakeup_fd` is an eventfd that is drained,
+     * but not dispatched, whenever it becomes readable...
+     */
+    auto open(int wakeup_fd,
+              ReactorBackendType type = ReactorBackendType::epoll) -> void;
+
+    /* Destroys the backend, and removes every registration...
+     */
+    auto close() noexcept -> void;
+
+    [[nodiscard]] auto backend() const noexcept -> ReactorBackendType;
+
+    /* Starts the timeline of all of the frame timers registered
+     * so far. Timers registered after this call are dispatched
+     * at the next wakeup...
+     */
+    auto start() -> void;
+
+    auto set_pacing(FramePacing pacing) noexcept -> void;
+
+    /* The clock that frame deadlines are measured against. This
+     * must not be changed once the reactor has started...
+     */
+    auto set_clock(Clock& clock) noexcept -> void;
+    [[nodiscard]] auto clock() const noexcept -> Clock&;
+
+    /* The clock value that tick zero of the frame timers falls on,
+     * if it was given one. Otherwise the timeline starts when the
+     * reactor does. This must not be changed once the reactor has
+     * started...
+     */
+    auto set_origin(std::optional<std::uint64_t> origin) noexcept -> void;
+    [[nodiscard]] auto origin() const noexcept -> std::optional<std::uint64_t>;
+
+    /* The tick being dispatched. See
+     * `FrameScheduler::current_tick()`...
+     */
+    [[nodiscard]] auto current_tick() const noexcept -> FrameTick const&;
+
+    auto add_notification(int fd, Readiness readiness) -> void;
+    auto add_frame_tick(FramePeriod period, Readiness readiness) -> void;
+    auto remove_notification(int fd) -> void;
+
+    /* Resumes `coroutine` once, at the next tick of a frame timer
+     * with the given period...
+     */
+    auto resume_at_next_tick(FramePeriod period,
+                             std::coroutine_handle<> coroutine) -> void;
+
+    /* Resumes `coroutine` once, when `fd` is next readable...
+     */
+    auto resume_when_readable(int fd, std::coroutine_handle<> coroutine)
+        -> void;
+
+    /* Resumes `coroutine` from `wait()`. Unlike the rest of the
+     * reactor, this may be called from any thread, and at any
+     * time. Coroutines posted while the reactor isn't open are
+     * resumed once it has started...
+     */
+    auto post(std::coroutine_handle<> coroutine) -> void;
+
+    /* Returns true if there are no registrations, other than
+     * the wakeup handle, and no posted coroutines...
+     */
+    [[nodiscard]] auto empty() noexcept -> bool;
+
+    /* Blocks until at least one registration is ready, then
+     * dispatches every ready registration...
+     */
+    auto wait() -> void;
+
+private:
+    auto add_entry(Entry entry) -> Entry&;
+    auto arm_timer() -> void;
+    auto dispatch_timers() -> void;
+    auto release_removed() noexcept -> void;
+    auto resume_posted() -> void;
+    auto signal_wakeup() noexcept -> void;
+
+    std::unique_ptr<ReactorBackend> backend_;
+    Clock* clock_ { &monotonic_clock() };
+    std::optional<std::uint64_t> origin_;
+    ReactorBackendType backend_type_ { ReactorBackendType::epoll };
+    bool started_ { false };
+    std::optional<std::uint64_t> armed_wake_time_;
+    FrameScheduler scheduler_;
+    std::unordered_map<int, Entry> entries_;
+
+    /* The nodes of released entries, kept for reuse so that
+     * registering a handle doesn't allocate...
+     */
+    std::vector<std::unordered_map<int, Entry>::node_type> spare_entries_;
+    std::vector<int> removed_;
+    std::vector<ReactorEvent> events_;
+
+    /* `posted_` and `wakeup_fd_` are shared with other threads,
+     * and guarded by `post_mutex_`. Posted coroutines are
+     * swapped into `resuming_` before they're resumed, so that
+     * neither vector needs to grow once they've warmed up...
+     */
+    std::mutex post_mutex_;
+    std::vector<std::coroutine_handle<>> posted_;
+    int wakeup_fd_ { -1 };
+    std::vector<std::coroutine_handle<>> resuming_;
+    std::size_t num_resumed_ { 0 };
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_REACTOR_HPP_INCLUDED
@@ -0,0 +1,68 @@
+#ifndef SHADOW_CAST_SERVICES_REACTOR_BACKEND_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_REACTOR_BACKEND_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sc
+{
+
+enum struct ReactorBackendType
+{
+    epoll,
+    io_uring
+};
+
+struct ReactorEvent
+{
+    enum struct Type
+    {
+        readable,
+        timer
+    };
+
+    Type type;
+    void* data;
+    std::int64_t result;
+};
+
+/* The operating system facility a `Reactor` uses to wait for
+ * file handles and its timer. `data` is
+ * an opaque value that is given back in the `ReactorEvent`...
+ */
+struct ReactorBackend
+{
+    virtual ~ReactorBackend() = default;
+
+    /* Reports `fd` as readable, for as long as it remains so,
+     * until it's removed...
+     */
+    virtual auto add(int fd, void* data) -> void = 0;
+    virtual auto remove(int fd) -> void = 0;
+
+    /* Arms the timer to expire at the absolute `CLOCK_MONOTONIC`
+     * time `wake_time`, replacing any previous expiry. If
+     * `wake_time` is empty then the timer is disarmed...
+     */
+    virtual auto arm_timer(std::optional<std::uint64_t> wake_time) -> void = 0;
+
+    /* Blocks until at least one event is available, then replaces
+     * the contents of `events` with every available event. On
+     * return, `events` may be empty if the wait was interrupted...
+     */
+    virtual auto wait(std::vector<ReactorEvent>& events) -> void = 0;
+};
+
+auto make_epoll_backend() -> std::unique_ptr<ReactorBackend>;
+
+/* Throws `std::system_error` if io_uring isn't available, e.g.
+ * if the kernel doesn't support it, or it has been disabled...
+ */
+auto make_io_uring_backend() -> std::unique_ptr<ReactorBackend>;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_REACTOR_BACKEND_HPP_INCLUDED
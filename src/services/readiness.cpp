@@ -1,6 +1,10 @@
 #include "services/readiness.hpp"
+#include "metrics/metrics.hpp"
+#include "services/clock.hpp"
+#include "services/frame_scheduler.hpp"
+#include "services/reactor.hpp"
 #include "services/service.hpp"
-#include <algorithm>
+#include "services/task.hpp"
 
 namespace sc
 {
@@ -11,14 +15,33 @@ FrameTimeRatio::FrameTimeRatio(std::size_t n, std::size_t d) noexcept
 {
 }
 
+auto dispatch(Readiness const& readiness) -> void
+{
+    auto const call = [&] {
+        if (readiness.coroutine)
+            resume(readiness.coroutine);
+        else
+            readiness.dispatch(*readiness.svc);
+    };
+
+    if (!readiness.metrics) {
+        call();
+        return;
+    }
+
+    auto const start = monotonic_now();
+    call();
+    readiness.metrics->add_dispatch(monotonic_now() - start);
+}
+
 ReadinessRegister::ReadinessRegister(Service& svc,
-                                     NotifyRegisterType& reg,
-                                     FrameTickRegisterType& freg,
-                                     std::size_t ftime) noexcept
+                                     Reactor& reactor,
+                                     FrameTime const& ftime,
+                                     metrics::DispatchMetrics* metrics) noexcept
     : current_svc_ { &svc }
-    , notify_reg_ { &reg }
-    , frame_tick_reg_ { &freg }
+    , reactor_ { &reactor }
     , frame_time_ { ftime }
+    , metrics_ { metrics }
 {
 }
 
@@ -29,32 +52,53 @@ auto ReadinessRegister::operator()(RegisterType val, ServiceDispatch dispatch)
         [&](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, int>) {
-                notify_reg_->emplace(arg, Readiness { current_svc_, dispatch });
+                reactor_->add_notification(
+                    arg, Readiness { current_svc_, dispatch, metrics_ });
             }
             else {
-                auto expiry = static_cast<std::size_t>(
-                    static_cast<float>(frame_time_) *
-                    (static_cast<float>(arg.num) / arg.denom));
-
-                auto insert_pos =
-                    std::lower_bound(frame_tick_reg_->begin(),
-                                     frame_tick_reg_->end(),
-                                     expiry,
-                                     [&](auto const& a, auto const& b) {
-                                         return a.frame_time < b;
-                                     });
-
-                frame_tick_reg_->emplace(
-                    insert_pos,
-                    FrameTickReadiness {
-                        { current_svc_, dispatch }, expiry, 0 });
+                /* Keep the period as an exact ratio. Truncating it
+                 * to whole nanoseconds here would make the timer
+                 * drift from the ideal timeline...
+                 */
+                auto const period = FramePeriod {
+                    .num = frame_time_.numerator() * arg.num,
+                    .denom = frame_time_.denominator() * arg.denom
+                };
+
+                reactor_->add_frame_tick(
+                    period, Readiness { current_svc_, dispatch, metrics_ });
             }
         },
         val);
 }
 
+auto ReadinessRegister::remove(int fd) -> void
+{
+    reactor_->remove_notification(fd);
+}
+
+auto ReadinessRegister::spawn(Task task) -> void
+{
+    reactor_->post(task.release());
+}
+
 auto ReadinessRegister::frame_time() const noexcept -> std::size_t
 {
-    return frame_time_;
+    return frame_time_.value();
+}
+
+auto ReadinessRegister::clock() const noexcept -> Clock const&
+{
+    return reactor_->clock();
+}
+
+auto ReadinessRegister::origin() const noexcept -> std::optional<std::uint64_t>
+{
+    return reactor_->origin();
+}
+
+auto ReadinessRegister::current_tick() const noexcept -> FrameTick const&
+{
+    return reactor_->current_tick();
 }
 } // namespace sc
@@ -1,17 +1,27 @@
 #ifndef SHADOW_CAST_READINESS_HPP_INCLUDED
 #define SHADOW_CAST_READINESS_HPP_INCLUDED
 
+#include "utils/frame_time.hpp"
 #include <cinttypes>
+#include <coroutine>
 #include <cstddef>
+#include <optional>
 #include <type_traits>
-#include <unordered_map>
 #include <variant>
-#include <vector>
 
 namespace sc
 {
 
+namespace metrics
+{
+struct DispatchMetrics;
+}
+
+struct Clock;
+struct FrameTick;
 struct Service;
+struct Reactor;
+struct Task;
 
 using ServiceDispatch = auto(*)(Service&) -> void;
 
@@ -19,14 +29,22 @@ struct Readiness
 {
     Service* svc;
     ServiceDispatch dispatch;
-};
 
-struct FrameTickReadiness : Readiness
-{
-    std::size_t frame_time;
-    std::size_t remaining;
+    /* If set, each dispatch is timed and recorded here...
+     */
+    metrics::DispatchMetrics* metrics { nullptr };
+
+    /* If set, this coroutine is resumed instead of calling
+     * `dispatch`. See `Task`...
+     */
+    std::coroutine_handle<> coroutine {};
 };
 
+/* Calls `readiness.dispatch`, or resumes `readiness.coroutine`,
+ * recording its duration if the readiness has metrics...
+ */
+auto dispatch(Readiness const& readiness) -> void;
+
 struct FrameTimeRatio
 {
     explicit FrameTimeRatio(std::size_t n, std::size_t d = 1) noexcept;
@@ -37,25 +55,55 @@ struct FrameTimeRatio
 
 using RegisterType = std::variant<int, FrameTimeRatio>;
 
+/* A service may keep a copy of its `ReadinessRegister` and use it
+ * to add or remove registrations from within its own dispatch
+ * functions, i.e. while the owning context is running. It must
+ * not be used from any other thread.
+ */
 struct ReadinessRegister
 {
-    using NotifyRegisterType = std::unordered_map<int, Readiness>;
-    using FrameTickRegisterType = std::vector<FrameTickReadiness>;
-
     explicit ReadinessRegister(Service&,
-                               NotifyRegisterType&,
-                               FrameTickRegisterType&,
-                               std::size_t) noexcept;
+                               Reactor&,
+                               FrameTime const&,
+                               metrics::DispatchMetrics* = nullptr) noexcept;
 
     auto operator()(RegisterType val, ServiceDispatch dispatch) -> void;
 
+    /* Removes a file handle previously registered by this
+     * service. It is safe to call this before closing the
+     * handle, including from within a dispatch function...
+     */
+    auto remove(int fd) -> void;
+
+    /* Starts `task` on the context, from the context's next
+     * iteration...
+     */
+    auto spawn(Task task) -> void;
+
     auto frame_time() const noexcept -> std::size_t;
 
+    /* The context's clock. Services should take any timestamps
+     * from this, rather than from the system clock, so that they
+     * remain consistent when the context runs on virtual time...
+     */
+    auto clock() const noexcept -> Clock const&;
+
+    /* The clock value that the context's timeline starts from, if
+     * it was given one with `Context::set_origin()`...
+     */
+    auto origin() const noexcept -> std::optional<std::uint64_t>;
+
+    /* The frame tick that's being dispatched, including how many
+     * ticks were missed before it. This is only meaningful from
+     * within a frame timer's dispatch function...
+     */
+    auto current_tick() const noexcept -> FrameTick const&;
+
 private:
     Service* current_svc_;
-    NotifyRegisterType* notify_reg_;
-    FrameTickRegisterType* frame_tick_reg_;
-    std::size_t frame_time_;
+    Reactor* reactor_;
+    FrameTime frame_time_;
+    metrics::DispatchMetrics* metrics_;
 };
 
 } // namespace sc
@@ -0,0 +1,349 @@
+#include "services/replay_buffer.hpp"
+#include "av/format.hpp"
+#include "error.hpp"
+#include "logging.hpp"
+#include "utils/scope_guard.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+AVRational constexpr kNanoseconds { 1, 1'000'000'000 };
+
+auto rebase(std::int64_t ts, std::int64_t offset) noexcept -> std::int64_t
+{
+    return ts == AV_NOPTS_VALUE ? ts : ts - offset;
+}
+
+} // namespace
+
+namespace sc
+{
+
+ReplayPacket::ReplayPacket()
+    : packet { av_packet_alloc() }
+    , stream { nullptr }
+    , time_base { 0, 1 }
+    , time { 0 }
+    , keyframe { false }
+{
+    if (!packet)
+        throw std::bad_alloc {};
+}
+
+auto ReplayPacket::reset() noexcept -> void
+{
+    av_packet_unref(packet.get());
+    stream = nullptr;
+    time_base = AVRational { 0, 1 };
+    time = 0;
+    keyframe = false;
+}
+
+ReplayBuffer::ReplayBuffer(ReplayLimits limits) noexcept
+    : limits_ { limits }
+{
+}
+
+ReplayBuffer::~ReplayBuffer() { clear(); }
+
+auto ReplayBuffer::push(AVPacket& packet,
+                        AVStream& stream,
+                        AVRational time_base) -> void
+{
+    auto const keyframe = is_video_keyframe(packet, stream);
+
+    if (waiting_for_keyframe_) {
+        if (!keyframe)
+            return;
+
+        waiting_for_keyframe_ = false;
+    }
+
+    auto item = pool_.get();
+    av_packet_move_ref(item->packet.get(), &packet);
+    item->stream = &stream;
+    item->time_base = time_base;
+    item->time = decode_time(*item->packet, time_base);
+    item->keyframe = keyframe;
+
+    bytes_ += static_cast<std::size_t>(item->packet->size);
+    keyframes_ += keyframe;
+    count_ += 1;
+    latest_ = count_ == 1 ? item->time : std::max(latest_, item->time);
+    packets_.push_back(item.release());
+
+    /* The oldest GOP is only dropped once the rest of the buffer
+     * covers the whole duration by itself...
+     */
+    if (keyframe) {
+        while (has_expired_gop())
+            evict_gop();
+    }
+
+    while (bytes_ > limits_.max_bytes && keyframes_ > 1)
+        evict_gop();
+
+    if (bytes_ > limits_.max_bytes) {
+        clear();
+        waiting_for_keyframe_ = true;
+    }
+}
+
+auto ReplayBuffer::snapshot() const -> ReplayClip
+{
+    ReplayClip clip;
+    clip.reserve(count_);
+    for (auto const& item : packets_) {
+        PacketPtr packet { av_packet_alloc() };
+        if (!packet)
+            throw std::bad_alloc {};
+
+        if (auto const ret = av_packet_ref(packet.get(), item.packet.get());
+            ret < 0)
+            throw std::runtime_error { "Failed to reference packet: " +
+                                       av_error_to_string(ret) };
+
+        clip.push_back(ClipPacket { .packet = std::move(packet),
+                                    .stream = item.stream,
+                                    .time_base = item.time_base });
+    }
+
+    return clip;
+}
+
+auto ReplayBuffer::duration() const noexcept -> std::uint64_t
+{
+    if (packets_.empty())
+        return 0;
+
+    return static_cast<std::uint64_t>(latest_ - packets_.front().time);
+}
+
+auto ReplayBuffer::size_bytes() const noexcept -> std::size_t
+{
+    return bytes_;
+}
+
+auto ReplayBuffer::size() const noexcept -> std::size_t { return count_; }
+
+auto ReplayBuffer::clear() noexcept -> void
+{
+    while (!packets_.empty())
+        evict_gop();
+}
+
+auto ReplayBuffer::evict_gop() noexcept -> void
+{
+    do {
+        auto& item = packets_.front();
+        packets_.pop_front();
+
+        bytes_ -= static_cast<std::size_t>(item.packet->size);
+        keyframes_ -= item.keyframe;
+        count_ -= 1;
+
+        /* Release the data now, rather than when the item is
+         * reused, so it doesn't count against the limit...
+         */
+        item.reset();
+        pool_.put(&item);
+    } while (!packets_.empty() && !packets_.front().keyframe);
+}
+
+auto ReplayBuffer::has_expired_gop() const noexcept -> bool
+{
+    if (keyframes_ < 2)
+        return false;
+
+    auto it = std::next(packets_.begin());
+    while (!it->keyframe)
+        ++it;
+
+    return static_cast<std::uint64_t>(latest_ - it->time) >=
+           limits_.duration;
+}
+
+auto write_replay_clip(ReplayClip&& clip, std::string const& path) -> void
+{
+    if (clip.empty())
+        return;
+
+    AVFormatContext* fc_tmp;
+    if (auto const ret = avformat_alloc_output_context2(
+            &fc_tmp, nullptr, nullptr, path.c_str());
+        ret < 0)
+        throw FormatError { "Failed to allocate replay output context: " +
+                            av_error_to_string(ret) };
+
+    FormatContextPtr format_context { fc_tmp };
+
+    /* Give the clip a stream for each of the source's streams, in the
+     * same order...
+     */
+    std::vector<AVStream*> sources;
+    for (auto const& item : clip) {
+        if (std::find(sources.begin(), sources.end(), item.stream) ==
+            sources.end())
+            sources.push_back(item.stream);
+    }
+
+    std::sort(sources.begin(), sources.end(), [](auto a, auto b) {
+        return a->index < b->index;
+    });
+
+    std::vector<AVStream*> streams;
+    for (auto const* source : sources) {
+        auto* stream = avformat_new_stream(format_context.get(), nullptr);
+        if (!stream)
+            throw std::bad_alloc {};
+
+        if (auto const ret =
+                avcodec_parameters_copy(stream->codecpar, source->codecpar);
+            ret < 0)
+            throw FormatError { "Failed to copy stream parameters: " +
+                                av_error_to_string(ret) };
+
+        auto const first = std::find_if(clip.begin(), clip.end(), [&](auto& p) {
+            return p.stream == source;
+        });
+        stream->time_base = first->time_base;
+        streams.push_back(stream);
+    }
+
+    if (auto const ret =
+            avio_open(&format_context->pb, path.c_str(), AVIO_FLAG_WRITE);
+        ret < 0)
+        throw IOError { "Failed to open replay file: " +
+                        av_error_to_string(ret) };
+
+    SC_SCOPE_GUARD([&] { avio_closep(&format_context->pb); });
+
+    if (auto const ret = avformat_write_header(format_context.get(), nullptr);
+        ret < 0)
+        throw IOError { "Failed to write replay header: " +
+                        av_error_to_string(ret) };
+
+    /* The clip starts with a keyframe. Anything from the other
+     * streams that's older than it is dropped...
+     */
+    auto const start =
+        decode_time(*clip.front().packet, clip.front().time_base);
+    for (auto& item : clip) {
+        auto* packet = item.packet.get();
+        if (decode_time(*packet, item.time_base) < start)
+            continue;
+
+        auto const offset = av_rescale_q(start, kNanoseconds, item.time_base);
+        packet->pts = rebase(packet->pts, offset);
+        packet->dts = rebase(packet->dts, offset);
+
+        auto const index = static_cast<std::size_t>(
+            std::find(sources.begin(), sources.end(), item.stream) -
+            sources.begin());
+        av_packet_rescale_ts(packet, item.time_base, streams[index]->time_base);
+        packet->stream_index = streams[index]->index;
+
+        if (auto const ret =
+                av_interleaved_write_frame(format_context.get(), packet);
+            ret < 0)
+            throw IOError { "Failed to write replay packet: " +
+                            av_error_to_string(ret) };
+    }
+
+    if (auto const ret = av_write_trailer(format_context.get()); ret < 0)
+        throw IOError { "Failed to write replay trailer: " +
+                        av_error_to_string(ret) };
+}
+
+auto replay_clip_path(std::string_view output_path, std::time_t time)
+    -> std::string
+{
+    std::tm local {};
+    static_cast<void>(::localtime_r(&time, &local));
+
+    char stamp[32];
+    static_cast<void>(
+        std::strftime(stamp, sizeof(stamp), "-%Y%m%d-%H%M%S", &local));
+
+    std::filesystem::path const path { output_path };
+    auto result = path.parent_path() / path.stem();
+    result += stamp;
+    result += path.extension();
+    return result.string();
+}
+
+ReplayWriter::ReplayWriter(std::string output_path)
+    : output_path_ { std::move(output_path) }
+    , thread_ { [&] { run(); } }
+{
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    {
+        std::lock_guard lock { mutex_ };
+        stopping_ = true;
+    }
+    clip_ready_.notify_one();
+    thread_.join();
+}
+
+auto ReplayWriter::write(ReplayClip&& clip) -> void
+{
+    {
+        std::lock_guard lock { mutex_ };
+        pending_.push_back(PendingClip { .clip = std::move(clip),
+                                         .time = std::time(nullptr) });
+    }
+    clip_ready_.notify_one();
+}
+
+auto ReplayWriter::run() noexcept -> void
+{
+    std::unique_lock lock { mutex_ };
+    while (true) {
+        clip_ready_.wait(lock, [&] { return stopping_ || pending_.size(); });
+        if (pending_.empty())
+            break;
+
+        auto pending = std::move(pending_.front());
+        pending_.pop_front();
+        lock.unlock();
+
+        try {
+            auto const path = unique_path(pending.time);
+            write_replay_clip(std::move(pending.clip), path);
+            log::info("Saved replay: "s + path);
+        }
+        catch (std::exception const& e) {
+            log::error("Failed to save replay: "s + e.what());
+        }
+
+        /* Release the clip's packets before waiting for the next...
+         */
+        pending.clip.clear();
+        lock.lock();
+    }
+}
+
+auto ReplayWriter::unique_path(std::time_t time) const -> std::string
+{
+    auto path = replay_clip_path(output_path_, time);
+    std::filesystem::path const base { path };
+    for (auto n = 2; std::filesystem::exists(path); ++n) {
+        auto next = base.parent_path() / base.stem();
+        next += "-" + std::to_string(n);
+        next += base.extension();
+        path = next.string();
+    }
+
+    return path;
+}
+
+} // namespace sc
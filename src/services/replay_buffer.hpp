@@ -0,0 +1,156 @@
+#ifndef SHADOW_CAST_SERVICES_REPLAY_BUFFER_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_REPLAY_BUFFER_HPP_INCLUDED
+
+#include "av/packet.hpp"
+#include "utils/intrusive_list.hpp"
+#include "utils/pool.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace sc
+{
+
+struct ReplayLimits
+{
+    /* Nanoseconds of media to keep...
+     */
+    std::uint64_t duration;
+
+    /* The most bytes of encoded data to keep...
+     */
+    std::size_t max_bytes;
+};
+
+struct ReplayPacket : ListItemBase
+{
+    ReplayPacket();
+
+    PacketPtr packet;
+    AVStream* stream;
+    AVRational time_base;
+
+    /* The packet's decode time, in nanoseconds...
+     */
+    std::int64_t time;
+    bool keyframe;
+
+    auto reset() noexcept -> void;
+};
+
+struct ClipPacket
+{
+    PacketPtr packet;
+    AVStream* stream;
+    AVRational time_base;
+};
+
+using ReplayClip = std::vector<ClipPacket>;
+
+/* Keeps the most recent encoded packets of every stream, up to
+ * `ReplayLimits`. Packets are dropped a whole GOP at a time, so the
+ * buffer always starts with a video keyframe. The byte limit is
+ * never exceeded; if a single GOP doesn't fit then everything is
+ * dropped and the buffer waits for the next keyframe. Not thread
+ * safe...
+ */
+struct ReplayBuffer
+{
+    explicit ReplayBuffer(ReplayLimits limits) noexcept;
+    ~ReplayBuffer();
+
+    ReplayBuffer(ReplayBuffer const&) = delete;
+    auto operator=(ReplayBuffer const&) -> ReplayBuffer& = delete;
+
+    /* Takes over the reference to `packet`'s data, without copying
+     * it. `time_base` is the time base of `packet`'s timestamps...
+     */
+    auto push(AVPacket& packet, AVStream& stream, AVRational time_base)
+        -> void;
+
+    /* Returns a new reference to every packet in the buffer. The
+     * data itself isn't copied...
+     */
+    [[nodiscard]] auto snapshot() const -> ReplayClip;
+
+    /* The time between the first and the latest packets, in
+     * nanoseconds...
+     */
+    [[nodiscard]] auto duration() const noexcept -> std::uint64_t;
+    [[nodiscard]] auto size_bytes() const noexcept -> std::size_t;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+
+    auto clear() noexcept -> void;
+
+private:
+    auto evict_gop() noexcept -> void;
+    auto has_expired_gop() const noexcept -> bool;
+
+    ReplayLimits limits_;
+    Pool<ReplayPacket> pool_;
+    IntrusiveList<ReplayPacket> packets_;
+    std::size_t count_ { 0 };
+    std::size_t bytes_ { 0 };
+    std::size_t keyframes_ { 0 };
+    std::int64_t latest_ { 0 };
+    bool waiting_for_keyframe_ { true };
+};
+
+/* Writes `clip` to a new file at `path`, with the container format
+ * implied by its extension. Timestamps start from the clip's first
+ * keyframe...
+ */
+auto write_replay_clip(ReplayClip&& clip, std::string const& path) -> void;
+
+/* Returns the path of a clip saved at `time`, based on the output
+ * file's path, e.g. "video.mp4" gives "video-20240101-120000.mp4"...
+ */
+[[nodiscard]] auto replay_clip_path(std::string_view output_path,
+                                    std::time_t time) -> std::string;
+
+/* Writes clips, one at a time, on a background thread, so saving a
+ * replay never holds up the muxer. Clips still queued when this is
+ * destroyed are written first...
+ */
+struct ReplayWriter
+{
+    explicit ReplayWriter(std::string output_path);
+    ~ReplayWriter();
+
+    ReplayWriter(ReplayWriter const&) = delete;
+    auto operator=(ReplayWriter const&) -> ReplayWriter& = delete;
+
+    auto write(ReplayClip&& clip) -> void;
+
+private:
+    struct PendingClip
+    {
+        ReplayClip clip;
+        std::time_t time;
+    };
+
+    auto run() noexcept -> void;
+    auto unique_path(std::time_t time) const -> std::string;
+
+    std::string output_path_;
+    std::mutex mutex_;
+    std::condition_variable clip_ready_;
+    std::deque<PendingClip> pending_;
+    bool stopping_ { false };
+    std::thread thread_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_REPLAY_BUFFER_HPP_INCLUDED
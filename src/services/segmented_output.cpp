@@ -0,0 +1,298 @@
+#include "services/segmented_output.hpp"
+#include "av/packet.hpp"
+#include "error.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <new>
+#include <system_error>
+#include <utility>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+std::size_t constexpr kDefaultIndexWidth = 4;
+
+auto format_index(std::size_t index, std::size_t width) -> std::string
+{
+    auto result = std::to_string(index);
+    if (result.size() < width)
+        result.insert(0, width - result.size(), '0');
+
+    return result;
+}
+
+} // namespace
+
+namespace sc
+{
+
+SegmentTracker::SegmentTracker(SegmentLimits limits) noexcept
+    : limits_ { limits }
+{
+}
+
+auto SegmentTracker::next(std::int64_t time,
+                          std::size_t size,
+                          bool keyframe) noexcept -> bool
+{
+    if (!started_) {
+        started_ = true;
+        start_ = latest_ = time;
+    }
+
+    auto const full =
+        (limits_.duration && duration() >= limits_.duration) ||
+        (limits_.max_bytes && bytes_ >= limits_.max_bytes);
+
+    if (keyframe && full) {
+        start_ = latest_ = time;
+        bytes_ = size;
+        return true;
+    }
+
+    latest_ = std::max(latest_, time);
+    bytes_ += size;
+    return false;
+}
+
+auto SegmentTracker::duration() const noexcept -> std::uint64_t
+{
+    return static_cast<std::uint64_t>(latest_ - start_);
+}
+
+auto SegmentTracker::size_bytes() const noexcept -> std::size_t
+{
+    return bytes_;
+}
+
+auto segment_path(std::string_view pattern, std::size_t index) -> std::string
+{
+    std::string result;
+    auto replaced = false;
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') {
+            result += pattern[i];
+            continue;
+        }
+
+        if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+            result += '%';
+            ++i;
+            continue;
+        }
+
+        auto end = i + 1;
+        std::size_t width = 0;
+        while (end < pattern.size() &&
+               std::isdigit(static_cast<unsigned char>(pattern[end])))
+            width = width * 10 + static_cast<std::size_t>(pattern[end++] - '0');
+
+        if (replaced || end == pattern.size() || pattern[end] != 'd') {
+            result += pattern[i];
+            continue;
+        }
+
+        result += format_index(index, width);
+        replaced = true;
+        i = end;
+    }
+
+    if (replaced)
+        return result;
+
+    std::filesystem::path const path { result };
+    auto numbered = path.parent_path() / path.stem();
+    numbered += "-" + format_index(index, kDefaultIndexWidth);
+    numbered += path.extension();
+    return numbered.string();
+}
+
+SegmentedOutput::SegmentedOutput(AVFormatContext& source,
+                                 SegmentLimits limits,
+                                 WriteBehindOptions const& options,
+                                 DictionaryPtr header_options)
+    : source_ { source }
+    , options_ { options }
+    , header_options_ { std::move(header_options) }
+    , tracker_ { limits }
+    , current_ { open_segment(0) }
+    , next_index_ { 1 }
+    , thread_ { [&] { run(); } }
+{
+}
+
+SegmentedOutput::~SegmentedOutput() { close(); }
+
+auto SegmentedOutput::write(AVPacket& packet,
+                            AVStream const& stream,
+                            AVRational time_base) -> void
+{
+    if (tracker_.next(decode_time(packet, time_base),
+                      static_cast<std::size_t>(packet.size),
+                      is_video_keyframe(packet, stream)))
+        rotate();
+
+    auto* output_stream = current_.format_context->streams[stream.index];
+    av_packet_rescale_ts(&packet, time_base, output_stream->time_base);
+    packet.stream_index = output_stream->index;
+
+    if (auto const ret =
+            av_interleaved_write_frame(current_.format_context.get(), &packet);
+        ret < 0)
+        throw IOError { "Failed to write packet to " + current_.path + ": " +
+                        av_error_to_string(ret) };
+}
+
+auto SegmentedOutput::flush_fragment() -> void
+{
+    sc::flush_fragment(*current_.format_context);
+}
+
+auto SegmentedOutput::close() noexcept -> void
+{
+    if (closed_)
+        return;
+
+    closed_ = true;
+    {
+        std::lock_guard lock { mutex_ };
+        closing_.push_back(std::move(current_));
+        stopping_ = true;
+    }
+    work_ready_.notify_one();
+    thread_.join();
+}
+
+auto SegmentedOutput::open_segment(std::size_t index) const -> Segment
+{
+    Segment segment { .path = segment_path(source_.url, index),
+                      .file = nullptr,
+                      .io_context = nullptr,
+                      .format_context = nullptr };
+
+    AVFormatContext* fc_tmp;
+    if (auto const ret = avformat_alloc_output_context2(
+            &fc_tmp, source_.oformat, nullptr, segment.path.c_str());
+        ret < 0)
+        throw FormatError { "Failed to allocate segment output context: " +
+                            av_error_to_string(ret) };
+
+    segment.format_context.reset(fc_tmp);
+
+    for (unsigned int i = 0; i < source_.nb_streams; ++i) {
+        auto const* source_stream = source_.streams[i];
+        auto* stream = avformat_new_stream(fc_tmp, nullptr);
+        if (!stream)
+            throw std::bad_alloc {};
+
+        if (auto const ret = avcodec_parameters_copy(stream->codecpar,
+                                                     source_stream->codecpar);
+            ret < 0)
+            throw FormatError { "Failed to copy stream parameters: " +
+                                av_error_to_string(ret) };
+
+        stream->time_base = source_stream->time_base;
+    }
+
+    segment.file = std::make_unique<WriteBehindFile>(segment.path, options_);
+    segment.io_context = make_io_context(*segment.file);
+    fc_tmp->pb = segment.io_context.get();
+    fc_tmp->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    write_header(*fc_tmp, header_options_.get());
+
+    return segment;
+}
+
+auto SegmentedOutput::close_segment(Segment& segment) -> void
+{
+    if (auto const ret = av_write_trailer(segment.format_context.get());
+        ret < 0)
+        throw IOError { "Failed to write trailer to " + segment.path + ": " +
+                        av_error_to_string(ret) };
+
+    segment.file->close();
+}
+
+auto SegmentedOutput::rotate() -> void
+{
+    std::unique_lock lock { mutex_ };
+
+    /* The next segment is normally opened long before it's needed,
+     * so this only waits if segments are very short...
+     */
+    segment_ready_.wait(lock, [&] { return next_ || error_; });
+    if (!next_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+
+    closing_.push_back(std::exchange(current_, std::move(*next_)));
+    next_.reset();
+    index_ += 1;
+    next_index_ = index_ + 1;
+    lock.unlock();
+    work_ready_.notify_one();
+}
+
+auto SegmentedOutput::run() noexcept -> void
+{
+    std::unique_lock lock { mutex_ };
+    while (true) {
+        work_ready_.wait(lock, [&] {
+            return stopping_ || closing_.size() || next_index_;
+        });
+
+        /* Opening the next segment comes first, since the caller
+         * may soon be waiting for it...
+         */
+        if (next_index_ && !stopping_) {
+            auto const index = *std::exchange(next_index_, std::nullopt);
+            lock.unlock();
+            std::optional<Segment> segment;
+            std::exception_ptr error;
+            try {
+                segment.emplace(open_segment(index));
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            next_ = std::move(segment);
+            error_ = error;
+            segment_ready_.notify_one();
+            continue;
+        }
+
+        if (closing_.empty())
+            break;
+
+        {
+            auto segment = std::move(closing_.front());
+            closing_.pop_front();
+            lock.unlock();
+
+            try {
+                close_segment(segment);
+                log::info("Finished segment: "s + segment.path);
+            }
+            catch (std::exception const& e) {
+                log::error("Failed to finish segment: "s + e.what());
+            }
+        }
+        lock.lock();
+    }
+
+    /* A segment that was opened, but never used, is removed...
+     */
+    if (next_) {
+        auto const path = next_->path;
+        next_.reset();
+        std::error_code ec;
+        static_cast<void>(std::filesystem::remove(path, ec));
+    }
+}
+
+} // namespace sc
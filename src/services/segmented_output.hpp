@@ -0,0 +1,148 @@
+#ifndef SHADOW_CAST_SERVICES_SEGMENTED_OUTPUT_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_SEGMENTED_OUTPUT_HPP_INCLUDED
+
+#include "av/format.hpp"
+#include "io/write_behind_file.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace sc
+{
+
+struct SegmentLimits
+{
+    /* Nanoseconds of media in each segment. Zero means no limit...
+     */
+    std::uint64_t duration;
+
+    /* Bytes of encoded data in each segment. Zero means no limit...
+     */
+    std::size_t max_bytes;
+};
+
+/* Decides where each segment, or fragment, ends. A segment only
+ * ends once it has reached one of its limits, and then only at a
+ * video keyframe, so every segment after the first starts with
+ * one...
+ */
+struct SegmentTracker
+{
+    explicit SegmentTracker(SegmentLimits limits) noexcept;
+
+    /* Records a packet, of `size` bytes, with a decode time of `time`
+     * nanoseconds. Returns true if the packet should start a new
+     * segment...
+     */
+    auto next(std::int64_t time, std::size_t size, bool keyframe) noexcept
+        -> bool;
+
+    [[nodiscard]] auto duration() const noexcept -> std::uint64_t;
+    [[nodiscard]] auto size_bytes() const noexcept -> std::size_t;
+
+private:
+    SegmentLimits limits_;
+    bool started_ { false };
+    std::int64_t start_ { 0 };
+    std::int64_t latest_ { 0 };
+    std::size_t bytes_ { 0 };
+};
+
+/* Returns the path of segment `index`. The first `%d`, or `%0<N>d`,
+ * in `pattern` is replaced with the index, e.g. "capture-%04d.mkv"
+ * gives "capture-0001.mkv". If there isn't one then the index is
+ * appended to the file's stem in the same format...
+ */
+[[nodiscard]] auto segment_path(std::string_view pattern, std::size_t index)
+    -> std::string;
+
+/* Splits the output into a series of files, each with the same
+ * streams as `source`, and named after its url by `segment_path()`.
+ *
+ * Only writing the packets happens on the calling thread. A
+ * background thread opens the next segment ahead of time, and
+ * writes the trailer of, and closes, each finished one, so moving
+ * from one segment to the next doesn't hold up the caller.
+ *
+ * Timestamps carry on from one segment to the next, so the segments
+ * can be joined back together without any gaps...
+ */
+struct SegmentedOutput
+{
+    SegmentedOutput(AVFormatContext& source,
+                    SegmentLimits limits,
+                    WriteBehindOptions const& options,
+                    DictionaryPtr header_options = nullptr);
+    ~SegmentedOutput();
+
+    SegmentedOutput(SegmentedOutput const&) = delete;
+    auto operator=(SegmentedOutput const&) -> SegmentedOutput& = delete;
+
+    /* Writes `packet`, whose timestamps are in `time_base`, to the
+     * current segment's copy of `stream`. `stream` must belong to
+     * `source`...
+     */
+    auto write(AVPacket& packet, AVStream const& stream, AVRational time_base)
+        -> void;
+
+    /* Ends the current segment's current fragment. See
+     * `flush_fragment()`...
+     */
+    auto flush_fragment() -> void;
+
+    /* Finishes the current segment and waits for every segment to
+     * be closed. Errors closing a segment are logged, rather than
+     * thrown, so they don't stop the capture. Calling this again
+     * does nothing...
+     */
+    auto close() noexcept -> void;
+
+private:
+    struct Segment
+    {
+        std::string path;
+        std::unique_ptr<WriteBehindFile> file;
+        IOContextPtr io_context;
+        FormatContextPtr format_context;
+    };
+
+    auto open_segment(std::size_t index) const -> Segment;
+    static auto close_segment(Segment& segment) -> void;
+    auto rotate() -> void;
+    auto run() noexcept -> void;
+
+    AVFormatContext& source_;
+    WriteBehindOptions options_;
+    DictionaryPtr header_options_;
+    SegmentTracker tracker_;
+    Segment current_;
+    std::size_t index_ { 0 };
+    bool closed_ { false };
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable segment_ready_;
+    std::deque<Segment> closing_;
+    std::optional<Segment> next_;
+    std::optional<std::size_t> next_index_;
+    std::exception_ptr error_;
+    bool stopping_ { false };
+
+    std::thread thread_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_SEGMENTED_OUTPUT_HPP_INCLUDED
@@ -0,0 +1,217 @@
+#include "services/task.hpp"
+#include "services/context.hpp"
+#include "services/reactor.hpp"
+#include "utils/contracts.hpp"
+#include <array>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace
+{
+
+thread_local sc::Reactor* current_reactor = nullptr;
+thread_local sc::FrameTime const* current_frame_time = nullptr;
+thread_local std::exception_ptr pending_exception = nullptr;
+
+/* Frames are pooled by size, rounded up to a multiple of
+ * `kGranularity`. Larger frames go straight to the heap. Frames
+ * are often freed on a different thread to the one that
+ * allocated them, e.g. after `resume_on()`, so a single pool is
+ * shared by every thread...
+ */
+struct FramePool
+{
+    static constexpr std::size_t kGranularity = 64;
+    static constexpr std::size_t kNumClasses = 32;
+
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    FramePool() = default;
+    FramePool(FramePool const&) = delete;
+    auto operator=(FramePool const&) -> FramePool& = delete;
+
+    ~FramePool()
+    {
+        for (auto* head : free_) {
+            while (head)
+                ::operator delete(std::exchange(head, head->next));
+        }
+    }
+
+    static auto size_class(std::size_t size) noexcept -> std::size_t
+    {
+        return (size + kGranularity - 1) / kGranularity - 1;
+    }
+
+    auto allocate(std::size_t size) -> void*
+    {
+        auto const index = size_class(size);
+        if (index >= kNumClasses)
+            return ::operator new(size);
+
+        {
+            std::lock_guard lock { mutex_ };
+            if (auto* frame = free_[index]; frame) {
+                free_[index] = frame->next;
+                return frame;
+            }
+        }
+
+        return ::operator new((index + 1) * kGranularity);
+    }
+
+    auto deallocate(void* ptr, std::size_t size) noexcept -> void
+    {
+        auto const index = size_class(size);
+        if (index >= kNumClasses) {
+            ::operator delete(ptr);
+            return;
+        }
+
+        auto* frame = ::new (ptr) FreeFrame {};
+        std::lock_guard lock { mutex_ };
+        frame->next = std::exchange(free_[index], frame);
+    }
+
+private:
+    std::mutex mutex_;
+    std::array<FreeFrame*, kNumClasses> free_ {};
+};
+
+auto frame_pool() -> FramePool&
+{
+    static FramePool pool;
+    return pool;
+}
+
+auto current() -> sc::Reactor&
+{
+    SC_EXPECT(current_reactor != nullptr);
+    return *current_reactor;
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto Task::promise_type::operator new(std::size_t size) -> void*
+{
+    return frame_pool().allocate(size);
+}
+
+auto Task::promise_type::operator delete(void* ptr, std::size_t size) noexcept
+    -> void
+{
+    frame_pool().deallocate(ptr, size);
+}
+
+auto Task::promise_type::get_return_object() noexcept -> Task
+{
+    return Task { std::coroutine_handle<promise_type>::from_promise(*this) };
+}
+
+auto Task::promise_type::unhandled_exception() noexcept -> void
+{
+    pending_exception = std::current_exception();
+}
+
+Task::Task(std::coroutine_handle<promise_type> handle) noexcept
+    : handle_ { handle }
+{
+}
+
+Task::Task(Task&& other) noexcept
+    : handle_ { std::exchange(other.handle_, nullptr) }
+{
+}
+
+auto Task::operator=(Task&& other) noexcept -> Task&
+{
+    if (this != &other) {
+        if (handle_)
+            handle_.destroy();
+
+        handle_ = std::exchange(other.handle_, nullptr);
+    }
+
+    return *this;
+}
+
+Task::~Task()
+{
+    if (handle_)
+        handle_.destroy();
+}
+
+auto Task::release() noexcept -> std::coroutine_handle<>
+{
+    return std::exchange(handle_, nullptr);
+}
+
+auto NextFrameAwaiter::await_suspend(std::coroutine_handle<> coroutine)
+    -> void
+{
+    SC_EXPECT(current_frame_time != nullptr);
+    auto const period =
+        FramePeriod { .num = current_frame_time->numerator() * ratio.num,
+                      .denom = current_frame_time->denominator() *
+                               ratio.denom };
+
+    current().resume_at_next_tick(period, coroutine);
+}
+
+auto ReadableAwaiter::await_suspend(std::coroutine_handle<> coroutine) -> void
+{
+    current().resume_when_readable(fd, coroutine);
+}
+
+auto ResumeOnAwaiter::await_suspend(std::coroutine_handle<> coroutine) -> void
+{
+    ctx->post(coroutine);
+}
+
+auto next_frame(FrameTimeRatio ratio) -> NextFrameAwaiter
+{
+    return NextFrameAwaiter { .ratio = ratio };
+}
+
+auto readable(int fd) noexcept -> ReadableAwaiter
+{
+    return ReadableAwaiter { .fd = fd };
+}
+
+auto resume_on(Context& ctx) noexcept -> ResumeOnAwaiter
+{
+    return ResumeOnAwaiter { .ctx = &ctx };
+}
+
+auto resume(std::coroutine_handle<> coroutine) -> void
+{
+    coroutine.resume();
+    if (pending_exception)
+        std::rethrow_exception(std::exchange(pending_exception, nullptr));
+}
+
+namespace detail
+{
+CurrentReactorGuard::CurrentReactorGuard(Reactor& reactor,
+                                         FrameTime const& ft) noexcept
+    : previous_reactor_ { std::exchange(current_reactor, &reactor) }
+    , previous_frame_time_ { std::exchange(current_frame_time, &ft) }
+{
+}
+
+CurrentReactorGuard::~CurrentReactorGuard()
+{
+    current_reactor = previous_reactor_;
+    current_frame_time = previous_frame_time_;
+}
+} // namespace detail
+
+} // namespace sc
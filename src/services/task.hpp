@@ -0,0 +1,131 @@
+#ifndef SHADOW_CAST_SERVICES_TASK_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_TASK_HPP_INCLUDED
+
+#include "services/readiness.hpp"
+#include "utils/frame_time.hpp"
+#include <coroutine>
+#include <cstddef>
+
+namespace sc
+{
+
+struct Context;
+struct Reactor;
+
+/* A coroutine that runs on a `Context`'s thread. A task doesn't
+ * start until it's spawned with `Context::spawn()` or
+ * `ReadinessRegister::spawn()`. From then on it belongs to the
+ * context, which destroys it if it's still suspended when the
+ * context stops. An exception that escapes a task is rethrown
+ * from `Context::run()`.
+ *
+ * Coroutine frames are allocated from a pool that is shared by
+ * every thread, so once the pool has warmed up, starting a task
+ * doesn't allocate, even if its frame was freed on another
+ * thread...
+ */
+struct Task
+{
+    struct promise_type
+    {
+        static auto operator new(std::size_t size) -> void*;
+        static auto operator delete(void* ptr, std::size_t size) noexcept
+            -> void;
+
+        auto get_return_object() noexcept -> Task;
+        auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+        auto final_suspend() noexcept -> std::suspend_never { return {}; }
+        auto return_void() noexcept -> void {}
+        auto unhandled_exception() noexcept -> void;
+    };
+
+    Task(Task&&) noexcept;
+    auto operator=(Task&&) noexcept -> Task&;
+    ~Task();
+
+    /* Gives up ownership of the coroutine, which is yet to be
+     * started...
+     */
+    [[nodiscard]] auto release() noexcept -> std::coroutine_handle<>;
+
+private:
+    explicit Task(std::coroutine_handle<promise_type>) noexcept;
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+struct NextFrameAwaiter
+{
+    auto await_ready() const noexcept -> bool { return false; }
+    auto await_suspend(std::coroutine_handle<>) -> void;
+    auto await_resume() const noexcept -> void {}
+
+    FrameTimeRatio ratio;
+};
+
+struct ReadableAwaiter
+{
+    auto await_ready() const noexcept -> bool { return false; }
+    auto await_suspend(std::coroutine_handle<>) -> void;
+    auto await_resume() const noexcept -> void {}
+
+    int fd;
+};
+
+struct ResumeOnAwaiter
+{
+    auto await_ready() const noexcept -> bool { return false; }
+    auto await_suspend(std::coroutine_handle<>) -> void;
+    auto await_resume() const noexcept -> void {}
+
+    Context* ctx;
+};
+
+/* Suspends the calling task until the next tick of a frame timer
+ * with the given ratio. The ticks lie on the same timeline as the
+ * context's other frame timers, so a task that overruns a frame
+ * resumes on the following tick, rather than drifting. Must be
+ * awaited on a context's thread...
+ */
+[[nodiscard]] auto next_frame(FrameTimeRatio ratio = FrameTimeRatio(1))
+    -> NextFrameAwaiter;
+
+/* Suspends the calling task until `fd` is readable. `fd` must not
+ * be registered with the context by anything else. Must be awaited
+ * on a context's thread...
+ */
+[[nodiscard]] auto readable(int fd) noexcept -> ReadableAwaiter;
+
+/* Suspends the calling task and resumes it on `ctx`'s thread. This
+ * may be awaited from any thread...
+ */
+[[nodiscard]] auto resume_on(Context& ctx) noexcept -> ResumeOnAwaiter;
+
+/* Resumes `coroutine`, rethrowing any exception that escapes a
+ * task...
+ */
+auto resume(std::coroutine_handle<> coroutine) -> void;
+
+namespace detail
+{
+/* Makes `reactor` the target of the awaitables above, on the
+ * calling thread, for the lifetime of this object...
+ */
+struct CurrentReactorGuard
+{
+    CurrentReactorGuard(Reactor& reactor, FrameTime const& ft) noexcept;
+    ~CurrentReactorGuard();
+
+    CurrentReactorGuard(CurrentReactorGuard const&) = delete;
+    auto operator=(CurrentReactorGuard const&)
+        -> CurrentReactorGuard& = delete;
+
+private:
+    Reactor* previous_reactor_;
+    FrameTime const* previous_frame_time_;
+};
+} // namespace detail
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_TASK_HPP_INCLUDED
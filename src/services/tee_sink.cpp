@@ -0,0 +1,362 @@
+#include "services/tee_sink.hpp"
+#include "error.hpp"
+#include "logging.hpp"
+#include "utils/scope_guard.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+/* For urls, such as "udp://..." or "pipe:1", that don't imply a
+ * format...
+ */
+char const kFallbackFormat[] = "mpegts";
+
+} // namespace
+
+namespace sc
+{
+
+/* Everything the sink's thread uses. It's shared with the thread, so
+ * that it stays valid for as long as the thread runs, even if the
+ * sink gives up waiting for it. Unless noted, members are guarded by
+ * `mutex`...
+ */
+struct TeeSink::State
+{
+    struct Slot
+    {
+        PacketPtr packet;
+        AVRational time_base;
+    };
+
+    State(std::string output_url, TeeSinkOptions const& sink_options);
+
+    static auto interrupt(void* opaque) noexcept -> int;
+
+    auto create(AVFormatContext const& source) -> FormatContextPtr;
+    auto open(AVFormatContext& output) -> void;
+    auto write_all(AVFormatContext& output) -> void;
+    auto disconnect() noexcept -> void;
+
+    std::string const url;
+    TeeSinkOptions const options;
+    std::atomic<bool> aborted { false };
+
+    /* Created by the sink, and then only used by its thread...
+     */
+    FormatContextPtr format_context;
+
+    mutable std::mutex mutex;
+    std::condition_variable packet_ready;
+    std::condition_variable finished;
+    std::vector<Slot> slots;
+    std::size_t head { 0 };
+    std::size_t count { 0 };
+    std::size_t bytes { 0 };
+    bool waiting_for_keyframe { true };
+    std::optional<std::chrono::steady_clock::time_point> full_since;
+    std::optional<std::chrono::steady_clock::time_point> stopped_at;
+    bool finished_running { false };
+    TeeSinkMetrics metrics;
+};
+
+TeeSink::State::State(std::string output_url,
+                      TeeSinkOptions const& sink_options)
+    : url { std::move(output_url) }
+    , options { sink_options }
+{
+    slots.reserve(options.max_packets);
+    for (std::size_t i = 0; i < options.max_packets; ++i) {
+        PacketPtr packet { av_packet_alloc() };
+        if (!packet)
+            throw std::bad_alloc {};
+
+        slots.push_back(
+            Slot { .packet = std::move(packet), .time_base = { 0, 1 } });
+    }
+}
+
+auto TeeSink::State::interrupt(void* opaque) noexcept -> int
+{
+    return static_cast<State*>(opaque)->aborted.load(
+        std::memory_order_relaxed);
+}
+
+auto TeeSink::State::create(AVFormatContext const& source)
+    -> FormatContextPtr
+{
+    auto const* format_name =
+        av_guess_format(nullptr, url.c_str(), nullptr) ? nullptr
+                                                       : kFallbackFormat;
+
+    AVFormatContext* fc_tmp;
+    if (auto const ret = avformat_alloc_output_context2(
+            &fc_tmp, nullptr, format_name, url.c_str());
+        ret < 0)
+        throw FormatError { "Failed to allocate output context: " +
+                            av_error_to_string(ret) };
+
+    FormatContextPtr result { fc_tmp };
+    result->interrupt_callback =
+        AVIOInterruptCB { .callback = &interrupt, .opaque = this };
+
+    for (unsigned int i = 0; i < source.nb_streams; ++i) {
+        auto const* source_stream = source.streams[i];
+        auto* stream = avformat_new_stream(fc_tmp, nullptr);
+        if (!stream)
+            throw std::bad_alloc {};
+
+        if (auto const ret = avcodec_parameters_copy(stream->codecpar,
+                                                     source_stream->codecpar);
+            ret < 0)
+            throw FormatError { "Failed to copy stream parameters: " +
+                                av_error_to_string(ret) };
+
+        stream->time_base = source_stream->time_base;
+    }
+
+    return result;
+}
+
+auto TeeSink::State::open(AVFormatContext& output) -> void
+{
+    if (output.oformat->flags & AVFMT_NOFILE)
+        return;
+
+    if (auto const ret = avio_open2(&output.pb,
+                                    url.c_str(),
+                                    AVIO_FLAG_WRITE,
+                                    &output.interrupt_callback,
+                                    nullptr);
+        ret < 0)
+        throw IOError { "Failed to open output: " + av_error_to_string(ret) };
+}
+
+auto TeeSink::State::write_all(AVFormatContext& output) -> void
+{
+    PacketPtr packet { av_packet_alloc() };
+    if (!packet)
+        throw std::bad_alloc {};
+
+    std::unique_lock lock { mutex };
+    while (true) {
+        packet_ready.wait(lock, [&] {
+            return stopped_at || count || metrics.disconnected;
+        });
+
+        if (metrics.disconnected || !count)
+            return;
+
+        auto& slot = slots[head];
+        av_packet_move_ref(packet.get(), slot.packet.get());
+        auto const time_base = slot.time_base;
+        head = (head + 1) % slots.size();
+        count -= 1;
+        bytes -= static_cast<std::size_t>(packet->size);
+        lock.unlock();
+
+        auto const* stream = output.streams[packet->stream_index];
+        av_packet_rescale_ts(packet.get(), time_base, stream->time_base);
+        if (auto const ret = av_interleaved_write_frame(&output, packet.get());
+            ret < 0)
+            throw IOError { "Failed to write packet: " +
+                            av_error_to_string(ret) };
+
+        lock.lock();
+        metrics.written += 1;
+    }
+}
+
+auto TeeSink::State::disconnect() noexcept -> void
+{
+    metrics.disconnected = true;
+    aborted.store(true, std::memory_order_relaxed);
+
+    metrics.dropped += count;
+    for (; count; --count) {
+        av_packet_unref(slots[head].packet.get());
+        head = (head + 1) % slots.size();
+    }
+    bytes = 0;
+    packet_ready.notify_one();
+}
+
+TeeSink::TeeSink(std::string url,
+                 AVFormatContext const& source,
+                 TeeSinkOptions const& options)
+    : state_ { std::make_shared<State>(std::move(url), options) }
+{
+    /* The streams are copied here, rather than on the thread, so
+     * that the thread never references `source`...
+     */
+    try {
+        state_->format_context = state_->create(source);
+    }
+    catch (std::exception const& e) {
+        log::error("Disconnecting output " + state_->url + ": " + e.what());
+        std::lock_guard lock { state_->mutex };
+        state_->disconnect();
+    }
+
+    thread_ = std::thread { &TeeSink::run, state_ };
+}
+
+TeeSink::~TeeSink() { close(); }
+
+auto TeeSink::push(AVPacket const& packet,
+                   AVStream const& stream,
+                   AVRational time_base) -> void
+{
+    auto& state = *state_;
+    auto const keyframe = is_video_keyframe(packet, stream);
+    auto const size = static_cast<std::size_t>(packet.size);
+
+    {
+        std::lock_guard lock { state.mutex };
+        if (state.metrics.disconnected) {
+            state.metrics.dropped += 1;
+            return;
+        }
+
+        auto const full =
+            state.count == state.slots.size() ||
+            (state.count && state.bytes + size > state.options.max_bytes);
+        if (!full)
+            state.full_since.reset();
+
+        if (full || (state.waiting_for_keyframe && !keyframe)) {
+            auto const now = std::chrono::steady_clock::now();
+            if (full && !state.full_since)
+                state.full_since = now;
+
+            state.metrics.dropped += 1;
+            state.waiting_for_keyframe = true;
+            if (!state.full_since ||
+                now - *state.full_since < state.options.stall_timeout)
+                return;
+
+            log::warn("Disconnecting output that fell too far behind: "s +
+                      state.url);
+            state.disconnect();
+            return;
+        }
+
+        auto& slot =
+            state.slots[(state.head + state.count) % state.slots.size()];
+        if (av_packet_ref(slot.packet.get(), &packet) < 0) {
+            state.metrics.dropped += 1;
+            state.waiting_for_keyframe = true;
+            return;
+        }
+
+        slot.packet->stream_index = stream.index;
+        slot.time_base = time_base;
+        state.count += 1;
+        state.bytes += size;
+        state.waiting_for_keyframe = false;
+    }
+
+    state.packet_ready.notify_one();
+}
+
+auto TeeSink::stop() noexcept -> void
+{
+    {
+        std::lock_guard lock { state_->mutex };
+        if (state_->stopped_at)
+            return;
+
+        state_->stopped_at = std::chrono::steady_clock::now();
+    }
+
+    state_->packet_ready.notify_one();
+}
+
+auto TeeSink::close() noexcept -> void
+{
+    if (!thread_.joinable())
+        return;
+
+    stop();
+
+    /* A thread that doesn't finish in time may be stuck in a call
+     * that the interrupt callback can't break, e.g. opening, or
+     * writing to, a pipe with no reader. Joining it could hang the
+     * muxer, and with it the main output, so it's left to end by
+     * itself, and the state it shares is freed once it does...
+     */
+    auto& state = *state_;
+    std::unique_lock lock { state.mutex };
+    if (state.finished.wait_until(
+            lock, *state.stopped_at + state.options.close_timeout, [&] {
+                return state.finished_running;
+            })) {
+        lock.unlock();
+        thread_.join();
+        lock.lock();
+    }
+    else {
+        log::warn("Gave up waiting to finish output: "s + state.url);
+        state.disconnect();
+        thread_.detach();
+    }
+
+    if (state.metrics.dropped)
+        log::warn("Output " + state.url + " dropped " +
+                  std::to_string(state.metrics.dropped) + " packets");
+}
+
+auto TeeSink::url() const noexcept -> std::string const&
+{
+    return state_->url;
+}
+
+auto TeeSink::metrics() const -> TeeSinkMetrics
+{
+    std::lock_guard lock { state_->mutex };
+    return state_->metrics;
+}
+
+auto TeeSink::run(std::shared_ptr<State> state) noexcept -> void
+{
+    try {
+        if (auto format_context = std::move(state->format_context);
+            format_context) {
+            state->open(*format_context);
+            SC_SCOPE_GUARD([&] { avio_closep(&format_context->pb); });
+
+            write_header(*format_context, nullptr);
+            state->write_all(*format_context);
+
+            if (!state->aborted.load(std::memory_order_relaxed)) {
+                if (auto const ret = av_write_trailer(format_context.get());
+                    ret < 0)
+                    throw IOError { "Failed to write trailer: " +
+                                    av_error_to_string(ret) };
+            }
+        }
+    }
+    catch (std::exception const& e) {
+        std::lock_guard lock { state->mutex };
+        if (!state->metrics.disconnected) {
+            log::error("Disconnecting output " + state->url + ": " +
+                       e.what());
+            state->disconnect();
+        }
+    }
+
+    std::lock_guard lock { state->mutex };
+    state->finished_running = true;
+    state->finished.notify_all();
+}
+
+} // namespace sc
@@ -0,0 +1,110 @@
+#ifndef SHADOW_CAST_SERVICES_TEE_SINK_HPP_INCLUDED
+#define SHADOW_CAST_SERVICES_TEE_SINK_HPP_INCLUDED
+
+#include "av/format.hpp"
+#include "av/packet.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace sc
+{
+
+struct TeeSinkOptions
+{
+    /* The most packets, and bytes of encoded data, that may be
+     * waiting to be written before packets are dropped...
+     */
+    std::size_t max_packets { 1'024 };
+    std::size_t max_bytes { 32 * 1'024 * 1'024 };
+
+    /* If packets are still being dropped, because the queue is full,
+     * after this long then the sink is disconnected...
+     */
+    std::chrono::nanoseconds stall_timeout { std::chrono::seconds { 5 } };
+
+    /* How long, once it's asked to stop, the sink has to write what's
+     * queued and finish its output, before it's given up on...
+     */
+    std::chrono::nanoseconds close_timeout { std::chrono::seconds { 5 } };
+};
+
+struct TeeSinkMetrics
+{
+    std::uint64_t written { 0 };
+    std::uint64_t dropped { 0 };
+    bool disconnected { false };
+};
+
+/* An extra output that receives a copy of every encoded packet. The
+ * format is guessed from `url`, falling back to MPEG-TS for urls
+ * that don't imply one, such as "udp://..." or "pipe:1".
+ *
+ * The sink opens, and writes to, its output on its own thread, from
+ * a bounded queue. `push()` never blocks; if the queue is full then
+ * packets are dropped until there's space again and the next video
+ * keyframe arrives, so the output can still be decoded. A sink that
+ * stays full for longer than `stall_timeout`, or fails to write, is
+ * disconnected, without affecting the encoders or any other
+ * output.
+ *
+ * The thread shares the sink's state, rather than referencing the
+ * sink, so that a thread stuck somewhere it can't be interrupted,
+ * e.g. writing to a pipe nobody reads, can be left behind...
+ */
+struct TeeSink
+{
+    /* `source`'s streams are copied, so it needn't outlive the
+     * sink...
+     */
+    TeeSink(std::string url,
+            AVFormatContext const& source,
+            TeeSinkOptions const& options = {});
+    ~TeeSink();
+
+    TeeSink(TeeSink const&) = delete;
+    auto operator=(TeeSink const&) -> TeeSink& = delete;
+
+    /* Queues a new reference to `packet`, whose timestamps are in
+     * `time_base`, for `source`'s `stream`. The data isn't copied...
+     */
+    auto push(AVPacket const& packet,
+              AVStream const& stream,
+              AVRational time_base) -> void;
+
+    /* Asks the sink to write out everything that's queued, then
+     * finish its output, without waiting for it to. This starts the
+     * `close_timeout`, so that several sinks can be stopped at
+     * once...
+     */
+    auto stop() noexcept -> void;
+
+    /* Stops the sink, and waits for it to finish its output. If it
+     * hasn't by the end of its `close_timeout`, it's disconnected,
+     * and its thread is left to end by itself, so this always
+     * returns. Calling this again does nothing...
+     */
+    auto close() noexcept -> void;
+
+    [[nodiscard]] auto url() const noexcept -> std::string const&;
+    [[nodiscard]] auto metrics() const -> TeeSinkMetrics;
+
+private:
+    struct State;
+
+    static auto run(std::shared_ptr<State> state) noexcept -> void;
+
+    std::shared_ptr<State> state_;
+    std::thread thread_;
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_SERVICES_TEE_SINK_HPP_INCLUDED
@@ -2,10 +2,6 @@
 #include "nvidia/NvFBC.h"
 #include "utils/contracts.hpp"
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-#include "metrics/metrics.hpp"
-#endif
-
 namespace sc
 {
 
@@ -21,7 +17,7 @@ VideoService::VideoService(
 
 auto VideoService::on_init(ReadinessRegister reg) -> void
 {
-    frame_time_ = reg.frame_time();
+    register_.emplace(reg);
     reg(FrameTimeRatio(1), &dispatch_frame);
 }
 
@@ -29,10 +25,6 @@ auto dispatch_frame(Service& svc) -> void
 {
     auto& self = static_cast<VideoService&>(svc);
 
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    auto const frame_start = global_elapsed.nanosecond_value();
-#endif
-
     CUdeviceptr cu_device_ptr {};
 
     NVFBC_FRAME_GRAB_INFO frame_info {};
@@ -49,12 +41,8 @@ auto dispatch_frame(Service& svc) -> void
         throw NvFBCError { self.nvfbc_, self.nvfbc_session_ };
 
     if (self.receiver_)
-        (*self.receiver_)(cu_device_ptr, frame_info, self.frame_time_);
-
-#ifdef SHADOW_CAST_ENABLE_HISTOGRAMS
-    metrics::add_frame_time(metrics::video_metrics,
-                            global_elapsed.nanosecond_value() - frame_start);
-#endif
+        (*self.receiver_)(
+            cu_device_ptr, frame_info, self.register_->current_tick());
 }
 
 } // namespace sc
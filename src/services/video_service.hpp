@@ -4,6 +4,8 @@
 #include "config.hpp"
 
 #include "nvidia.hpp"
+#include "services/frame_scheduler.hpp"
+#include "services/readiness.hpp"
 #include "services/service.hpp"
 #include "utils/borrowed_ptr.hpp"
 #include "utils/receiver.hpp"
@@ -16,7 +18,7 @@ struct VideoService final : Service
     friend auto dispatch_frame(Service&) -> void;
 
     using CaptureFrameReceiverType =
-        Receiver<void(CUdeviceptr, NVFBC_FRAME_GRAB_INFO, std::uint64_t)>;
+        Receiver<void(CUdeviceptr, NVFBC_FRAME_GRAB_INFO, FrameTick const&)>;
 
     VideoService(NvFBC,
                  BorrowedPtr<std::remove_pointer_t<CUcontext>>,
@@ -37,7 +39,7 @@ private:
     NVFBC_SESSION_HANDLE nvfbc_session_;
 
     std::optional<CaptureFrameReceiverType> receiver_;
-    std::uint64_t frame_time_ { 0 };
+    std::optional<ReadinessRegister> register_;
 };
 
 auto dispatch_frame(Service&) -> void;
@@ -1,18 +1,25 @@
 #ifndef SHADOW_CAST_UTILS_HPP_INCLUDED
 #define SHADOW_CAST_UTILS_HPP_INCLUDED
 
+#include "./utils/audio_source.hpp"
 #include "./utils/base64.hpp"
 #include "./utils/borrowed_ptr.hpp"
+#include "./utils/bounded_queue.hpp"
 #include "./utils/cmd_line.hpp"
 #include "./utils/contracts.hpp"
 #include "./utils/elapsed.hpp"
 #include "./utils/frame_time.hpp"
+#include "./utils/frame_timeline.hpp"
 #include "./utils/intrusive_list.hpp"
+#include "./utils/mpsc_queue.hpp"
 #include "./utils/non_pointer.hpp"
 #include "./utils/pool.hpp"
 #include "./utils/receiver.hpp"
+#include "./utils/rendition.hpp"
 #include "./utils/result.hpp"
+#include "./utils/sample_clock.hpp"
 #include "./utils/scope_guard.hpp"
 #include "./utils/symbol.hpp"
+#include "./utils/thread_policy.hpp"
 
 #endif // SHADOW_CAST_UTILS_HPP_INCLUDED
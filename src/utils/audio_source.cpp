@@ -0,0 +1,79 @@
+#include "utils/audio_source.hpp"
+#include <charconv>
+
+namespace
+{
+
+unsigned constexpr kMaxGainPercent = 400;
+
+auto parse_type(std::string_view val) noexcept
+    -> std::optional<sc::AudioSourceType>
+{
+    if (val == "desktop")
+        return sc::AudioSourceType::desktop;
+
+    if (val == "mic")
+        return sc::AudioSourceType::microphone;
+
+    return std::nullopt;
+}
+
+/* Parses a gain, as a whole percentage...
+ */
+auto parse_gain(std::string_view val) noexcept -> std::optional<float>
+{
+    unsigned percent {};
+    auto const* last = val.data() + val.size();
+    auto const r = std::from_chars(val.data(), last, percent);
+    if (r.ec != std::errc {} || r.ptr != last || percent > kMaxGainPercent)
+        return std::nullopt;
+
+    return static_cast<float>(percent) / 100.0f;
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto parse_audio_source(std::string_view val) -> std::optional<AudioSource>
+{
+    AudioSource result { .type = {}, .node = {}, .gain = 1.0f };
+
+    /* Node names may contain '@' themselves, so the gain is taken from
+     * the end...
+     */
+    if (auto const at = val.rfind('@'); at != std::string_view::npos) {
+        auto const gain = parse_gain(val.substr(at + 1));
+        if (!gain)
+            return std::nullopt;
+
+        result.gain = *gain;
+        val = val.substr(0, at);
+    }
+
+    if (auto const eq = val.find('='); eq != std::string_view::npos) {
+        if (eq + 1 == val.size())
+            return std::nullopt;
+
+        result.node = std::string { val.substr(eq + 1) };
+        val = val.substr(0, eq);
+    }
+
+    auto const type = parse_type(val);
+    if (!type)
+        return std::nullopt;
+
+    result.type = *type;
+    return result;
+}
+
+auto audio_source_name(AudioSource const& source) -> std::string
+{
+    if (source.node.size())
+        return source.node;
+
+    return source.type == AudioSourceType::desktop ? "Desktop" : "Microphone";
+}
+
+} // namespace sc
@@ -0,0 +1,51 @@
+#ifndef SHADOW_CAST_UTILS_AUDIO_SOURCE_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_AUDIO_SOURCE_HPP_INCLUDED
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace sc
+{
+
+enum struct AudioSourceType
+{
+    /* What's being played, from a sink's monitor...
+     */
+    desktop,
+
+    /* What's being recorded, e.g. from a microphone...
+     */
+    microphone,
+};
+
+/* Something to capture audio from. Each source has a PipeWire stream
+ * of its own...
+ */
+struct AudioSource
+{
+    AudioSourceType type;
+
+    /* The name of the sink, or source, node to capture. Empty means
+     * the default one...
+     */
+    std::string node;
+
+    /* Applied when the sources are mixed into a single stream...
+     */
+    float gain;
+};
+
+/* Parses a source in the format "<TYPE>[=<NODE>][@<PERCENT>]", where
+ * <TYPE> is "desktop" or "mic", e.g. "mic=alsa_input.usb-mic@150"...
+ */
+[[nodiscard]] auto parse_audio_source(std::string_view)
+    -> std::optional<AudioSource>;
+
+/* A name for the source, for its stream's title...
+ */
+[[nodiscard]] auto audio_source_name(AudioSource const&) -> std::string;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_AUDIO_SOURCE_HPP_INCLUDED
@@ -0,0 +1,21 @@
+#include "utils/bounded_queue.hpp"
+
+namespace sc
+{
+
+auto parse_overflow_policy(std::string_view val) noexcept
+    -> std::optional<OverflowPolicy>
+{
+    if (val == "block")
+        return OverflowPolicy::block;
+
+    if (val == "drop-oldest")
+        return OverflowPolicy::drop_oldest;
+
+    if (val == "drop-newest")
+        return OverflowPolicy::drop_newest;
+
+    return std::nullopt;
+}
+
+} // namespace sc
@@ -0,0 +1,270 @@
+#ifndef SHADOW_CAST_UTILS_BOUNDED_QUEUE_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_BOUNDED_QUEUE_HPP_INCLUDED
+
+#include "utils/intrusive_list.hpp"
+#include "utils/mpsc_queue.hpp"
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+namespace sc
+{
+
+/* What a `BoundedQueue` does with a new item once it's full...
+ */
+enum struct OverflowPolicy
+{
+    block,
+    drop_oldest,
+    drop_newest,
+};
+
+struct QueueOptions
+{
+    /* The most items that may be queued. Zero means no limit...
+     */
+    std::size_t capacity { 0 };
+    OverflowPolicy policy { OverflowPolicy::block };
+};
+
+struct QueueMetrics
+{
+    std::size_t depth { 0 };
+    std::size_t high_water { 0 };
+    std::uint64_t dropped { 0 };
+};
+
+/* An `MpscQueue` that holds at most `capacity` items. While there's
+ * space, `push()` is as cheap, and as lock-free, as it is for an
+ * `MpscQueue`, and so is `pop_all()`. Once the queue is full, items
+ * that `IsDroppable` allows are dropped according to the queue's
+ * `OverflowPolicy`, and anything else waits for the consumer to make
+ * space. The consumer only takes the lock when a producer is waiting,
+ * or one has taken items to search for the oldest it can drop.
+ *
+ * A dropped item is handed back to the caller, rather than destroyed,
+ * so that it can be returned to the pool it came from...
+ */
+template <ListItem T, typename IsDroppable>
+struct BoundedQueue
+{
+    struct PushResult
+    {
+        /* True if the queue was empty, so the consumer needs waking.
+         * See `MpscQueue::push()`...
+         */
+        bool notify;
+
+        /* The item that was dropped to keep within the capacity, if
+         * any. This may be the item that was pushed...
+         */
+        T* dropped;
+    };
+
+    explicit BoundedQueue(QueueOptions options,
+                          IsDroppable is_droppable = IsDroppable {}) noexcept
+        : options_ { options }
+        , is_droppable_ { is_droppable }
+    {
+    }
+
+    BoundedQueue(BoundedQueue const&) = delete;
+    auto operator=(BoundedQueue const&) -> BoundedQueue& = delete;
+
+    ~BoundedQueue() { assert(backlog_.empty()); }
+
+    /* Adds `item` to the queue, making space for it if it's full.
+     * This may be called from any thread...
+     */
+    auto push(T* item) -> PushResult
+    {
+        if (try_reserve())
+            return { pending_.push(item), nullptr };
+
+        std::unique_lock lock { mutex_ };
+        if (try_reserve())
+            return { pending_.push(item), nullptr };
+
+        if (options_.policy != OverflowPolicy::block && is_droppable_(*item)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            if (options_.policy == OverflowPolicy::drop_newest)
+                return { false, item };
+
+            /* The oldest item is swapped for the new one, so the
+             * depth stays the same...
+             */
+            if (auto* oldest = remove_oldest_droppable(); oldest)
+                return { pending_.push(item), oldest };
+
+            return { false, item };
+        }
+
+        waiting_.fetch_add(1, std::memory_order_seq_cst);
+        space_.wait(lock, [&] { return closed_ || try_reserve(); });
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        if (closed_)
+            reserve();
+
+        return { pending_.push(item), nullptr };
+    }
+
+    /* Adds `item` to the queue whether or not it's full, e.g. a
+     * final item that must not wait. This may be called from any
+     * thread...
+     */
+    auto push_unbounded(T* item) noexcept -> bool
+    {
+        reserve();
+        return pending_.push(item);
+    }
+
+    /* Moves every queued item to the back of `list`, in the order
+     * they were pushed. This must only be called by the consumer...
+     */
+    auto pop_all(IntrusiveList<T>& list) noexcept -> void
+    {
+        IntrusiveList<T> items;
+        take_all(items);
+
+        std::size_t count = 0;
+        for ([[maybe_unused]] auto const& item : items)
+            ++count;
+
+        if (!count)
+            return;
+
+        list.splice(list.end(), items);
+
+        /* A producer counts itself as waiting before it checks the
+         * depth, and this checks for waiting producers after reducing
+         * it, so one of the two always sees the other...
+         */
+        depth_.fetch_sub(count, std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst)) {
+            {
+                std::lock_guard lock { mutex_ };
+            }
+            space_.notify_all();
+        }
+    }
+
+    /* Stops any producer from waiting for space, now or later.
+     * Items are still queued, beyond the capacity if need be, and
+     * can still be popped...
+     */
+    auto close() noexcept -> void
+    {
+        std::lock_guard lock { mutex_ };
+        closed_ = true;
+        space_.notify_all();
+    }
+
+    [[nodiscard]] auto metrics() const noexcept -> QueueMetrics
+    {
+        return { .depth = depth_.load(std::memory_order_relaxed),
+                 .high_water = high_water_.load(std::memory_order_relaxed),
+                 .dropped = dropped_.load(std::memory_order_relaxed) };
+    }
+
+private:
+    auto try_reserve() noexcept -> bool
+    {
+        auto depth = depth_.load(std::memory_order_seq_cst);
+        do {
+            if (options_.capacity && depth >= options_.capacity)
+                return false;
+        } while (!depth_.compare_exchange_weak(
+            depth, depth + 1, std::memory_order_relaxed));
+
+        record_depth(depth + 1);
+        return true;
+    }
+
+    auto reserve() noexcept -> void
+    {
+        record_depth(depth_.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    auto record_depth(std::size_t depth) noexcept -> void
+    {
+        auto high_water = high_water_.load(std::memory_order_relaxed);
+        while (depth > high_water &&
+               !high_water_.compare_exchange_weak(
+                   high_water, depth, std::memory_order_relaxed))
+            ;
+    }
+
+    /* Takes every item that's been pushed, and not yet popped, for
+     * the consumer. Items that a producer moved to `backlog_` are
+     * older than those still in `pending_`, so while there are any,
+     * both are taken under the lock...
+     */
+    auto take_all(IntrusiveList<T>& items) noexcept -> void
+    {
+        consuming_.store(true, std::memory_order_seq_cst);
+        if (!stealing_.load(std::memory_order_seq_cst)) {
+            pending_.pop_all(items);
+            consuming_.store(false, std::memory_order_release);
+            return;
+        }
+
+        consuming_.store(false, std::memory_order_release);
+        std::lock_guard lock { mutex_ };
+        items.splice(items.end(), backlog_);
+        pending_.pop_all(items);
+        stealing_.store(false, std::memory_order_relaxed);
+    }
+
+    /* Called with `mutex_` held. Once `stealing_` is set, the
+     * consumer won't take from `pending_` without the lock, so after
+     * waiting for any `take_all()` already in progress, the items in
+     * `pending_` can be moved to `backlog_` without reordering them...
+     */
+    auto remove_oldest_droppable() noexcept -> T*
+    {
+        stealing_.store(true, std::memory_order_seq_cst);
+        while (consuming_.load(std::memory_order_seq_cst))
+            std::this_thread::yield();
+
+        pending_.pop_all(backlog_);
+        for (auto it = backlog_.begin(); it != backlog_.end(); ++it) {
+            if (!is_droppable_(*it))
+                continue;
+
+            auto* item = &*it;
+            static_cast<void>(backlog_.erase(it));
+            return item;
+        }
+
+        return nullptr;
+    }
+
+    QueueOptions options_;
+    IsDroppable is_droppable_;
+    MpscQueue<T> pending_;
+    std::atomic<std::size_t> depth_ { 0 };
+    std::atomic<std::size_t> high_water_ { 0 };
+    std::atomic<std::uint64_t> dropped_ { 0 };
+
+    std::atomic<std::size_t> waiting_ { 0 };
+    std::atomic<bool> consuming_ { false };
+    std::atomic<bool> stealing_ { false };
+
+    std::mutex mutex_;
+    std::condition_variable space_;
+    IntrusiveList<T> backlog_;
+    bool closed_ { false };
+};
+
+[[nodiscard]] auto parse_overflow_policy(std::string_view) noexcept
+    -> std::optional<OverflowPolicy>;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_BOUNDED_QUEUE_HPP_INCLUDED
@@ -17,6 +17,13 @@ namespace
 {
 
 constexpr char const kStrictFrameTimeEnvVar[] = "SHADOW_CAST_STRICT_FPS";
+constexpr char const kTimerSlackEnvVar[] = "SHADOW_CAST_TIMER_SLACK_NS";
+constexpr char const kIoUringEnvVar[] = "SHADOW_CAST_IO_URING";
+constexpr std::uint64_t kNsPerUs = 1'000;
+constexpr std::uint64_t kNsPerMs = 1'000'000;
+constexpr std::size_t kPrefaultStackSize = 256 * 1'024;
+constexpr std::size_t kBytesPerMiB = 1'024 * 1'024;
+constexpr std::uint64_t kNsPerSecond = 1'000'000'000;
 
 template <typename Container, typename... T>
 constexpr auto construct(T... vals) noexcept -> Container
@@ -36,6 +43,67 @@ sc::CmdLineOptionSpec const cmd_line_spec[] = {
       .validation = sc::no_validation,
       .description = "The audio encoder to use. Default 'libopus'" },
 
+    /* Audio sources...
+     */
+    {
+        .short_name = 'a',
+        .long_name = "--audio-source",
+        .option = sc::CmdLineOption::audio_source,
+        .flags = sc::cmdline::VALUE_REQUIRED,
+        .validation = sc::no_validation,
+        .description =
+            "Capture audio from this source, as '<TYPE>[=<NODE>][@<GAIN>]'. "
+            "<TYPE> is 'desktop', for what's playing, or 'mic', for what's "
+            "being recorded, <NODE> names a PipeWire sink, or source, other "
+            "than the default, and <GAIN> is a percentage, between 0 - 400, "
+            "applied when mixing with -x. E.g. 'mic@150'. May be given more "
+            "than once. Each source is encoded as a track of its own unless "
+            "-x is given. Default 'desktop'",
+    },
+
+    /* Thread affinity...
+     */
+    { .short_name = 'c',
+      .long_name = "--cpu-affinity",
+      .option = sc::CmdLineOption::cpu_affinity,
+      .flags = sc::cmdline::VALUE_REQUIRED,
+      .validation = sc::no_validation,
+      .description =
+          "Pin threads to CPUs, as a colon-separated list of "
+          "<THREAD>=<CPUS> pairs. <THREAD> is one of 'video', 'audio' or "
+          "'encoder', and <CPUS> is a list such as '2,4-5'. E.g. "
+          "'video=2:audio=3:encoder=4-7'. Default is no affinity" },
+
+    /* Direct I/O...
+     */
+    {
+        .short_name = 'd',
+        .long_name = "--direct-io",
+        .option = sc::CmdLineOption::direct_io,
+        .flags = 0,
+        .validation = sc::no_validation,
+        .description = "Write the output file with O_DIRECT, bypassing the "
+                       "page cache. Falls back to normal writes if the file "
+                       "system doesn't support it",
+    },
+
+    /* Fragmented output...
+     */
+    {
+        .short_name = 'F',
+        .long_name = "--fragment",
+        .option = sc::CmdLineOption::fragment,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 100, 60'000 },
+        .description =
+            "Write the output as a series of fragments of this many "
+            "milliseconds, starting at the next keyframe, so memory use "
+            "stays flat, finishing is almost instant, and the file stays "
+            "playable if the capture is cut short. Only MP4, MOV and "
+            "Matroska outputs are supported. Must be between 100 - 60000. "
+            "Default is disabled",
+    },
+
     /* Frame rate...
      */
     { .short_name = 'f',
@@ -58,6 +126,109 @@ sc::CmdLineOptionSpec const cmd_line_spec[] = {
         .description = "Show usage",
     },
 
+    /* Lock memory...
+     */
+    {
+        .short_name = 'm',
+        .long_name = "--lock-memory",
+        .option = sc::CmdLineOption::lock_memory,
+        .flags = 0,
+        .validation = sc::no_validation,
+        .description = "Lock all memory into RAM, and prefault each thread's "
+                       "stack, so that no thread is delayed by a page fault",
+    },
+
+    /* Audio mixdown...
+     */
+    {
+        .short_name = 'x',
+        .long_name = "--mix-audio",
+        .option = sc::CmdLineOption::mix_audio,
+        .flags = 0,
+        .validation = sc::no_validation,
+        .description = "Mix every audio source (-a) into a single track, "
+                       "rather than encoding each one separately",
+    },
+
+    /* Frame overrun policy...
+     */
+    {
+        .short_name = 'o',
+        .long_name = "--overrun",
+        .option = sc::CmdLineOption::overrun_policy,
+        .flags = sc::cmdline::VALUE_REQUIRED,
+        .validation =
+            construct<sc::AcceptableValues>("drop", "duplicate", "vfr"),
+        .description =
+            "What to do when video frames are missed. 'drop' skips them, "
+            "'duplicate' repeats the previous frame, for up to one second, "
+            "and 'vfr' skips them but keeps accurate timestamps. Default "
+            "'drop'",
+    },
+
+    /* Realtime priority...
+     */
+    {
+        .short_name = 'r',
+        .long_name = "--realtime",
+        .option = sc::CmdLineOption::realtime_priority,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 1, 99 },
+        .description =
+            "Run the video and audio threads with SCHED_FIFO at this "
+            "priority. Must be between 1 - 99. If permission is denied "
+            "then the threads fall back to a raised SCHED_OTHER priority. "
+            "Default is no realtime scheduling",
+    },
+
+    /* Encoding ladder...
+     */
+    {
+        .short_name = 'L',
+        .long_name = "--rendition",
+        .option = sc::CmdLineOption::rendition,
+        .flags = sc::cmdline::VALUE_REQUIRED,
+        .validation = sc::no_validation,
+        .description =
+            "Also encode the video scaled to this size, and optionally at "
+            "this bit rate in kbit/s, as an extra stream in each output, "
+            "e.g. '1280x720@2500'. Without a bit rate it's encoded at the "
+            "same quality as the full size stream. May be given more than "
+            "once. The video is only captured once, and each size has its "
+            "own encoder thread. Only supported when capturing a Wayland "
+            "session",
+    },
+
+    /* Replay mode...
+     */
+    {
+        .short_name = 'R',
+        .long_name = "--replay",
+        .option = sc::CmdLineOption::replay,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 5, 3'600 },
+        .description =
+            "Keep only the last <VALUE> seconds of video and audio in "
+            "memory, rather than writing everything to the output file. "
+            "Sending SIGUSR1 saves them to a new file, named after the "
+            "output file with the date and time appended. Must be between "
+            "5 - 3600. Default is disabled",
+    },
+
+    /* Replay memory limit...
+     */
+    {
+        .short_name = 'M',
+        .long_name = "--replay-memory",
+        .option = sc::CmdLineOption::replay_memory,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 16, 16'384 },
+        .description =
+            "The most memory, in MiB, that replay mode may use for encoded "
+            "media. If it's reached then less than the requested number of "
+            "seconds is kept. Must be between 16 - 16384. Default 1024",
+    },
+
     /* Sample rate...
      */
     {
@@ -70,6 +241,115 @@ sc::CmdLineOptionSpec const cmd_line_spec[] = {
             "Audio sample rate. Must be between 8000 - 48000. Default 48000",
     },
 
+    /* Segment size...
+     */
+    {
+        .short_name = 'Z',
+        .long_name = "--segment-size",
+        .option = sc::CmdLineOption::segment_size,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 16, 1'048'576 },
+        .description =
+            "Start a new output file, at the next keyframe, once the "
+            "current one holds this many MiB. The output file name may "
+            "contain a '%d', or e.g. '%04d', for the segment number; if it "
+            "doesn't then one is appended. Must be between 16 - 1048576. "
+            "Default is no limit",
+    },
+
+    /* Segment duration...
+     */
+    {
+        .short_name = 'S',
+        .long_name = "--segment-time",
+        .option = sc::CmdLineOption::segment_time,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 1, 86'400 },
+        .description =
+            "Start a new output file, at the next keyframe, once the "
+            "current one holds this many seconds. Named in the same way as "
+            "for -Z. Must be between 1 - 86400. Default is no limit",
+    },
+
+    /* Shutdown deadline...
+     */
+    {
+        .short_name = 'D',
+        .long_name = "--shutdown-timeout",
+        .option = sc::CmdLineOption::shutdown_timeout,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 1, 600 },
+        .description =
+            "Seconds that the encoders, and then the muxer, each have to "
+            "finish once the capture stops. Anything still queued after "
+            "that is discarded, so the output is finished sooner, but "
+            "loses its last few frames. Anything still running after a "
+            "second timeout ends the process, and the output is left "
+            "unfinished. Must be between 1 - 600. Default 10",
+    },
+
+    /* Encoder queue size...
+     */
+    {
+        .short_name = 'Q',
+        .long_name = "--queue-size",
+        .option = sc::CmdLineOption::queue_size,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 1, 600 },
+        .description =
+            "The most frames that each encoder may have waiting to be "
+            "encoded. If an encoder falls this far behind then -P decides "
+            "what happens to the next video frame. Must be between 1 - 600. "
+            "Default 32",
+    },
+
+    /* Encoder queue policy...
+     */
+    {
+        .short_name = 'P',
+        .long_name = "--queue-policy",
+        .option = sc::CmdLineOption::queue_policy,
+        .flags = sc::cmdline::VALUE_REQUIRED,
+        .validation = construct<sc::AcceptableValues>(
+            "block", "drop-oldest", "drop-newest"),
+        .description =
+            "What to do with a video frame when its encoder's queue is "
+            "full. 'block' waits for space, which misses capture ticks as "
+            "for -o, 'drop-oldest' discards the oldest frame still queued, "
+            "and 'drop-newest' discards the new frame. Audio is never "
+            "dropped. Default 'block'",
+    },
+
+    /* Frame pacing spin threshold...
+     */
+    {
+        .short_name = 'p',
+        .long_name = "--spin-threshold",
+        .option = sc::CmdLineOption::spin_threshold,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 0, 2'000 },
+        .description =
+            "Busy-wait for this many microseconds before each video frame "
+            "for more precise frame pacing, at the cost of CPU time. Must "
+            "be between 0 - 2000. Default 0",
+    },
+
+    /* Tee output...
+     */
+    {
+        .short_name = 'T',
+        .long_name = "--tee",
+        .option = sc::CmdLineOption::tee,
+        .flags = sc::cmdline::VALUE_REQUIRED,
+        .validation = sc::no_validation,
+        .description =
+            "Also send the encoded video and audio to this url, e.g. "
+            "'udp://127.0.0.1:5000' or 'pipe:1', which is MPEG-TS unless "
+            "its extension says otherwise. May be given more than once. An "
+            "output that can't keep up drops packets, and is disconnected "
+            "if it stays behind, without affecting the others",
+    },
+
     /* Show version..
      */
     {
@@ -88,10 +368,27 @@ sc::CmdLineOptionSpec const cmd_line_spec[] = {
         .long_name = "--video-encoder",
         .option = sc::CmdLineOption::video_encoder,
         .flags = sc::cmdline::VALUE_REQUIRED,
-        .validation =
-            construct<sc::AcceptableValues>("h264_nvenc", "hevc_nvenc"),
-        .description = "Video encoder to use. Valid values are 'h264_nvenc', "
-                       "'hevc_nvenc'. Default 'hevc_nvenc'",
+        .validation = construct<sc::AcceptableValues>(
+            "h264_nvenc", "hevc_nvenc", "libx264", "libx265", "ffv1"),
+        .description =
+            "Video encoder to use. Valid values are 'h264_nvenc', "
+            "'hevc_nvenc', and the software encoders 'libx264', 'libx265' "
+            "and 'ffv1', which only capture a Wayland session. Default "
+            "'hevc_nvenc'",
+    },
+
+    /* Output write buffer...
+     */
+    {
+        .short_name = 'b',
+        .long_name = "--write-buffer",
+        .option = sc::CmdLineOption::write_buffer,
+        .flags = sc::cmdline::VALUE_REQUIRED | sc::cmdline::VALUE_NUMERIC,
+        .validation = sc::ValidRange { 8, 1'024 },
+        .description =
+            "Size of the output file's write buffer, in MiB. If the disk "
+            "falls this far behind then encoding is held up until it "
+            "catches up. Must be between 8 - 1024. Default 64",
     },
 };
 
@@ -267,6 +564,18 @@ auto CmdLine::has_option(CmdLineOption opt) const noexcept -> bool
                         [&](auto const& item) { return item.option == opt; });
 }
 
+auto CmdLine::get_option_values(CmdLineOption opt) const
+    -> std::vector<std::string_view>
+{
+    std::vector<std::string_view> values;
+    for (auto const& item : options_) {
+        if (item.option == opt)
+            values.push_back(item.value);
+    }
+
+    return values;
+}
+
 auto CmdLine::get_option_value_dispatch(CmdLineOption opt, StringValue) const
     -> std::string_view
 {
@@ -339,6 +648,19 @@ auto read_env(Parameters& params) -> void
         strict_frame_time) {
         params.strict_frame_time = std::strcmp(strict_frame_time, "1") == 0;
     }
+
+    if (auto const* timer_slack = std::getenv(kTimerSlackEnvVar);
+        timer_slack) {
+        std::uint64_t val { 0 };
+        auto const* last = timer_slack + std::strlen(timer_slack);
+        if (auto const r = std::from_chars(timer_slack, last, val);
+            r.ec == std::errc {} && r.ptr == last)
+            params.timer_slack = val;
+    }
+
+    if (auto const* io_uring = std::getenv(kIoUringEnvVar); io_uring) {
+        params.use_io_uring = std::strcmp(io_uring, "1") == 0;
+    }
 }
 
 auto get_parameters(CmdLine const& cmdline) noexcept
@@ -359,13 +681,157 @@ auto get_parameters(CmdLine const& cmdline) noexcept
             sc::CmdLineOption::frame_rate, 60, sc::number_value)),
         .sample_rate = cmdline.get_option_value_or_default(
             sc::CmdLineOption::sample_rate, 48'000, sc::number_value),
-        .output_file = cmdline.args().size() ? cmdline.args()[0] : ""
+        .output_file = cmdline.args().size() ? cmdline.args()[0] : "",
+        .spin_threshold =
+            static_cast<std::uint64_t>(cmdline.get_option_value_or_default(
+                sc::CmdLineOption::spin_threshold, 0, sc::number_value)) *
+            kNsPerUs
     };
 
     if (!params.output_file.size())
         return CmdLineError { CmdLineError::error,
                               "Missing parameter: output file" };
 
+    if (cmdline.has_option(CmdLineOption::cpu_affinity) &&
+        !parse_thread_affinity(
+            cmdline.get_option_value(CmdLineOption::cpu_affinity),
+            params.topology))
+        return CmdLineError { CmdLineError::error,
+                              "Invalid CPU affinity: "s +
+                                  std::string { cmdline.get_option_value(
+                                      CmdLineOption::cpu_affinity) } };
+
+    if (cmdline.has_option(CmdLineOption::realtime_priority)) {
+        auto const priority = cmdline.get_option_value(
+            CmdLineOption::realtime_priority, number_value);
+        for (auto* policy :
+             { &params.topology.video, &params.topology.audio }) {
+            policy->scheduling = SchedulingPolicy::fifo;
+            policy->priority = priority;
+        }
+    }
+
+    if (cmdline.has_option(CmdLineOption::lock_memory)) {
+        params.topology.lock_memory = true;
+        for (auto* policy : { &params.topology.video,
+                              &params.topology.audio,
+                              &params.topology.encoder })
+            policy->prefault_stack = kPrefaultStackSize;
+    }
+
+    if (cmdline.has_option(CmdLineOption::overrun_policy)) {
+        auto const val =
+            cmdline.get_option_value(CmdLineOption::overrun_policy);
+        auto const policy = parse_overrun_policy(val);
+        if (!policy)
+            return CmdLineError { CmdLineError::error,
+                                  "Invalid overrun policy: "s +
+                                      std::string { val } };
+
+        params.overrun_policy = *policy;
+    }
+
+    params.write_buffer_size =
+        static_cast<std::size_t>(cmdline.get_option_value_or_default(
+            sc::CmdLineOption::write_buffer, 64, sc::number_value)) *
+        kBytesPerMiB;
+    params.direct_io = cmdline.has_option(CmdLineOption::direct_io);
+
+    params.shutdown_timeout =
+        static_cast<std::uint64_t>(cmdline.get_option_value_or_default(
+            sc::CmdLineOption::shutdown_timeout, 10, sc::number_value)) *
+        kNsPerSecond;
+
+    params.encoder_queue.capacity =
+        static_cast<std::size_t>(cmdline.get_option_value_or_default(
+            sc::CmdLineOption::queue_size, 32, sc::number_value));
+
+    if (cmdline.has_option(CmdLineOption::queue_policy)) {
+        auto const val = cmdline.get_option_value(CmdLineOption::queue_policy);
+        auto const policy = parse_overflow_policy(val);
+        if (!policy)
+            return CmdLineError { CmdLineError::error,
+                                  "Invalid queue policy: "s +
+                                      std::string { val } };
+
+        params.encoder_queue.policy = *policy;
+    }
+
+    if (cmdline.has_option(CmdLineOption::replay)) {
+        params.replay_duration =
+            static_cast<std::uint64_t>(cmdline.get_option_value(
+                CmdLineOption::replay, number_value)) *
+            kNsPerSecond;
+        params.replay_max_bytes =
+            static_cast<std::size_t>(cmdline.get_option_value_or_default(
+                sc::CmdLineOption::replay_memory, 1'024, sc::number_value)) *
+            kBytesPerMiB;
+    }
+
+    if (cmdline.has_option(CmdLineOption::segment_time))
+        params.segment_duration =
+            static_cast<std::uint64_t>(cmdline.get_option_value(
+                CmdLineOption::segment_time, number_value)) *
+            kNsPerSecond;
+
+    if (cmdline.has_option(CmdLineOption::segment_size))
+        params.segment_max_bytes =
+            static_cast<std::size_t>(cmdline.get_option_value(
+                CmdLineOption::segment_size, number_value)) *
+            kBytesPerMiB;
+
+    if (params.replay_duration &&
+        (params.segment_duration || params.segment_max_bytes))
+        return CmdLineError { CmdLineError::error,
+                              "Segmented output can't be used in replay mode" };
+
+    if (cmdline.has_option(CmdLineOption::fragment))
+        params.fragment_duration =
+            static_cast<std::uint64_t>(cmdline.get_option_value(
+                CmdLineOption::fragment, number_value)) *
+            kNsPerMs;
+
+    if (params.replay_duration && params.fragment_duration)
+        return CmdLineError {
+            CmdLineError::error,
+            "Fragmented output can't be used in replay mode"
+        };
+
+    for (auto const url : cmdline.get_option_values(CmdLineOption::tee))
+        params.tee_outputs.emplace_back(url);
+
+    for (auto const val :
+         cmdline.get_option_values(CmdLineOption::audio_source)) {
+        auto source = parse_audio_source(val);
+        if (!source)
+            return CmdLineError { CmdLineError::error,
+                                  "Invalid audio source: "s +
+                                      std::string { val } };
+
+        params.audio_sources.push_back(std::move(*source));
+    }
+
+    if (!params.audio_sources.size())
+        params.audio_sources.push_back(AudioSource {
+            .type = AudioSourceType::desktop, .node = {}, .gain = 1.0f });
+
+    params.mix_audio = cmdline.has_option(CmdLineOption::mix_audio);
+
+    for (auto const val : cmdline.get_option_values(CmdLineOption::rendition)) {
+        auto const rendition = parse_rendition(val);
+        if (!rendition)
+            return CmdLineError { CmdLineError::error,
+                                  "Invalid rendition: "s +
+                                      std::string { val } };
+
+        params.renditions.push_back(*rendition);
+    }
+
+    /* Fill a gap of up to a second with duplicates...
+     */
+    params.max_duplicates = cmdline.get_option_value_or_default(
+        sc::CmdLineOption::frame_rate, 60, sc::number_value);
+
     read_env(params);
     return params;
 }
@@ -2,8 +2,13 @@
 #define SHADOW_CAST_UTILS_CMD_LINE_HPP_INCLUDED
 
 #include "error.hpp"
+#include "utils/audio_source.hpp"
+#include "utils/bounded_queue.hpp"
 #include "utils/frame_time.hpp"
+#include "utils/frame_timeline.hpp"
+#include "utils/rendition.hpp"
 #include "utils/result.hpp"
+#include "utils/thread_policy.hpp"
 #include <algorithm>
 #include <array>
 #include <cinttypes>
@@ -33,11 +38,30 @@ enum ValueFlags : std::uint32_t
 enum class CmdLineOption
 {
     audio_encoder,
+    audio_source,
+    cpu_affinity,
+    direct_io,
+    fragment,
     frame_rate,
     help,
+    lock_memory,
+    mix_audio,
+    overrun_policy,
+    queue_policy,
+    queue_size,
+    realtime_priority,
+    rendition,
+    replay,
+    replay_memory,
     video_encoder,
     version,
     sample_rate,
+    segment_size,
+    segment_time,
+    shutdown_timeout,
+    spin_threshold,
+    tee,
+    write_buffer,
 };
 
 struct Parameters
@@ -48,6 +72,80 @@ struct Parameters
     std::int32_t sample_rate;
     std::string output_file;
     bool strict_frame_time { true };
+
+    /* Frame pacing, in nanoseconds. See `FramePacing`...
+     */
+    std::uint64_t spin_threshold { 0 };
+    std::uint64_t timer_slack { 0 };
+
+    /* Use io_uring, rather than epoll, for each context's event
+     * loop...
+     */
+    bool use_io_uring { false };
+
+    /* The affinity and scheduling of each thread...
+     */
+    ThreadTopology topology {};
+
+    /* How the video timestamps respond to missed frames, and the
+     * most frames that may be duplicated to fill a single gap...
+     */
+    OverrunPolicy overrun_policy { OverrunPolicy::drop };
+    std::uint64_t max_duplicates { 0 };
+
+    /* How the output file is written. See `WriteBehindOptions`...
+     */
+    std::size_t write_buffer_size { 0 };
+    bool direct_io { false };
+
+    /* In replay mode, only the last `replay_duration` nanoseconds,
+     * or `replay_max_bytes` bytes, of encoded media are kept, and
+     * nothing is written until a replay is saved. Zero disables
+     * replay mode...
+     */
+    std::uint64_t replay_duration { 0 };
+    std::size_t replay_max_bytes { 0 };
+
+    /* Split the output into files of at most `segment_duration`
+     * nanoseconds, or `segment_max_bytes` bytes, each. Zero means no
+     * limit. See `SegmentLimits`...
+     */
+    std::uint64_t segment_duration { 0 };
+    std::size_t segment_max_bytes { 0 };
+
+    /* Write the output as a series of fragments of at least this many
+     * nanoseconds each, rather than indexing the whole file when it's
+     * finished. Zero disables fragmented output...
+     */
+    std::uint64_t fragment_duration { 0 };
+
+    /* Extra outputs that receive a copy of the encoded streams. See
+     * `TeeSink`...
+     */
+    std::vector<std::string> tee_outputs {};
+
+    /* What audio is captured, and whether each source is encoded as a
+     * track of its own, or they're all mixed into a single one...
+     */
+    std::vector<AudioSource> audio_sources {};
+    bool mix_audio { false };
+
+    /* Extra encodes of the captured video, at other sizes and bit
+     * rates, that are written alongside the full resolution one...
+     */
+    std::vector<Rendition> renditions {};
+
+    /* Nanoseconds that the encoders, and then the muxer, have to
+     * finish once the capture stops, before whatever they still have
+     * queued is discarded...
+     */
+    std::uint64_t shutdown_timeout { 0 };
+
+    /* The most frames that each encoder may have queued, and what
+     * happens to a video frame once the queue is full. See
+     * `BoundedQueue`...
+     */
+    QueueOptions encoder_queue {};
 };
 
 struct NoValidation
@@ -120,6 +218,11 @@ public:
 
     auto get_option_value(CmdLineOption opt) const noexcept -> std::string_view;
 
+    /* The values of every occurrence of `opt`, in order...
+     */
+    auto get_option_values(CmdLineOption opt) const
+        -> std::vector<std::string_view>;
+
     template <OptionDataType T = StringValue>
     decltype(auto) get_option_value(CmdLineOption opt,
                                     T dt = string_value) const
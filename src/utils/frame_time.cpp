@@ -1,11 +1,11 @@
 #include "utils/frame_time.hpp"
 #include <libavutil/rational.h>
+#include <numeric>
 
 namespace
 {
 std::uint64_t constexpr kNsPerSec = 1'000'000'000;
 std::uint64_t constexpr kNsPerMs = 1'000'000;
-auto constexpr kRound = kNsPerMs / 2;
 
 } // namespace
 namespace sc
@@ -16,19 +16,37 @@ FrameTime::FrameTime(std::uint64_t frame_time_nanoseconds) noexcept
 {
 }
 
+FrameTime::FrameTime(std::uint64_t num, std::uint64_t denom) noexcept
+    : frame_time_nanoseconds_ { num / std::gcd(num, denom) }
+    , denominator_ { denom / std::gcd(num, denom) }
+{
+}
+
 auto FrameTime::value() const noexcept -> std::uint64_t
 {
-    return frame_time_nanoseconds_;
+    return frame_time_nanoseconds_ / denominator_;
 }
 
 auto FrameTime::value_in_milliseconds() const noexcept -> std::uint64_t
 {
-    return (frame_time_nanoseconds_ + kRound) / kNsPerMs;
+    return (frame_time_nanoseconds_ + (kNsPerMs * denominator_) / 2) /
+           (kNsPerMs * denominator_);
+}
+
+auto FrameTime::numerator() const noexcept -> std::uint64_t
+{
+    return frame_time_nanoseconds_;
+}
+
+auto FrameTime::denominator() const noexcept -> std::uint64_t
+{
+    return denominator_;
 }
 
 auto FrameTime::fps() const noexcept -> float
 {
-    return static_cast<float>(kNsPerSec) / frame_time_nanoseconds_;
+    return static_cast<float>(kNsPerSec * denominator_) /
+           frame_time_nanoseconds_;
 }
 
 auto FrameTime::fps_ratio() const noexcept -> AVRational
@@ -43,7 +61,7 @@ auto truncate_to_millisecond(FrameTime const& ft) noexcept -> FrameTime
 }
 auto from_fps(std::uint32_t fps) noexcept -> FrameTime
 {
-    return FrameTime { kNsPerSec / fps };
+    return FrameTime { kNsPerSec, fps };
 }
 
 } // namespace sc
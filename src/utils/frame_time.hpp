@@ -6,16 +6,27 @@
 
 namespace sc
 {
+/* A frame time, in nanoseconds. This is held as the exact
+ * ratio `numerator() / denominator()` so that frame times
+ * which aren't a whole number of nanoseconds, such as
+ * 16.666...ms at 60fps, don't accumulate error when used
+ * to build a timeline. `value()` gives the truncated
+ * integer value...
+ */
 struct FrameTime
 {
     explicit FrameTime(std::uint64_t) noexcept;
+    FrameTime(std::uint64_t /*num*/, std::uint64_t /*denom*/) noexcept;
     auto value() const noexcept -> std::uint64_t;
     auto value_in_milliseconds() const noexcept -> std::uint64_t;
+    auto numerator() const noexcept -> std::uint64_t;
+    auto denominator() const noexcept -> std::uint64_t;
     auto fps() const noexcept -> float;
     auto fps_ratio() const noexcept -> AVRational;
 
 private:
     std::uint64_t frame_time_nanoseconds_;
+    std::uint64_t denominator_ { 1 };
 };
 
 auto truncate_to_millisecond(FrameTime const&) noexcept -> FrameTime;
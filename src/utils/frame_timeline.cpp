@@ -0,0 +1,69 @@
+#include "utils/frame_timeline.hpp"
+#include <algorithm>
+
+namespace sc
+{
+
+FrameTimeline::FrameTimeline(OverrunPolicy policy,
+                             std::uint64_t max_duplicates) noexcept
+    : policy_ { policy }
+    , max_duplicates_ { max_duplicates }
+{
+}
+
+auto FrameTimeline::step(std::uint64_t index, std::uint64_t missed) noexcept
+    -> TimelineStep
+{
+    TimelineStep result {};
+    if (policy_ == OverrunPolicy::drop) {
+        result.pts = next_pts_;
+    }
+    else {
+        /* The timer never dispatches the same tick twice, but keep
+         * the timestamps strictly increasing regardless...
+         */
+        result.pts = std::max(index, next_pts_);
+
+        /* There's nothing to duplicate until the first frame has
+         * been written...
+         */
+        if (policy_ == OverrunPolicy::duplicate && has_previous_) {
+            auto const gap = std::min(missed, result.pts - next_pts_);
+            result.first_duplicate = result.pts - gap;
+            result.duplicates = std::min(gap, max_duplicates_);
+        }
+    }
+
+    counts_.dropped += missed - result.duplicates;
+    counts_.duplicated += result.duplicates;
+    next_pts_ = result.pts + 1;
+    has_previous_ = true;
+    return result;
+}
+
+auto FrameTimeline::policy() const noexcept -> OverrunPolicy
+{
+    return policy_;
+}
+
+auto FrameTimeline::counts() const noexcept -> OverrunCounts const&
+{
+    return counts_;
+}
+
+auto parse_overrun_policy(std::string_view val) noexcept
+    -> std::optional<OverrunPolicy>
+{
+    if (val == "drop")
+        return OverrunPolicy::drop;
+
+    if (val == "duplicate")
+        return OverrunPolicy::duplicate;
+
+    if (val == "vfr")
+        return OverrunPolicy::variable;
+
+    return std::nullopt;
+}
+
+} // namespace sc
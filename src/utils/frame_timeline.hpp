@@ -0,0 +1,81 @@
+#ifndef SHADOW_CAST_UTILS_FRAME_TIMELINE_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_FRAME_TIMELINE_HPP_INCLUDED
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace sc
+{
+
+/* How a video stream's timestamps respond when frame ticks are
+ * missed, e.g. because capture or encoding overran a frame...
+ *
+ * - `drop`: Missed ticks are skipped, and each frame is given the
+ *   timestamp following the previous frame. This keeps a constant
+ *   frame rate, but the stream runs ahead of wall time, and of the
+ *   audio, by one frame for each missed tick.
+ * - `duplicate`: The previous frame is written again for each missed
+ *   tick, up to a budget, and each frame is stamped with its own
+ *   tick. Ticks beyond the budget are skipped.
+ * - `variable`: Missed ticks are skipped, and each frame is stamped
+ *   with its own tick, producing a variable frame rate stream.
+ */
+enum struct OverrunPolicy
+{
+    drop,
+    duplicate,
+    variable
+};
+
+struct OverrunCounts
+{
+    std::uint64_t dropped { 0 };
+    std::uint64_t duplicated { 0 };
+};
+
+/* What to write for a single frame tick. `duplicates` copies of the
+ * previous frame are written first, with consecutive timestamps
+ * starting at `first_duplicate`, followed by the new frame at
+ * `pts`...
+ */
+struct TimelineStep
+{
+    std::uint64_t first_duplicate { 0 };
+    std::uint64_t duplicates { 0 };
+    std::uint64_t pts { 0 };
+};
+
+/* Maps the frame ticks of a video stream to presentation
+ * timestamps, in units of the frame time, according to an
+ * `OverrunPolicy`, and counts the frames that are dropped or
+ * duplicated along the way...
+ */
+struct FrameTimeline
+{
+    explicit FrameTimeline(OverrunPolicy policy = OverrunPolicy::drop,
+                           std::uint64_t max_duplicates = 0) noexcept;
+
+    /* Advances the timeline to tick `index`, which followed `missed`
+     * ticks that weren't dispatched...
+     */
+    [[nodiscard]] auto step(std::uint64_t index, std::uint64_t missed) noexcept
+        -> TimelineStep;
+
+    [[nodiscard]] auto policy() const noexcept -> OverrunPolicy;
+    [[nodiscard]] auto counts() const noexcept -> OverrunCounts const&;
+
+private:
+    OverrunPolicy policy_;
+    std::uint64_t max_duplicates_;
+    std::uint64_t next_pts_ { 0 };
+    bool has_previous_ { false };
+    OverrunCounts counts_ {};
+};
+
+[[nodiscard]] auto parse_overrun_policy(std::string_view) noexcept
+    -> std::optional<OverrunPolicy>;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_FRAME_TIMELINE_HPP_INCLUDED
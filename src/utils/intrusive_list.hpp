@@ -70,7 +70,7 @@ struct IntrusiveList
 
         Element* current;
 
-        Iterator(ListItemBase* item) noexcept
+        Iterator(Element* item) noexcept
             : current { item }
         {
         }
@@ -248,19 +248,32 @@ struct IntrusiveList
         return before;
     }
 
-    auto
-    splice(iterator before, IntrusiveList& other, iterator first, iterator last)
-        -> void
+    /* Moves the items in `[first, last)` from `other` to before
+     * `before`. The items are relinked as a single chain, so this
+     * takes constant time, however many items are moved...
+     */
+    auto splice(iterator before,
+                [[maybe_unused]] IntrusiveList& other,
+                iterator first,
+                iterator last) noexcept -> void
     {
-        auto it = first;
-        while (it != last) {
-            auto* val = &*it;
-            it = other.erase(it);
-            before = insert(val, before);
-        }
+        if (first == last)
+            return;
+
+        auto* first_item = first.current;
+        auto* last_item = last.current->prev;
+        auto* before_item = before.current;
+
+        first_item->prev->next = last.current;
+        last.current->prev = first_item->prev;
+
+        before_item->prev->next = first_item;
+        first_item->prev = before_item->prev;
+        last_item->next = before_item;
+        before_item->prev = last_item;
     }
 
-    auto splice(iterator before, IntrusiveList& other) -> void
+    auto splice(iterator before, IntrusiveList& other) noexcept -> void
     {
         splice(before, other, other.begin(), other.end());
     }
@@ -0,0 +1,91 @@
+#ifndef SHADOW_CAST_UTILS_MPSC_QUEUE_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_MPSC_QUEUE_HPP_INCLUDED
+
+#include "utils/intrusive_list.hpp"
+#include <atomic>
+#include <cassert>
+
+namespace sc
+{
+
+/* An intrusive, lock-free queue with any number of producers and a
+ * single consumer. Items are linked through their `ListItemBase`, so
+ * pushing never allocates, and an item must not be in any other list
+ * while it's queued.
+ *
+ * `push()` reports when the queue goes from empty to non-empty, so
+ * a producer only needs to wake the consumer for the first item of
+ * each batch. The consumer takes the whole batch at once with
+ * `pop_all()`. For example...
+ *
+ *     // Producer
+ *     if (queue.push(item))
+ *         notify(event_fd);
+ *
+ *     // Consumer, once `event_fd` is readable
+ *     drain(event_fd);
+ *     queue.pop_all(items);
+ *
+ * The consumer must drain its notification *before* calling
+ * `pop_all()`, otherwise a wakeup for a later batch may be lost...
+ */
+template <ListItem T>
+struct MpscQueue
+{
+    MpscQueue() noexcept = default;
+
+    MpscQueue(MpscQueue const&) = delete;
+    auto operator=(MpscQueue const&) -> MpscQueue& = delete;
+
+    ~MpscQueue() { assert(empty()); }
+
+    /* Adds `item` to the queue. Returns true if the queue was
+     * empty. This may be called from any thread...
+     */
+    auto push(T* item) noexcept -> bool
+    {
+        assert(item);
+        ListItemBase* base = item;
+        auto* head = head_.load(std::memory_order_relaxed);
+        do {
+            base->next = head;
+        } while (!head_.compare_exchange_weak(head,
+                                              base,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+        return head == nullptr;
+    }
+
+    /* Moves every queued item to the back of `list`, in the order
+     * they were pushed. The queue is emptied with a single atomic
+     * exchange, so producers are never held up by the consumer.
+     * This must only be called by the consumer...
+     */
+    auto pop_all(IntrusiveList<T>& list) noexcept -> void
+    {
+        /* The items are linked newest first, so insert each one
+         * before the one that was pushed after it...
+         */
+        auto before = list.end();
+        auto* item = head_.exchange(nullptr, std::memory_order_acquire);
+        while (item) {
+            auto* next = item->next;
+            static_cast<void>(list.insert(static_cast<T*>(item), before));
+            before = typename IntrusiveList<T>::iterator { item };
+            item = next;
+        }
+    }
+
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    std::atomic<ListItemBase*> head_ { nullptr };
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_MPSC_QUEUE_HPP_INCLUDED
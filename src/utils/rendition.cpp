@@ -0,0 +1,77 @@
+#include "utils/rendition.hpp"
+#include <charconv>
+
+namespace
+{
+
+std::uint32_t constexpr kMinDimension = 128;
+std::uint32_t constexpr kMaxWidth = 7'680;
+std::uint32_t constexpr kMaxHeight = 4'320;
+std::int64_t constexpr kMinKbps = 100;
+std::int64_t constexpr kMaxKbps = 500'000;
+std::int64_t constexpr kBitsPerKbit = 1'000;
+
+/* Parses a whole number from the front of `val`, removing it...
+ */
+template <typename T>
+auto take_number(std::string_view& val) noexcept -> std::optional<T>
+{
+    T result {};
+    auto const r =
+        std::from_chars(val.data(), val.data() + val.size(), result);
+    if (r.ec != std::errc {})
+        return std::nullopt;
+
+    val.remove_prefix(static_cast<std::size_t>(r.ptr - val.data()));
+    return result;
+}
+
+auto take_char(std::string_view& val, char c) noexcept -> bool
+{
+    if (!val.size() || val.front() != c)
+        return false;
+
+    val.remove_prefix(1);
+    return true;
+}
+
+auto is_valid_dimension(std::uint32_t val, std::uint32_t max) noexcept -> bool
+{
+    return val >= kMinDimension && val <= max && val % 2 == 0;
+}
+
+} // namespace
+
+namespace sc
+{
+
+auto parse_rendition(std::string_view val) noexcept -> std::optional<Rendition>
+{
+    auto const width = take_number<std::uint32_t>(val);
+    if (!width || !take_char(val, 'x'))
+        return std::nullopt;
+
+    auto const height = take_number<std::uint32_t>(val);
+    if (!height)
+        return std::nullopt;
+
+    if (!is_valid_dimension(*width, kMaxWidth) ||
+        !is_valid_dimension(*height, kMaxHeight))
+        return std::nullopt;
+
+    Rendition result { .width = *width, .height = *height, .bit_rate = 0 };
+    if (take_char(val, '@')) {
+        auto const kbps = take_number<std::int64_t>(val);
+        if (!kbps || *kbps < kMinKbps || *kbps > kMaxKbps)
+            return std::nullopt;
+
+        result.bit_rate = *kbps * kBitsPerKbit;
+    }
+
+    if (val.size())
+        return std::nullopt;
+
+    return result;
+}
+
+} // namespace sc
@@ -0,0 +1,33 @@
+#ifndef SHADOW_CAST_UTILS_RENDITION_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_RENDITION_HPP_INCLUDED
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace sc
+{
+
+/* An extra encode of the captured video, scaled to `width` x
+ * `height`...
+ */
+struct Rendition
+{
+    std::uint32_t width;
+    std::uint32_t height;
+
+    /* Bits per second. Zero means the same constant quality as the
+     * full resolution encode...
+     */
+    std::int64_t bit_rate;
+};
+
+/* Parses a rendition in the format "<WIDTH>x<HEIGHT>[@<KBPS>]", e.g.
+ * "1280x720@2500". The width and height must be even...
+ */
+[[nodiscard]] auto parse_rendition(std::string_view) noexcept
+    -> std::optional<Rendition>;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_RENDITION_HPP_INCLUDED
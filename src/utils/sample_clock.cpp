@@ -0,0 +1,67 @@
+#include "utils/sample_clock.hpp"
+#include <algorithm>
+
+namespace
+{
+
+std::uint64_t constexpr kNsPerSecond = 1'000'000'000;
+
+/* Split, so a long capture doesn't overflow...
+ */
+auto to_samples(std::uint64_t ns, std::uint32_t sample_rate) noexcept
+    -> std::uint64_t
+{
+    return (ns / kNsPerSecond) * sample_rate +
+           (ns % kNsPerSecond) * sample_rate / kNsPerSecond;
+}
+
+} // namespace
+
+namespace sc
+{
+
+SampleClock::SampleClock(std::uint64_t origin,
+                         std::uint32_t sample_rate,
+                         std::uint64_t max_drift) noexcept
+    : origin_ { origin }
+    , sample_rate_ { sample_rate }
+    , max_drift_ { max_drift }
+{
+}
+
+auto SampleClock::step(std::uint64_t now, std::size_t n) noexcept
+    -> SampleStep
+{
+    /* The quantum has just arrived, so its first sample was captured
+     * `n` samples ago...
+     */
+    auto const elapsed = to_samples(now > origin_ ? now - origin_ : 0,
+                                    sample_rate_);
+    auto const expected = elapsed > n ? elapsed - n : 0;
+
+    if (!started_) {
+        started_ = true;
+        position_ = expected;
+    }
+
+    SampleStep result { .position = position_, .skip = 0, .resynced = false };
+    if (expected > position_ + max_drift_) {
+        result.position = position_ = expected;
+        result.resynced = true;
+    }
+    else if (position_ > expected + max_drift_) {
+        result.skip = static_cast<std::size_t>(
+            std::min<std::uint64_t>(position_ - expected, n));
+        result.resynced = true;
+    }
+
+    position_ += n - result.skip;
+    return result;
+}
+
+auto SampleClock::position() const noexcept -> std::uint64_t
+{
+    return position_;
+}
+
+} // namespace sc
@@ -0,0 +1,58 @@
+#ifndef SHADOW_CAST_UTILS_SAMPLE_CLOCK_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_SAMPLE_CLOCK_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sc
+{
+
+/* Where a quantum of captured samples belongs. `skip` samples at the
+ * front of the quantum are discarded, and the rest start at
+ * `position`...
+ */
+struct SampleStep
+{
+    std::uint64_t position;
+    std::size_t skip;
+    bool resynced;
+};
+
+/* Places each quantum of a capture's samples on a timeline shared by
+ * every capture, counted in samples from `origin`, a time on the
+ * audio context's `Clock`.
+ *
+ * A capture starts wherever the clock says it does, and then simply
+ * counts its samples, so the timestamps stay smooth despite the
+ * jitter in when quanta arrive. If the count drifts more than
+ * `max_drift` samples from the clock, e.g. because the device runs
+ * on a clock of its own, or stopped delivering for a while, it's
+ * pulled back into step. A capture that has fallen behind leaves a
+ * gap, and one that has run ahead has samples skipped...
+ */
+struct SampleClock
+{
+    SampleClock(std::uint64_t origin,
+                std::uint32_t sample_rate,
+                std::uint64_t max_drift) noexcept;
+
+    /* Places `n` samples that arrived at `now`...
+     */
+    [[nodiscard]] auto step(std::uint64_t now, std::size_t n) noexcept
+        -> SampleStep;
+
+    /* Where the next sample belongs...
+     */
+    [[nodiscard]] auto position() const noexcept -> std::uint64_t;
+
+private:
+    std::uint64_t origin_;
+    std::uint32_t sample_rate_;
+    std::uint64_t max_drift_;
+    std::uint64_t position_ { 0 };
+    bool started_ { false };
+};
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_SAMPLE_CLOCK_HPP_INCLUDED
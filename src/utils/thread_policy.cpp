@@ -0,0 +1,286 @@
+#include "utils/thread_policy.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <alloca.h>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+
+int constexpr kMinNice = -20;
+int constexpr kMaxNice = 19;
+std::size_t constexpr kPageSize = 4096;
+std::size_t constexpr kMaxEncoderThreads = 16;
+
+auto to_cpu_set(std::vector<int> const& cpus) -> cpu_set_t
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto const cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+            throw std::system_error { EINVAL, std::system_category() };
+
+        CPU_SET(cpu, &set);
+    }
+
+    return set;
+}
+
+auto from_cpu_set(cpu_set_t const& set) -> std::vector<int>
+{
+    std::vector<int> cpus;
+    for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+auto to_native(sc::SchedulingPolicy policy) noexcept -> int
+{
+    switch (policy) {
+    case sc::SchedulingPolicy::fifo:
+        return SCHED_FIFO;
+    case sc::SchedulingPolicy::round_robin:
+        return SCHED_RR;
+    default:
+        return SCHED_OTHER;
+    }
+}
+
+auto set_scheduler(int policy, int priority) noexcept -> bool
+{
+    sched_param param {};
+    param.sched_priority = priority;
+    return ::sched_setscheduler(0, policy, &param) == 0;
+}
+
+auto thread_nice() noexcept -> std::optional<int>
+{
+    errno = 0;
+    auto const val = ::getpriority(PRIO_PROCESS, ::gettid());
+    if (val == -1 && errno)
+        return std::nullopt;
+
+    return val;
+}
+
+/* Without `CAP_SYS_NICE`, a thread may lower its nice value as
+ * far as `RLIMIT_NICE` allows, which is given as `20 - nice`...
+ */
+auto lowest_permitted_nice() noexcept -> int
+{
+    rlimit limit {};
+    if (::getrlimit(RLIMIT_NICE, &limit) < 0 || limit.rlim_cur == 0)
+        return kMaxNice + 1;
+
+    auto const ceiling =
+        std::min<rlim_t>(limit.rlim_cur, kMaxNice + 1 - kMinNice);
+    return kMaxNice + 1 - static_cast<int>(ceiling);
+}
+
+auto realtime_priority_limit() noexcept -> int
+{
+    rlimit limit {};
+    if (::getrlimit(RLIMIT_RTPRIO, &limit) < 0)
+        return 0;
+
+    return static_cast<int>(std::min<rlim_t>(limit.rlim_cur, 99));
+}
+
+[[gnu::noinline]] auto prefault_stack(std::size_t size) noexcept -> void
+{
+    auto* stack = static_cast<unsigned char volatile*>(::alloca(size));
+    for (std::size_t i = 0; i < size; i += kPageSize)
+        stack[i] = 0;
+}
+
+} // namespace
+
+namespace sc
+{
+
+ThreadPolicyGuard::ThreadPolicyGuard(ThreadPolicy const& policy)
+{
+    if (policy.cpus.size()) {
+        cpu_set_t previous;
+        if (::sched_getaffinity(0, sizeof(previous), &previous) < 0)
+            throw std::system_error { errno, std::system_category() };
+
+        auto const set = to_cpu_set(policy.cpus);
+        if (::sched_setaffinity(0, sizeof(set), &set) < 0)
+            throw std::system_error { errno, std::system_category() };
+
+        previous_cpus_ = from_cpu_set(previous);
+    }
+
+    if (policy.scheduling != SchedulingPolicy::normal) {
+        auto const native = to_native(policy.scheduling);
+        auto const priority =
+            std::clamp(policy.priority,
+                       ::sched_get_priority_min(native),
+                       ::sched_get_priority_max(native));
+
+        sched_param previous {};
+        auto const previous_policy = ::sched_getscheduler(0);
+        if (previous_policy >= 0 && ::sched_getparam(0, &previous) == 0) {
+            /* Try the requested priority, then the highest that
+             * `RLIMIT_RTPRIO` permits, before falling back to the
+             * lowest nice value we're allowed...
+             */
+            auto const limit = realtime_priority_limit();
+            if (set_scheduler(native, priority) ||
+                (errno == EPERM && limit > 0 && limit < priority &&
+                 set_scheduler(native, limit))) {
+                previous_policy_ = previous_policy;
+                previous_priority_ = previous.sched_priority;
+            }
+            else {
+                log::warn("Couldn't apply realtime scheduling: "s +
+                          std::strerror(errno) +
+                          ". Falling back to SCHED_OTHER");
+
+                auto const current = thread_nice();
+                auto const target =
+                    std::max(kMinNice, lowest_permitted_nice());
+                if (current && target < *current &&
+                    ::setpriority(PRIO_PROCESS, ::gettid(), target) == 0)
+                    previous_nice_ = current;
+            }
+        }
+    }
+
+    if (policy.prefault_stack)
+        prefault_stack(policy.prefault_stack);
+}
+
+ThreadPolicyGuard::~ThreadPolicyGuard()
+{
+    /* Lowering a thread's priority, or restoring its original
+     * affinity, is always permitted, so these can't fail...
+     */
+    if (previous_nice_)
+        static_cast<void>(
+            ::setpriority(PRIO_PROCESS, ::gettid(), *previous_nice_));
+
+    if (previous_policy_)
+        static_cast<void>(set_scheduler(*previous_policy_, previous_priority_));
+
+    if (previous_cpus_.size()) {
+        try {
+            auto const set = to_cpu_set(previous_cpus_);
+            static_cast<void>(::sched_setaffinity(0, sizeof(set), &set));
+        }
+        catch (...) {
+        }
+    }
+}
+
+auto parse_cpu_list(std::string_view list) -> std::optional<std::vector<int>>
+{
+    auto const parse_cpu = [](std::string_view val) -> std::optional<int> {
+        int cpu {};
+        auto const* last = val.data() + val.size();
+        if (auto const r = std::from_chars(val.data(), last, cpu);
+            r.ec != std::errc {} || r.ptr != last || cpu < 0 ||
+            cpu >= CPU_SETSIZE)
+            return std::nullopt;
+
+        return cpu;
+    };
+
+    std::vector<int> cpus;
+    for (auto end = std::size_t { 0 }; end != std::string_view::npos;
+         list = list.substr(end + 1)) {
+        end = list.find(',');
+        auto const item = list.substr(0, end);
+        auto const dash = item.find('-');
+        auto const first = parse_cpu(item.substr(0, dash));
+        auto const last = dash == std::string_view::npos
+                              ? first
+                              : parse_cpu(item.substr(dash + 1));
+
+        if (!first || !last || *last < *first)
+            return std::nullopt;
+
+        for (auto cpu = *first; cpu <= *last; ++cpu)
+            cpus.push_back(cpu);
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+auto parse_thread_affinity(std::string_view spec, ThreadTopology& topology)
+    -> bool
+{
+    auto result = topology;
+    for (auto end = std::size_t { 0 }; end != std::string_view::npos;
+         spec = spec.substr(end + 1)) {
+        end = spec.find(':');
+        auto const item = spec.substr(0, end);
+        auto const equals = item.find('=');
+        if (equals == std::string_view::npos)
+            return false;
+
+        auto const name = item.substr(0, equals);
+        auto cpus = parse_cpu_list(item.substr(equals + 1));
+        if (!cpus)
+            return false;
+
+        if (name == "video")
+            result.video.cpus = std::move(*cpus);
+        else if (name == "audio")
+            result.audio.cpus = std::move(*cpus);
+        else if (name == "encoder")
+            result.encoder.cpus = std::move(*cpus);
+        else
+            return false;
+    }
+
+    topology = std::move(result);
+    return true;
+}
+
+auto encoder_thread_budget(ThreadTopology const& topology,
+                           std::size_t encoders) noexcept -> int
+{
+    auto cpus = topology.encoder.cpus.size();
+    if (!cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        cpus = ::sched_getaffinity(0, sizeof(set), &set) == 0
+                   ? static_cast<std::size_t>(CPU_COUNT(&set))
+                   : 1;
+    }
+
+    auto const share = cpus / std::max<std::size_t>(encoders, 1);
+    return static_cast<int>(
+        std::clamp<std::size_t>(share, 1, kMaxEncoderThreads));
+}
+
+auto lock_memory() noexcept -> bool
+{
+    if (::mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        return false;
+
+    static_cast<void>(::mallopt(M_TRIM_THRESHOLD, -1));
+    static_cast<void>(::mallopt(M_MMAP_MAX, 0));
+    return true;
+}
+
+} // namespace sc
@@ -0,0 +1,110 @@
+#ifndef SHADOW_CAST_UTILS_THREAD_POLICY_HPP_INCLUDED
+#define SHADOW_CAST_UTILS_THREAD_POLICY_HPP_INCLUDED
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace sc
+{
+
+enum struct SchedulingPolicy
+{
+    normal,
+    fifo,
+    round_robin
+};
+
+/* How the thread running a `Context` is scheduled. A default
+ * constructed policy leaves the thread as it is...
+ */
+struct ThreadPolicy
+{
+    /* The CPUs the thread may run on. If empty then the thread's
+     * affinity isn't changed...
+     */
+    std::vector<int> cpus {};
+
+    /* A realtime `scheduling` policy needs either `CAP_SYS_NICE`
+     * or a sufficient `RLIMIT_RTPRIO`. If neither is available
+     * then the thread falls back to the highest priority it's
+     * allowed under `SCHED_OTHER`...
+     */
+    SchedulingPolicy scheduling { SchedulingPolicy::normal };
+    int priority { 0 };
+
+    /* The number of bytes of stack to touch before the thread
+     * starts dispatching, so that it doesn't page fault in the
+     * middle of a frame...
+     */
+    std::size_t prefault_stack { 0 };
+};
+
+/* The policy for each of Shadow Cast's threads...
+ */
+struct ThreadTopology
+{
+    ThreadPolicy video {};
+    ThreadPolicy audio {};
+    ThreadPolicy encoder {};
+
+    /* Locks the process's memory, see `lock_memory()`...
+     */
+    bool lock_memory { false };
+};
+
+/* Applies a policy to the calling thread for the lifetime of
+ * this object, restoring the thread's previous affinity and
+ * scheduling afterwards. Throws `std::system_error` if the
+ * affinity can't be applied, e.g. if a CPU doesn't exist...
+ */
+struct ThreadPolicyGuard
+{
+    explicit ThreadPolicyGuard(ThreadPolicy const&);
+    ~ThreadPolicyGuard();
+
+    ThreadPolicyGuard(ThreadPolicyGuard const&) = delete;
+    auto operator=(ThreadPolicyGuard const&) -> ThreadPolicyGuard& = delete;
+
+private:
+    std::vector<int> previous_cpus_ {};
+    std::optional<int> previous_policy_ {};
+    int previous_priority_ { 0 };
+    std::optional<int> previous_nice_ {};
+};
+
+/* Parses a list of CPUs in the format accepted by `taskset -c`,
+ * e.g. "0,2,4-7"...
+ */
+[[nodiscard]] auto parse_cpu_list(std::string_view)
+    -> std::optional<std::vector<int>>;
+
+/* Parses the CPUs of each thread from a colon-separated list of
+ * `<THREAD>=<CPU LIST>` pairs, where `<THREAD>` is one of "video",
+ * "audio" or "encoder", e.g. "video=2:audio=3:encoder=4-7".
+ * Returns false if `spec` isn't valid...
+ */
+[[nodiscard]] auto parse_thread_affinity(std::string_view spec,
+                                         ThreadTopology& topology) -> bool;
+
+/* The number of threads each of `encoders` software encoders should
+ * use. They share the encoder CPUs between them, or every CPU the
+ * process may run on if the encoders aren't pinned, up to a limit
+ * past which more threads only add latency...
+ */
+[[nodiscard]] auto encoder_thread_budget(ThreadTopology const& topology,
+                                         std::size_t encoders) noexcept
+    -> int;
+
+/* Locks all of the process's current and future pages into RAM,
+ * and stops `malloc()` from returning freed memory to the system,
+ * so that pooled allocations stay resident. Returns false, having
+ * changed nothing, if the pages can't be locked, e.g. because of
+ * `RLIMIT_MEMLOCK`...
+ */
+auto lock_memory() noexcept -> bool;
+
+} // namespace sc
+
+#endif // SHADOW_CAST_UTILS_THREAD_POLICY_HPP_INCLUDED
@@ -0,0 +1,169 @@
+#include "av/media_chunk.hpp"
+#include "handlers/audio_mixer.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+std::size_t constexpr kChannels = 2;
+std::size_t constexpr kFrameSize = 4;
+
+/* 200ms of skew, at this rate, is 20 samples...
+ */
+std::size_t constexpr kSampleRate = 100;
+
+struct Mixed
+{
+    std::uint64_t position;
+    std::vector<float> left;
+    std::vector<float> right;
+};
+
+auto make_pool() -> std::shared_ptr<sc::MediaChunkPool>
+{
+    return sc::MediaChunkPool::create(
+        sc::SampleFormat::float_planar, kChannels, kFrameSize, 32);
+}
+
+/* A chunk of `kFrameSize` samples at `position`, with every left
+ * sample set to `value`, and every right sample to its negative...
+ */
+auto make_chunk(sc::MediaChunkPool& pool, std::uint64_t position, float value)
+    -> sc::MediaChunkPool::ItemPtr
+{
+    sc::MediaChunkPool::ItemPtr chunk { pool.get() };
+    EXPECT(chunk);
+    chunk->position = position;
+    chunk->sample_count = kFrameSize;
+
+    auto const planes = chunk->planes();
+    auto* left = reinterpret_cast<float*>(planes[0]);
+    auto* right = reinterpret_cast<float*>(planes[1]);
+    for (std::size_t i = 0; i < kFrameSize; ++i) {
+        left[i] = value;
+        right[i] = -value;
+    }
+
+    return chunk;
+}
+
+auto make_mixer(std::vector<float> gains, std::vector<Mixed>& output)
+    -> sc::AudioMixer
+{
+    return sc::AudioMixer {
+        std::move(gains),
+        sc::SampleFormat::float_planar,
+        kChannels,
+        kFrameSize,
+        kSampleRate,
+        sc::AudioMixer::OutputType {
+            [&output](sc::MediaChunkPool::ItemPtr chunk) {
+                EXPECT(chunk->sample_count == kFrameSize);
+                auto const planes = chunk->planes();
+                auto const* left = reinterpret_cast<float const*>(planes[0]);
+                auto const* right = reinterpret_cast<float const*>(planes[1]);
+                output.push_back(
+                    Mixed { .position = chunk->position,
+                            .left = { left, left + kFrameSize },
+                            .right = { right, right + kFrameSize } });
+            } }
+    };
+}
+
+auto all_equal(std::vector<float> const& values, float expected) -> bool
+{
+    for (auto v : values) {
+        if (v != expected)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+auto should_mix_sources_with_their_gains() -> void
+{
+    auto pool = make_pool();
+    std::vector<Mixed> output;
+    auto mixer = make_mixer({ 1.0f, 0.5f }, output);
+
+    mixer(0, make_chunk(*pool, 0, 0.25f));
+    EXPECT(output.empty());
+
+    mixer(1, make_chunk(*pool, 0, 0.5f));
+    EXPECT(output.size() == 1);
+    EXPECT(output[0].position == 0);
+    EXPECT(all_equal(output[0].left, 0.5f));
+    EXPECT(all_equal(output[0].right, -0.5f));
+}
+
+auto should_align_sources_by_position() -> void
+{
+    auto pool = make_pool();
+    std::vector<Mixed> output;
+    auto mixer = make_mixer({ 1.0f, 1.0f }, output);
+
+    /* The second source is half a frame behind the first...
+     */
+    mixer(0, make_chunk(*pool, 0, 0.25f));
+    mixer(0, make_chunk(*pool, 4, 0.25f));
+    mixer(1, make_chunk(*pool, 2, 0.5f));
+    EXPECT(output.size() == 1);
+    EXPECT(output[0].left ==
+           (std::vector<float> { 0.25f, 0.25f, 0.75f, 0.75f }));
+
+    mixer(1, make_chunk(*pool, 6, 0.5f));
+    EXPECT(output.size() == 2);
+    EXPECT(output[1].position == 4);
+    EXPECT(all_equal(output[1].left, 0.75f));
+}
+
+auto should_not_wait_for_a_silent_source() -> void
+{
+    auto pool = make_pool();
+    std::vector<Mixed> output;
+    auto mixer = make_mixer({ 1.0f, 1.0f }, output);
+
+    /* Once the first source is 20 samples past a frame, the frame is
+     * mixed without the second...
+     */
+    for (std::uint64_t position = 0; position < 20; position += kFrameSize)
+        mixer(0, make_chunk(*pool, position, 0.25f));
+    EXPECT(output.empty());
+
+    mixer(0, make_chunk(*pool, 20, 0.25f));
+    EXPECT(output.size() == 1);
+    EXPECT(output[0].position == 0);
+    EXPECT(all_equal(output[0].left, 0.25f));
+}
+
+auto should_discard_late_chunks() -> void
+{
+    auto pool = make_pool();
+    std::vector<Mixed> output;
+    auto mixer = make_mixer({ 1.0f, 1.0f }, output);
+
+    for (std::uint64_t position = 0; position < 28; position += kFrameSize)
+        mixer(0, make_chunk(*pool, position, 0.25f));
+    EXPECT(output.size() == 2);
+
+    /* Already mixed, so it must not hold anything up...
+     */
+    mixer(1, make_chunk(*pool, 4, 0.5f));
+    mixer(1, make_chunk(*pool, 8, 0.5f));
+    EXPECT(output.size() == 3);
+    EXPECT(output[2].position == 8);
+    EXPECT(all_equal(output[2].left, 0.75f));
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_mix_sources_with_their_gains),
+                          TEST(should_align_sources_by_position),
+                          TEST(should_not_wait_for_a_silent_source),
+                          TEST(should_discard_late_chunks) });
+}
@@ -0,0 +1,246 @@
+#include "testing.hpp"
+#include "utils/bounded_queue.hpp"
+#include "utils/intrusive_list.hpp"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Item : sc::ListItemBase
+{
+    std::size_t value { 0 };
+    bool droppable { true };
+};
+
+struct IsDroppable
+{
+    auto operator()(Item const& item) const noexcept -> bool
+    {
+        return item.droppable;
+    }
+};
+
+using Queue = sc::BoundedQueue<Item, IsDroppable>;
+
+auto make_items(std::size_t n) -> std::vector<Item>
+{
+    std::vector<Item> items(n);
+    for (std::size_t i = 0; i < n; ++i)
+        items[i].value = i;
+
+    return items;
+}
+
+auto drain(Queue& queue) -> std::vector<std::size_t>
+{
+    sc::IntrusiveList<Item> items;
+    queue.pop_all(items);
+
+    std::vector<std::size_t> values;
+    while (!items.empty()) {
+        values.push_back(items.front().value);
+        items.pop_front();
+    }
+
+    return values;
+}
+
+} // namespace
+
+auto should_drop_the_newest_items() -> void
+{
+    auto items = make_items(5);
+    Queue queue { { .capacity = 3,
+                    .policy = sc::OverflowPolicy::drop_newest } };
+
+    for (std::size_t i = 0; i < 3; ++i)
+        EXPECT(queue.push(&items[i]).dropped == nullptr);
+
+    EXPECT(queue.push(&items[3]).dropped == &items[3]);
+    EXPECT(queue.push(&items[4]).dropped == &items[4]);
+
+    auto const metrics = queue.metrics();
+    EXPECT(metrics.depth == 3);
+    EXPECT(metrics.high_water == 3);
+    EXPECT(metrics.dropped == 2);
+    EXPECT((drain(queue) == std::vector<std::size_t> { 0, 1, 2 }));
+    EXPECT(queue.metrics().depth == 0);
+}
+
+auto should_drop_the_oldest_items() -> void
+{
+    auto items = make_items(5);
+    Queue queue { { .capacity = 3,
+                    .policy = sc::OverflowPolicy::drop_oldest } };
+
+    for (std::size_t i = 0; i < 3; ++i)
+        static_cast<void>(queue.push(&items[i]));
+
+    EXPECT(queue.push(&items[3]).dropped == &items[0]);
+    EXPECT(queue.push(&items[4]).dropped == &items[1]);
+
+    EXPECT(queue.metrics().depth == 3);
+    EXPECT(queue.metrics().dropped == 2);
+    EXPECT((drain(queue) == std::vector<std::size_t> { 2, 3, 4 }));
+}
+
+auto should_skip_items_that_cannot_be_dropped() -> void
+{
+    auto items = make_items(4);
+    items[0].droppable = false;
+    Queue queue { { .capacity = 3,
+                    .policy = sc::OverflowPolicy::drop_oldest } };
+
+    for (std::size_t i = 0; i < 3; ++i)
+        static_cast<void>(queue.push(&items[i]));
+
+    EXPECT(queue.push(&items[3]).dropped == &items[1]);
+    EXPECT((drain(queue) == std::vector<std::size_t> { 0, 2, 3 }));
+}
+
+auto should_never_drop_items_that_cannot_be_dropped() -> void
+{
+    auto items = make_items(3);
+    items[2].droppable = false;
+    Queue queue { { .capacity = 2,
+                    .policy = sc::OverflowPolicy::drop_newest } };
+
+    static_cast<void>(queue.push(&items[0]));
+    static_cast<void>(queue.push(&items[1]));
+
+    /* The queue is full, so this waits until the consumer makes
+     * space...
+     */
+    std::atomic<Item*> dropped { &items[0] };
+    std::thread producer { [&] { dropped = queue.push(&items[2]).dropped; } };
+
+    auto const first = drain(queue);
+    producer.join();
+
+    EXPECT(dropped == nullptr);
+    EXPECT((first == std::vector<std::size_t> { 0, 1 }));
+    EXPECT(queue.metrics().dropped == 0);
+    EXPECT((drain(queue) == std::vector<std::size_t> { 2 }));
+}
+
+auto should_block_until_there_is_space() -> void
+{
+    constexpr std::size_t kNumItems = 10'000;
+    constexpr std::size_t kCapacity = 4;
+
+    auto items = make_items(kNumItems);
+    Queue queue { { .capacity = kCapacity,
+                    .policy = sc::OverflowPolicy::block } };
+
+    std::thread producer { [&] {
+        for (auto& item : items)
+            static_cast<void>(queue.push(&item));
+    } };
+
+    std::vector<std::size_t> received;
+    while (received.size() < kNumItems) {
+        auto const values = drain(queue);
+        if (values.empty())
+            std::this_thread::yield();
+
+        received.insert(received.end(), values.begin(), values.end());
+    }
+
+    producer.join();
+
+    auto in_order = true;
+    for (std::size_t i = 0; i < kNumItems; ++i)
+        in_order = in_order && received[i] == i;
+
+    EXPECT(in_order);
+    EXPECT(queue.metrics().high_water <= kCapacity);
+    EXPECT(queue.metrics().dropped == 0);
+}
+
+auto should_keep_order_while_dropping_the_oldest_items() -> void
+{
+    constexpr std::size_t kNumItems = 100'000;
+    constexpr std::size_t kCapacity = 4;
+
+    /* Every other item can't be dropped, so the consumer must see
+     * all of those, in order, while the producer takes items from
+     * under it to drop...
+     */
+    auto items = make_items(kNumItems);
+    for (std::size_t i = 0; i < kNumItems; i += 2)
+        items[i].droppable = false;
+
+    Queue queue { { .capacity = kCapacity,
+                    .policy = sc::OverflowPolicy::drop_oldest } };
+
+    std::atomic<bool> done { false };
+    std::thread producer { [&] {
+        for (auto& item : items)
+            static_cast<void>(queue.push(&item));
+
+        done = true;
+    } };
+
+    std::vector<std::size_t> received;
+    auto finished = false;
+    while (!finished) {
+        finished = done;
+        auto const values = drain(queue);
+        received.insert(received.end(), values.begin(), values.end());
+    }
+
+    producer.join();
+
+    auto in_order = true;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < received.size(); ++i) {
+        in_order = in_order && (i == 0 || received[i - 1] < received[i]);
+        kept += received[i] % 2 == 0;
+    }
+
+    EXPECT(in_order);
+    EXPECT(kept == kNumItems / 2);
+    EXPECT(received.size() + queue.metrics().dropped == kNumItems);
+}
+
+auto should_stop_blocking_once_closed() -> void
+{
+    auto items = make_items(3);
+    Queue queue { { .capacity = 1, .policy = sc::OverflowPolicy::block } };
+
+    static_cast<void>(queue.push(&items[0]));
+    std::thread producer { [&] { static_cast<void>(queue.push(&items[1])); } };
+
+    queue.close();
+    producer.join();
+
+    EXPECT(queue.push_unbounded(&items[2]) == false);
+    EXPECT(queue.metrics().high_water == 3);
+    EXPECT((drain(queue) == std::vector<std::size_t> { 0, 1, 2 }));
+}
+
+auto should_parse_overflow_policies() -> void
+{
+    EXPECT(sc::parse_overflow_policy("block") == sc::OverflowPolicy::block);
+    EXPECT(sc::parse_overflow_policy("drop-oldest") ==
+           sc::OverflowPolicy::drop_oldest);
+    EXPECT(sc::parse_overflow_policy("drop-newest") ==
+           sc::OverflowPolicy::drop_newest);
+    EXPECT(!sc::parse_overflow_policy("drop"));
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_drop_the_newest_items),
+          TEST(should_drop_the_oldest_items),
+          TEST(should_skip_items_that_cannot_be_dropped),
+          TEST(should_never_drop_items_that_cannot_be_dropped),
+          TEST(should_block_until_there_is_space),
+          TEST(should_keep_order_while_dropping_the_oldest_items),
+          TEST(should_stop_blocking_once_closed),
+          TEST(should_parse_overflow_policies) });
+}
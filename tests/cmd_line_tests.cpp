@@ -36,7 +36,203 @@ auto should_fail_number_range() -> void
     EXPECT_THROWS(sc::parse_cmd_line(std::size(argv), argv));
 }
 
+auto should_parse_segment_limits() -> void
+{
+    char const* argv[] = { "-S", "600", "-Z", "2048", "/tmp/test-%03d.mkv" };
+
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).segment_duration == 600'000'000'000);
+    EXPECT(sc::get_value(params).segment_max_bytes == 2'048ull << 20);
+}
+
+auto should_parse_fragment_duration() -> void
+{
+    char const* argv[] = { "-F", "2000", "/tmp/test.mp4" };
+
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).fragment_duration == 2'000'000'000);
+}
+
+auto should_parse_every_tee_output() -> void
+{
+    char const* argv[] = {
+        "-T", "udp://127.0.0.1:5000", "/tmp/test.mkv", "-T", "pipe:1"
+    };
+
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).output_file == "/tmp/test.mkv");
+    auto const& tee_outputs = sc::get_value(params).tee_outputs;
+    EXPECT(tee_outputs.size() == 2);
+    EXPECT(tee_outputs[0] == "udp://127.0.0.1:5000");
+    EXPECT(tee_outputs[1] == "pipe:1");
+}
+
+auto should_parse_renditions() -> void
+{
+    char const* argv[] = {
+        "-L", "1280x720@2500", "-L", "640x360", "/tmp/test.mkv"
+    };
+
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(params);
+    auto const& renditions = sc::get_value(params).renditions;
+    EXPECT(renditions.size() == 2);
+    EXPECT(renditions[0].width == 1'280);
+    EXPECT(renditions[0].height == 720);
+    EXPECT(renditions[0].bit_rate == 2'500'000);
+    EXPECT(renditions[1].width == 640);
+    EXPECT(renditions[1].height == 360);
+    EXPECT(renditions[1].bit_rate == 0);
+}
+
+auto should_reject_invalid_renditions() -> void
+{
+    EXPECT(!sc::parse_rendition("1280x"));
+    EXPECT(!sc::parse_rendition("1280x720@"));
+    EXPECT(!sc::parse_rendition("1281x720"));
+    EXPECT(!sc::parse_rendition("64x64"));
+    EXPECT(!sc::parse_rendition("1280x720@10"));
+    EXPECT(!sc::parse_rendition("1280x720@2500k"));
+
+    char const* argv[] = { "-L", "720p", "/tmp/test.mkv" };
+    EXPECT(!sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv)));
+}
+
+auto should_parse_audio_sources() -> void
+{
+    char const* defaults_argv[] = { "/tmp/test.mkv" };
+    auto const defaults = sc::get_parameters(
+        sc::parse_cmd_line(std::size(defaults_argv), defaults_argv));
+
+    EXPECT(defaults);
+    EXPECT(!sc::get_value(defaults).mix_audio);
+    auto const& default_sources = sc::get_value(defaults).audio_sources;
+    EXPECT(default_sources.size() == 1);
+    EXPECT(default_sources[0].type == sc::AudioSourceType::desktop);
+    EXPECT(default_sources[0].node.empty());
+
+    char const* argv[] = { "-a", "desktop@80",   "-a",
+                           "mic=usb@mic@150", "-x", "-a",
+                           "desktop=hdmi",    "/tmp/test.mkv" };
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).mix_audio);
+    auto const& sources = sc::get_value(params).audio_sources;
+    EXPECT(sources.size() == 3);
+    EXPECT(sources[0].type == sc::AudioSourceType::desktop);
+    EXPECT(sources[0].gain == 0.8f);
+    EXPECT(sources[1].type == sc::AudioSourceType::microphone);
+    EXPECT(sources[1].node == "usb@mic");
+    EXPECT(sources[1].gain == 1.5f);
+    EXPECT(sources[2].node == "hdmi");
+    EXPECT(sources[2].gain == 1.0f);
+}
+
+auto should_reject_invalid_audio_sources() -> void
+{
+    EXPECT(!sc::parse_audio_source("speakers"));
+    EXPECT(!sc::parse_audio_source("mic="));
+    EXPECT(!sc::parse_audio_source("mic@"));
+    EXPECT(!sc::parse_audio_source("mic@401"));
+    EXPECT(!sc::parse_audio_source("mic@50%"));
+
+    char const* argv[] = { "-a", "line-in", "/tmp/test.mkv" };
+    EXPECT(!sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv)));
+}
+
+auto should_parse_shutdown_timeout() -> void
+{
+    char const* argv[] = { "/tmp/test.mkv" };
+    auto const defaults =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(defaults);
+    EXPECT(sc::get_value(defaults).shutdown_timeout == 10'000'000'000);
+
+    char const* timeout_argv[] = { "-D", "3", "/tmp/test.mkv" };
+    auto const params = sc::get_parameters(
+        sc::parse_cmd_line(std::size(timeout_argv), timeout_argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).shutdown_timeout == 3'000'000'000);
+}
+
+auto should_parse_encoder_queue() -> void
+{
+    char const* argv[] = { "/tmp/test.mkv" };
+    auto const defaults =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(defaults);
+    EXPECT(sc::get_value(defaults).encoder_queue.capacity == 32);
+    EXPECT(sc::get_value(defaults).encoder_queue.policy ==
+           sc::OverflowPolicy::block);
+
+    char const* queue_argv[] = { "-Q", "8", "-P", "drop-oldest",
+                                 "/tmp/test.mkv" };
+    auto const params = sc::get_parameters(
+        sc::parse_cmd_line(std::size(queue_argv), queue_argv));
+
+    EXPECT(params);
+    EXPECT(sc::get_value(params).encoder_queue.capacity == 8);
+    EXPECT(sc::get_value(params).encoder_queue.policy ==
+           sc::OverflowPolicy::drop_oldest);
+
+    char const* invalid_argv[] = { "-P", "drop", "/tmp/test.mkv" };
+    EXPECT_THROWS(sc::parse_cmd_line(std::size(invalid_argv), invalid_argv));
+}
+
+auto should_accept_software_encoders() -> void
+{
+    for (auto const* encoder : { "libx264", "libx265", "ffv1" }) {
+        char const* argv[] = { "-V", encoder, "/tmp/test.mkv" };
+        auto const params =
+            sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+        EXPECT(params);
+        EXPECT(sc::get_value(params).video_encoder == encoder);
+    }
+
+    char const* argv[] = { "-V", "libvpx", "/tmp/test.mkv" };
+    EXPECT_THROWS(sc::parse_cmd_line(std::size(argv), argv));
+}
+
+auto should_not_segment_in_replay_mode() -> void
+{
+    char const* argv[] = { "-R", "30", "-S", "600", "/tmp/test.mkv" };
+
+    auto const params =
+        sc::get_parameters(sc::parse_cmd_line(std::size(argv), argv));
+
+    EXPECT(!params);
+}
+
 auto main() -> int
 {
-    return testing::run({ TEST(should_parse), TEST(should_fail_number_range) });
+    return testing::run({ TEST(should_parse),
+                          TEST(should_fail_number_range),
+                          TEST(should_parse_segment_limits),
+                          TEST(should_parse_fragment_duration),
+                          TEST(should_parse_every_tee_output),
+                          TEST(should_parse_renditions),
+                          TEST(should_reject_invalid_renditions),
+                          TEST(should_parse_audio_sources),
+                          TEST(should_reject_invalid_audio_sources),
+                          TEST(should_parse_shutdown_timeout),
+                          TEST(should_parse_encoder_queue),
+                          TEST(should_accept_software_encoders),
+                          TEST(should_not_segment_in_replay_mode) });
 }
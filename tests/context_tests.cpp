@@ -0,0 +1,318 @@
+#include "services/context.hpp"
+#include "services/readiness.hpp"
+#include "services/service.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+struct TickingService final : sc::Service
+{
+    TickingService(sc::Context& ctx, std::size_t stop_after) noexcept
+        : ctx_ { ctx }
+        , stop_after_ { stop_after }
+    {
+    }
+
+    std::size_t ticks { 0 };
+
+protected:
+    auto on_init(sc::ReadinessRegister reg) -> void override
+    {
+        reg(sc::FrameTimeRatio(1), &dispatch);
+    }
+
+private:
+    static auto dispatch(sc::Service& svc) -> void
+    {
+        auto& self = static_cast<TickingService&>(svc);
+        if (++self.ticks == self.stop_after_)
+            self.ctx_.request_stop();
+    }
+
+    sc::Context& ctx_;
+    std::size_t stop_after_;
+};
+
+/* Registers an eventfd on its first tick, signals it, then removes
+ * and closes it when it's dispatched. This exercises registering
+ * and removing handles while the context is running...
+ */
+struct DynamicService final : sc::Service
+{
+    explicit DynamicService(sc::Context& ctx) noexcept
+        : ctx_ { ctx }
+    {
+    }
+
+    std::size_t notifications { 0 };
+    bool removed { false };
+
+protected:
+    auto on_init(sc::ReadinessRegister reg) -> void override
+    {
+        reg_.emplace(reg);
+        reg(sc::FrameTimeRatio(1), &dispatch_tick);
+    }
+
+    auto on_uninit() noexcept -> void override
+    {
+        if (event_fd_ >= 0)
+            ::close(event_fd_);
+        event_fd_ = -1;
+    }
+
+private:
+    static auto dispatch_tick(sc::Service& svc) -> void
+    {
+        auto& self = static_cast<DynamicService&>(svc);
+        if (self.removed) {
+            self.ctx_.request_stop();
+            return;
+        }
+
+        if (self.event_fd_ >= 0)
+            return;
+
+        self.event_fd_ = ::eventfd(0, EFD_NONBLOCK);
+        EXPECT(self.event_fd_ >= 0);
+        (*self.reg_)(self.event_fd_, &dispatch_notification);
+
+        std::uint64_t const val { 1 };
+        EXPECT(::write(self.event_fd_, &val, sizeof(val)) ==
+               static_cast<ssize_t>(sizeof(val)));
+    }
+
+    static auto dispatch_notification(sc::Service& svc) -> void
+    {
+        auto& self = static_cast<DynamicService&>(svc);
+        self.notifications += 1;
+
+        self.reg_->remove(self.event_fd_);
+        ::close(self.event_fd_);
+        self.event_fd_ = -1;
+        self.removed = true;
+    }
+
+    sc::Context& ctx_;
+    std::optional<sc::ReadinessRegister> reg_;
+    int event_fd_ { -1 };
+};
+
+/* Records the context's clock on each tick...
+ */
+struct TimestampingService final : sc::Service
+{
+    TimestampingService(sc::Context& ctx, std::size_t stop_after) noexcept
+        : ctx_ { ctx }
+        , stop_after_ { stop_after }
+    {
+    }
+
+    std::vector<std::uint64_t> timestamps;
+    std::optional<std::uint64_t> origin;
+
+protected:
+    auto on_init(sc::ReadinessRegister reg) -> void override
+    {
+        reg_.emplace(reg);
+        origin = reg.origin();
+        timestamps.reserve(stop_after_);
+        reg(sc::FrameTimeRatio(1), &dispatch);
+    }
+
+private:
+    static auto dispatch(sc::Service& svc) -> void
+    {
+        auto& self = static_cast<TimestampingService&>(svc);
+        self.timestamps.push_back(self.reg_->clock().now());
+        if (self.timestamps.size() == self.stop_after_)
+            self.ctx_.request_stop();
+    }
+
+    sc::Context& ctx_;
+    std::optional<sc::ReadinessRegister> reg_;
+    std::size_t stop_after_;
+};
+
+auto run_on_virtual_time(sc::ReactorBackendType backend) -> void
+{
+    /* An hour at 60fps...
+     */
+    std::size_t constexpr kTicks = 60 * 60 * 60;
+    std::uint64_t constexpr kStart = 1'000;
+
+    sc::VirtualClock clock { kStart };
+    sc::Context ctx { 60 };
+    ctx.set_clock(clock);
+    ctx.set_backend(backend);
+    ctx.services().add_from_factory<TimestampingService>(
+        [&] { return std::make_unique<TimestampingService>(ctx, kTicks); });
+
+    ctx.run();
+
+    /* Every tick is dispatched exactly on its deadline, so the
+     * timestamps are the same on every run...
+     */
+    auto const& timestamps =
+        ctx.services().use_if<TimestampingService>()->timestamps;
+    EXPECT(timestamps.size() == kTicks);
+    for (std::size_t i = 0; i < timestamps.size(); ++i)
+        EXPECT(timestamps[i] == kStart + (i * 1'000'000'000) / 60);
+
+    EXPECT(clock.now() == timestamps.back());
+
+    auto const* metrics = ctx.metrics_for<TimestampingService>();
+    EXPECT(metrics);
+    EXPECT(metrics->missed_ticks == 0);
+    EXPECT(metrics->max_lateness == 0);
+
+    /* ...and far faster than realtime...
+     */
+    EXPECT(ctx.metrics().run_time < 60ull * 1'000'000'000);
+}
+
+auto should_share_a_timeline_origin() -> void
+{
+    std::uint64_t constexpr kOrigin = 1'000;
+    std::uint64_t constexpr kStart = 5'000'000;
+
+    sc::VirtualClock clock { kStart };
+    sc::Context ctx { 60 };
+    ctx.set_clock(clock);
+    ctx.set_origin(kOrigin);
+    ctx.services().add_from_factory<TimestampingService>(
+        [&] { return std::make_unique<TimestampingService>(ctx, 4); });
+
+    ctx.run();
+
+    /* Tick zero was already due when the context started. The rest
+     * fall on the origin's timeline, rather than the start's...
+     */
+    auto const* svc = ctx.services().use_if<TimestampingService>();
+    EXPECT(svc->origin == kOrigin);
+    EXPECT(svc->timestamps.size() == 4);
+    EXPECT(svc->timestamps[0] == kStart);
+    for (std::size_t i = 1; i < svc->timestamps.size(); ++i)
+        EXPECT(svc->timestamps[i] == kOrigin + (i * 1'000'000'000) / 60);
+}
+
+auto dispatch_frame_ticks(sc::ReactorBackendType backend) -> void
+{
+    sc::Context ctx { 1'000 };
+    ctx.set_backend(backend);
+    ctx.services().add_from_factory<TickingService>(
+        [&] { return std::make_unique<TickingService>(ctx, 10); });
+
+    ctx.run();
+
+    EXPECT(ctx.services().use_if<TickingService>()->ticks == 10);
+}
+
+auto register_and_remove_while_running(sc::ReactorBackendType backend)
+    -> void
+{
+    sc::Context ctx { 1'000 };
+    ctx.set_backend(backend);
+    ctx.services().add_from_factory<DynamicService>(
+        [&] { return std::make_unique<DynamicService>(ctx); });
+
+    ctx.run();
+
+    auto const* svc = ctx.services().use_if<DynamicService>();
+    EXPECT(svc->removed);
+    EXPECT(svc->notifications == 1);
+}
+
+} // namespace
+
+auto should_dispatch_frame_ticks() -> void
+{
+    dispatch_frame_ticks(sc::ReactorBackendType::epoll);
+}
+
+auto should_dispatch_frame_ticks_with_io_uring() -> void
+{
+    dispatch_frame_ticks(sc::ReactorBackendType::io_uring);
+}
+
+auto should_register_and_remove_while_running() -> void
+{
+    register_and_remove_while_running(sc::ReactorBackendType::epoll);
+}
+
+auto should_register_and_remove_while_running_with_io_uring() -> void
+{
+    register_and_remove_while_running(sc::ReactorBackendType::io_uring);
+}
+
+auto should_run_on_virtual_time() -> void
+{
+    run_on_virtual_time(sc::ReactorBackendType::epoll);
+}
+
+auto should_run_on_virtual_time_with_io_uring() -> void
+{
+    run_on_virtual_time(sc::ReactorBackendType::io_uring);
+}
+
+auto should_record_dispatch_metrics() -> void
+{
+    sc::Context ctx { 1'000 };
+    ctx.services().add_from_factory<TickingService>(
+        [&] { return std::make_unique<TickingService>(ctx, 10); });
+    ctx.services().add_from_factory<DynamicService>(
+        [&] { return std::make_unique<DynamicService>(ctx); });
+
+    ctx.run();
+
+    auto const* ticking = ctx.metrics_for<TickingService>();
+    EXPECT(ticking);
+    EXPECT(ticking->ticks ==
+           ctx.services().use_if<TickingService>()->ticks);
+    EXPECT(ticking->dispatches == ticking->ticks);
+    EXPECT(ticking->max_duration >= ticking->mean_duration());
+
+    /* The notification is counted as a dispatch, but not a tick...
+     */
+    auto const* dynamic = ctx.metrics_for<DynamicService>();
+    EXPECT(dynamic);
+    EXPECT(dynamic->dispatches == dynamic->ticks + 1);
+
+    EXPECT(ctx.metrics().services.size() == 2);
+    EXPECT(ctx.metrics().iterations > 0);
+    EXPECT(ctx.metrics().run_time > 0);
+}
+
+auto should_run_more_than_once() -> void
+{
+    sc::Context ctx { 1'000 };
+    ctx.services().add_from_factory<TickingService>(
+        [&] { return std::make_unique<TickingService>(ctx, 5); });
+
+    ctx.run();
+    ctx.services().use_if<TickingService>()->ticks = 0;
+    ctx.run();
+
+    EXPECT(ctx.services().use_if<TickingService>()->ticks == 5);
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_dispatch_frame_ticks),
+          TEST(should_dispatch_frame_ticks_with_io_uring),
+          TEST(should_register_and_remove_while_running),
+          TEST(should_register_and_remove_while_running_with_io_uring),
+          TEST(should_run_on_virtual_time),
+          TEST(should_run_on_virtual_time_with_io_uring),
+          TEST(should_share_a_timeline_origin),
+          TEST(should_record_dispatch_metrics),
+          TEST(should_run_more_than_once) });
+}
@@ -0,0 +1,131 @@
+#include "av/frame_converter.hpp"
+#include "testing.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace
+{
+
+std::uint32_t constexpr kWidth = 16;
+std::uint32_t constexpr kHeight = 16;
+
+/* Fills a downloaded frame with a single BGRA color...
+ */
+auto fill_bgra(sc::FrameConverter::Destination const& dest,
+               std::uint8_t b,
+               std::uint8_t g,
+               std::uint8_t r) -> void
+{
+    for (std::size_t y = 0; y < kHeight; ++y) {
+        auto* row = dest.data + y * dest.pitch;
+        for (std::size_t x = 0; x < kWidth; ++x) {
+            row[x * 4 + 0] = b;
+            row[x * 4 + 1] = g;
+            row[x * 4 + 2] = r;
+            row[x * 4 + 3] = 0xff;
+        }
+    }
+}
+
+/* Every sample of a plane is within a step or two of `expected`,
+ * allowing for the scaler's rounding...
+ */
+auto plane_is(AVFrame const& frame,
+              int plane,
+              std::size_t width,
+              std::size_t height,
+              int expected) -> bool
+{
+    for (std::size_t y = 0; y < height; ++y) {
+        auto const* row = frame.data[plane] + y * frame.linesize[plane];
+        for (std::size_t x = 0; x < width; ++x)
+            if (std::abs(row[x] - expected) > 2)
+                return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+auto should_download_straight_into_frames_of_the_source_format() -> void
+{
+    sc::FrameConverter converter { { .width = kWidth, .height = kHeight },
+                                   AV_PIX_FMT_BGRA,
+                                   AV_PIX_FMT_BGRA };
+
+    sc::FramePtr frame { av_frame_alloc() };
+    auto const dest = converter.prepare(*frame);
+    EXPECT(dest.data == frame->data[0]);
+    EXPECT(dest.pitch == static_cast<std::size_t>(frame->linesize[0]));
+    EXPECT(dest.pitch % 32 == 0);
+
+    fill_bgra(dest, 0x10, 0x20, 0x30);
+    converter.convert(*frame);
+
+    EXPECT(frame->format == AV_PIX_FMT_BGRA);
+    EXPECT(frame->width == static_cast<int>(kWidth));
+    EXPECT(frame->height == static_cast<int>(kHeight));
+    EXPECT(frame->data[0][0] == 0x10);
+    EXPECT(frame->data[0][(kHeight - 1) * dest.pitch + 2] == 0x30);
+}
+
+auto should_convert_bgra_to_yuv420p() -> void
+{
+    sc::FrameConverter converter { { .width = kWidth, .height = kHeight },
+                                   AV_PIX_FMT_BGRA,
+                                   AV_PIX_FMT_YUV420P };
+
+    /* The frame holds the downloaded pixels, as they are, until it's
+     * converted...
+     */
+    sc::FramePtr frame { av_frame_alloc() };
+    auto const dest = converter.prepare(*frame);
+    EXPECT(dest.data == frame->data[0]);
+    EXPECT(frame->format == AV_PIX_FMT_BGRA);
+
+    /* Pure red, in BT.601 limited range...
+     */
+    fill_bgra(dest, 0, 0, 0xff);
+    converter.convert(*frame);
+
+    EXPECT(frame->format == AV_PIX_FMT_YUV420P);
+    EXPECT(plane_is(*frame, 0, kWidth, kHeight, 81));
+    EXPECT(plane_is(*frame, 1, kWidth / 2, kHeight / 2, 90));
+    EXPECT(plane_is(*frame, 2, kWidth / 2, kHeight / 2, 240));
+}
+
+auto should_not_overwrite_frames_still_held() -> void
+{
+    sc::FrameConverter converter { { .width = kWidth, .height = kHeight },
+                                   AV_PIX_FMT_BGRA,
+                                   AV_PIX_FMT_YUV420P };
+
+    /* Frames are downloaded on the capture thread, and may still be
+     * queued, unconverted, when the next is downloaded...
+     */
+    sc::FramePtr first { av_frame_alloc() };
+    fill_bgra(converter.prepare(*first), 0xff, 0xff, 0xff);
+
+    sc::FramePtr second { av_frame_alloc() };
+    fill_bgra(converter.prepare(*second), 0, 0, 0);
+
+    converter.convert(*first);
+    converter.convert(*second);
+
+    EXPECT(first->buf[0]->data != second->buf[0]->data);
+    EXPECT(plane_is(*first, 0, kWidth, kHeight, 235));
+    EXPECT(plane_is(*second, 0, kWidth, kHeight, 16));
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_download_straight_into_frames_of_the_source_format),
+          TEST(should_convert_bgra_to_yuv420p),
+          TEST(should_not_overwrite_frames_still_held) });
+}
@@ -0,0 +1,280 @@
+#include "services/frame_scheduler.hpp"
+#include "services/service.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+struct RecordingService final : sc::Service
+{
+    std::vector<std::uint64_t> dispatched;
+    std::uint64_t const* clock { nullptr };
+
+    static auto dispatch(sc::Service& svc) -> void
+    {
+        auto& self = static_cast<RecordingService&>(svc);
+        self.dispatched.push_back(*self.clock);
+    }
+
+protected:
+    auto on_init(sc::ReadinessRegister) -> void override {}
+};
+
+/* 60fps, i.e. 16'666'666.666...ns...
+ */
+constexpr sc::FramePeriod k60Fps { .num = 1'000'000'000, .denom = 60 };
+
+} // namespace
+
+auto should_compute_exact_fractional_deadlines() -> void
+{
+    RecordingService svc;
+    sc::FrameScheduler scheduler;
+    auto const& timer = scheduler.add(
+        k60Fps, sc::Readiness { &svc, &RecordingService::dispatch });
+
+    scheduler.start(0);
+
+    EXPECT(sc::deadline_of(timer, 1) == 16'666'666);
+    EXPECT(sc::deadline_of(timer, 2) == 33'333'333);
+    EXPECT(sc::deadline_of(timer, 3) == 50'000'000);
+
+    /* After an hour the deadline must be exact, rather than being
+     * 216'000 * 0.666...ns = 144us early...
+     */
+    EXPECT(sc::deadline_of(timer, 216'000) == 3'600'000'000'000);
+}
+
+auto should_dispatch_on_fixed_timeline() -> void
+{
+    std::uint64_t now = 1'000;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    auto const& timer = scheduler.add(
+        k60Fps, sc::Readiness { &svc, &RecordingService::dispatch });
+
+    scheduler.start(now);
+    EXPECT(scheduler.next_deadline() == 1'000);
+
+    auto const clock = [&] { return now; };
+
+    scheduler.dispatch(clock);
+    EXPECT(svc.dispatched.size() == 1);
+    EXPECT(scheduler.next_deadline() == 1'000 + 16'666'666);
+
+    /* A late dispatch mustn't move subsequent deadlines...
+     */
+    now = 1'000 + 16'666'666 + 3'000'000;
+    scheduler.dispatch(clock);
+    EXPECT(svc.dispatched.size() == 2);
+    EXPECT(timer.lateness == 3'000'000);
+    EXPECT(timer.missed == 0);
+    EXPECT(scheduler.next_deadline() == 1'000 + 33'333'333);
+
+    /* An early wakeup doesn't dispatch...
+     */
+    now = 1'000 + 33'333'000;
+    scheduler.dispatch(clock);
+    EXPECT(svc.dispatched.size() == 2);
+}
+
+auto should_report_missed_deadlines() -> void
+{
+    std::uint64_t now = 0;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    auto const& timer = scheduler.add(
+        k60Fps, sc::Readiness { &svc, &RecordingService::dispatch });
+
+    scheduler.start(now);
+    auto const clock = [&] { return now; };
+    scheduler.dispatch(clock);
+
+    /* Ticks 1, 2 and 3 have passed. Only a single dispatch is
+     * made, for tick 3, and the other two are reported missed...
+     */
+    now = 50'000'100;
+    scheduler.dispatch(clock);
+    EXPECT(svc.dispatched.size() == 2);
+    EXPECT(timer.missed == 2);
+    EXPECT(timer.lateness == 100);
+    EXPECT(timer.tick == 4);
+    EXPECT(scheduler.next_deadline() == 66'666'666);
+
+    EXPECT(scheduler.current_tick().index == 3);
+    EXPECT(scheduler.current_tick().missed == 2);
+    EXPECT(scheduler.current_tick().deadline == 50'000'000);
+}
+
+/* Deadlines are rounded down to whole nanoseconds, so a clock
+ * that lands exactly on one must still dispatch that tick, and
+ * only that tick...
+ */
+auto should_dispatch_exactly_on_rounded_deadlines() -> void
+{
+    std::uint64_t now = 0;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    auto const& timer = scheduler.add(
+        k60Fps, sc::Readiness { &svc, &RecordingService::dispatch });
+
+    scheduler.start(now);
+    auto const clock = [&] { return now; };
+
+    for (std::uint64_t tick = 0; tick < 120; ++tick) {
+        now = *scheduler.next_deadline();
+        EXPECT(now == sc::deadline_of(timer, tick));
+
+        scheduler.dispatch(clock);
+        EXPECT(svc.dispatched.size() == tick + 1);
+        EXPECT(timer.missed == 0);
+        EXPECT(timer.lateness == 0);
+    }
+}
+
+auto should_dispatch_in_deadline_order() -> void
+{
+    std::uint64_t now = 0;
+    std::vector<int> order;
+
+    struct OrderedService final : sc::Service
+    {
+        OrderedService(std::vector<int>& o, int i) noexcept
+            : order { o }
+            , id { i }
+        {
+        }
+
+        static auto dispatch(sc::Service& svc) -> void
+        {
+            auto& self = static_cast<OrderedService&>(svc);
+            self.order.push_back(self.id);
+        }
+
+        std::vector<int>& order;
+        int id;
+
+    protected:
+        auto on_init(sc::ReadinessRegister) -> void override {}
+    };
+
+    OrderedService slow { order, 1 };
+    OrderedService fast { order, 2 };
+
+    sc::FrameScheduler scheduler;
+    scheduler.add(sc::FramePeriod { .num = 30, .denom = 1 },
+                  sc::Readiness { &slow, &OrderedService::dispatch });
+    scheduler.add(sc::FramePeriod { .num = 20, .denom = 1 },
+                  sc::Readiness { &fast, &OrderedService::dispatch });
+
+    scheduler.start(now);
+    auto const clock = [&] { return now; };
+    scheduler.dispatch(clock);
+    EXPECT((order == std::vector<int> { 1, 2 }));
+
+    order.clear();
+    now = 45;
+    scheduler.dispatch(clock);
+    EXPECT((order == std::vector<int> { 2, 1 }));
+}
+
+auto should_wake_early_and_spin_when_pacing() -> void
+{
+    std::uint64_t now = 0;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    scheduler.set_pacing(sc::FramePacing { .spin_threshold = 500 });
+    scheduler.add(sc::FramePeriod { .num = 10'000, .denom = 1 },
+                  sc::Readiness { &svc, &RecordingService::dispatch });
+
+    scheduler.start(now);
+    EXPECT(scheduler.wake_time() == 0);
+
+    auto const clock = [&] { return now; };
+    scheduler.dispatch(clock);
+    EXPECT(scheduler.next_deadline() == 10'000);
+    EXPECT(scheduler.wake_time() == 9'500);
+
+    /* Each read of the clock advances it, so the spin eventually
+     * reaches the deadline...
+     */
+    now = 9'500;
+    scheduler.dispatch([&] { return now += 100; });
+    EXPECT(svc.dispatched.size() == 2);
+    EXPECT(svc.dispatched.back() == 10'000);
+}
+
+auto should_start_timeline_at_an_earlier_origin() -> void
+{
+    std::uint64_t now = 10'000'000;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    scheduler.add(k60Fps,
+                  sc::Readiness { &svc, &RecordingService::dispatch });
+
+    /* Tick zero is already due, but the ticks that follow it are
+     * still on the origin's timeline...
+     */
+    scheduler.start(now, 1'000);
+    EXPECT(scheduler.next_deadline() == 1'000);
+
+    auto const clock = [&] { return now; };
+    scheduler.dispatch(clock);
+    EXPECT(svc.dispatched.size() == 1);
+    EXPECT(scheduler.current_tick().deadline == 1'000);
+    EXPECT(scheduler.current_tick().missed == 0);
+    EXPECT(scheduler.next_deadline() == 1'000 + 16'666'666);
+}
+
+auto should_join_the_shared_timeline_once_started() -> void
+{
+    std::uint64_t now = 10'000'000;
+    RecordingService svc;
+    svc.clock = &now;
+
+    sc::FrameScheduler scheduler;
+    scheduler.start(now, 1'000);
+
+    /* A timer added later isn't given a timeline of its own, starting
+     * at the time it was added, but joins the origin's at the next
+     * tick...
+     */
+    now = 20'000'000;
+    scheduler.dispatch([&] { return now; });
+    auto const& timer = scheduler.add(
+        k60Fps, sc::Readiness { &svc, &RecordingService::dispatch });
+
+    EXPECT(timer.origin == 1'000);
+    EXPECT(timer.tick == 2);
+    EXPECT(scheduler.next_deadline() == 1'000 + 33'333'333);
+
+    now = 1'000 + 33'333'333;
+    scheduler.dispatch([&] { return now; });
+    EXPECT(svc.dispatched.size() == 1);
+    EXPECT(scheduler.current_tick().index == 2);
+    EXPECT(scheduler.current_tick().missed == 0);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_compute_exact_fractional_deadlines),
+                          TEST(should_dispatch_on_fixed_timeline),
+                          TEST(should_report_missed_deadlines),
+                          TEST(should_dispatch_exactly_on_rounded_deadlines),
+                          TEST(should_dispatch_in_deadline_order),
+                          TEST(should_start_timeline_at_an_earlier_origin),
+                          TEST(should_join_the_shared_timeline_once_started),
+                          TEST(should_wake_early_and_spin_when_pacing) });
+}
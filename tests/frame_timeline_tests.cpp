@@ -0,0 +1,92 @@
+#include "testing.hpp"
+#include "utils/frame_timeline.hpp"
+
+auto should_keep_consecutive_timestamps_when_dropping() -> void
+{
+    sc::FrameTimeline timeline { sc::OverrunPolicy::drop };
+
+    EXPECT(timeline.step(0, 0).pts == 0);
+    auto const step = timeline.step(3, 2);
+    EXPECT(step.pts == 1);
+    EXPECT(step.duplicates == 0);
+    EXPECT(timeline.step(4, 0).pts == 2);
+
+    EXPECT(timeline.counts().dropped == 2);
+    EXPECT(timeline.counts().duplicated == 0);
+}
+
+auto should_stamp_each_frame_with_its_tick() -> void
+{
+    sc::FrameTimeline timeline { sc::OverrunPolicy::variable, 10 };
+
+    EXPECT(timeline.step(0, 0).pts == 0);
+    auto const step = timeline.step(3, 2);
+    EXPECT(step.pts == 3);
+    EXPECT(step.duplicates == 0);
+    EXPECT(timeline.step(4, 0).pts == 4);
+
+    EXPECT(timeline.counts().dropped == 2);
+    EXPECT(timeline.counts().duplicated == 0);
+}
+
+auto should_duplicate_missed_frames() -> void
+{
+    sc::FrameTimeline timeline { sc::OverrunPolicy::duplicate, 10 };
+
+    EXPECT(timeline.step(0, 0).pts == 0);
+    auto const step = timeline.step(3, 2);
+    EXPECT(step.first_duplicate == 1);
+    EXPECT(step.duplicates == 2);
+    EXPECT(step.pts == 3);
+
+    EXPECT(timeline.counts().dropped == 0);
+    EXPECT(timeline.counts().duplicated == 2);
+}
+
+auto should_limit_duplicates() -> void
+{
+    sc::FrameTimeline timeline { sc::OverrunPolicy::duplicate, 2 };
+
+    EXPECT(timeline.step(0, 0).pts == 0);
+
+    /* The first two missed ticks are filled, and the remaining
+     * three are dropped...
+     */
+    auto const step = timeline.step(6, 5);
+    EXPECT(step.first_duplicate == 1);
+    EXPECT(step.duplicates == 2);
+    EXPECT(step.pts == 6);
+
+    EXPECT(timeline.counts().dropped == 3);
+    EXPECT(timeline.counts().duplicated == 2);
+}
+
+auto should_not_duplicate_before_the_first_frame() -> void
+{
+    sc::FrameTimeline timeline { sc::OverrunPolicy::duplicate, 10 };
+
+    auto const step = timeline.step(2, 2);
+    EXPECT(step.duplicates == 0);
+    EXPECT(step.pts == 2);
+    EXPECT(timeline.counts().dropped == 2);
+}
+
+auto should_parse_overrun_policies() -> void
+{
+    EXPECT(sc::parse_overrun_policy("drop") == sc::OverrunPolicy::drop);
+    EXPECT(sc::parse_overrun_policy("duplicate") ==
+           sc::OverrunPolicy::duplicate);
+    EXPECT(sc::parse_overrun_policy("vfr") == sc::OverrunPolicy::variable);
+    EXPECT(!sc::parse_overrun_policy("catch-up"));
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_keep_consecutive_timestamps_when_dropping),
+          TEST(should_stamp_each_frame_with_its_tick),
+          TEST(should_duplicate_missed_frames),
+          TEST(should_limit_duplicates),
+          TEST(should_not_duplicate_before_the_first_frame),
+          TEST(should_parse_overrun_policies) });
+}
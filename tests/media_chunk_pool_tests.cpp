@@ -0,0 +1,125 @@
+#include "av/frame.hpp"
+#include "av/media_chunk.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace
+{
+
+auto take_all(sc::MediaChunkPool& pool) -> std::vector<sc::MediaChunk*>
+{
+    std::vector<sc::MediaChunk*> chunks;
+    while (auto* chunk = pool.get())
+        chunks.push_back(chunk);
+
+    return chunks;
+}
+
+} // namespace
+
+auto should_run_out_of_chunks() -> void
+{
+    auto pool = sc::MediaChunkPool::create(
+        sc::SampleFormat::float_planar, 2, 960, 4);
+
+    auto chunks = take_all(*pool);
+    EXPECT(chunks.size() == 4);
+    EXPECT(pool->get() == nullptr);
+
+    pool->put(chunks.back());
+    chunks.back()->sample_count = 960;
+    auto* chunk = pool->get();
+    EXPECT(chunk == chunks.back());
+    EXPECT(chunk->sample_count == 0);
+
+    for (auto* c : chunks)
+        pool->put(c);
+}
+
+auto should_have_a_plane_for_each_channel() -> void
+{
+    auto planar = sc::MediaChunkPool::create(
+        sc::SampleFormat::float_planar, 2, 960, 1);
+    auto interleaved = sc::MediaChunkPool::create(
+        sc::SampleFormat::s16_interleaved, 2, 960, 1);
+
+    sc::MediaChunkPool::ItemPtr planar_chunk { planar->get() };
+    sc::MediaChunkPool::ItemPtr interleaved_chunk { interleaved->get() };
+
+    auto const planes = planar_chunk->planes();
+    EXPECT(planes.size() == 2);
+    EXPECT(planes[1] - planes[0] >= 960 * 4);
+    EXPECT(interleaved_chunk->planes().size() == 1);
+}
+
+auto should_return_chunks_once_frames_are_released() -> void
+{
+    auto pool =
+        sc::MediaChunkPool::create(sc::SampleFormat::float_planar, 2, 960, 1);
+    sc::FramePtr frame { av_frame_alloc() };
+
+    sc::MediaChunkPool::ItemPtr chunk { pool->get() };
+    auto* const samples = chunk->planes()[0];
+    sc::MediaChunkPool::attach(std::move(chunk), *frame);
+
+    EXPECT(frame->data[0] == samples);
+    EXPECT(frame->buf[0] != nullptr);
+    EXPECT(pool->get() == nullptr);
+
+    av_frame_unref(frame.get());
+    auto* returned = pool->get();
+    EXPECT(returned != nullptr);
+    pool->put(returned);
+}
+
+auto should_outlive_its_owner_while_referenced() -> void
+{
+    auto pool =
+        sc::MediaChunkPool::create(sc::SampleFormat::s16_interleaved, 2, 64, 2);
+    sc::FramePtr frame { av_frame_alloc() };
+
+    sc::MediaChunkPool::attach(sc::MediaChunkPool::ItemPtr { pool->get() },
+                               *frame);
+
+    std::weak_ptr<sc::MediaChunkPool> weak = pool;
+    pool.reset();
+    EXPECT(!weak.expired());
+
+    frame->data[0][0] = 1;
+    av_frame_unref(frame.get());
+    EXPECT(weak.expired());
+}
+
+auto should_take_back_chunks_from_other_threads() -> void
+{
+    auto pool = sc::MediaChunkPool::create(
+        sc::SampleFormat::float_planar, 2, 960, 4);
+
+    auto chunks = take_all(*pool);
+    std::thread consumer { [&] {
+        for (auto* chunk : chunks)
+            pool->put(chunk);
+    } };
+    consumer.join();
+
+    auto again = take_all(*pool);
+    EXPECT(again.size() == 4);
+    for (auto* chunk : again)
+        pool->put(chunk);
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_run_out_of_chunks),
+          TEST(should_have_a_plane_for_each_channel),
+          TEST(should_take_back_chunks_from_other_threads),
+          TEST(should_return_chunks_once_frames_are_released),
+          TEST(should_outlive_its_owner_while_referenced) });
+}
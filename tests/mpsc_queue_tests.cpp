@@ -0,0 +1,141 @@
+#include "testing.hpp"
+#include "utils/intrusive_list.hpp"
+#include "utils/mpsc_queue.hpp"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Item : sc::ListItemBase
+{
+    std::size_t producer { 0 };
+    std::size_t value { 0 };
+};
+
+} // namespace
+
+auto should_pop_items_in_order() -> void
+{
+    Item a, b, c;
+    a.value = 1;
+    b.value = 2;
+    c.value = 3;
+
+    sc::MpscQueue<Item> queue;
+    EXPECT(queue.empty());
+    queue.push(&a);
+    queue.push(&b);
+    queue.push(&c);
+    EXPECT(!queue.empty());
+
+    sc::IntrusiveList<Item> list;
+    queue.pop_all(list);
+    EXPECT(queue.empty());
+
+    auto it = list.begin();
+    EXPECT((it++)->value == 1);
+    EXPECT((it++)->value == 2);
+    EXPECT((it++)->value == 3);
+    EXPECT(it == list.end());
+}
+
+auto should_report_first_push_of_each_batch() -> void
+{
+    Item a, b, c;
+    sc::MpscQueue<Item> queue;
+    sc::IntrusiveList<Item> list;
+
+    EXPECT(queue.push(&a));
+    EXPECT(!queue.push(&b));
+
+    queue.pop_all(list);
+    EXPECT(queue.push(&c));
+
+    queue.pop_all(list);
+    EXPECT(std::distance(list.begin(), list.end()) == 3);
+}
+
+auto should_append_to_existing_items() -> void
+{
+    Item a, b;
+    a.value = 1;
+    b.value = 2;
+
+    sc::IntrusiveList<Item> list;
+    list.push_back(&a);
+
+    sc::MpscQueue<Item> queue;
+    queue.push(&b);
+    queue.pop_all(list);
+
+    EXPECT(list.front().value == 1);
+    EXPECT(list.back().value == 2);
+}
+
+/* Every item pushed by each producer must be popped exactly once,
+ * and in the order that producer pushed them, with a wakeup for
+ * every batch...
+ */
+auto should_hand_off_items_from_many_producers() -> void
+{
+    constexpr std::size_t kNumProducers = 4;
+    constexpr std::size_t kItemsPerProducer = 50'000;
+
+    std::vector<Item> items(kNumProducers * kItemsPerProducer);
+    sc::MpscQueue<Item> queue;
+    std::atomic<std::size_t> wakeups { 0 };
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < kNumProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (std::size_t i = 0; i < kItemsPerProducer; ++i) {
+                auto& item = items[p * kItemsPerProducer + i];
+                item.producer = p;
+                item.value = i;
+                if (queue.push(&item))
+                    wakeups.fetch_add(1, std::memory_order_release);
+            }
+        });
+    }
+
+    std::vector<std::size_t> next(kNumProducers, 0);
+    std::size_t received = 0;
+    std::size_t batches = 0;
+    bool in_order = true;
+    while (received < items.size()) {
+        if (!wakeups.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        wakeups.fetch_sub(1, std::memory_order_acquire);
+        sc::IntrusiveList<Item> list;
+        queue.pop_all(list);
+        batches += 1;
+
+        for (auto const& item : list) {
+            in_order = in_order && item.value == next[item.producer];
+            next[item.producer] = item.value + 1;
+            received += 1;
+        }
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+
+    EXPECT(in_order);
+    EXPECT(queue.empty());
+    EXPECT(received == items.size());
+    EXPECT(batches <= items.size());
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_pop_items_in_order),
+                          TEST(should_report_first_push_of_each_batch),
+                          TEST(should_append_to_existing_items),
+                          TEST(should_hand_off_items_from_many_producers) });
+}
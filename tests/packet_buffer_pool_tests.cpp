@@ -0,0 +1,86 @@
+#include "av/packet.hpp"
+#include "testing.hpp"
+#include <cstddef>
+
+namespace
+{
+
+struct BufferRefGuard
+{
+    ~BufferRefGuard() { av_buffer_unref(&buffer); }
+
+    AVBufferRef* buffer;
+};
+
+} // namespace
+
+auto should_round_buffers_up_to_a_size_class() -> void
+{
+    sc::PacketBufferPool pool;
+
+    BufferRefGuard small { pool.get(1) };
+    BufferRefGuard medium { pool.get(5'000) };
+    BufferRefGuard exact { pool.get(16'384) };
+
+    EXPECT(small.buffer && small.buffer->size == 4'096);
+    EXPECT(medium.buffer && medium.buffer->size == 8'192);
+    EXPECT(exact.buffer && exact.buffer->size == 16'384);
+}
+
+auto should_reuse_released_buffers() -> void
+{
+    sc::PacketBufferPool pool;
+
+    auto* buffer = pool.get(10'000);
+    EXPECT(buffer);
+    auto const* data = buffer->data;
+    av_buffer_unref(&buffer);
+
+    BufferRefGuard reused { pool.get(12'000) };
+    EXPECT(reused.buffer && reused.buffer->data == data);
+}
+
+auto should_keep_buffers_until_every_reference_is_released() -> void
+{
+    sc::PacketBufferPool pool;
+
+    sc::PacketPtr packet { av_packet_alloc() };
+    sc::PacketPtr reference { av_packet_alloc() };
+    packet->buf = pool.get(1'000);
+    EXPECT(packet->buf);
+    packet->data = packet->buf->data;
+    packet->size = 1'000;
+
+    EXPECT(av_packet_ref(reference.get(), packet.get()) == 0);
+    EXPECT(reference->data == packet->data);
+
+    auto const* data = packet->data;
+    av_packet_unref(packet.get());
+
+    {
+        BufferRefGuard other { pool.get(1'000) };
+        EXPECT(other.buffer && other.buffer->data != data);
+    }
+
+    av_packet_unref(reference.get());
+    BufferRefGuard reused { pool.get(1'000) };
+    EXPECT(reused.buffer && reused.buffer->data == data);
+}
+
+auto should_allocate_the_largest_buffers_on_their_own() -> void
+{
+    sc::PacketBufferPool pool;
+
+    std::size_t const size = (std::size_t { 1 } << 26) + 1;
+    BufferRefGuard large { pool.get(size) };
+    EXPECT(large.buffer && large.buffer->size == size);
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_round_buffers_up_to_a_size_class),
+          TEST(should_reuse_released_buffers),
+          TEST(should_keep_buffers_until_every_reference_is_released),
+          TEST(should_allocate_the_largest_buffers_on_their_own) });
+}
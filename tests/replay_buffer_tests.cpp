@@ -0,0 +1,170 @@
+#include "services/replay_buffer.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+
+namespace
+{
+
+AVRational constexpr kVideoTimeBase { 1, 30 };
+AVRational constexpr kAudioTimeBase { 1, 48'000 };
+std::uint64_t constexpr kNsPerSecond = 1'000'000'000;
+
+struct Streams
+{
+    Streams()
+    {
+        video_params.codec_type = AVMEDIA_TYPE_VIDEO;
+        audio_params.codec_type = AVMEDIA_TYPE_AUDIO;
+        video.codecpar = &video_params;
+        video.index = 0;
+        audio.codecpar = &audio_params;
+        audio.index = 1;
+    }
+
+    AVCodecParameters video_params {};
+    AVCodecParameters audio_params {};
+    AVStream video {};
+    AVStream audio {};
+};
+
+/* Pushes a frame of 30fps video, with a keyframe every second...
+ */
+auto push_video(sc::ReplayBuffer& buffer,
+                Streams& streams,
+                std::int64_t frame,
+                int size = 1'000) -> void
+{
+    auto packet = testing::make_packet(frame, size, frame % 30 == 0);
+    buffer.push(*packet, streams.video, kVideoTimeBase);
+}
+
+auto push_audio(sc::ReplayBuffer& buffer,
+                Streams& streams,
+                std::int64_t sample) -> void
+{
+    auto packet = testing::make_packet(sample, 100, true);
+    buffer.push(*packet, streams.audio, kAudioTimeBase);
+}
+
+} // namespace
+
+auto should_start_with_a_keyframe() -> void
+{
+    Streams streams;
+    sc::ReplayBuffer buffer { { .duration = 10 * kNsPerSecond,
+                                .max_bytes = 1'024 * 1'024 } };
+
+    push_audio(buffer, streams, 0);
+    push_video(buffer, streams, 29);
+    EXPECT(buffer.size() == 0);
+
+    push_video(buffer, streams, 30);
+    push_audio(buffer, streams, 48'000);
+    EXPECT(buffer.size() == 2);
+
+    auto const clip = buffer.snapshot();
+    EXPECT(clip.front().stream == &streams.video);
+    EXPECT(clip.front().packet->flags & AV_PKT_FLAG_KEY);
+}
+
+auto should_keep_the_requested_duration() -> void
+{
+    Streams streams;
+    sc::ReplayBuffer buffer { { .duration = 3 * kNsPerSecond,
+                                .max_bytes = 1'024 * 1'024 } };
+
+    for (std::int64_t frame = 0; frame < 300; ++frame) {
+        push_video(buffer, streams, frame);
+        push_audio(buffer, streams, frame * 1'600);
+    }
+
+    /* Whole GOPs are dropped, so between the requested duration and
+     * one GOP longer is kept...
+     */
+    EXPECT(buffer.duration() >= 3 * kNsPerSecond);
+    EXPECT(buffer.duration() < 4 * kNsPerSecond);
+
+    auto const clip = buffer.snapshot();
+    EXPECT(clip.size() == buffer.size());
+    EXPECT(clip.front().packet->flags & AV_PKT_FLAG_KEY);
+    EXPECT(clip.front().packet->pts % 30 == 0);
+}
+
+auto should_never_exceed_the_byte_limit() -> void
+{
+    Streams streams;
+    sc::ReplayBuffer buffer { { .duration = 60 * kNsPerSecond,
+                                .max_bytes = 50'000 } };
+
+    for (std::int64_t frame = 0; frame < 300; ++frame) {
+        push_video(buffer, streams, frame);
+        EXPECT(buffer.size_bytes() <= 50'000);
+    }
+
+    EXPECT(buffer.size_bytes() > 0);
+    EXPECT(buffer.snapshot().front().packet->flags & AV_PKT_FLAG_KEY);
+}
+
+auto should_wait_for_a_keyframe_if_a_gop_does_not_fit() -> void
+{
+    Streams streams;
+    sc::ReplayBuffer buffer { { .duration = 60 * kNsPerSecond,
+                                .max_bytes = 10'000 } };
+
+    for (std::int64_t frame = 0; frame < 11; ++frame)
+        push_video(buffer, streams, frame);
+
+    /* The GOP outgrew the limit, so everything was dropped, and
+     * nothing more is kept until the next keyframe...
+     */
+    EXPECT(buffer.size() == 0);
+    EXPECT(buffer.size_bytes() == 0);
+
+    push_video(buffer, streams, 11);
+    EXPECT(buffer.size() == 0);
+
+    push_video(buffer, streams, 30);
+    EXPECT(buffer.size() == 1);
+}
+
+auto should_not_copy_packet_data() -> void
+{
+    Streams streams;
+    sc::ReplayBuffer buffer { { .duration = 10 * kNsPerSecond,
+                                .max_bytes = 1'024 * 1'024 } };
+
+    auto packet = testing::make_packet(0, 1'000, true);
+    auto const* data = packet->data;
+    buffer.push(*packet, streams.video, kVideoTimeBase);
+
+    EXPECT(packet->data == nullptr);
+
+    auto const clip = buffer.snapshot();
+    EXPECT(clip.size() == 1);
+    EXPECT(clip.front().packet->data == data);
+    EXPECT(clip.front().packet->size == 1'000);
+}
+
+auto should_name_clips_after_the_output_file() -> void
+{
+    ::setenv("TZ", "UTC", 1);
+    ::tzset();
+
+    EXPECT(sc::replay_clip_path("/tmp/out/video.mp4", 0) ==
+           "/tmp/out/video-19700101-000000.mp4");
+    EXPECT(sc::replay_clip_path("video.mkv", 86'400 + 3'661) ==
+           "video-19700102-010101.mkv");
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_start_with_a_keyframe),
+          TEST(should_keep_the_requested_duration),
+          TEST(should_never_exceed_the_byte_limit),
+          TEST(should_wait_for_a_keyframe_if_a_gop_does_not_fit),
+          TEST(should_not_copy_packet_data),
+          TEST(should_name_clips_after_the_output_file) });
+}
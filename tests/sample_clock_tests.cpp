@@ -0,0 +1,87 @@
+#include "testing.hpp"
+#include "utils/sample_clock.hpp"
+#include <cstdint>
+
+namespace
+{
+
+std::uint64_t constexpr kOrigin = 5'000'000'000;
+std::uint32_t constexpr kSampleRate = 48'000;
+std::uint64_t constexpr kMaxDrift = 2'400;
+
+/* The time, after the origin, that `samples` samples take...
+ */
+auto after(std::uint64_t samples) -> std::uint64_t
+{
+    return kOrigin + (samples * 1'000'000'000 + kSampleRate - 1) / kSampleRate;
+}
+
+} // namespace
+
+auto should_start_where_the_clock_says() -> void
+{
+    sc::SampleClock clock { kOrigin, kSampleRate, kMaxDrift };
+
+    auto const step = clock.step(after(10'000), 1'024);
+    EXPECT(step.position == 10'000 - 1'024);
+    EXPECT(step.skip == 0);
+    EXPECT(!step.resynced);
+    EXPECT(clock.position() == 10'000);
+}
+
+auto should_count_samples_through_jitter() -> void
+{
+    sc::SampleClock clock { kOrigin, kSampleRate, kMaxDrift };
+    static_cast<void>(clock.step(after(1'024), 1'024));
+
+    /* Each quantum arrives up to 20ms early, or late...
+     */
+    for (std::uint64_t i = 2; i < 100; ++i) {
+        auto const jitter = (i % 2 ? 960 : -960);
+        auto const step =
+            clock.step(after(i * 1'024 + static_cast<std::uint64_t>(jitter)),
+                       1'024);
+        EXPECT(step.position == (i - 1) * 1'024);
+        EXPECT(!step.resynced);
+    }
+}
+
+auto should_leave_a_gap_when_behind() -> void
+{
+    sc::SampleClock clock { kOrigin, kSampleRate, kMaxDrift };
+    static_cast<void>(clock.step(after(1'024), 1'024));
+
+    /* Nothing arrives for a second...
+     */
+    auto const step = clock.step(after(49'024 + 1'024), 1'024);
+    EXPECT(step.resynced);
+    EXPECT(step.skip == 0);
+    EXPECT(step.position == 49'024);
+    EXPECT(clock.position() == 50'048);
+}
+
+auto should_skip_samples_when_ahead() -> void
+{
+    sc::SampleClock clock { kOrigin, kSampleRate, kMaxDrift };
+    static_cast<void>(clock.step(after(1'024), 1'024));
+
+    /* Four quanta arrive at once, so the last is more than the drift
+     * allowed ahead...
+     */
+    for (auto i = 0; i < 3; ++i)
+        EXPECT(!clock.step(after(2'048), 1'024).resynced);
+
+    auto const step = clock.step(after(2'048), 1'024);
+    EXPECT(step.resynced);
+    EXPECT(step.position == 4'096);
+    EXPECT(step.skip == 1'024);
+    EXPECT(clock.position() == 4'096);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_start_where_the_clock_says),
+                          TEST(should_count_samples_through_jitter),
+                          TEST(should_leave_a_gap_when_behind),
+                          TEST(should_skip_samples_when_ahead) });
+}
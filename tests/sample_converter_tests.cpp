@@ -0,0 +1,273 @@
+#include "av/sample_converter.hpp"
+#include "av/sample_kernels.hpp"
+#include "error.hpp"
+#include "testing.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/* Odd lengths leave a tail for the SIMD kernels to finish off...
+ */
+std::array<std::size_t, 6> constexpr kLengths { 0, 1, 7, 17, 67, 1001 };
+
+auto random_floats(std::size_t n) -> std::vector<float>
+{
+    std::mt19937 gen { 42 };
+    std::uniform_real_distribution<float> dist { -1.5f, 1.5f };
+    std::vector<float> values(n);
+    for (auto& v : values)
+        v = dist(gen);
+
+    /* Exactly full scale, and halfway between two integers...
+     */
+    if (n > 3) {
+        values[0] = 1.0f;
+        values[1] = -1.0f;
+        values[2] = 0.5f / 32768.0f;
+    }
+
+    return values;
+}
+
+template <typename T>
+auto random_integers(std::size_t n) -> std::vector<T>
+{
+    std::mt19937 gen { 42 };
+    std::uniform_int_distribution<T> dist { std::numeric_limits<T>::min(),
+                                            std::numeric_limits<T>::max() };
+    std::vector<T> values(n);
+    for (auto& v : values)
+        v = dist(gen);
+
+    return values;
+}
+
+template <typename T>
+auto same_bytes(std::vector<T> const& lhs, std::vector<T> const& rhs) -> bool
+{
+    if (lhs.size() != rhs.size())
+        return false;
+
+    return lhs.empty() ||
+           std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T)) == 0;
+}
+
+auto planes_of(std::vector<float>& data, std::size_t channels, std::size_t n)
+    -> std::vector<float*>
+{
+    std::vector<float*> planes;
+    for (std::size_t c = 0; c < channels; ++c)
+        planes.push_back(data.data() + c * n);
+
+    return planes;
+}
+
+} // namespace
+
+auto should_match_scalar_kernels() -> void
+{
+    auto const& scalar = sc::scalar_sample_kernels();
+    for (auto const* kernels : sc::available_sample_kernels()) {
+        for (auto n : kLengths) {
+            auto const floats = random_floats(n);
+            auto const s16 = random_integers<std::int16_t>(n);
+            auto const s32 = random_integers<std::int32_t>(n);
+
+            std::vector<std::int16_t> s16_out(n), s16_expected(n);
+            kernels->float_to_s16(floats.data(), s16_out.data(), n);
+            scalar.float_to_s16(floats.data(), s16_expected.data(), n);
+            EXPECT(same_bytes(s16_out, s16_expected));
+
+            std::vector<std::int32_t> s32_out(n), s32_expected(n);
+            kernels->float_to_s32(floats.data(), s32_out.data(), n);
+            scalar.float_to_s32(floats.data(), s32_expected.data(), n);
+            EXPECT(same_bytes(s32_out, s32_expected));
+
+            std::vector<double> f64(n), f64_expected(n);
+            kernels->float_to_double(floats.data(), f64.data(), n);
+            scalar.float_to_double(floats.data(), f64_expected.data(), n);
+            EXPECT(same_bytes(f64, f64_expected));
+
+            std::vector<float> out(n), expected(n);
+            kernels->s16_to_float(s16.data(), out.data(), n);
+            scalar.s16_to_float(s16.data(), expected.data(), n);
+            EXPECT(same_bytes(out, expected));
+
+            kernels->s32_to_float(s32.data(), out.data(), n);
+            scalar.s32_to_float(s32.data(), expected.data(), n);
+            EXPECT(same_bytes(out, expected));
+
+            kernels->double_to_float(f64.data(), out.data(), n);
+            scalar.double_to_float(f64.data(), expected.data(), n);
+            EXPECT(same_bytes(out, expected));
+
+            kernels->mix(floats.data(), 0.7f, out.data(), n);
+            scalar.mix(floats.data(), 0.7f, expected.data(), n);
+            EXPECT(same_bytes(out, expected));
+        }
+    }
+}
+
+auto should_match_scalar_interleaving() -> void
+{
+    auto const& scalar = sc::scalar_sample_kernels();
+    for (auto const* kernels : sc::available_sample_kernels()) {
+        for (std::size_t channels : { 1, 2, 3, 6 }) {
+            for (auto n : kLengths) {
+                auto const interleaved = random_floats(n * channels);
+
+                std::vector<float> planar(n * channels);
+                std::vector<float> expected(n * channels);
+                auto const planes = planes_of(planar, channels, n);
+                auto const expected_planes = planes_of(expected, channels, n);
+                kernels->deinterleave(interleaved.data(), planes, n);
+                scalar.deinterleave(interleaved.data(), expected_planes, n);
+                EXPECT(same_bytes(planar, expected));
+
+                std::vector<float const*> const_planes { planes.begin(),
+                                                         planes.end() };
+                std::vector<float> round_trip(n * channels);
+                kernels->interleave(const_planes, round_trip.data(), n);
+                EXPECT(same_bytes(round_trip, interleaved));
+            }
+        }
+    }
+}
+
+auto should_clamp_out_of_range_samples() -> void
+{
+    std::array<float, 4> const floats { 1.5f, -1.5f, 1.0f, -1.0f };
+    for (auto const* kernels : sc::available_sample_kernels()) {
+        std::array<std::int16_t, 4> s16 {};
+        kernels->float_to_s16(floats.data(), s16.data(), s16.size());
+        EXPECT(s16[0] == 32767);
+        EXPECT(s16[1] == -32768);
+        EXPECT(s16[2] == 32767);
+        EXPECT(s16[3] == -32768);
+
+        std::array<std::int32_t, 4> s32 {};
+        kernels->float_to_s32(floats.data(), s32.data(), s32.size());
+        EXPECT(s32[0] > 2147483000);
+        EXPECT(s32[1] == std::numeric_limits<std::int32_t>::min());
+        EXPECT(s32[2] == s32[0]);
+        EXPECT(s32[3] == s32[1]);
+    }
+}
+
+auto should_round_trip_s16_through_planar_float() -> void
+{
+    for (std::size_t channels : { 1, 2, 3, 6 }) {
+        for (auto n : kLengths) {
+            auto const source = random_integers<std::int16_t>(n * channels);
+            std::vector<float> planar(n * channels);
+            std::vector<std::int16_t> result(n * channels);
+
+            std::vector<std::uint8_t*> planes;
+            for (std::size_t c = 0; c < channels; ++c)
+                planes.push_back(
+                    reinterpret_cast<std::uint8_t*>(planar.data() + c * n));
+
+            sc::SampleConverter to_planar { sc::SampleFormat::s16_interleaved,
+                                            sc::SampleFormat::float_planar,
+                                            channels };
+            sc::SampleConverter to_s16 { sc::SampleFormat::float_planar,
+                                         sc::SampleFormat::s16_interleaved,
+                                         channels };
+
+            std::array<std::uint8_t const*, 1> const from {
+                reinterpret_cast<std::uint8_t const*>(source.data())
+            };
+            std::vector<std::uint8_t const*> const planar_from {
+                planes.begin(), planes.end()
+            };
+            std::array<std::uint8_t*, 1> const to {
+                reinterpret_cast<std::uint8_t*>(result.data())
+            };
+
+            to_planar.convert(from, 0, planes, 0, n);
+            to_s16.convert(planar_from, 0, to, 0, n);
+            EXPECT(same_bytes(result, source));
+        }
+    }
+}
+
+auto should_convert_at_offsets() -> void
+{
+    std::size_t constexpr kChannels = 2;
+    std::size_t constexpr kSamples = 600;
+    auto const source = random_floats(kSamples * kChannels);
+    std::vector<double> expected(kSamples * kChannels);
+    std::vector<double> result(kSamples * kChannels);
+
+    /* Interleaved floats to planar doubles, in two uneven pieces...
+     */
+    sc::SampleConverter converter { sc::SampleFormat::float_interleaved,
+                                    sc::SampleFormat::double_planar,
+                                    kChannels };
+    std::array<std::uint8_t const*, 1> const from {
+        reinterpret_cast<std::uint8_t const*>(source.data())
+    };
+    std::array<std::uint8_t*, kChannels> const to {
+        reinterpret_cast<std::uint8_t*>(result.data()),
+        reinterpret_cast<std::uint8_t*>(result.data() + kSamples)
+    };
+    converter.convert(from, 0, to, 0, 333);
+    converter.convert(from, 333, to, 333, kSamples - 333);
+
+    for (std::size_t i = 0; i < kSamples; ++i) {
+        expected[i] = source[i * kChannels];
+        expected[kSamples + i] = source[i * kChannels + 1];
+    }
+    EXPECT(same_bytes(result, expected));
+}
+
+auto should_copy_matching_formats() -> void
+{
+    auto const source = random_integers<std::int16_t>(20);
+    std::vector<std::int16_t> result(24);
+
+    sc::SampleConverter converter { sc::SampleFormat::s16_interleaved,
+                                    sc::SampleFormat::s16_interleaved,
+                                    2 };
+    std::array<std::uint8_t const*, 1> const from {
+        reinterpret_cast<std::uint8_t const*>(source.data())
+    };
+    std::array<std::uint8_t*, 1> const to { reinterpret_cast<std::uint8_t*>(
+        result.data()) };
+    converter.convert(from, 0, to, 2, 10);
+
+    EXPECT(result[0] == 0);
+    EXPECT(std::memcmp(result.data() + 4, source.data(), 40) == 0);
+}
+
+auto should_reject_unsupported_formats() -> void
+{
+    auto threw = false;
+    try {
+        sc::SampleConverter converter { sc::SampleFormat::float_planar,
+                                        sc::SampleFormat::s64_planar,
+                                        2 };
+    }
+    catch (sc::CodecError const&) {
+        threw = true;
+    }
+
+    EXPECT(threw);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_match_scalar_kernels),
+                          TEST(should_match_scalar_interleaving),
+                          TEST(should_clamp_out_of_range_samples),
+                          TEST(should_round_trip_s16_through_planar_float),
+                          TEST(should_convert_at_offsets),
+                          TEST(should_copy_matching_formats),
+                          TEST(should_reject_unsupported_formats) });
+}
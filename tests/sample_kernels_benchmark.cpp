@@ -0,0 +1,153 @@
+#include "av/sample_converter.hpp"
+#include "av/sample_kernels.hpp"
+#include "testing.hpp"
+#include "utils/elapsed.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+/* A little over a second of 48kHz stereo, converted enough times to
+ * smooth out the timer...
+ */
+std::size_t constexpr kSamples = 48'000 * 2 + 7;
+std::size_t constexpr kIterations = 200;
+
+/* Keeps the compiler from dropping conversions whose results are
+ * never read...
+ */
+auto clobber(void const* p) noexcept -> void
+{
+    asm volatile("" : : "r"(p) : "memory");
+}
+
+template <typename F>
+auto report(char const* kernels, char const* routine, F&& f) -> double
+{
+    f();
+
+    sc::Elapsed elapsed;
+    for (std::size_t i = 0; i < kIterations; ++i)
+        f();
+
+    auto const ns = static_cast<double>(elapsed.nanosecond_value());
+    auto const samples_per_us = 1'000.0 * kSamples * kIterations / ns;
+    std::printf("%-8s %-22s %10.1f samples/us\n",
+                kernels,
+                routine,
+                samples_per_us);
+    return samples_per_us;
+}
+
+} // namespace
+
+auto benchmark_kernels() -> void
+{
+    std::vector<float> floats(kSamples, 0.25f);
+    std::vector<float> more_floats(kSamples);
+    std::vector<std::int16_t> s16(kSamples, 1234);
+    std::vector<std::int32_t> s32(kSamples, 123'456);
+    std::vector<double> f64(kSamples, 0.5);
+
+    auto const n = kSamples;
+    auto const half = kSamples / 2;
+    std::array<float const*, 2> const planes { floats.data(),
+                                               floats.data() + half };
+    std::array<float*, 2> const out_planes { more_floats.data(),
+                                             more_floats.data() + half };
+
+    for (auto const* k : sc::available_sample_kernels()) {
+        auto const* name = k->name;
+        report(name, "s16_to_float", [&] {
+            k->s16_to_float(s16.data(), more_floats.data(), n);
+            clobber(more_floats.data());
+        });
+        report(name, "s32_to_float", [&] {
+            k->s32_to_float(s32.data(), more_floats.data(), n);
+            clobber(more_floats.data());
+        });
+        report(name, "double_to_float", [&] {
+            k->double_to_float(f64.data(), more_floats.data(), n);
+            clobber(more_floats.data());
+        });
+        report(name, "float_to_s16", [&] {
+            k->float_to_s16(floats.data(), s16.data(), n);
+            clobber(s16.data());
+        });
+        report(name, "float_to_s32", [&] {
+            k->float_to_s32(floats.data(), s32.data(), n);
+            clobber(s32.data());
+        });
+        report(name, "float_to_double", [&] {
+            k->float_to_double(floats.data(), f64.data(), n);
+            clobber(f64.data());
+        });
+        report(name, "interleave (2ch)", [&] {
+            k->interleave(planes, more_floats.data(), half);
+            clobber(more_floats.data());
+        });
+        report(name, "deinterleave (2ch)", [&] {
+            k->deinterleave(floats.data(), out_planes, half);
+            clobber(more_floats.data());
+        });
+        report(name, "mix", [&] {
+            k->mix(floats.data(), 0.5f, more_floats.data(), n);
+            clobber(more_floats.data());
+        });
+    }
+}
+
+/* The conversions the audio service makes, from PipeWire's planar
+ * floats to what the encoders ask for...
+ */
+auto benchmark_converter() -> void
+{
+    std::size_t constexpr kChannels = 2;
+    auto const n = kSamples / kChannels;
+    std::vector<float> source(kSamples, 0.25f);
+    std::vector<std::int16_t> s16(kSamples);
+    std::vector<float> floats(kSamples);
+
+    std::array<std::uint8_t const*, kChannels> const from {
+        reinterpret_cast<std::uint8_t const*>(source.data()),
+        reinterpret_cast<std::uint8_t const*>(source.data() + n)
+    };
+    std::array<std::uint8_t*, 1> const to_s16 {
+        reinterpret_cast<std::uint8_t*>(s16.data())
+    };
+    std::array<std::uint8_t*, 1> const to_floats {
+        reinterpret_cast<std::uint8_t*>(floats.data())
+    };
+
+    for (auto const* k : sc::available_sample_kernels()) {
+        sc::SampleConverter s16_converter { sc::SampleFormat::float_planar,
+                                            sc::SampleFormat::s16_interleaved,
+                                            kChannels,
+                                            *k };
+        sc::SampleConverter flt_converter {
+            sc::SampleFormat::float_planar,
+            sc::SampleFormat::float_interleaved,
+            kChannels,
+            *k
+        };
+
+        auto const rate = report(k->name, "fltp -> s16", [&] {
+            s16_converter.convert(from, 0, to_s16, 0, n);
+            clobber(s16.data());
+        });
+        report(k->name, "fltp -> flt", [&] {
+            flt_converter.convert(from, 0, to_floats, 0, n);
+            clobber(floats.data());
+        });
+        EXPECT(rate > 0.0);
+    }
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(benchmark_kernels), TEST(benchmark_converter) });
+}
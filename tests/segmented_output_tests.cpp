@@ -0,0 +1,90 @@
+#include "services/segmented_output.hpp"
+#include "testing.hpp"
+#include <cstdint>
+
+namespace
+{
+
+std::int64_t constexpr kNsPerSecond = 1'000'000'000;
+std::int64_t constexpr kFrameTime = kNsPerSecond / 30;
+
+} // namespace
+
+auto should_end_segments_on_a_keyframe() -> void
+{
+    sc::SegmentTracker tracker { { .duration = 10 * kNsPerSecond,
+                                   .max_bytes = 0 } };
+
+    /* 30fps, with a keyframe every 4 seconds...
+     */
+    std::int64_t segment_start = 0;
+    std::size_t segments = 0;
+    for (std::int64_t frame = 0; frame < 30 * 60; ++frame) {
+        auto const keyframe = frame % 120 == 0;
+        if (!tracker.next(frame * kFrameTime, 1'000, keyframe))
+            continue;
+
+        EXPECT(keyframe);
+        EXPECT(frame * kFrameTime - segment_start >= 10 * kNsPerSecond);
+        EXPECT(frame * kFrameTime - segment_start < 14 * kNsPerSecond);
+        segment_start = frame * kFrameTime;
+        segments += 1;
+    }
+
+    EXPECT(segments == 4);
+}
+
+auto should_end_segments_by_size() -> void
+{
+    sc::SegmentTracker tracker { { .duration = 0, .max_bytes = 100'000 } };
+
+    std::size_t segments = 0;
+    for (std::int64_t frame = 0; frame < 1'000; ++frame) {
+        auto const keyframe = frame % 30 == 0;
+        if (tracker.next(frame * kFrameTime, 1'000, keyframe)) {
+            EXPECT(keyframe);
+            segments += 1;
+        }
+
+        /* A segment can only overrun its limit until the next
+         * keyframe...
+         */
+        EXPECT(tracker.size_bytes() < 100'000 + 30 * 1'000);
+    }
+
+    EXPECT(segments > 0);
+}
+
+auto should_never_end_a_segment_without_limits() -> void
+{
+    sc::SegmentTracker tracker { { .duration = 0, .max_bytes = 0 } };
+
+    for (std::int64_t frame = 0; frame < 1'000; ++frame)
+        EXPECT(!tracker.next(frame * kFrameTime, 1'000'000, true));
+
+    EXPECT(tracker.duration() == 999 * kFrameTime);
+}
+
+auto should_number_segments_from_a_pattern() -> void
+{
+    EXPECT(sc::segment_path("capture-%04d.mkv", 7) == "capture-0007.mkv");
+    EXPECT(sc::segment_path("/tmp/%d/capture.mp4", 12) ==
+           "/tmp/12/capture.mp4");
+    EXPECT(sc::segment_path("100%%-%02d.mkv", 123) == "100%-123.mkv");
+}
+
+auto should_number_segments_without_a_pattern() -> void
+{
+    EXPECT(sc::segment_path("/tmp/capture.mkv", 3) ==
+           "/tmp/capture-0003.mkv");
+    EXPECT(sc::segment_path("capture%s.mkv", 0) == "capture%s-0000.mkv");
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_end_segments_on_a_keyframe),
+                          TEST(should_end_segments_by_size),
+                          TEST(should_never_end_a_segment_without_limits),
+                          TEST(should_number_segments_from_a_pattern),
+                          TEST(should_number_segments_without_a_pattern) });
+}
@@ -0,0 +1,100 @@
+#include "av/codec.hpp"
+#include "av/frame_converter.hpp"
+#include "av/packet.hpp"
+#include "testing.hpp"
+#include "utils/frame_time.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+namespace
+{
+
+sc::VideoOutputSize constexpr kSize { .width = 64, .height = 64 };
+
+/* Encodes `num_frames` captured frames, each a different shade of
+ * grey, then flushes the encoder. Returns how many packets it gave
+ * back, and how many of those were keyframes...
+ */
+auto encode(AVCodecContext& codec, std::size_t num_frames)
+    -> std::pair<std::size_t, std::size_t>
+{
+    sc::FrameConverter converter { kSize, AV_PIX_FMT_BGR0, codec.pix_fmt };
+    sc::PacketPtr packet { av_packet_alloc() };
+    std::size_t packets = 0;
+    std::size_t keyframes = 0;
+
+    auto const receive = [&] {
+        while (avcodec_receive_packet(&codec, packet.get()) == 0) {
+            EXPECT(packet->size > 0);
+            packets += 1;
+            keyframes += (packet->flags & AV_PKT_FLAG_KEY) ? 1 : 0;
+            av_packet_unref(packet.get());
+        }
+    };
+
+    for (std::size_t i = 0; i < num_frames; ++i) {
+        sc::FramePtr frame { av_frame_alloc() };
+        auto const dest = converter.prepare(*frame);
+        for (std::size_t y = 0; y < kSize.height; ++y)
+            for (std::size_t x = 0; x < kSize.width * 4; ++x)
+                dest.data[y * dest.pitch + x] =
+                    static_cast<std::uint8_t>(i * 32 + x / 4);
+
+        converter.convert(*frame);
+        frame->pts = static_cast<std::int64_t>(i);
+        EXPECT(avcodec_send_frame(&codec, frame.get()) == 0);
+        receive();
+    }
+
+    EXPECT(avcodec_send_frame(&codec, nullptr) == 0);
+    receive();
+    return { packets, keyframes };
+}
+
+} // namespace
+
+auto should_encode_ffv1_from_system_memory() -> void
+{
+    auto codec = sc::create_software_video_encoder(
+        "ffv1", kSize, sc::from_fps(30), AV_PIX_FMT_BGR0, 4);
+
+    /* FFV1 takes the captured frames as they are, and every frame it
+     * encodes is a keyframe...
+     */
+    EXPECT(codec->pix_fmt == AV_PIX_FMT_BGR0);
+
+    auto const [packets, keyframes] = encode(*codec, 5);
+    EXPECT(packets == 5);
+    EXPECT(keyframes == 5);
+}
+
+auto should_encode_x264_from_system_memory() -> void
+{
+    /* x264 is an optional dependency of FFmpeg...
+     */
+    if (!avcodec_find_encoder_by_name("libx264"))
+        return;
+
+    auto codec = sc::create_software_video_encoder(
+        "libx264", kSize, sc::from_fps(30), AV_PIX_FMT_BGR0, 2);
+
+    /* libx264 has no packed RGB input, so frames are converted to
+     * 4:2:0...
+     */
+    EXPECT(codec->pix_fmt == AV_PIX_FMT_YUV420P);
+
+    auto const [packets, keyframes] = encode(*codec, 10);
+    EXPECT(packets == 10);
+    EXPECT(keyframes >= 1);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_encode_ffv1_from_system_memory),
+                          TEST(should_encode_x264_from_system_memory) });
+}
@@ -0,0 +1,326 @@
+#include "services/context.hpp"
+#include "services/readiness.hpp"
+#include "services/service.hpp"
+#include "services/task.hpp"
+#include "testing.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/* Counts every heap allocation made by the process...
+ */
+namespace
+{
+std::atomic<std::size_t> num_allocations { 0 };
+}
+
+auto operator new(std::size_t size) -> void*
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* ptr = std::malloc(size ? size : 1); ptr)
+        return ptr;
+
+    throw std::bad_alloc {};
+}
+
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+
+auto operator delete(void* ptr, std::size_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+namespace
+{
+
+/* Runs a single task, spawned from `on_init()`, and keeps the
+ * context running until it's stopped...
+ */
+struct TaskService final : sc::Service
+{
+    using Factory = auto(*)(TaskService&) -> sc::Task;
+
+    TaskService(sc::Context& context, Factory factory) noexcept
+        : ctx { context }
+        , factory_ { factory }
+    {
+    }
+
+    sc::Context& ctx;
+    std::optional<sc::ReadinessRegister> reg;
+    std::vector<std::uint64_t> timestamps;
+    int event_fd { -1 };
+    std::thread::id thread;
+    bool finished { false };
+
+protected:
+    auto on_init(sc::ReadinessRegister r) -> void override
+    {
+        reg.emplace(r);
+        r.spawn(factory_(*this));
+    }
+
+private:
+    Factory factory_;
+};
+
+/* Does nothing but keep its context running...
+ */
+struct IdleService final : sc::Service
+{
+    explicit IdleService() noexcept
+    {
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK);
+    }
+
+    ~IdleService() { ::close(event_fd_); }
+
+protected:
+    auto on_init(sc::ReadinessRegister r) -> void override
+    {
+        r(event_fd_, &dispatch);
+    }
+
+private:
+    static auto dispatch(sc::Service&) -> void {}
+
+    int event_fd_;
+};
+
+struct DestructionFlag
+{
+    ~DestructionFlag() { *flag = true; }
+    bool* flag;
+};
+
+auto count_frames(TaskService& svc) -> sc::Task
+{
+    for (auto i = 0; i < 5; ++i) {
+        co_await sc::next_frame();
+        svc.timestamps.push_back(svc.reg->clock().now());
+    }
+
+    svc.finished = true;
+    svc.ctx.request_stop();
+}
+
+auto count_half_frames(TaskService& svc) -> sc::Task
+{
+    for (auto i = 0; i < 4; ++i) {
+        co_await sc::next_frame(sc::FrameTimeRatio(1, 2));
+        svc.timestamps.push_back(svc.reg->clock().now());
+    }
+
+    svc.ctx.request_stop();
+}
+
+auto wait_for_event(TaskService& svc) -> sc::Task
+{
+    svc.event_fd = ::eventfd(0, EFD_NONBLOCK);
+    EXPECT(svc.event_fd >= 0);
+
+    co_await sc::next_frame();
+
+    std::uint64_t val { 1 };
+    EXPECT(::write(svc.event_fd, &val, sizeof(val)) ==
+           static_cast<ssize_t>(sizeof(val)));
+
+    co_await sc::readable(svc.event_fd);
+    EXPECT(::read(svc.event_fd, &val, sizeof(val)) ==
+           static_cast<ssize_t>(sizeof(val)));
+
+    /* The handle can be awaited again...
+     */
+    EXPECT(::write(svc.event_fd, &val, sizeof(val)) ==
+           static_cast<ssize_t>(sizeof(val)));
+    co_await sc::readable(svc.event_fd);
+
+    ::close(svc.event_fd);
+    svc.finished = true;
+    svc.ctx.request_stop();
+}
+
+auto throw_on_first_frame(TaskService&) -> sc::Task
+{
+    co_await sc::next_frame();
+    throw std::runtime_error { "Task failed" };
+}
+
+bool never_ready_task_destroyed = false;
+
+auto wait_forever(TaskService& svc) -> sc::Task
+{
+    DestructionFlag flag { &never_ready_task_destroyed };
+    svc.event_fd = ::eventfd(0, EFD_NONBLOCK);
+
+    co_await sc::next_frame();
+    svc.ctx.request_stop();
+    co_await sc::readable(svc.event_fd);
+
+    svc.finished = true;
+}
+
+sc::Context* other_context = nullptr;
+
+auto hand_off(TaskService& svc) -> sc::Task
+{
+    co_await sc::next_frame();
+    co_await sc::resume_on(*other_context);
+    svc.thread = std::this_thread::get_id();
+    other_context->request_stop();
+
+    co_await sc::resume_on(svc.ctx);
+    svc.finished = true;
+    svc.ctx.request_stop();
+}
+
+std::size_t steady_state_allocations = 0;
+
+auto child(std::uint64_t& counter) -> sc::Task
+{
+    counter += 1;
+    co_return;
+}
+
+auto spawn_children(TaskService& svc) -> sc::Task
+{
+    std::uint64_t counter { 0 };
+    std::size_t allocations { 0 };
+    std::uint64_t val { 1 };
+    svc.event_fd = ::eventfd(0, EFD_NONBLOCK);
+
+    for (auto i = 0; i < 200; ++i) {
+        /* Let the pools and buffers warm up first...
+         */
+        if (i == 100)
+            allocations = num_allocations.load();
+
+        svc.reg->spawn(child(counter));
+        co_await sc::next_frame();
+
+        static_cast<void>(::write(svc.event_fd, &val, sizeof(val)));
+        co_await sc::readable(svc.event_fd);
+        static_cast<void>(::read(svc.event_fd, &val, sizeof(val)));
+    }
+
+    steady_state_allocations = num_allocations.load() - allocations;
+    EXPECT(counter >= 199);
+
+    ::close(svc.event_fd);
+    svc.finished = true;
+    svc.ctx.request_stop();
+}
+
+auto run_task(sc::Context& ctx, TaskService::Factory factory) -> TaskService&
+{
+    ctx.services().add_from_factory<TaskService>(
+        [&] { return std::make_unique<TaskService>(ctx, factory); });
+
+    ctx.run();
+    return *ctx.services().use_if<TaskService>();
+}
+
+} // namespace
+
+auto should_resume_on_each_frame() -> void
+{
+    sc::VirtualClock clock;
+    sc::Context ctx { 60 };
+    ctx.set_clock(clock);
+
+    auto const& svc = run_task(ctx, &count_frames);
+    EXPECT(svc.finished);
+
+    /* Each await resumes on the next tick of the context's
+     * timeline...
+     */
+    EXPECT(svc.timestamps.size() == 5);
+    for (std::size_t i = 0; i < svc.timestamps.size(); ++i)
+        EXPECT(svc.timestamps[i] == ((i + 1) * 1'000'000'000) / 60);
+}
+
+auto should_resume_on_fractional_frames() -> void
+{
+    sc::VirtualClock clock;
+    sc::Context ctx { 50 };
+    ctx.set_clock(clock);
+
+    auto const& svc = run_task(ctx, &count_half_frames);
+    EXPECT(svc.timestamps.size() == 4);
+    for (std::size_t i = 0; i < svc.timestamps.size(); ++i)
+        EXPECT(svc.timestamps[i] == (i + 1) * 10'000'000);
+}
+
+auto should_resume_when_readable() -> void
+{
+    sc::Context ctx { 1'000 };
+    EXPECT(run_task(ctx, &wait_for_event).finished);
+}
+
+auto should_resume_when_readable_with_io_uring() -> void
+{
+    sc::Context ctx { 1'000 };
+    ctx.set_backend(sc::ReactorBackendType::io_uring);
+    EXPECT(run_task(ctx, &wait_for_event).finished);
+}
+
+auto should_rethrow_task_exceptions() -> void
+{
+    sc::Context ctx { 1'000 };
+    EXPECT_THROWS(run_task(ctx, &throw_on_first_frame));
+}
+
+auto should_destroy_suspended_tasks() -> void
+{
+    sc::Context ctx { 1'000 };
+    auto const& svc = run_task(ctx, &wait_forever);
+    ::close(svc.event_fd);
+
+    EXPECT(!svc.finished);
+    EXPECT(never_ready_task_destroyed);
+}
+
+auto should_resume_on_another_context() -> void
+{
+    sc::Context ctx { 1'000 };
+    sc::Context other { 1'000 };
+    other_context = &other;
+    other.services().add_from_factory<IdleService>(
+        [] { return std::make_unique<IdleService>(); });
+
+    auto other_thread = std::thread { [&] { other.run(); } };
+    auto const main_thread = std::this_thread::get_id();
+
+    auto const& svc = run_task(ctx, &hand_off);
+    other_thread.join();
+
+    EXPECT(svc.finished);
+    EXPECT(svc.thread != main_thread);
+}
+
+auto should_not_allocate_in_steady_state() -> void
+{
+    sc::Context ctx { 1'000 };
+    EXPECT(run_task(ctx, &spawn_children).finished);
+    EXPECT(steady_state_allocations == 0);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_resume_on_each_frame),
+                          TEST(should_resume_on_fractional_frames),
+                          TEST(should_resume_when_readable),
+                          TEST(should_resume_when_readable_with_io_uring),
+                          TEST(should_rethrow_task_exceptions),
+                          TEST(should_destroy_suspended_tasks),
+                          TEST(should_resume_on_another_context),
+                          TEST(should_not_allocate_in_steady_state) });
+}
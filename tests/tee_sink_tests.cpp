@@ -0,0 +1,197 @@
+#include "services/tee_sink.hpp"
+#include "testing.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <new>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+
+/* A source with a single video stream, whose packets the sink can
+ * mux without any particular bitstream...
+ */
+auto make_source() -> sc::FormatContextPtr
+{
+    AVFormatContext* fc_tmp;
+    if (avformat_alloc_output_context2(&fc_tmp, nullptr, "mpegts", nullptr) <
+        0)
+        throw std::bad_alloc {};
+
+    sc::FormatContextPtr source { fc_tmp };
+    auto* stream = avformat_new_stream(fc_tmp, nullptr);
+    if (!stream)
+        throw std::bad_alloc {};
+
+    stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    stream->codecpar->codec_id = AV_CODEC_ID_MPEG2VIDEO;
+    stream->codecpar->width = 64;
+    stream->codecpar->height = 64;
+    stream->time_base = AVRational { 1, 90'000 };
+    return source;
+}
+
+/* A packet of encoded video, of a typical size...
+ */
+auto make_packet(std::int64_t ts, bool keyframe) -> sc::PacketPtr
+{
+    return testing::make_packet(ts, 1'000, keyframe);
+}
+
+} // namespace
+
+auto should_disconnect_if_the_output_cannot_be_opened() -> void
+{
+    AVFormatContext source {};
+    AVCodecParameters params {};
+    params.codec_type = AVMEDIA_TYPE_VIDEO;
+    AVStream stream {};
+    stream.codecpar = &params;
+
+    sc::TeeSink sink { "/nonexistent/directory/output.ts", source };
+
+    /* Pushing never waits for the output, whatever state it's in...
+     */
+    auto const start = std::chrono::steady_clock::now();
+    for (std::int64_t i = 0; i < 10'000; ++i) {
+        auto packet = make_packet(i, i % 30 == 0);
+        sink.push(*packet, stream, AVRational { 1, 30 });
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT(elapsed < std::chrono::seconds { 2 });
+
+    sink.close();
+
+    auto const metrics = sink.metrics();
+    EXPECT(metrics.disconnected);
+    EXPECT(metrics.written == 0);
+    EXPECT(metrics.dropped == 10'000);
+}
+
+auto should_drop_packets_until_a_keyframe() -> void
+{
+    testing::TempFile output { "keyframe.ts" };
+    auto source = make_source();
+    auto const& stream = *source->streams[0];
+
+    sc::TeeSink sink { output.path.string(), *source };
+
+    /* A sink starts with a keyframe. Everything from the first one
+     * on is written, keyframe or not...
+     */
+    for (std::int64_t i = 0; i < 10; ++i) {
+        auto packet = make_packet(i, i == 5);
+        sink.push(*packet, stream, AVRational { 1, 30 });
+    }
+
+    sink.close();
+
+    auto const metrics = sink.metrics();
+    EXPECT(!metrics.disconnected);
+    EXPECT(metrics.dropped == 5);
+    EXPECT(metrics.written == 5);
+    EXPECT(std::filesystem::file_size(output.path) > 0);
+}
+
+auto should_disconnect_a_stalled_output_without_blocking() -> void
+{
+    /* Opening a FIFO for writing blocks until it has a reader, so the
+     * sink's thread is stuck before it writes anything...
+     */
+    testing::TempFile output { "stalled.ts" };
+    EXPECT(::mkfifo(output.path.c_str(), 0600) == 0);
+    auto source = make_source();
+    auto const& stream = *source->streams[0];
+
+    auto constexpr kStallTimeout = std::chrono::milliseconds { 50 };
+    sc::TeeSink sink { output.path.string(),
+                       *source,
+                       sc::TeeSinkOptions { .max_packets = 4,
+                                            .stall_timeout = kStallTimeout } };
+
+    auto const start = std::chrono::steady_clock::now();
+    for (std::int64_t i = 0; i < 20; ++i) {
+        auto packet = make_packet(i, i % 5 == 0);
+        sink.push(*packet, stream, AVRational { 1, 30 });
+    }
+
+    EXPECT(!sink.metrics().disconnected);
+    EXPECT(sink.metrics().dropped == 16);
+
+    /* Once the queue has been full for longer than the stall timeout,
+     * the next packet disconnects the sink...
+     */
+    std::this_thread::sleep_for(kStallTimeout * 2);
+    auto packet = make_packet(20, true);
+    sink.push(*packet, stream, AVRational { 1, 30 });
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT(elapsed < std::chrono::seconds { 1 });
+
+    auto const metrics = sink.metrics();
+    EXPECT(metrics.disconnected);
+    EXPECT(metrics.written == 0);
+    EXPECT(metrics.dropped == 21);
+
+    /* Giving the FIFO a reader releases the sink's thread, which
+     * then gives up, since the sink has been disconnected...
+     */
+    auto const reader = ::open(output.path.c_str(), O_RDONLY | O_NONBLOCK);
+    EXPECT(reader >= 0);
+    sink.close();
+    ::close(reader);
+}
+
+auto should_give_up_on_a_stuck_output_when_closing() -> void
+{
+    /* Nothing reads from the FIFO, so the sink's thread is stuck
+     * opening it, where the interrupt callback can't reach it...
+     */
+    testing::TempFile output { "stuck.ts" };
+    EXPECT(::mkfifo(output.path.c_str(), 0600) == 0);
+    auto source = make_source();
+    auto const& stream = *source->streams[0];
+
+    auto constexpr kCloseTimeout = std::chrono::milliseconds { 100 };
+    sc::TeeSink sink { output.path.string(),
+                       *source,
+                       sc::TeeSinkOptions { .close_timeout = kCloseTimeout } };
+
+    for (std::int64_t i = 0; i < 10; ++i) {
+        auto packet = make_packet(i, i % 5 == 0);
+        sink.push(*packet, stream, AVRational { 1, 30 });
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    sink.close();
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT(elapsed >= kCloseTimeout);
+    EXPECT(elapsed < std::chrono::seconds { 2 });
+
+    auto const metrics = sink.metrics();
+    EXPECT(metrics.disconnected);
+    EXPECT(metrics.written == 0);
+    EXPECT(metrics.dropped == 10);
+
+    /* Giving the FIFO a reader releases the abandoned thread, which
+     * closes its end once it sees it's been disconnected...
+     */
+    auto const reader = ::open(output.path.c_str(), O_RDONLY);
+    EXPECT(reader >= 0);
+    char buffer[4'096];
+    while (::read(reader, buffer, sizeof(buffer)) > 0)
+        ;
+
+    ::close(reader);
+}
+
+auto main() -> int
+{
+    return testing::run(
+        { TEST(should_disconnect_if_the_output_cannot_be_opened),
+          TEST(should_drop_packets_until_a_keyframe),
+          TEST(should_disconnect_a_stalled_output_without_blocking),
+          TEST(should_give_up_on_a_stuck_output_when_closing) });
+}
@@ -1,6 +1,12 @@
 #include "./testing.hpp"
 #include <cstddef>
 #include <iostream>
+#include <new>
+#include <string>
+#include <unistd.h>
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
 
 namespace testing
 {
@@ -62,4 +68,28 @@ auto run_with_context(int argc,
     return passed == tests.size() ? 0 : 1;
 }
 
+TempFile::TempFile(std::string_view name)
+    : path { std::filesystem::temp_directory_path() /
+             ("shadow_cast_" + std::to_string(::getpid()) + "_" +
+              std::string { name }) }
+{
+}
+
+TempFile::~TempFile()
+{
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+auto make_packet(std::int64_t ts, int size, bool keyframe) -> sc::PacketPtr
+{
+    sc::PacketPtr packet { av_packet_alloc() };
+    if (!packet || av_new_packet(packet.get(), size) < 0)
+        throw std::bad_alloc {};
+
+    packet->pts = packet->dts = ts;
+    packet->flags = keyframe ? AV_PKT_FLAG_KEY : 0;
+    return packet;
+}
+
 } // namespace testing
@@ -1,8 +1,12 @@
 #ifndef RGBCTL_TESTING_HPP_INCLUDED
 #define RGBCTL_TESTING_HPP_INCLUDED
 
+#include "av/packet.hpp"
+#include <cstdint>
+#include <filesystem>
 #include <initializer_list>
 #include <stdexcept>
+#include <string_view>
 #include <tuple>
 
 #define STRINGIFY_IMPL(x) #x
@@ -61,6 +65,25 @@ run_with_context(int, char const**, std::initializer_list<TestWithContext>)
     -> int;
 [[nodiscard]] auto run(std::initializer_list<Test>) -> int;
 
+/* A path in the temporary directory, unique to the test process and
+ * `name`, that's removed, if it was created, once the test is done...
+ */
+struct TempFile
+{
+    explicit TempFile(std::string_view name);
+    ~TempFile();
+
+    TempFile(TempFile const&) = delete;
+    auto operator=(TempFile const&) -> TempFile& = delete;
+
+    std::filesystem::path path;
+};
+
+/* A packet of `size` bytes, whose timestamps are both `ts`...
+ */
+[[nodiscard]] auto make_packet(std::int64_t ts, int size, bool keyframe)
+    -> sc::PacketPtr;
+
 } // namespace testing
 
 #endif // RGBCTL_TESTING_HPP_INCLUDED
@@ -0,0 +1,123 @@
+#include "testing.hpp"
+#include "utils/thread_policy.hpp"
+#include <sched.h>
+#include <vector>
+
+namespace
+{
+
+auto current_affinity() -> std::vector<int>
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    static_cast<void>(::sched_getaffinity(0, sizeof(set), &set));
+
+    std::vector<int> cpus;
+    for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+} // namespace
+
+auto should_parse_cpu_lists() -> void
+{
+    auto const cpus = sc::parse_cpu_list("4-6,0,5");
+    EXPECT(cpus);
+    EXPECT((*cpus == std::vector<int> { 0, 4, 5, 6 }));
+
+    EXPECT(!sc::parse_cpu_list(""));
+    EXPECT(!sc::parse_cpu_list("1,"));
+    EXPECT(!sc::parse_cpu_list("3-1"));
+    EXPECT(!sc::parse_cpu_list("a"));
+    EXPECT(!sc::parse_cpu_list("-1"));
+}
+
+auto should_parse_thread_affinity() -> void
+{
+    sc::ThreadTopology topology;
+    EXPECT(sc::parse_thread_affinity("video=2:encoder=4-5", topology));
+    EXPECT((topology.video.cpus == std::vector<int> { 2 }));
+    EXPECT(topology.audio.cpus.empty());
+    EXPECT((topology.encoder.cpus == std::vector<int> { 4, 5 }));
+}
+
+auto should_reject_invalid_thread_affinity() -> void
+{
+    sc::ThreadTopology topology;
+    topology.audio.cpus = { 1 };
+
+    EXPECT(!sc::parse_thread_affinity("audio=2:capture=3", topology));
+    EXPECT(!sc::parse_thread_affinity("audio", topology));
+    EXPECT(!sc::parse_thread_affinity("audio=", topology));
+
+    /* A failed parse leaves the topology untouched...
+     */
+    EXPECT((topology.audio.cpus == std::vector<int> { 1 }));
+}
+
+auto should_apply_and_restore_affinity() -> void
+{
+    auto const original = current_affinity();
+    EXPECT(original.size());
+
+    {
+        sc::ThreadPolicyGuard guard { sc::ThreadPolicy {
+            .cpus = { original.back() } } };
+        EXPECT((current_affinity() == std::vector<int> { original.back() }));
+        EXPECT(::sched_getcpu() == original.back());
+    }
+
+    EXPECT(current_affinity() == original);
+}
+
+auto should_fail_to_apply_invalid_affinity() -> void
+{
+    EXPECT_THROWS(sc::ThreadPolicyGuard { sc::ThreadPolicy {
+        .cpus = { CPU_SETSIZE - 1 } } });
+}
+
+/* Whether or not realtime scheduling is permitted here, applying
+ * it mustn't fail, and the original policy must be restored...
+ */
+auto should_restore_scheduling_policy() -> void
+{
+    auto const original = ::sched_getscheduler(0);
+
+    {
+        sc::ThreadPolicyGuard guard { sc::ThreadPolicy {
+            .scheduling = sc::SchedulingPolicy::round_robin,
+            .priority = 1,
+            .prefault_stack = 64 * 1'024 } };
+    }
+
+    EXPECT(::sched_getscheduler(0) == original);
+}
+
+auto should_share_cpus_between_encoders() -> void
+{
+    sc::ThreadTopology topology;
+    topology.encoder.cpus = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    EXPECT(sc::encoder_thread_budget(topology, 1) == 8);
+    EXPECT(sc::encoder_thread_budget(topology, 3) == 2);
+    EXPECT(sc::encoder_thread_budget(topology, 16) == 1);
+
+    topology.encoder.cpus.clear();
+    auto const budget = sc::encoder_thread_budget(topology, 1);
+    EXPECT(budget >= 1 && budget <= 16);
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_parse_cpu_lists),
+                          TEST(should_parse_thread_affinity),
+                          TEST(should_reject_invalid_thread_affinity),
+                          TEST(should_apply_and_restore_affinity),
+                          TEST(should_fail_to_apply_invalid_affinity),
+                          TEST(should_restore_scheduling_policy),
+                          TEST(should_share_cpus_between_encoders) });
+}
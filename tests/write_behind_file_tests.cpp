@@ -0,0 +1,173 @@
+#include "io/write_behind_file.hpp"
+#include "testing.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+
+std::size_t constexpr kMiB = 1'024 * 1'024;
+
+auto make_data(std::size_t size) -> std::vector<std::uint8_t>
+{
+    std::vector<std::uint8_t> data(size);
+    for (std::size_t i = 0; i < size; ++i)
+        data[i] = static_cast<std::uint8_t>((i * 31) ^ (i >> 12));
+
+    return data;
+}
+
+auto read_file(std::filesystem::path const& path) -> std::vector<std::uint8_t>
+{
+    std::ifstream input { path, std::ios::binary };
+    return { std::istreambuf_iterator<char> { input },
+             std::istreambuf_iterator<char> {} };
+}
+
+auto write_in_chunks(sc::WriteBehindFile& file,
+                     std::vector<std::uint8_t> const& data,
+                     std::size_t chunk_size) -> void
+{
+    auto remaining = std::span<std::uint8_t const> { data };
+    while (remaining.size()) {
+        auto const n = std::min(chunk_size, remaining.size());
+        file.write(remaining.first(n));
+        remaining = remaining.subspan(n);
+    }
+}
+
+} // namespace
+
+auto should_write_sequentially() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto const data = make_data(5 * kMiB + 123);
+
+    sc::WriteBehindFile file { tmp.path };
+    write_in_chunks(file, data, 32'768);
+    EXPECT(file.size() == static_cast<std::int64_t>(data.size()));
+    file.close();
+
+    EXPECT(read_file(tmp.path) == data);
+
+    auto const metrics = file.metrics();
+    EXPECT(metrics.bytes_written == data.size());
+    EXPECT(metrics.writes > 0);
+}
+
+auto should_wrap_around_the_buffer() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto const data = make_data(20 * kMiB + 7);
+
+    sc::WriteBehindFile file { tmp.path,
+                               sc::WriteBehindOptions { .buffer_size = 0 } };
+    write_in_chunks(file, data, 300'001);
+    file.close();
+
+    EXPECT(read_file(tmp.path) == data);
+
+    /* The buffer is never smaller than two writes, and never holds
+     * more than it can fit...
+     */
+    auto const metrics = file.metrics();
+    EXPECT(metrics.high_water <= 2 * kMiB);
+    EXPECT(metrics.bytes_written == data.size());
+}
+
+auto should_patch_earlier_bytes() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto expected = make_data(3 * kMiB);
+    std::uint8_t const patch[] = { 'a', 'b', 'c', 'd' };
+
+    sc::WriteBehindFile file { tmp.path };
+    write_in_chunks(file, expected, 65'536);
+
+    EXPECT(file.seek(16, SEEK_SET) == 16);
+    file.write(patch);
+    EXPECT(file.seek(0, SEEK_END) == static_cast<std::int64_t>(3 * kMiB));
+    file.write(patch);
+    file.close();
+
+    std::copy(std::begin(patch), std::end(patch), expected.begin() + 16);
+    expected.insert(expected.end(), std::begin(patch), std::end(patch));
+    EXPECT(read_file(tmp.path) == expected);
+}
+
+auto should_write_across_the_end_of_the_file() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto expected = make_data(kMiB);
+    auto const tail = make_data(100);
+
+    sc::WriteBehindFile file { tmp.path };
+    write_in_chunks(file, expected, 4'096);
+    EXPECT(file.seek(-50, SEEK_CUR) == static_cast<std::int64_t>(kMiB - 50));
+    file.write(tail);
+    file.close();
+
+    expected.resize(kMiB - 50);
+    expected.insert(expected.end(), tail.begin(), tail.end());
+    EXPECT(read_file(tmp.path) == expected);
+}
+
+auto should_write_with_direct_io() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto const data = make_data(9 * kMiB + 4'097);
+
+    /* Falls back to buffered writes if the file system doesn't
+     * support O_DIRECT, so the contents should be the same either
+     * way...
+     */
+    sc::WriteBehindFile file { tmp.path,
+                               sc::WriteBehindOptions { .direct_io = true } };
+    write_in_chunks(file, data, 200'000);
+
+    std::uint8_t const patch[] = { 1, 2, 3 };
+    file.seek(4'095, SEEK_SET);
+    file.write(patch);
+    file.seek(0, SEEK_END);
+    write_in_chunks(file, data, 123'456);
+    file.close();
+
+    auto expected = data;
+    std::copy(std::begin(patch), std::end(patch), expected.begin() + 4'095);
+    expected.insert(expected.end(), data.begin(), data.end());
+    EXPECT(read_file(tmp.path) == expected);
+}
+
+auto should_not_keep_preallocated_space() -> void
+{
+    testing::TempFile tmp { "write_behind" };
+    auto const data = make_data(kMiB + 1);
+
+    sc::WriteBehindFile file {
+        tmp.path, sc::WriteBehindOptions { .preallocate = 64 * kMiB }
+    };
+    write_in_chunks(file, data, 65'536);
+    file.close();
+
+    EXPECT(std::filesystem::file_size(tmp.path) == data.size());
+}
+
+auto should_throw_if_the_file_cannot_be_opened() -> void
+{
+    EXPECT_THROWS(sc::WriteBehindFile { "/nonexistent/directory/output" });
+}
+
+auto main() -> int
+{
+    return testing::run({ TEST(should_write_sequentially),
+                          TEST(should_wrap_around_the_buffer),
+                          TEST(should_patch_earlier_bytes),
+                          TEST(should_write_across_the_end_of_the_file),
+                          TEST(should_write_with_direct_io),
+                          TEST(should_not_keep_preallocated_space),
+                          TEST(should_throw_if_the_file_cannot_be_opened) });
+}